@@ -45,6 +45,7 @@
 #include "theme.h"
 #include "netrcparser.h"
 #include "libsync/logger.h"
+#include "libsync/tracelog.h"
 
 #include "config.h"
 
@@ -84,6 +85,7 @@ struct CmdOptions
     int uplimit;
     bool deltasync;
     quint64 deltasyncminfilesize;
+    QString metricsFile;
 };
 
 // we can't use csync_set_userdata because the SyncEngine sets it already.
@@ -200,6 +202,8 @@ void help()
     std::cout << "  -h                     Sync hidden files,do not ignore them" << std::endl;
     std::cout << "  --version, -v          Display version and exit" << std::endl;
     std::cout << "  --logdebug             More verbose logging" << std::endl;
+    std::cout << "  --tracefile [file]     Write a binary trace log to [file], convert with " APPLICATION_EXECUTABLE "tracedump" << std::endl;
+    std::cout << "  --metrics [file]       Write the metrics of the sync run to [file] as JSON" << std::endl;
     std::cout << "" << std::endl;
     exit(0);
 }
@@ -284,6 +288,15 @@ void parseOptions(const QStringList &app_args, CmdOptions *options)
         } else if (option == "--logdebug") {
             Logger::instance()->setLogFile("-");
             Logger::instance()->setLogDebug(true);
+        } else if (option == "--tracefile" && !it.peekNext().startsWith("-")) {
+            const QString traceFile = it.next();
+            if (!TraceLog::instance()->start(traceFile)) {
+                std::cerr << "Could not open trace file '" << qPrintable(traceFile) << "'" << std::endl;
+                exit(1);
+            }
+            Logger::instance()->setTraceDebug(true);
+        } else if (option == "--metrics" && !it.peekNext().startsWith("-")) {
+            options->metricsFile = it.next();
         } else {
             help();
         }
@@ -576,6 +589,10 @@ restart_sync:
 
     int resultCode = app.exec();
 
+    if (!options.metricsFile.isEmpty() && !engine.metrics().writeJson(options.metricsFile)) {
+        std::cerr << "Could not write metrics to '" << qPrintable(options.metricsFile) << "'" << std::endl;
+    }
+
     if (engine.isAnotherSyncNeeded() != NoFollowUpSync) {
         if (restartCount < options.restartTimes) {
             restartCount++;
@@ -585,5 +602,7 @@ restart_sync:
         qWarning() << "Another sync is needed, but not done because restart count is exceeded" << restartCount;
     }
 
+    TraceLog::instance()->stop();
+
     return resultCode;
 }
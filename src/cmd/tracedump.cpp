@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+/*
+ * Offline converter for the binary trace logs written with --tracefile.
+ */
+
+#include <iostream>
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+
+#include "libsync/tracelog.h"
+#include "config.h"
+
+using namespace OCC;
+
+static void help()
+{
+    const char *binaryName = APPLICATION_EXECUTABLE "tracedump";
+
+    std::cout << binaryName << " - convert " APPLICATION_NAME " trace logs" << std::endl;
+    std::cout << "" << std::endl;
+    std::cout << "Usage: " << binaryName << " [OPTION] <tracefile>" << std::endl;
+    std::cout << "" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --json                 Output one JSON object per line (JSONL)" << std::endl;
+    std::cout << "  --events               Only output structured events, no log messages" << std::endl;
+    std::cout << "" << std::endl;
+    exit(0);
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    bool json = false;
+    bool eventsOnly = false;
+    QString fileName;
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+    foreach (const QString &option, args) {
+        if (option == "--json") {
+            json = true;
+        } else if (option == "--events") {
+            eventsOnly = true;
+        } else if (!option.startsWith("-") && fileName.isEmpty()) {
+            fileName = option;
+        } else {
+            help();
+        }
+    }
+    if (fileName.isEmpty())
+        help();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::cerr << "Could not open '" << qPrintable(fileName) << "'" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bool ok = readTraceLog(&file, [&](const TraceRecord &record) {
+        if (eventsOnly && record._kind != TraceRecord::Event)
+            return;
+        if (json) {
+            std::cout << record.toJson().constData() << "\n";
+        } else {
+            std::cout << qUtf8Printable(record.toText()) << "\n";
+        }
+    });
+    std::cout.flush();
+
+    if (!ok) {
+        std::cerr << "'" << qPrintable(fileName) << "' is not a trace log or is truncated" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
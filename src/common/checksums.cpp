@@ -89,19 +89,38 @@ Q_LOGGING_CATEGORY(lcChecksums, "sync.checksums", QtInfoMsg)
 
 #define BUFSIZE qint64(500 * 1024) // 500 KiB
 
-static QByteArray calcCryptoHash( const QString& filename, QCryptographicHash::Algorithm algo )
+// Reads the whole file and passes it to addData in blocks. Only the bytes
+// actually read are added to byteCounter. Gives up if abort becomes true.
+template <typename AddData>
+static bool readBlocks(QFile &file, const ChecksumByteCounter &byteCounter, const std::atomic<bool> *abort,
+    AddData addData)
 {
-     QFile file(filename);
-     QByteArray arr;
-     QCryptographicHash crypto( algo );
-
-     if (file.open(QIODevice::ReadOnly)) {
-         if (crypto.addData(&file)) {
-             arr = crypto.result().toHex();
-         }
-     }
-     return arr;
- }
+    QByteArray buf(int(qMin(BUFSIZE, file.size() + 1)), Qt::Uninitialized);
+    while (true) {
+        if (abort && abort->load())
+            return false;
+        const qint64 size = file.read(buf.data(), buf.size());
+        if (size < 0)
+            return false;
+        if (size == 0)
+            return true;
+        addData(buf.constData(), size);
+        if (byteCounter)
+            *byteCounter += quint64(size);
+    }
+}
+
+static QByteArray calcCryptoHash(const QString &filename, QCryptographicHash::Algorithm algo,
+    const ChecksumByteCounter &byteCounter = ChecksumByteCounter(), const std::atomic<bool> *abort = nullptr)
+{
+    QFile file(filename);
+    QCryptographicHash crypto(algo);
+    if (file.open(QIODevice::ReadOnly)
+        && readBlocks(file, byteCounter, abort, [&crypto](const char *data, qint64 size) { crypto.addData(data, int(size)); })) {
+        return crypto.result().toHex();
+    }
+    return QByteArray();
+}
 
 QByteArray calcMd5(const QString &filename)
 {
@@ -114,24 +133,26 @@ QByteArray calcSha1(const QString &filename)
 }
 
 #ifdef ZLIB_FOUND
-QByteArray calcAdler32(const QString &filename)
+static QByteArray calcAdler32(const QString &filename, const ChecksumByteCounter &byteCounter,
+    const std::atomic<bool> *abort)
 {
     QFile file(filename);
-    const qint64 bufSize = qMin(BUFSIZE, file.size() + 1);
-    QByteArray buf(bufSize, Qt::Uninitialized);
-
     unsigned int adler = adler32(0L, Z_NULL, 0);
     if (file.open(QIODevice::ReadOnly)) {
-        qint64 size;
-        while (!file.atEnd()) {
-            size = file.read(buf.data(), bufSize);
-            if (size > 0)
-                adler = adler32(adler, (const Bytef *)buf.data(), size);
-        }
+        const bool complete = readBlocks(file, byteCounter, abort, [&adler](const char *data, qint64 size) {
+            adler = adler32(adler, (const Bytef *)data, size);
+        });
+        if (!complete && abort && abort->load())
+            return QByteArray();
     }
 
     return QByteArray::number(adler, 16);
 }
+
+QByteArray calcAdler32(const QString &filename)
+{
+    return calcAdler32(filename, ChecksumByteCounter(), nullptr);
+}
 #endif
 
 QByteArray makeChecksumHeader(const QByteArray &checksumType, const QByteArray &checksum)
@@ -233,10 +254,12 @@ void ComputeChecksum::start(const QString &filePath)
     connect(&_watcher, &QFutureWatcherBase::finished,
         this, &ComputeChecksum::slotCalculationDone,
         Qt::UniqueConnection);
-    _watcher.setFuture(QtConcurrent::run(ComputeChecksum::computeNow, filePath, checksumType()));
+    _watcher.setFuture(QtConcurrent::run(ComputeChecksum::computeNow, filePath, checksumType(), _byteCounter,
+        static_cast<const std::atomic<bool> *>(nullptr)));
 }
 
-QByteArray ComputeChecksum::computeNow(const QString &filePath, const QByteArray &checksumType)
+QByteArray ComputeChecksum::computeNow(const QString &filePath, const QByteArray &checksumType,
+    const ChecksumByteCounter &byteCounter, const std::atomic<bool> *abort)
 {
     if (!checksumComputationEnabled()) {
         qCWarning(lcChecksums) << "Checksum computation disabled by environment variable";
@@ -244,20 +267,20 @@ QByteArray ComputeChecksum::computeNow(const QString &filePath, const QByteArray
     }
 
     if (checksumType == checkSumMD5C) {
-        return calcMd5(filePath);
+        return calcCryptoHash(filePath, QCryptographicHash::Md5, byteCounter, abort);
     } else if (checksumType == checkSumSHA1C) {
-        return calcSha1(filePath);
+        return calcCryptoHash(filePath, QCryptographicHash::Sha1, byteCounter, abort);
     } else if (checksumType == checkSumSHA2C) {
-        return calcCryptoHash(filePath, QCryptographicHash::Sha256);
+        return calcCryptoHash(filePath, QCryptographicHash::Sha256, byteCounter, abort);
     }
 #if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
     else if (checksumType == checkSumSHA3C) {
-        return calcCryptoHash(filePath, QCryptographicHash::Sha3_256);
+        return calcCryptoHash(filePath, QCryptographicHash::Sha3_256, byteCounter, abort);
     }
 #endif
 #ifdef ZLIB_FOUND
     else if (checksumType == checkSumAdlerC) {
-        return calcAdler32(filePath);
+        return calcAdler32(filePath, byteCounter, abort);
     }
 #endif
     // for an unknown checksum or no checksum, we're done right now
@@ -299,6 +322,7 @@ void ValidateChecksumHeader::start(const QString &filePath, const QByteArray &ch
 
     auto calculator = new ComputeChecksum(this);
     calculator->setChecksumType(_expectedChecksumType);
+    calculator->setByteCounter(_byteCounter);
     connect(calculator, &ComputeChecksum::done,
         this, &ValidateChecksumHeader::slotChecksumCalculated);
     calculator->start(filePath);
@@ -24,6 +24,9 @@
 #include <QObject>
 #include <QByteArray>
 #include <QFutureWatcher>
+#include <QSharedPointer>
+
+#include <atomic>
 
 namespace OCC {
 
@@ -64,6 +67,14 @@ OCSYNC_EXPORT bool uploadChecksumEnabled();
 /// Checks OWNCLOUD_CONTENT_CHECKSUM_TYPE (default: SHA1)
 OCSYNC_EXPORT QByteArray contentChecksumType();
 
+/**
+ * Counts the file bytes read for checksums, for example during one sync.
+ *
+ * Shared, because a computation may still be running when the job that
+ * started it is gone.
+ */
+typedef QSharedPointer<std::atomic<quint64>> ChecksumByteCounter;
+
 // Exported functions for the tests.
 QByteArray OCSYNC_EXPORT calcMd5(const QString &fileName);
 QByteArray OCSYNC_EXPORT calcSha1(const QString &fileName);
@@ -88,6 +99,9 @@ public:
 
     QByteArray checksumType() const;
 
+    /** The bytes read for the checksum are added to counter, if set */
+    void setByteCounter(const ChecksumByteCounter &counter) { _byteCounter = counter; }
+
     /**
      * Computes the checksum for the given file path.
      *
@@ -97,8 +111,13 @@ public:
 
     /**
      * Computes the checksum synchronously.
+     *
+     * The bytes read from the file are added to byteCounter, if set. If
+     * abort is set and becomes true the computation stops and returns an
+     * empty checksum.
      */
-    static QByteArray computeNow(const QString &filePath, const QByteArray &checksumType);
+    static QByteArray computeNow(const QString &filePath, const QByteArray &checksumType,
+        const ChecksumByteCounter &byteCounter = ChecksumByteCounter(), const std::atomic<bool> *abort = nullptr);
 
 signals:
     void done(const QByteArray &checksumType, const QByteArray &checksum);
@@ -108,6 +127,7 @@ private slots:
 
 private:
     QByteArray _checksumType;
+    ChecksumByteCounter _byteCounter;
 
     // watcher for the checksum calculation thread
     QFutureWatcher<QByteArray> _watcher;
@@ -132,6 +152,9 @@ public:
      */
     void start(const QString &filePath, const QByteArray &checksumHeader);
 
+    /** See ComputeChecksum::setByteCounter() */
+    void setByteCounter(const ChecksumByteCounter &counter) { _byteCounter = counter; }
+
 signals:
     void validated(const QByteArray &checksumType, const QByteArray &checksum);
     void validationFailed(const QString &errMsg);
@@ -142,6 +165,7 @@ private slots:
 private:
     QByteArray _expectedChecksumType;
     QByteArray _expectedChecksum;
+    ChecksumByteCounter _byteCounter;
 };
 
 /**
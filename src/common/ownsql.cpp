@@ -17,6 +17,7 @@
  */
 
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QLoggingCategory>
 #include <QString>
 #include <QFile>
@@ -304,8 +305,14 @@ bool SqlQuery::exec()
         return false;
     }
 
+    if (_sqldb)
+        _sqldb->_statistics._queryCount++;
+    _timeNextStep = true;
+
     // Don't do anything for selects, that is how we use the lib :-|
     if (!isSelect() && !isPragma()) {
+        QElapsedTimer timer;
+        timer.start();
         int rc, n = 0;
         do {
             rc = sqlite3_step(_stmt);
@@ -319,6 +326,8 @@ bool SqlQuery::exec()
             }
         } while ((n < SQLITE_REPEAT_COUNT) && ((rc == SQLITE_BUSY) || (rc == SQLITE_LOCKED)));
         _errId = rc;
+        if (_sqldb)
+            _sqldb->_statistics._queryTimeNs += timer.nsecsElapsed();
 
         if (_errId != SQLITE_DONE && _errId != SQLITE_ROW) {
             _error = QString::fromUtf8(sqlite3_errmsg(_db));
@@ -340,7 +349,18 @@ bool SqlQuery::exec()
 
 bool SqlQuery::next()
 {
-    SQLITE_DO(sqlite3_step(_stmt));
+    // The first step of a select does the lookup, the others mostly copy rows
+    if (_timeNextStep && _sqldb) {
+        _timeNextStep = false;
+        QElapsedTimer timer;
+        timer.start();
+        SQLITE_DO(sqlite3_step(_stmt));
+        _sqldb->_statistics._queryTimeNs += timer.nsecsElapsed();
+    } else {
+        SQLITE_DO(sqlite3_step(_stmt));
+    }
+    if (_sqldb && _errId == SQLITE_ROW)
+        _sqldb->_statistics._rowCount++;
     return _errId == SQLITE_ROW;
 }
 
@@ -411,6 +431,37 @@ void SqlQuery::bindValue(int pos, const QVariant &value)
     ASSERT(res == SQLITE_OK);
 }
 
+void SqlQuery::bindInt64(int pos, qint64 value)
+{
+    qCDebug(lcSql) << "SQL bind" << pos << value;
+
+    if (!_stmt) {
+        ASSERT(false);
+        return;
+    }
+    int res = sqlite3_bind_int64(_stmt, pos, value);
+    if (res != SQLITE_OK) {
+        qCWarning(lcSql) << "ERROR binding SQL value:" << value << "error:" << res;
+    }
+    ASSERT(res == SQLITE_OK);
+}
+
+void SqlQuery::bindText(int pos, const QByteArray &utf8)
+{
+    qCDebug(lcSql) << "SQL bind" << pos << utf8;
+
+    if (!_stmt) {
+        ASSERT(false);
+        return;
+    }
+    // SQLITE_TRANSIENT: the caller's array may be gone before exec()
+    int res = sqlite3_bind_text(_stmt, pos, utf8.constData(), utf8.size(), SQLITE_TRANSIENT);
+    if (res != SQLITE_OK) {
+        qCWarning(lcSql) << "ERROR binding SQL value:" << utf8 << "error:" << res;
+    }
+    ASSERT(res == SQLITE_OK);
+}
+
 bool SqlQuery::nullValue(int index)
 {
     return sqlite3_column_type(_stmt, index) == SQLITE_NULL;
@@ -437,6 +488,12 @@ QByteArray SqlQuery::baValue(int index)
         sqlite3_column_bytes(_stmt, index));
 }
 
+QByteArray SqlQuery::baValueRaw(int index)
+{
+    return QByteArray::fromRawData(static_cast<const char *>(sqlite3_column_blob(_stmt, index)),
+        sqlite3_column_bytes(_stmt, index));
+}
+
 QString SqlQuery::error() const
 {
     return _error;
@@ -489,5 +546,48 @@ bool SqlQuery::initOrReset(const QByteArray &sql, OCC::SqlDatabase &db)
     }
 }
 
+/* =========================================================================================== */
+
+SqlQueryCache::SqlQueryCache(SqlDatabase &db, int capacity)
+    : _db(db)
+    , _capacity(capacity)
+{
+}
+
+SqlQueryCache::~SqlQueryCache()
+{
+    clear();
+}
+
+SqlQuery *SqlQueryCache::get(const QByteArray &sql)
+{
+    auto it = _index.constFind(sql);
+    if (it != _index.constEnd()) {
+        _lru.splice(_lru.begin(), _lru, *it);
+        SqlQuery *query = _lru.front()._query.get();
+        // Prepares the statement again if the database was closed in the meantime
+        if (!query->initOrReset(sql, _db))
+            return nullptr;
+        return query;
+    }
+
+    std::unique_ptr<SqlQuery> query(new SqlQuery(_db));
+    if (!query->initOrReset(sql, _db))
+        return nullptr;
+    _lru.push_front(Entry{ sql, std::move(query) });
+    _index.insert(sql, _lru.begin());
+
+    while (int(_lru.size()) > _capacity) {
+        _index.remove(_lru.back()._sql);
+        _lru.pop_back();
+    }
+    return _lru.front()._query.get();
+}
+
+void SqlQueryCache::clear()
+{
+    _index.clear();
+    _lru.clear();
+}
 
 } // namespace OCC
@@ -22,6 +22,10 @@
 #include <QObject>
 #include <QVariant>
 #include <QSet>
+#include <QHash>
+
+#include <list>
+#include <memory>
 
 #include "ocsynclib.h"
 
@@ -52,6 +56,17 @@ public:
     QString error() const;
     sqlite3 *sqliteDb();
 
+    /** Counters for the work done by the queries on this database */
+    struct Statistics
+    {
+        quint64 _queryCount = 0; // number of executed statements
+        quint64 _rowCount = 0; // number of rows stepped through with next()
+        // time spent in sqlite3_step, by exec() and the first next() after
+        // it; the following rows aren't timed to keep next() cheap
+        qint64 _queryTimeNs = 0;
+    };
+    const Statistics &statistics() const { return _statistics; }
+
 private:
     enum class CheckDbResult {
         Ok,
@@ -69,6 +84,7 @@ private:
 
     friend class SqlQuery;
     QSet<SqlQuery *> _queries;
+    Statistics _statistics;
 };
 
 /**
@@ -126,11 +142,22 @@ public:
     int intValue(int index);
     quint64 int64Value(int index);
     QByteArray baValue(int index);
+    /**
+     * Like baValue() but without copying the data out of sqlite.
+     *
+     * The result is only valid until the next call to next(), exec(),
+     * reset_and_clear_bindings() or finish(); copy it to keep it longer.
+     */
+    QByteArray baValueRaw(int index);
     bool isSelect();
     bool isPragma();
     bool exec();
     bool next();
     void bindValue(int pos, const QVariant &value);
+    /// Typed variants of bindValue() that don't go through QVariant
+    void bindInt64(int pos, qint64 value);
+    /// Binds UTF-8 text as is, without the UTF-16 round trip of QString values
+    void bindText(int pos, const QByteArray &utf8);
     QString lastQuery() const;
     int numRowsAffected();
     void reset_and_clear_bindings();
@@ -143,6 +170,50 @@ private:
     QString _error;
     int _errId;
     QByteArray _sql;
+    bool _timeNextStep = false;
+};
+
+/**
+ * @brief LRU cache of prepared statements, keyed by their SQL text
+ * @ingroup libsync
+ *
+ * Replaces keeping one SqlQuery member per statement around: get() prepares
+ * the statement the first time it is used and afterwards only resets it.
+ * The least recently used statements are finalized once there are more than
+ * the capacity.
+ */
+class OCSYNC_EXPORT SqlQueryCache
+{
+    Q_DISABLE_COPY(SqlQueryCache)
+public:
+    explicit SqlQueryCache(SqlDatabase &db, int capacity = 64);
+    ~SqlQueryCache();
+
+    /**
+     * Returns the query for sql, prepared and with results and bindings cleared.
+     * Returns nullptr if the statement can't be prepared.
+     *
+     * The pointer stays valid until capacity other statements were requested
+     * or clear() is called.
+     */
+    SqlQuery *get(const QByteArray &sql);
+
+    /// Finalizes all cached statements
+    void clear();
+
+    int size() const { return int(_lru.size()); }
+
+private:
+    struct Entry
+    {
+        QByteArray _sql;
+        std::unique_ptr<SqlQuery> _query;
+    };
+
+    SqlDatabase &_db;
+    int _capacity;
+    std::list<Entry> _lru; // most recently used first
+    QHash<QByteArray, std::list<Entry>::iterator> _index;
 };
 
 } // namespace OCC
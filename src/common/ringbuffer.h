@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "common/asserts.h"
+
+namespace OCC {
+
+/**
+ * @brief A sequence with a maximum size that drops its oldest entries
+ *
+ * Index 0 is the oldest entry. Appending to a full buffer overwrites the
+ * oldest entry and removing the oldest entries is cheap. Memory is only
+ * allocated as entries are added.
+ *
+ * Removing entries from the middle is O(n) and meant to be rare.
+ *
+ * @ingroup libsync
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(int capacity)
+        : _capacity(capacity)
+    {
+        ASSERT(capacity > 0);
+    }
+
+    int capacity() const { return _capacity; }
+    int size() const { return _size; }
+    bool isEmpty() const { return _size == 0; }
+    bool isFull() const { return _size == _capacity; }
+
+    const T &at(int i) const { return _data[index(i)]; }
+    T &operator[](int i) { return _data[index(i)]; }
+
+    /** Appends an entry, dropping the oldest one if the buffer is full */
+    void append(T value)
+    {
+        if (_size < storageSize()) {
+            // Reuse a slot freed by removeFirst()
+            _data[(_start + _size) % storageSize()] = std::move(value);
+            ++_size;
+        } else if (_size < _capacity) {
+            linearize();
+            _data.push_back(std::move(value));
+            ++_size;
+        } else {
+            _data[_start] = std::move(value);
+            _start = (_start + 1) % storageSize();
+        }
+    }
+
+    /** Removes the count oldest entries */
+    void removeFirst(int count)
+    {
+        ASSERT(count >= 0 && count <= _size);
+        for (int i = 0; i < count; ++i) {
+            _data[_start] = T(); // release what the entry holds
+            _start = (_start + 1) % storageSize();
+        }
+        _size -= count;
+    }
+
+    void removeAt(int i)
+    {
+        ASSERT(i >= 0 && i < _size);
+        linearize();
+        _data.erase(_data.begin() + i);
+        --_size;
+    }
+
+    /** Removes all entries for which pred returns true, returns how many */
+    template <typename Pred>
+    int removeIf(Pred pred)
+    {
+        linearize();
+        const auto end = _data.begin() + _size;
+        const auto it = std::remove_if(_data.begin(), end, pred);
+        const int removed = static_cast<int>(end - it);
+        _data.erase(it, end);
+        _size -= removed;
+        return removed;
+    }
+
+    void clear()
+    {
+        _data.clear();
+        _start = 0;
+        _size = 0;
+    }
+
+private:
+    int storageSize() const { return static_cast<int>(_data.size()); }
+
+    int index(int i) const
+    {
+        ASSERT(i >= 0 && i < _size);
+        return (_start + i) % storageSize();
+    }
+
+    // Moves the entries to the front of the storage, so it can be
+    // modified like a plain vector.
+    void linearize()
+    {
+        if (_start == 0)
+            return;
+        std::rotate(_data.begin(), _data.begin() + _start, _data.end());
+        _start = 0;
+    }
+
+    std::vector<T> _data;
+    int _start = 0; // storage index of the oldest entry
+    int _size = 0;
+    int _capacity;
+};
+
+} // namespace OCC
@@ -41,6 +41,11 @@
 #define IS_PREFIX_PATH_OR_EQUAL(prefix, path) \
     "(" path " == " prefix " OR " IS_PREFIX_PATH_OF(prefix, path) ")"
 
+// Same as IS_PREFIX_PATH_OF, but on the sortkey column (path||'/') so the
+// metadata_sortkey index can be used
+#define IS_PREFIX_PATH_OF_SORTKEY(prefix) \
+    "(sortkey > (" prefix "||'/') AND sortkey < (" prefix "||'0'))"
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcDb, "sync.database", QtInfoMsg)
@@ -51,6 +56,15 @@ Q_LOGGING_CATEGORY(lcDb, "sync.database", QtInfoMsg)
         " FROM metadata" \
         "  LEFT JOIN checksumtype as contentchecksumtype ON metadata.contentChecksumTypeId == contentchecksumtype.id"
 
+#define GET_ERROR_BLACKLIST_QUERY \
+        "SELECT lastTryEtag, lastTryModtime, retrycount, errorstring, lastTryTime, ignoreDuration, renameTarget, errorCategory, requestId" \
+        " FROM blacklist WHERE path=?1"
+
+#define DELETE_DOWNLOAD_INFO_QUERY "DELETE FROM downloadinfo WHERE path=?1"
+#define DELETE_DOWNLOAD_SEGMENTS_QUERY "DELETE FROM downloadsegments WHERE path=?1"
+#define DELETE_CONTENT_CHUNKS_QUERY "DELETE FROM contentchunks WHERE path=?1"
+#define DELETE_UPLOAD_INFO_QUERY "DELETE FROM uploadinfo WHERE path=?1"
+
 static void fillFileRecordFromGetQuery(SyncJournalFileRecord &rec, SqlQuery &query)
 {
     rec._path = query.baValue(0);
@@ -89,6 +103,7 @@ static QByteArray defaultJournalMode(const QString &dbPath)
 
 SyncJournalDb::SyncJournalDb(const QString &dbFilePath, QObject *parent)
     : QObject(parent)
+    , _queryCache(_db)
     , _dbFile(dbFilePath)
     , _mutex(QMutex::Recursive)
     , _transaction(0)
@@ -379,6 +394,8 @@ bool SyncJournalDb::checkConnect()
                         // ignoredChildrenRemote
                         // contentChecksum
                         // contentChecksumTypeId
+                        // parent
+                        // sortkey
                         "PRIMARY KEY(phash)"
                         ");");
 
@@ -419,6 +436,31 @@ bool SyncJournalDb::checkConnect()
         return sqlFail("Create table downloadinfo", createQuery);
     }
 
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS downloadsegments("
+                        "path VARCHAR(4096),"
+                        "rangestart INTEGER(8),"
+                        "rangeend INTEGER(8),"
+                        "received INTEGER(8),"
+                        "PRIMARY KEY(path, rangestart)"
+                        ");");
+
+    if (!createQuery.exec()) {
+        return sqlFail("Create table downloadsegments", createQuery);
+    }
+
+    createQuery.prepare("CREATE TABLE IF NOT EXISTS contentchunks("
+                        "path VARCHAR(4096),"
+                        "etag VARCHAR(32),"
+                        "chunkoffset INTEGER(8),"
+                        "size INTEGER(8),"
+                        "hash BLOB,"
+                        "PRIMARY KEY(path, chunkoffset)"
+                        ");");
+
+    if (!createQuery.exec()) {
+        return sqlFail("Create table contentchunks", createQuery);
+    }
+
     createQuery.prepare("CREATE TABLE IF NOT EXISTS uploadinfo("
                         "path VARCHAR(4096),"
                         "chunk INTEGER,"
@@ -505,6 +547,7 @@ bool SyncJournalDb::checkConnect()
     }
 
     bool forceRemoteDiscovery = false;
+    bool clientVersionChanged = false;
 
     SqlQuery versionQuery("SELECT major, minor, patch FROM version;", _db);
     if (!versionQuery.next()) {
@@ -542,6 +585,7 @@ bool SyncJournalDb::checkConnect()
 
         // Not comparing the BUILD id here, correct?
         if (!(major == MIRALL_VERSION_MAJOR && minor == MIRALL_VERSION_MINOR && patch == MIRALL_VERSION_PATCH)) {
+            clientVersionChanged = true;
             createQuery.prepare("UPDATE version SET major=?1, minor=?2, patch =?3, custom=?4 "
                                 "WHERE major=?5 AND minor=?6 AND patch=?7;");
             createQuery.bindValue(1, MIRALL_VERSION_MAJOR);
@@ -564,6 +608,12 @@ bool SyncJournalDb::checkConnect()
         qCWarning(lcDb) << "Failed to update the database structure!";
     }
 
+    // Older clients don't know about the parent and sortkey columns and
+    // leave them empty for the records they write.
+    if (rc && clientVersionChanged) {
+        rc = fillParentAndSortKeyColumns(QByteArrayLiteral("sortkey IS NULL"));
+    }
+
     /*
      * If we are upgrading from a client version older than 1.5,
      * we cannot read from the database because we need to fetch the files id and etags.
@@ -575,26 +625,6 @@ bool SyncJournalDb::checkConnect()
     if (forceRemoteDiscovery) {
         forceRemoteDiscoveryNextSyncLocked();
     }
-    if (!_deleteDownloadInfoQuery.initOrReset("DELETE FROM downloadinfo WHERE path=?1", _db)) {
-        return sqlFail("prepare _deleteDownloadInfoQuery", _deleteDownloadInfoQuery);
-    }
-
-
-    if (!_deleteUploadInfoQuery.initOrReset("DELETE FROM uploadinfo WHERE path=?1", _db)) {
-        return sqlFail("prepare _deleteUploadInfoQuery", _deleteUploadInfoQuery);
-    }
-
-    QByteArray sql("SELECT lastTryEtag, lastTryModtime, retrycount, errorstring, lastTryTime, ignoreDuration, renameTarget, errorCategory, requestId "
-                   "FROM blacklist WHERE path=?1");
-    if (Utility::fsCasePreserving()) {
-        // if the file system is case preserving we have to check the blacklist
-        // case insensitively
-        sql += " COLLATE NOCASE";
-    }
-    if (!_getErrorBlacklistQuery.initOrReset(sql, _db)) {
-        return sqlFail("prepare _getErrorBlacklistQuery", _getErrorBlacklistQuery);
-    }
-
     // don't start a new transaction now
     commitInternal(QString("checkConnect End"), false);
 
@@ -617,6 +647,7 @@ void SyncJournalDb::close()
     qCInfo(lcDb) << "Closing DB" << _dbFile;
 
     commitTransaction();
+    _queryCache.clear();
     _db.close();
     clearEtagStorageFilter();
     _metadataTableIsEmpty = false;
@@ -696,14 +727,57 @@ bool SyncJournalDb::updateMetadataTableStructure()
         commitInternal("update database structure: add path index");
     }
 
+    if (columns.indexOf("parent") == -1) {
+        SqlQuery query(_db);
+        query.prepare("ALTER TABLE metadata ADD COLUMN parent INTEGER(8);");
+        if (!query.exec()) {
+            sqlFail("updateMetadataTableStructure: add parent column", query);
+            re = false;
+        }
+        query.prepare("ALTER TABLE metadata ADD COLUMN sortkey TEXT;");
+        if (!query.exec()) {
+            sqlFail("updateMetadataTableStructure: add sortkey column", query);
+            re = false;
+        }
+        if (re && !fillParentAndSortKeyColumns(QByteArrayLiteral("1"))) {
+            re = false;
+        }
+
+        // Superseded by metadata_parent_sortkey
+        query.prepare("DROP INDEX IF EXISTS metadata_parent;");
+        if (!query.exec()) {
+            sqlFail("updateMetadataTableStructure: drop index parent", query);
+            re = false;
+        }
+        commitInternal("update database structure: add parent and sortkey cols");
+    }
+
+    if (1) {
+        SqlQuery query(_db);
+        // listFilesInPath(): WHERE parent = ? ORDER BY sortkey
+        query.prepare("CREATE INDEX IF NOT EXISTS metadata_parent_sortkey ON metadata(parent, sortkey);");
+        if (!query.exec()) {
+            sqlFail("updateMetadataTableStructure: create index parent_sortkey", query);
+            re = false;
+        }
+        // getFilesBelowPath(): range scan in sortkey order
+        query.prepare("CREATE INDEX IF NOT EXISTS metadata_sortkey ON metadata(sortkey);");
+        if (!query.exec()) {
+            sqlFail("updateMetadataTableStructure: create index sortkey", query);
+            re = false;
+        }
+        commitInternal("update database structure: add parent and sortkey indexes");
+    }
+
     if (1) {
         SqlQuery query(_db);
-        query.prepare("CREATE INDEX IF NOT EXISTS metadata_parent ON metadata(parent_hash(path));");
+        // getFileRecordsByChecksum()
+        query.prepare("CREATE INDEX IF NOT EXISTS metadata_checksum ON metadata(contentChecksum);");
         if (!query.exec()) {
-            sqlFail("updateMetadataTableStructure: create index parent", query);
+            sqlFail("updateMetadataTableStructure: create index checksum", query);
             re = false;
         }
-        commitInternal("update database structure: add parent index");
+        commitInternal("update database structure: add checksum index");
     }
 
     if (columns.indexOf("ignoredChildrenRemote") == -1) {
@@ -826,6 +900,20 @@ bool SyncJournalDb::updateErrorBlacklistTableStructure()
     return re;
 }
 
+bool SyncJournalDb::fillParentAndSortKeyColumns(const QByteArray &condition)
+{
+    SqlQuery query(_db);
+    query.prepare("UPDATE metadata SET parent = parent_hash(path), sortkey = path||'/' WHERE " + condition + ";");
+    if (!query.exec()) {
+        sqlFail("fillParentAndSortKeyColumns", query);
+        return false;
+    }
+    if (query.numRowsAffected() > 0)
+        qCInfo(lcDb) << "Filled parent and sortkey of" << query.numRowsAffected() << "records";
+    commitInternal("fill parent and sortkey columns");
+    return true;
+}
+
 QVector<QByteArray> SyncJournalDb::tableColumns(const QByteArray &table)
 {
     QVector<QByteArray> columns;
@@ -852,6 +940,13 @@ qint64 SyncJournalDb::getPHash(const QByteArray &file)
     return h;
 }
 
+// The directory containing path, "" for the top level
+static QByteArray parentPath(const QByteArray &path)
+{
+    const int slash = path.lastIndexOf('/');
+    return slash < 0 ? QByteArray() : path.left(slash);
+}
+
 bool SyncJournalDb::setFileRecord(const SyncJournalFileRecord &_record)
 {
     SyncJournalFileRecord record = _record;
@@ -889,31 +984,34 @@ bool SyncJournalDb::setFileRecord(const SyncJournalFileRecord &_record)
         parseChecksumHeader(record._checksumHeader, &checksumType, &checksum);
         int contentChecksumTypeId = mapChecksumType(checksumType);
 
-        if (!_setFileRecordQuery.initOrReset(QByteArrayLiteral(
+        const auto query = _queryCache.get(QByteArrayLiteral(
             "INSERT OR REPLACE INTO metadata "
-            "(phash, pathlen, path, inode, uid, gid, mode, modtime, type, md5, fileid, remotePerm, filesize, ignoredChildrenRemote, contentChecksum, contentChecksumTypeId) "
-            "VALUES (?1 , ?2, ?3 , ?4 , ?5 , ?6 , ?7,  ?8 , ?9 , ?10, ?11, ?12, ?13, ?14, ?15, ?16);"), _db)) {
+            "(phash, pathlen, path, inode, uid, gid, mode, modtime, type, md5, fileid, remotePerm, filesize, ignoredChildrenRemote, contentChecksum, contentChecksumTypeId, parent, sortkey) "
+            "VALUES (?1 , ?2, ?3 , ?4 , ?5 , ?6 , ?7,  ?8 , ?9 , ?10, ?11, ?12, ?13, ?14, ?15, ?16, ?17, ?18);"));
+        if (!query) {
             return false;
         }
 
-        _setFileRecordQuery.bindValue(1, phash);
-        _setFileRecordQuery.bindValue(2, plen);
-        _setFileRecordQuery.bindValue(3, record._path);
-        _setFileRecordQuery.bindValue(4, record._inode);
-        _setFileRecordQuery.bindValue(5, 0); // uid Not used
-        _setFileRecordQuery.bindValue(6, 0); // gid Not used
-        _setFileRecordQuery.bindValue(7, 0); // mode Not used
-        _setFileRecordQuery.bindValue(8, record._modtime);
-        _setFileRecordQuery.bindValue(9, record._type);
-        _setFileRecordQuery.bindValue(10, etag);
-        _setFileRecordQuery.bindValue(11, fileId);
-        _setFileRecordQuery.bindValue(12, remotePerm);
-        _setFileRecordQuery.bindValue(13, record._fileSize);
-        _setFileRecordQuery.bindValue(14, record._serverHasIgnoredFiles ? 1 : 0);
-        _setFileRecordQuery.bindValue(15, checksum);
-        _setFileRecordQuery.bindValue(16, contentChecksumTypeId);
-
-        if (!_setFileRecordQuery.exec()) {
+        query->bindInt64(1, phash);
+        query->bindInt64(2, plen);
+        query->bindText(3, record._path);
+        query->bindInt64(4, record._inode);
+        query->bindInt64(5, 0); // uid Not used
+        query->bindInt64(6, 0); // gid Not used
+        query->bindInt64(7, 0); // mode Not used
+        query->bindInt64(8, record._modtime);
+        query->bindInt64(9, record._type);
+        query->bindText(10, etag);
+        query->bindText(11, fileId);
+        query->bindText(12, remotePerm);
+        query->bindInt64(13, record._fileSize);
+        query->bindInt64(14, record._serverHasIgnoredFiles ? 1 : 0);
+        query->bindText(15, checksum);
+        query->bindInt64(16, contentChecksumTypeId);
+        query->bindInt64(17, getPHash(parentPath(record._path)));
+        query->bindText(18, record._path + '/');
+
+        if (!query->exec()) {
             return false;
         }
 
@@ -935,20 +1033,37 @@ bool SyncJournalDb::deleteFileRecord(const QString &filename, bool recursively)
         // if (!recursively) {
         // always delete the actual file.
 
-        if (!_deleteFileRecordPhash.initOrReset(QByteArrayLiteral("DELETE FROM metadata WHERE phash=?1"), _db))
+        auto query = _queryCache.get(QByteArrayLiteral("DELETE FROM metadata WHERE phash=?1"));
+        if (!query)
             return false;
 
         qlonglong phash = getPHash(filename.toUtf8());
-        _deleteFileRecordPhash.bindValue(1, phash);
+        query->bindInt64(1, phash);
 
-        if (!_deleteFileRecordPhash.exec())
+        if (!query->exec())
+            return false;
+
+        query = _queryCache.get(QByteArrayLiteral(DELETE_CONTENT_CHUNKS_QUERY));
+        if (!query)
+            return false;
+        query->bindValue(1, filename);
+        if (!query->exec())
             return false;
 
         if (recursively) {
-            if (!_deleteFileRecordRecursively.initOrReset(QByteArrayLiteral("DELETE FROM metadata WHERE " IS_PREFIX_PATH_OF("?1", "path")), _db))
+            query = _queryCache.get(QByteArrayLiteral("DELETE FROM metadata WHERE " IS_PREFIX_PATH_OF("?1", "path")));
+            if (!query)
                 return false;
-            _deleteFileRecordRecursively.bindValue(1, filename);
-            if (!_deleteFileRecordRecursively.exec()) {
+            query->bindValue(1, filename);
+            if (!query->exec()) {
+                return false;
+            }
+
+            query = _queryCache.get(QByteArrayLiteral("DELETE FROM contentchunks WHERE " IS_PREFIX_PATH_OF("?1", "path")));
+            if (!query)
+                return false;
+            query->bindValue(1, filename);
+            if (!query->exec()) {
                 return false;
             }
         }
@@ -976,22 +1091,23 @@ bool SyncJournalDb::getFileRecord(const QByteArray &filename, SyncJournalFileRec
         return false;
 
     if (!filename.isEmpty()) {
-        if (!_getFileRecordQuery.initOrReset(QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE phash=?1"), _db))
+        const auto query = _queryCache.get(QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE phash=?1"));
+        if (!query)
             return false;
 
-        _getFileRecordQuery.bindValue(1, getPHash(filename));
+        query->bindInt64(1, getPHash(filename));
 
-        if (!_getFileRecordQuery.exec()) {
+        if (!query->exec()) {
             close();
             return false;
         }
 
-        if (_getFileRecordQuery.next()) {
-            fillFileRecordFromGetQuery(*rec, _getFileRecordQuery);
+        if (query->next()) {
+            fillFileRecordFromGetQuery(*rec, *query);
         } else {
-            int errId = _getFileRecordQuery.errorId();
+            int errId = query->errorId();
             if (errId != SQLITE_DONE) { // only do this if the problem is different from SQLITE_DONE
-                QString err = _getFileRecordQuery.error();
+                QString err = query->error();
                 qCWarning(lcDb) << "No journal entry found for " << filename << "Error: " << err;
                 close();
             }
@@ -1015,16 +1131,40 @@ bool SyncJournalDb::getFileRecordByInode(quint64 inode, SyncJournalFileRecord *r
     if (!checkConnect())
         return false;
 
-    if (!_getFileRecordQueryByInode.initOrReset(QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE inode=?1"), _db))
+    const auto query = _queryCache.get(QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE inode=?1"));
+    if (!query)
         return false;
 
-    _getFileRecordQueryByInode.bindValue(1, inode);
+    query->bindInt64(1, inode);
 
-    if (!_getFileRecordQueryByInode.exec())
+    if (!query->exec())
         return false;
 
-    if (_getFileRecordQueryByInode.next())
-        fillFileRecordFromGetQuery(*rec, _getFileRecordQueryByInode);
+    if (query->next())
+        fillFileRecordFromGetQuery(*rec, *query);
+
+    return true;
+}
+
+bool SyncJournalDb::listInodes(const std::function<void(quint64)> &rowCallback)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_metadataTableIsEmpty)
+        return true; // no error, yet nothing found
+
+    if (!checkConnect())
+        return false;
+
+    const auto query = _queryCache.get(QByteArrayLiteral("SELECT inode FROM metadata WHERE inode != 0"));
+    if (!query)
+        return false;
+
+    if (!query->exec())
+        return false;
+
+    while (query->next())
+        rowCallback(query->int64Value(0));
 
     return true;
 }
@@ -1039,17 +1179,49 @@ bool SyncJournalDb::getFileRecordsByFileId(const QByteArray &fileId, const std::
     if (!checkConnect())
         return false;
 
-    if (!_getFileRecordQueryByFileId.initOrReset(QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE fileid=?1"), _db))
+    const auto query = _queryCache.get(QByteArrayLiteral(GET_FILE_RECORD_QUERY " WHERE fileid=?1"));
+    if (!query)
+        return false;
+
+    query->bindText(1, fileId);
+
+    if (!query->exec())
+        return false;
+
+    while (query->next()) {
+        SyncJournalFileRecord rec;
+        fillFileRecordFromGetQuery(rec, *query);
+        rowCallback(rec);
+    }
+
+    return true;
+}
+
+bool SyncJournalDb::getFileRecordsByChecksum(const QByteArray &checksumHeader, const std::function<void(const SyncJournalFileRecord &)> &rowCallback)
+{
+    QMutexLocker locker(&_mutex);
+
+    QByteArray checksumType, checksum;
+    if (!parseChecksumHeader(checksumHeader, &checksumType, &checksum) || checksum.isEmpty() || _metadataTableIsEmpty)
+        return true; // no error, yet nothing found
+
+    if (!checkConnect())
+        return false;
+
+    const auto query = _queryCache.get(QByteArrayLiteral(
+        GET_FILE_RECORD_QUERY " WHERE contentChecksum=?1 AND contentchecksumtype.name=?2"));
+    if (!query)
         return false;
 
-    _getFileRecordQueryByFileId.bindValue(1, fileId);
+    query->bindText(1, checksum);
+    query->bindText(2, checksumType);
 
-    if (!_getFileRecordQueryByFileId.exec())
+    if (!query->exec())
         return false;
 
-    while (_getFileRecordQueryByFileId.next()) {
+    while (query->next()) {
         SyncJournalFileRecord rec;
-        fillFileRecordFromGetQuery(rec, _getFileRecordQueryByFileId);
+        fillFileRecordFromGetQuery(rec, *query);
         rowCallback(rec);
     }
 
@@ -1074,25 +1246,25 @@ bool SyncJournalDb::getFilesBelowPath(const QByteArray &path, const std::functio
         // and find nothing. So, unfortunately, we have to use a different query for
         // retrieving the whole tree.
 
-        if (!_getAllFilesQuery.initOrReset(QByteArrayLiteral( GET_FILE_RECORD_QUERY " ORDER BY path||'/' ASC"), _db))
+        query = _queryCache.get(QByteArrayLiteral(GET_FILE_RECORD_QUERY " ORDER BY sortkey ASC"));
+        if (!query)
             return false;
-        query = &_getAllFilesQuery;
     } else {
         // This query is used to skip discovery and fill the tree from the
         // database instead
-        if (!_getFilesBelowPathQuery.initOrReset(QByteArrayLiteral(
+        query = _queryCache.get(QByteArrayLiteral(
                 GET_FILE_RECORD_QUERY
-                " WHERE " IS_PREFIX_PATH_OF("?1", "path")
+                " WHERE " IS_PREFIX_PATH_OF_SORTKEY("?1")
                 // We want to ensure that the contents of a directory are sorted
                 // directly behind the directory itself. Without this ORDER BY
                 // an ordering like foo, foo-2, foo/file would be returned.
-                // With the trailing /, we get foo-2, foo, foo/file. This property
-                // is used in fill_tree_from_db().
-                " ORDER BY path||'/' ASC"), _db)) {
+                // With the trailing / of the sortkey, we get foo-2, foo, foo/file.
+                // This property is used in fill_tree_from_db().
+                " ORDER BY sortkey ASC"));
+        if (!query) {
             return false;
         }
-        query = &_getFilesBelowPathQuery;
-        query->bindValue(1, path);
+        query->bindText(1, path);
     }
 
     if (!query->exec()) {
@@ -1119,22 +1291,25 @@ bool SyncJournalDb::listFilesInPath(const QByteArray& path,
     if (!checkConnect())
         return false;
 
-    if (!_listFilesInPathQuery.initOrReset(QByteArrayLiteral(
-            GET_FILE_RECORD_QUERY " WHERE parent_hash(path) = ?1 ORDER BY path||'/' ASC"), _db))
+    const auto query = _queryCache.get(QByteArrayLiteral(
+            GET_FILE_RECORD_QUERY " WHERE parent = ?1 ORDER BY sortkey ASC"));
+    if (!query)
         return false;
 
-    _listFilesInPathQuery.bindValue(1, getPHash(path));
+    query->bindInt64(1, getPHash(path));
 
-    if (!_listFilesInPathQuery.exec())
+    if (!query->exec())
         return false;
 
-    while (_listFilesInPathQuery.next()) {
-        SyncJournalFileRecord rec;
-        fillFileRecordFromGetQuery(rec, _listFilesInPathQuery);
-        if (!rec._path.startsWith(path) || rec._path.indexOf("/", path.size() + 1) > 0) {
-            qWarning(lcDb) << "hash collision " << path << rec._path;
+    while (query->next()) {
+        // Check the path before copying anything out of the row
+        const QByteArray rowPath = query->baValueRaw(0);
+        if (!rowPath.startsWith(path) || rowPath.indexOf("/", path.size() + 1) > 0) {
+            qWarning(lcDb) << "hash collision " << path << rowPath;
             continue;
         }
+        SyncJournalFileRecord rec;
+        fillFileRecordFromGetQuery(rec, *query);
         rowCallback(rec);
     }
 
@@ -1176,16 +1351,17 @@ bool SyncJournalDb::updateFileRecordChecksum(const QString &filename,
 
     int checksumTypeId = mapChecksumType(contentChecksumType);
 
-    if (!_setFileRecordChecksumQuery.initOrReset(QByteArrayLiteral(
+    const auto query = _queryCache.get(QByteArrayLiteral(
             "UPDATE metadata"
             " SET contentChecksum = ?2, contentChecksumTypeId = ?3"
-            " WHERE phash == ?1;"), _db)) {
+            " WHERE phash == ?1;"));
+    if (!query) {
         return false;
     }
-    _setFileRecordChecksumQuery.bindValue(1, phash);
-    _setFileRecordChecksumQuery.bindValue(2, contentChecksum);
-    _setFileRecordChecksumQuery.bindValue(3, checksumTypeId);
-    return _setFileRecordChecksumQuery.exec();
+    query->bindInt64(1, phash);
+    query->bindText(2, contentChecksum);
+    query->bindInt64(3, checksumTypeId);
+    return query->exec();
 }
 
 bool SyncJournalDb::updateLocalMetadata(const QString &filename,
@@ -1203,18 +1379,19 @@ bool SyncJournalDb::updateLocalMetadata(const QString &filename,
     }
 
 
-    if (!_setFileRecordLocalMetadataQuery.initOrReset(QByteArrayLiteral(
+    const auto query = _queryCache.get(QByteArrayLiteral(
             "UPDATE metadata"
             " SET inode=?2, modtime=?3, filesize=?4"
-            " WHERE phash == ?1;"), _db)) {
+            " WHERE phash == ?1;"));
+    if (!query) {
         return false;
     }
 
-    _setFileRecordLocalMetadataQuery.bindValue(1, phash);
-    _setFileRecordLocalMetadataQuery.bindValue(2, inode);
-    _setFileRecordLocalMetadataQuery.bindValue(3, modtime);
-    _setFileRecordLocalMetadataQuery.bindValue(4, size);
-    return _setFileRecordLocalMetadataQuery.exec();
+    query->bindInt64(1, phash);
+    query->bindInt64(2, inode);
+    query->bindInt64(3, modtime);
+    query->bindInt64(4, size);
+    return query->exec();
 }
 
 static void toDownloadInfo(SqlQuery &query, SyncJournalDb::DownloadInfo *res)
@@ -1252,19 +1429,20 @@ SyncJournalDb::DownloadInfo SyncJournalDb::getDownloadInfo(const QString &file)
 
     if (checkConnect()) {
 
-        if (!_getDownloadInfoQuery.initOrReset(QByteArrayLiteral(
-                "SELECT tmpfile, etag, errorcount FROM downloadinfo WHERE path=?1"), _db)) {
+        const auto query = _queryCache.get(QByteArrayLiteral(
+                "SELECT tmpfile, etag, errorcount FROM downloadinfo WHERE path=?1"));
+        if (!query) {
             return res;
         }
 
-        _getDownloadInfoQuery.bindValue(1, file);
+        query->bindValue(1, file);
 
-        if (!_getDownloadInfoQuery.exec()) {
+        if (!query->exec()) {
             return res;
         }
 
-        if (_getDownloadInfoQuery.next()) {
-            toDownloadInfo(_getDownloadInfoQuery, &res);
+        if (query->next()) {
+            toDownloadInfo(*query, &res);
         } else {
             res._valid = false;
         }
@@ -1282,21 +1460,32 @@ void SyncJournalDb::setDownloadInfo(const QString &file, const SyncJournalDb::Do
 
 
     if (i._valid) {
-        if (!_setDownloadInfoQuery.initOrReset(QByteArrayLiteral(
+        const auto query = _queryCache.get(QByteArrayLiteral(
                 "INSERT OR REPLACE INTO downloadinfo "
                 "(path, tmpfile, etag, errorcount) "
-                "VALUES ( ?1 , ?2, ?3, ?4 )"), _db)) {
+                "VALUES ( ?1 , ?2, ?3, ?4 )"));
+        if (!query) {
             return;
         }
-        _setDownloadInfoQuery.bindValue(1, file);
-        _setDownloadInfoQuery.bindValue(2, i._tmpfile);
-        _setDownloadInfoQuery.bindValue(3, i._etag);
-        _setDownloadInfoQuery.bindValue(4, i._errorCount);
-        _setDownloadInfoQuery.exec();
+        query->bindValue(1, file);
+        query->bindValue(2, i._tmpfile);
+        query->bindText(3, i._etag);
+        query->bindInt64(4, i._errorCount);
+        query->exec();
     } else {
-        _deleteDownloadInfoQuery.reset_and_clear_bindings();
-        _deleteDownloadInfoQuery.bindValue(1, file);
-        _deleteDownloadInfoQuery.exec();
+        const auto query = _queryCache.get(QByteArrayLiteral(DELETE_DOWNLOAD_INFO_QUERY));
+        if (!query) {
+            return;
+        }
+        query->bindValue(1, file);
+        query->exec();
+
+        const auto segmentsQuery = _queryCache.get(QByteArrayLiteral(DELETE_DOWNLOAD_SEGMENTS_QUERY));
+        if (!segmentsQuery) {
+            return;
+        }
+        segmentsQuery->bindValue(1, file);
+        segmentsQuery->exec();
     }
 }
 
@@ -1330,12 +1519,150 @@ QVector<SyncJournalDb::DownloadInfo> SyncJournalDb::getAndDeleteStaleDownloadInf
         }
     }
 
-    if (!deleteBatch(_deleteDownloadInfoQuery, superfluousPaths, "downloadinfo"))
+    const auto deleteQuery = _queryCache.get(QByteArrayLiteral(DELETE_DOWNLOAD_INFO_QUERY));
+    if (!deleteQuery || !deleteBatch(*deleteQuery, superfluousPaths, "downloadinfo"))
+        return empty_result;
+
+    const auto deleteSegmentsQuery = _queryCache.get(QByteArrayLiteral(DELETE_DOWNLOAD_SEGMENTS_QUERY));
+    if (!deleteSegmentsQuery || !deleteBatch(*deleteSegmentsQuery, superfluousPaths, "downloadsegments"))
         return empty_result;
 
     return deleted_entries;
 }
 
+QVector<SyncJournalDb::DownloadSegment> SyncJournalDb::getDownloadSegments(const QString &file)
+{
+    QMutexLocker locker(&_mutex);
+
+    QVector<DownloadSegment> segments;
+    if (!checkConnect()) {
+        return segments;
+    }
+
+    const auto query = _queryCache.get(QByteArrayLiteral(
+            "SELECT rangestart, rangeend, received FROM downloadsegments WHERE path=?1 ORDER BY rangestart"));
+    if (!query) {
+        return segments;
+    }
+    query->bindValue(1, file);
+    if (!query->exec()) {
+        return segments;
+    }
+
+    while (query->next()) {
+        DownloadSegment segment;
+        segment._start = query->int64Value(0);
+        segment._end = query->int64Value(1);
+        segment._received = query->int64Value(2);
+        segments.append(segment);
+    }
+    return segments;
+}
+
+void SyncJournalDb::setDownloadSegments(const QString &file, const QVector<DownloadSegment> &segments)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!checkConnect()) {
+        return;
+    }
+
+    const auto deleteQuery = _queryCache.get(QByteArrayLiteral(DELETE_DOWNLOAD_SEGMENTS_QUERY));
+    if (!deleteQuery) {
+        return;
+    }
+    deleteQuery->bindValue(1, file);
+    if (!deleteQuery->exec()) {
+        return;
+    }
+
+    const auto query = _queryCache.get(QByteArrayLiteral(
+            "INSERT INTO downloadsegments "
+            "(path, rangestart, rangeend, received) "
+            "VALUES ( ?1 , ?2, ?3, ?4 )"));
+    if (!query) {
+        return;
+    }
+    for (const auto &segment : segments) {
+        query->reset_and_clear_bindings();
+        query->bindValue(1, file);
+        query->bindValue(2, segment._start);
+        query->bindValue(3, segment._end);
+        query->bindValue(4, segment._received);
+        if (!query->exec()) {
+            return;
+        }
+    }
+}
+
+QVector<SyncJournalDb::ContentChunk> SyncJournalDb::getContentChunks(const QString &file, QByteArray *etag)
+{
+    QMutexLocker locker(&_mutex);
+
+    QVector<ContentChunk> chunks;
+    etag->clear();
+    if (!checkConnect()) {
+        return chunks;
+    }
+
+    const auto query = _queryCache.get(QByteArrayLiteral(
+            "SELECT etag, chunkoffset, size, hash FROM contentchunks WHERE path=?1 ORDER BY chunkoffset"));
+    if (!query) {
+        return chunks;
+    }
+    query->bindValue(1, file);
+    if (!query->exec()) {
+        return chunks;
+    }
+
+    while (query->next()) {
+        *etag = query->baValue(0);
+        ContentChunk chunk;
+        chunk._offset = query->int64Value(1);
+        chunk._size = query->int64Value(2);
+        chunk._hash = query->baValue(3);
+        chunks.append(chunk);
+    }
+    return chunks;
+}
+
+void SyncJournalDb::setContentChunks(const QString &file, const QByteArray &etag, const QVector<ContentChunk> &chunks)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (!checkConnect()) {
+        return;
+    }
+
+    const auto deleteQuery = _queryCache.get(QByteArrayLiteral(DELETE_CONTENT_CHUNKS_QUERY));
+    if (!deleteQuery) {
+        return;
+    }
+    deleteQuery->bindValue(1, file);
+    if (!deleteQuery->exec()) {
+        return;
+    }
+
+    const auto query = _queryCache.get(QByteArrayLiteral(
+            "INSERT INTO contentchunks "
+            "(path, etag, chunkoffset, size, hash) "
+            "VALUES ( ?1 , ?2, ?3, ?4, ?5 )"));
+    if (!query) {
+        return;
+    }
+    for (const auto &chunk : chunks) {
+        query->reset_and_clear_bindings();
+        query->bindValue(1, file);
+        query->bindValue(2, etag);
+        query->bindValue(3, chunk._offset);
+        query->bindValue(4, chunk._size);
+        query->bindValue(5, chunk._hash);
+        if (!query->exec()) {
+            return;
+        }
+    }
+}
+
 int SyncJournalDb::downloadInfoCount()
 {
     int re = 0;
@@ -1361,25 +1688,26 @@ SyncJournalDb::UploadInfo SyncJournalDb::getUploadInfo(const QString &file)
     UploadInfo res;
 
     if (checkConnect()) {
-        if (!_getUploadInfoQuery.initOrReset(QByteArrayLiteral(
+        const auto query = _queryCache.get(QByteArrayLiteral(
                 "SELECT chunk, transferid, errorcount, size, modtime, contentChecksum FROM "
-                "uploadinfo WHERE path=?1"), _db)) {
+                "uploadinfo WHERE path=?1"));
+        if (!query) {
             return res;
         }
-        _getUploadInfoQuery.bindValue(1, file);
+        query->bindValue(1, file);
 
-        if (!_getUploadInfoQuery.exec()) {
+        if (!query->exec()) {
             return res;
         }
 
-        if (_getUploadInfoQuery.next()) {
+        if (query->next()) {
             bool ok = true;
-            res._chunk = _getUploadInfoQuery.intValue(0);
-            res._transferid = _getUploadInfoQuery.intValue(1);
-            res._errorCount = _getUploadInfoQuery.intValue(2);
-            res._size = _getUploadInfoQuery.int64Value(3);
-            res._modtime = _getUploadInfoQuery.int64Value(4);
-            res._contentChecksum = _getUploadInfoQuery.baValue(5);
+            res._chunk = query->intValue(0);
+            res._transferid = query->intValue(1);
+            res._errorCount = query->intValue(2);
+            res._size = query->int64Value(3);
+            res._modtime = query->int64Value(4);
+            res._contentChecksum = query->baValue(5);
             res._valid = ok;
         }
     }
@@ -1395,29 +1723,33 @@ void SyncJournalDb::setUploadInfo(const QString &file, const SyncJournalDb::Uplo
     }
 
     if (i._valid) {
-        if (!_setUploadInfoQuery.initOrReset(QByteArrayLiteral(
+        const auto query = _queryCache.get(QByteArrayLiteral(
             "INSERT OR REPLACE INTO uploadinfo "
             "(path, chunk, transferid, errorcount, size, modtime, contentChecksum) "
-            "VALUES ( ?1 , ?2, ?3 , ?4 ,  ?5, ?6 , ?7 )"), _db)) {
+            "VALUES ( ?1 , ?2, ?3 , ?4 ,  ?5, ?6 , ?7 )"));
+        if (!query) {
             return;
         }
 
-        _setUploadInfoQuery.bindValue(1, file);
-        _setUploadInfoQuery.bindValue(2, i._chunk);
-        _setUploadInfoQuery.bindValue(3, i._transferid);
-        _setUploadInfoQuery.bindValue(4, i._errorCount);
-        _setUploadInfoQuery.bindValue(5, i._size);
-        _setUploadInfoQuery.bindValue(6, i._modtime);
-        _setUploadInfoQuery.bindValue(7, i._contentChecksum);
+        query->bindValue(1, file);
+        query->bindValue(2, i._chunk);
+        query->bindValue(3, i._transferid);
+        query->bindValue(4, i._errorCount);
+        query->bindValue(5, i._size);
+        query->bindValue(6, i._modtime);
+        query->bindValue(7, i._contentChecksum);
 
-        if (!_setUploadInfoQuery.exec()) {
+        if (!query->exec()) {
             return;
         }
     } else {
-        _deleteUploadInfoQuery.reset_and_clear_bindings();
-        _deleteUploadInfoQuery.bindValue(1, file);
+        const auto query = _queryCache.get(QByteArrayLiteral(DELETE_UPLOAD_INFO_QUERY));
+        if (!query) {
+            return;
+        }
+        query->bindValue(1, file);
 
-        if (!_deleteUploadInfoQuery.exec()) {
+        if (!query->exec()) {
             return;
         }
     }
@@ -1449,7 +1781,8 @@ QVector<uint> SyncJournalDb::deleteStaleUploadInfos(const QSet<QString> &keep)
         }
     }
 
-    deleteBatch(_deleteUploadInfoQuery, superfluousPaths, "uploadinfo");
+    if (const auto deleteQuery = _queryCache.get(QByteArrayLiteral(DELETE_UPLOAD_INFO_QUERY)))
+        deleteBatch(*deleteQuery, superfluousPaths, "uploadinfo");
     return ids;
 }
 
@@ -1462,20 +1795,26 @@ SyncJournalErrorBlacklistRecord SyncJournalDb::errorBlacklistEntry(const QString
         return entry;
 
     if (checkConnect()) {
-        _getErrorBlacklistQuery.reset_and_clear_bindings();
-        _getErrorBlacklistQuery.bindValue(1, file);
-        if (_getErrorBlacklistQuery.exec()) {
-            if (_getErrorBlacklistQuery.next()) {
-                entry._lastTryEtag = _getErrorBlacklistQuery.baValue(0);
-                entry._lastTryModtime = _getErrorBlacklistQuery.int64Value(1);
-                entry._retryCount = _getErrorBlacklistQuery.intValue(2);
-                entry._errorString = _getErrorBlacklistQuery.stringValue(3);
-                entry._lastTryTime = _getErrorBlacklistQuery.int64Value(4);
-                entry._ignoreDuration = _getErrorBlacklistQuery.int64Value(5);
-                entry._renameTarget = _getErrorBlacklistQuery.stringValue(6);
+        // if the file system is case preserving we have to check the blacklist
+        // case insensitively
+        const auto query = _queryCache.get(Utility::fsCasePreserving()
+                ? QByteArrayLiteral(GET_ERROR_BLACKLIST_QUERY " COLLATE NOCASE")
+                : QByteArrayLiteral(GET_ERROR_BLACKLIST_QUERY));
+        if (!query)
+            return entry;
+        query->bindValue(1, file);
+        if (query->exec()) {
+            if (query->next()) {
+                entry._lastTryEtag = query->baValue(0);
+                entry._lastTryModtime = query->int64Value(1);
+                entry._retryCount = query->intValue(2);
+                entry._errorString = query->stringValue(3);
+                entry._lastTryTime = query->int64Value(4);
+                entry._ignoreDuration = query->int64Value(5);
+                entry._renameTarget = query->stringValue(6);
                 entry._errorCategory = static_cast<SyncJournalErrorBlacklistRecord::Category>(
-                    _getErrorBlacklistQuery.intValue(7));
-                entry._requestId = _getErrorBlacklistQuery.baValue(8);
+                    query->intValue(7));
+                entry._requestId = query->baValue(8);
                 entry._file = file;
             }
         }
@@ -1593,24 +1932,25 @@ void SyncJournalDb::setErrorBlacklistEntry(const SyncJournalErrorBlacklistRecord
         return;
     }
 
-    if (!_setErrorBlacklistQuery.initOrReset(QByteArrayLiteral(
+    const auto query = _queryCache.get(QByteArrayLiteral(
         "INSERT OR REPLACE INTO blacklist "
         "(path, lastTryEtag, lastTryModtime, retrycount, errorstring, lastTryTime, ignoreDuration, renameTarget, errorCategory, requestId) "
-        "VALUES ( ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10)"), _db)) {
+        "VALUES ( ?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10)"));
+    if (!query) {
         return;
     }
 
-    _setErrorBlacklistQuery.bindValue(1, item._file);
-    _setErrorBlacklistQuery.bindValue(2, item._lastTryEtag);
-    _setErrorBlacklistQuery.bindValue(3, item._lastTryModtime);
-    _setErrorBlacklistQuery.bindValue(4, item._retryCount);
-    _setErrorBlacklistQuery.bindValue(5, item._errorString);
-    _setErrorBlacklistQuery.bindValue(6, item._lastTryTime);
-    _setErrorBlacklistQuery.bindValue(7, item._ignoreDuration);
-    _setErrorBlacklistQuery.bindValue(8, item._renameTarget);
-    _setErrorBlacklistQuery.bindValue(9, item._errorCategory);
-    _setErrorBlacklistQuery.bindValue(10, item._requestId);
-    _setErrorBlacklistQuery.exec();
+    query->bindValue(1, item._file);
+    query->bindValue(2, item._lastTryEtag);
+    query->bindValue(3, item._lastTryModtime);
+    query->bindValue(4, item._retryCount);
+    query->bindValue(5, item._errorString);
+    query->bindValue(6, item._lastTryTime);
+    query->bindValue(7, item._ignoreDuration);
+    query->bindValue(8, item._renameTarget);
+    query->bindValue(9, item._errorCategory);
+    query->bindValue(10, item._requestId);
+    query->exec();
 }
 
 QVector<SyncJournalDb::PollInfo> SyncJournalDb::getPollInfos()
@@ -1672,18 +2012,19 @@ QStringList SyncJournalDb::getSelectiveSyncList(SyncJournalDb::SelectiveSyncList
         return result;
     }
 
-    if (!_getSelectiveSyncListQuery.initOrReset(QByteArrayLiteral("SELECT path FROM selectivesync WHERE type=?1"), _db)) {
+    const auto query = _queryCache.get(QByteArrayLiteral("SELECT path FROM selectivesync WHERE type=?1"));
+    if (!query) {
         *ok = false;
         return result;
     }
 
-    _getSelectiveSyncListQuery.bindValue(1, int(type));
-    if (!_getSelectiveSyncListQuery.exec()) {
+    query->bindValue(1, int(type));
+    if (!query->exec()) {
         *ok = false;
         return result;
     }
-    while (_getSelectiveSyncListQuery.next()) {
-        auto entry = _getSelectiveSyncListQuery.stringValue(0);
+    while (query->next()) {
+        auto entry = query->stringValue(0);
         if (!entry.endsWith(QLatin1Char('/'))) {
             entry.append(QLatin1Char('/'));
         }
@@ -1800,19 +2141,19 @@ QByteArray SyncJournalDb::getChecksumType(int checksumTypeId)
     }
 
     // Retrieve the id
-    auto &query = _getChecksumTypeQuery;
-    if (!query.initOrReset(QByteArrayLiteral("SELECT name FROM checksumtype WHERE id=?1"), _db))
+    const auto query = _queryCache.get(QByteArrayLiteral("SELECT name FROM checksumtype WHERE id=?1"));
+    if (!query)
         return {};
-    query.bindValue(1, checksumTypeId);
-    if (!query.exec()) {
+    query->bindValue(1, checksumTypeId);
+    if (!query->exec()) {
         return 0;
     }
 
-    if (!query.next()) {
+    if (!query->next()) {
         qCWarning(lcDb) << "No checksum type mapping found for" << checksumTypeId;
         return 0;
     }
-    return query.baValue(0);
+    return query->baValue(0);
 }
 
 int SyncJournalDb::mapChecksumType(const QByteArray &checksumType)
@@ -1826,26 +2167,28 @@ int SyncJournalDb::mapChecksumType(const QByteArray &checksumType)
         return *it;
 
     // Ensure the checksum type is in the db
-    if (!_insertChecksumTypeQuery.initOrReset(QByteArrayLiteral("INSERT OR IGNORE INTO checksumtype (name) VALUES (?1)"), _db))
+    auto query = _queryCache.get(QByteArrayLiteral("INSERT OR IGNORE INTO checksumtype (name) VALUES (?1)"));
+    if (!query)
         return 0;
-    _insertChecksumTypeQuery.bindValue(1, checksumType);
-    if (!_insertChecksumTypeQuery.exec()) {
+    query->bindText(1, checksumType);
+    if (!query->exec()) {
         return 0;
     }
 
     // Retrieve the id
-    if (!_getChecksumTypeIdQuery.initOrReset(QByteArrayLiteral("SELECT id FROM checksumtype WHERE name=?1"), _db))
+    query = _queryCache.get(QByteArrayLiteral("SELECT id FROM checksumtype WHERE name=?1"));
+    if (!query)
         return 0;
-    _getChecksumTypeIdQuery.bindValue(1, checksumType);
-    if (!_getChecksumTypeIdQuery.exec()) {
+    query->bindText(1, checksumType);
+    if (!query->exec()) {
         return 0;
     }
 
-    if (!_getChecksumTypeIdQuery.next()) {
+    if (!query->next()) {
         qCWarning(lcDb) << "No checksum type mapping found for" << checksumType;
         return 0;
     }
-    auto value = _getChecksumTypeIdQuery.intValue(0);
+    auto value = query->intValue(0);
     _checksymTypeCache[checksumType] = value;
     return value;
 }
@@ -1857,17 +2200,18 @@ QByteArray SyncJournalDb::dataFingerprint()
         return QByteArray();
     }
 
-    if (!_getDataFingerprintQuery.initOrReset(QByteArrayLiteral("SELECT fingerprint FROM datafingerprint"), _db))
+    const auto query = _queryCache.get(QByteArrayLiteral("SELECT fingerprint FROM datafingerprint"));
+    if (!query)
         return QByteArray();
 
-    if (!_getDataFingerprintQuery.exec()) {
+    if (!query->exec()) {
         return QByteArray();
     }
 
-    if (!_getDataFingerprintQuery.next()) {
+    if (!query->next()) {
         return QByteArray();
     }
-    return _getDataFingerprintQuery.baValue(0);
+    return query->baValue(0);
 }
 
 void SyncJournalDb::setDataFingerprint(const QByteArray &dataFingerprint)
@@ -1877,15 +2221,18 @@ void SyncJournalDb::setDataFingerprint(const QByteArray &dataFingerprint)
         return;
     }
 
-    if (!_setDataFingerprintQuery1.initOrReset(QByteArrayLiteral("DELETE FROM datafingerprint;"), _db)
-        || !_setDataFingerprintQuery2.initOrReset(QByteArrayLiteral("INSERT INTO datafingerprint (fingerprint) VALUES (?1);"), _db)) {
+    auto query = _queryCache.get(QByteArrayLiteral("DELETE FROM datafingerprint;"));
+    if (!query) {
         return;
     }
+    query->exec();
 
-    _setDataFingerprintQuery1.exec();
-
-    _setDataFingerprintQuery2.bindValue(1, dataFingerprint);
-    _setDataFingerprintQuery2.exec();
+    query = _queryCache.get(QByteArrayLiteral("INSERT INTO datafingerprint (fingerprint) VALUES (?1);"));
+    if (!query) {
+        return;
+    }
+    query->bindValue(1, dataFingerprint);
+    query->exec();
 }
 
 void SyncJournalDb::setConflictRecord(const ConflictRecord &record)
@@ -1894,18 +2241,19 @@ void SyncJournalDb::setConflictRecord(const ConflictRecord &record)
     if (!checkConnect())
         return;
 
-    auto &query = _setConflictRecordQuery;
-    ASSERT(query.initOrReset(QByteArrayLiteral(
-                          "INSERT OR REPLACE INTO conflicts "
-                          "(path, baseFileId, baseModtime, baseEtag, basePath) "
-                          "VALUES (?1, ?2, ?3, ?4, ?5);"),
-        _db));
-    query.bindValue(1, record.path);
-    query.bindValue(2, record.baseFileId);
-    query.bindValue(3, record.baseModtime);
-    query.bindValue(4, record.baseEtag);
-    query.bindValue(5, record.initialBasePath);
-    ASSERT(query.exec());
+    const auto query = _queryCache.get(QByteArrayLiteral(
+        "INSERT OR REPLACE INTO conflicts "
+        "(path, baseFileId, baseModtime, baseEtag, basePath) "
+        "VALUES (?1, ?2, ?3, ?4, ?5);"));
+    ASSERT(query);
+    if (!query)
+        return;
+    query->bindValue(1, record.path);
+    query->bindValue(2, record.baseFileId);
+    query->bindValue(3, record.baseModtime);
+    query->bindValue(4, record.baseEtag);
+    query->bindValue(5, record.initialBasePath);
+    ASSERT(query->exec());
 }
 
 ConflictRecord SyncJournalDb::conflictRecord(const QByteArray &path)
@@ -1915,18 +2263,20 @@ ConflictRecord SyncJournalDb::conflictRecord(const QByteArray &path)
     QMutexLocker locker(&_mutex);
     if (!checkConnect())
         return entry;
-    auto &query = _getConflictRecordQuery;
-    ASSERT(query.initOrReset(QByteArrayLiteral("SELECT baseFileId, baseModtime, baseEtag, basePath FROM conflicts WHERE path=?1;"), _db));
-    query.bindValue(1, path);
-    ASSERT(query.exec());
-    if (!query.next())
+    const auto query = _queryCache.get(QByteArrayLiteral("SELECT baseFileId, baseModtime, baseEtag, basePath FROM conflicts WHERE path=?1;"));
+    ASSERT(query);
+    if (!query)
+        return entry;
+    query->bindValue(1, path);
+    ASSERT(query->exec());
+    if (!query->next())
         return entry;
 
     entry.path = path;
-    entry.baseFileId = query.baValue(0);
-    entry.baseModtime = query.int64Value(1);
-    entry.baseEtag = query.baValue(2);
-    entry.initialBasePath = query.baValue(3);
+    entry.baseFileId = query->baValue(0);
+    entry.baseModtime = query->int64Value(1);
+    entry.baseEtag = query->baValue(2);
+    entry.initialBasePath = query->baValue(3);
     return entry;
 }
 
@@ -1936,9 +2286,12 @@ void SyncJournalDb::deleteConflictRecord(const QByteArray &path)
     if (!checkConnect())
         return;
 
-    ASSERT(_deleteConflictRecordQuery.initOrReset("DELETE FROM conflicts WHERE path=?1;", _db));
-    _deleteConflictRecordQuery.bindValue(1, path);
-    ASSERT(_deleteConflictRecordQuery.exec());
+    const auto query = _queryCache.get(QByteArrayLiteral("DELETE FROM conflicts WHERE path=?1;"));
+    ASSERT(query);
+    if (!query)
+        return;
+    query->bindValue(1, path);
+    ASSERT(query->exec());
 }
 
 QByteArrayList SyncJournalDb::conflictRecordPaths()
@@ -2039,6 +2392,12 @@ bool SyncJournalDb::isConnected()
     return checkConnect();
 }
 
+SqlDatabase::Statistics SyncJournalDb::queryStatistics()
+{
+    QMutexLocker lock(&_mutex);
+    return _db.statistics();
+}
+
 bool operator==(const SyncJournalDb::DownloadInfo &lhs,
     const SyncJournalDb::DownloadInfo &rhs)
 {
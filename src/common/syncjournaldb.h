@@ -58,7 +58,11 @@ public:
     bool getFileRecord(const QString &filename, SyncJournalFileRecord *rec) { return getFileRecord(filename.toUtf8(), rec); }
     bool getFileRecord(const QByteArray &filename, SyncJournalFileRecord *rec);
     bool getFileRecordByInode(quint64 inode, SyncJournalFileRecord *rec);
+    /// Calls rowCallback with the inode of every record that has one, in one query
+    bool listInodes(const std::function<void(quint64 inode)> &rowCallback);
     bool getFileRecordsByFileId(const QByteArray &fileId, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
+    /// Finds the records with the given content checksum, like "SHA1:abc"
+    bool getFileRecordsByChecksum(const QByteArray &checksumHeader, const std::function<void(const SyncJournalFileRecord &)> &rowCallback);
     bool getFilesBelowPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
     bool listFilesInPath(const QByteArray &path, const std::function<void(const SyncJournalFileRecord&)> &rowCallback);
     bool setFileRecord(const SyncJournalFileRecord &record);
@@ -94,6 +98,28 @@ public:
         int _errorCount;
         bool _valid;
     };
+    /** One byte range of a segmented download, see getDownloadSegments() */
+    struct DownloadSegment
+    {
+        DownloadSegment()
+            : _start(0)
+            , _end(0)
+            , _received(0)
+        {
+        }
+        qint64 _start; // offset of the first byte
+        qint64 _end; // offset after the last byte
+        qint64 _received; // bytes already written, starting at _start
+
+        qint64 remaining() const { return _end - _start - _received; }
+    };
+    /** One content-defined chunk of an uploaded file, see getContentChunks() */
+    struct ContentChunk
+    {
+        qint64 _offset = 0;
+        qint64 _size = 0;
+        QByteArray _hash; // raw SHA1 of the chunk data
+    };
     struct UploadInfo
     {
         UploadInfo()
@@ -129,6 +155,25 @@ public:
     DownloadInfo getDownloadInfo(const QString &file);
     void setDownloadInfo(const QString &file, const DownloadInfo &i);
     QVector<DownloadInfo> getAndDeleteStaleDownloadInfos(const QSet<QString> &keep);
+    /**
+     * The ranges of a download that is fetched over several connections.
+     *
+     * They belong to the DownloadInfo of the same file and are removed
+     * together with it.
+     */
+    QVector<DownloadSegment> getDownloadSegments(const QString &file);
+    void setDownloadSegments(const QString &file, const QVector<DownloadSegment> &segments);
+
+    /**
+     * The chunks of a file as it was last uploaded, together with the etag
+     * the server gave to that version.
+     *
+     * An upload of a new version only has to send the chunks the server
+     * doesn't have yet. The chunks are only valid as long as the etag is
+     * the one of the file on the server.
+     */
+    QVector<ContentChunk> getContentChunks(const QString &file, QByteArray *etag);
+    void setContentChunks(const QString &file, const QByteArray &etag, const QVector<ContentChunk> &chunks);
     int downloadInfoCount();
 
     UploadInfo getUploadInfo(const QString &file);
@@ -206,6 +251,11 @@ public:
      */
     bool isConnected();
 
+    /**
+     * Snapshot of the query counters of the underlying database connection.
+     */
+    SqlDatabase::Statistics queryStatistics();
+
     /**
      * Returns the checksum type for an id.
      */
@@ -265,6 +315,8 @@ private:
     bool updateDatabaseStructure();
     bool updateMetadataTableStructure();
     bool updateErrorBlacklistTableStructure();
+    // Computes the parent and sortkey columns of the metadata records matching condition
+    bool fillParentAndSortKeyColumns(const QByteArray &condition);
     bool sqlFail(const QString &log, const SqlQuery &query);
     void commitInternal(const QString &context, bool startTrans = true);
     void startTransaction();
@@ -281,42 +333,13 @@ private:
     int mapChecksumType(const QByteArray &checksumType);
 
     SqlDatabase _db;
+    SqlQueryCache _queryCache; // all statements that are run repeatedly
     QString _dbFile;
     QMutex _mutex; // Public functions are protected with the mutex.
     QMap<QByteArray, int> _checksymTypeCache;
     int _transaction;
     bool _metadataTableIsEmpty;
 
-    SqlQuery _getFileRecordQuery;
-    SqlQuery _getFileRecordQueryByInode;
-    SqlQuery _getFileRecordQueryByFileId;
-    SqlQuery _getFilesBelowPathQuery;
-    SqlQuery _getAllFilesQuery;
-    SqlQuery _listFilesInPathQuery;
-    SqlQuery _setFileRecordQuery;
-    SqlQuery _setFileRecordChecksumQuery;
-    SqlQuery _setFileRecordLocalMetadataQuery;
-    SqlQuery _getDownloadInfoQuery;
-    SqlQuery _setDownloadInfoQuery;
-    SqlQuery _deleteDownloadInfoQuery;
-    SqlQuery _getUploadInfoQuery;
-    SqlQuery _setUploadInfoQuery;
-    SqlQuery _deleteUploadInfoQuery;
-    SqlQuery _deleteFileRecordPhash;
-    SqlQuery _deleteFileRecordRecursively;
-    SqlQuery _getErrorBlacklistQuery;
-    SqlQuery _setErrorBlacklistQuery;
-    SqlQuery _getSelectiveSyncListQuery;
-    SqlQuery _getChecksumTypeIdQuery;
-    SqlQuery _getChecksumTypeQuery;
-    SqlQuery _insertChecksumTypeQuery;
-    SqlQuery _getDataFingerprintQuery;
-    SqlQuery _setDataFingerprintQuery1;
-    SqlQuery _setDataFingerprintQuery2;
-    SqlQuery _getConflictRecordQuery;
-    SqlQuery _setConflictRecordQuery;
-    SqlQuery _deleteConflictRecordQuery;
-
     /* Storing etags to these folders, or their parent folders, is filtered out.
      *
      * When avoidReadFromDbOnNextSync() is called some etags to _invalid_ in the
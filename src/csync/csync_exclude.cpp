@@ -244,7 +244,10 @@ void ExcludedFiles::addExcludeFilePath(const QString &path)
 
 void ExcludedFiles::setExcludeConflictFiles(bool onoff)
 {
+    if (_excludeConflictFiles == onoff)
+        return;
     _excludeConflictFiles = onoff;
+    emit excludesChanged();
 }
 
 void ExcludedFiles::addManualExclude(const QString &expr)
@@ -736,4 +739,6 @@ void ExcludedFiles::prepare()
     _fullRegexFile.optimize();
     _fullRegexDir.setPatternOptions(patternOptions);
     _fullRegexDir.optimize();
+
+    emit excludesChanged();
 }
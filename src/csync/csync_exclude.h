@@ -144,6 +144,13 @@ public slots:
      */
     bool reloadExcludeFiles();
 
+signals:
+    /**
+     * Emitted when isExcluded() may give different results than before,
+     * for users that cache them.
+     */
+    void excludesChanged();
+
 private:
     /**
      * Returns true if the version directive indicates the next line
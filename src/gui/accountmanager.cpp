@@ -21,6 +21,7 @@
 #include <cookiejar.h>
 #include <QSettings>
 #include <QDir>
+#include <QJsonDocument>
 #include <QNetworkAccessManager>
 
 namespace {
@@ -32,6 +33,9 @@ static const char caCertsKeyC[] = "CaCertificates";
 static const char accountsC[] = "Accounts";
 static const char versionC[] = "version";
 static const char serverVersionC[] = "serverVersion";
+static const char serverCapabilitiesC[] = "serverCapabilities";
+static const char davDisplayNameC[] = "dav_display_name";
+static const char http2SupportedC[] = "http2Supported";
 
 // The maximum versions that this client can read
 static const int maxAccountsVersion = 2;
@@ -213,6 +217,13 @@ void AccountManager::saveAccountHelper(Account *acc, QSettings &settings, bool s
     settings.setValue(QLatin1String(urlC), acc->_url.toString());
     settings.setValue(QLatin1String(davUserC), acc->_davUser);
     settings.setValue(QLatin1String(serverVersionC), acc->_serverVersion);
+    // Cached to connect without waiting for the server on the next start
+    settings.setValue(QLatin1String(davDisplayNameC), acc->_displayName);
+    settings.setValue(QLatin1String(http2SupportedC), acc->_http2Supported);
+    if (acc->_capabilities.isValid()) {
+        settings.setValue(QLatin1String(serverCapabilitiesC),
+            QString::fromUtf8(QJsonDocument::fromVariant(acc->_capabilities.raw()).toJson(QJsonDocument::Compact)));
+    }
     if (acc->_credentials) {
         if (saveCredentials) {
             // Only persist the credentials if the parameter is set, on migration from 1.8.x
@@ -276,6 +287,15 @@ AccountPtr AccountManager::loadAccountHelper(QSettings &settings)
     acc->_serverVersion = settings.value(QLatin1String(serverVersionC)).toString();
     acc->_davUser = settings.value(QLatin1String(davUserC)).toString();
 
+    // The server info of the last run, ConnectionValidator revalidates it
+    auto caps = QJsonDocument::fromJson(settings.value(QLatin1String(serverCapabilitiesC)).toString().toUtf8());
+    if (caps.isObject() && !acc->_davUser.isEmpty()) {
+        acc->_capabilities = Capabilities(caps.toVariant().toMap());
+        acc->_displayName = settings.value(QLatin1String(davDisplayNameC)).toString();
+        acc->_http2Supported = settings.value(QLatin1String(http2SupportedC)).toBool();
+        acc->_serverInfoFromCache = true;
+    }
+
     // We want to only restore settings for that auth type and the user value
     acc->_settingsMap.insert(QLatin1String(userC), settings.value(userC));
     QString authTypePrefix = "http_";
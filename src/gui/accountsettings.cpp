@@ -307,7 +307,7 @@ void AccountSettings::slotCustomContextMenuRequested(const QPoint &pos)
 
     if (!folderPaused) {
         ac = menu->addAction(tr("Force sync now"));
-        if (folderMan->currentSyncFolder() == folder) {
+        if (folderMan->currentSyncFolders().contains(folder)) {
             ac->setText(tr("Restart sync"));
         }
         ac->setEnabled(folderConnected);
@@ -616,10 +616,22 @@ void AccountSettings::slotForceSyncCurrentFolder()
 {
     FolderMan *folderMan = FolderMan::instance();
     if (auto selectedFolder = folderMan->folder(selectedFolderAlias())) {
-        // Terminate and reschedule any running sync
-        if (Folder *current = folderMan->currentSyncFolder()) {
-            folderMan->terminateSyncProcess();
-            folderMan->scheduleFolder(current);
+        if (folderMan->currentSyncFolders().contains(selectedFolder)) {
+            // Restart the running sync
+            folderMan->terminateSyncProcess(selectedFolder);
+        } else if (!folderMan->mayStartSync(selectedFolder)) {
+            // Make room by terminating and rescheduling a running sync,
+            // preferably one of the same account
+            Folder *preempted = nullptr;
+            foreach (Folder *f, folderMan->currentSyncFolders()) {
+                if (!preempted || f->accountState() == selectedFolder->accountState()) {
+                    preempted = f;
+                }
+            }
+            if (preempted) {
+                folderMan->terminateSyncProcess(preempted);
+                folderMan->scheduleFolder(preempted);
+            }
         }
 
         selectedFolder->slotWipeErrorBlacklist(); // issue #6757
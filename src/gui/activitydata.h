@@ -59,6 +59,7 @@ public:
     QUrl _link;
     QDateTime _dateTime;
     QString _accName; /* display name of the account involved */
+    QString _accountId; /* Account::id() of the account involved, display names aren't unique */
 
     QVector<ActivityLink> _links; /* These links are transformed into buttons that
                                    * call links as reactions on the activity */
@@ -33,6 +33,9 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcActivity, "gui.activity", QtInfoMsg)
 
+// Each refresh fetches the latest 100, older ones stay until there are more than these
+static const int maxActivitiesPerAccount = 1000;
+
 ActivityListModel::ActivityListModel(QWidget *parent)
     : QAbstractListModel(parent)
 {
@@ -99,17 +102,16 @@ int ActivityListModel::rowCount(const QModelIndex &) const
 
 // current strategy: Fetch 100 items per Account
 // ATTENTION: This method is const and thus it is not possible to modify
-// the _activityLists hash or so. Doesn't make it easier...
+// the _activityIds hash or so. Doesn't make it easier...
 bool ActivityListModel::canFetchMore(const QModelIndex &) const
 {
-    if (_activityLists.count() == 0)
+    if (_activityIds.count() == 0)
         return true;
 
-    for (auto i = _activityLists.begin(); i != _activityLists.end(); ++i) {
+    for (auto i = _activityIds.begin(); i != _activityIds.end(); ++i) {
         AccountState *ast = i.key();
         if (ast && ast->isConnected()) {
-            ActivityList activities = i.value();
-            if (activities.count() == 0 && !_currentlyFetching.contains(ast)) {
+            if (i.value().isEmpty() && !_currentlyFetching.contains(ast)) {
                 return true;
             }
         }
@@ -120,13 +122,16 @@ bool ActivityListModel::canFetchMore(const QModelIndex &) const
 
 void ActivityListModel::startFetchJob(AccountState *s)
 {
-    if (!s->isConnected()) {
+    if (!s->isConnected() || _currentlyFetching.contains(s)) {
         return;
     }
     JsonApiJob *job = new JsonApiJob(s->account(), QLatin1String("ocs/v1.php/cloud/activity"), this);
     QObject::connect(job, &JsonApiJob::jsonReceived,
         this, &ActivityListModel::slotActivitiesReceived);
+    QObject::connect(job, &JsonApiJob::notModified,
+        this, &ActivityListModel::slotActivitiesNotModified);
     job->setProperty("AccountStatePtr", QVariant::fromValue<QPointer<AccountState>>(s));
+    job->setIfNoneMatch(_activityEtags.value(s));
 
     QUrlQuery params;
     params.addQueryItem(QLatin1String("page"), QLatin1String("0"));
@@ -155,6 +160,7 @@ void ActivityListModel::slotActivitiesReceived(const QJsonDocument &json, int st
         Activity a;
         a._type = Activity::ActivityType;
         a._accName = ast->account()->displayName();
+        a._accountId = ast->account()->id();
         a._id = json.value("id").toInt();
         a._subject = json.value("subject").toString();
         a._message = json.value("message").toString();
@@ -164,31 +170,60 @@ void ActivityListModel::slotActivitiesReceived(const QJsonDocument &json, int st
         list.append(a);
     }
 
-    _activityLists[ast] = list;
+    // Only a successful answer may be reused for the next refreshes
+    auto job = qobject_cast<JsonApiJob *>(sender());
+    if (statusCode == 100 && job) {
+        _activityEtags[ast] = job->etag();
+    } else {
+        _activityEtags.remove(ast);
+    }
 
     emit activityJobStatusCode(ast, statusCode);
 
-    combineActivityLists();
+    mergeActivities(ast, list);
 }
 
-
-void ActivityListModel::combineActivityLists()
+void ActivityListModel::slotActivitiesNotModified()
 {
-    ActivityList resultList;
+    auto ast = qvariant_cast<QPointer<AccountState>>(sender()->property("AccountStatePtr"));
+    if (!ast)
+        return;
 
-    foreach (ActivityList list, _activityLists.values()) {
-        resultList.append(list);
-    }
+    _currentlyFetching.remove(ast);
+    qCDebug(lcActivity) << "Activities of" << ast->account()->displayName() << "didn't change";
 
-    std::sort(resultList.begin(), resultList.end());
+    // The answer was the successful one the ETag was stored for
+    emit activityJobStatusCode(ast, 100);
+}
 
-    beginResetModel();
-    _finalList.clear();
-    endResetModel();
+void ActivityListModel::mergeActivities(AccountState *ast, const ActivityList &list)
+{
+    QSet<qlonglong> &ids = _activityIds[ast];
+    foreach (const Activity &activity, list) {
+        if (ids.contains(activity._id))
+            continue;
+        ids.insert(activity._id);
+
+        int row = std::upper_bound(_finalList.begin(), _finalList.end(), activity) - _finalList.begin();
+        beginInsertRows(QModelIndex(), row, row);
+        _finalList.insert(row, activity);
+        endInsertRows();
+    }
+    evictActivities(ast);
+}
 
-    beginInsertRows(QModelIndex(), 0, resultList.count());
-    _finalList = resultList;
-    endInsertRows();
+void ActivityListModel::evictActivities(AccountState *ast)
+{
+    QSet<qlonglong> &ids = _activityIds[ast];
+    const QString accountId = ast->account()->id();
+    for (int row = _finalList.count() - 1; row >= 0 && ids.count() > maxActivitiesPerAccount; --row) {
+        if (_finalList.at(row)._accountId != accountId)
+            continue;
+        beginRemoveRows(QModelIndex(), row, row);
+        ids.remove(_finalList.at(row)._id);
+        _finalList.removeAt(row);
+        endRemoveRows();
+    }
 }
 
 void ActivityListModel::fetchMore(const QModelIndex &)
@@ -196,8 +231,8 @@ void ActivityListModel::fetchMore(const QModelIndex &)
     QList<AccountStatePtr> accounts = AccountManager::instance()->accounts();
 
     foreach (const AccountStatePtr &asp, accounts) {
-        if (!_activityLists.contains(asp.data()) && asp->isConnected()) {
-            _activityLists[asp.data()] = ActivityList();
+        if (!_activityIds.contains(asp.data()) && asp->isConnected()) {
+            _activityIds[asp.data()] = QSet<qlonglong>();
             startFetchJob(asp.data());
         }
     }
@@ -205,29 +240,23 @@ void ActivityListModel::fetchMore(const QModelIndex &)
 
 void ActivityListModel::slotRefreshActivity(AccountState *ast)
 {
-    if (ast && _activityLists.contains(ast)) {
-        _activityLists.remove(ast);
-    }
     startFetchJob(ast);
 }
 
 void ActivityListModel::slotRemoveAccount(AccountState *ast)
 {
-    if (_activityLists.contains(ast)) {
-        int i = 0;
-        const QString accountToRemove = ast->account()->displayName();
-
-        QMutableListIterator<Activity> it(_finalList);
+    if (_activityIds.contains(ast)) {
+        const QString accountToRemove = ast->account()->id();
 
-        while (it.hasNext()) {
-            Activity activity = it.next();
-            if (activity._accName == accountToRemove) {
-                beginRemoveRows(QModelIndex(), i, i + 1);
-                it.remove();
+        for (int row = _finalList.count() - 1; row >= 0; --row) {
+            if (_finalList.at(row)._accountId == accountToRemove) {
+                beginRemoveRows(QModelIndex(), row, row);
+                _finalList.removeAt(row);
                 endRemoveRows();
             }
         }
-        _activityLists.remove(ast);
+        _activityIds.remove(ast);
+        _activityEtags.remove(ast);
         _currentlyFetching.remove(ast);
     }
 }
@@ -32,6 +32,11 @@ class AccountState;
  * @ingroup gui
  *
  * Simple list model to provide the list view with data.
+ *
+ * Refreshing an account only inserts the activities that aren't in the list
+ * yet, at their place in the list. Answers that didn't change since the last
+ * refresh aren't even transferred, see JsonApiJob::setIfNoneMatch(). The
+ * oldest activities of an account are dropped beyond maxActivitiesPerAccount.
  */
 
 class ActivityListModel : public QAbstractListModel
@@ -54,16 +59,27 @@ public slots:
 
 private slots:
     void slotActivitiesReceived(const QJsonDocument &json, int statusCode);
+    void slotActivitiesNotModified();
 
 signals:
     void activityJobStatusCode(AccountState *ast, int statusCode);
 
 private:
     void startFetchJob(AccountState *s);
-    void combineActivityLists();
 
-    QMap<AccountState *, ActivityList> _activityLists;
-    ActivityList _finalList;
+    /** Inserts the activities that aren't in _finalList yet at their place */
+    void mergeActivities(AccountState *ast, const ActivityList &list);
+
+    /** Drops the account's oldest activities beyond maxActivitiesPerAccount */
+    void evictActivities(AccountState *ast);
+
+    /** The ids of each account's activities in _finalList */
+    QMap<AccountState *, QSet<qlonglong>> _activityIds;
+
+    /** The ETag of each account's last activity list */
+    QMap<AccountState *, QByteArray> _activityEtags;
+
+    ActivityList _finalList; // sorted youngest first
     QSet<AccountState *> _currentlyFetching;
 };
 }
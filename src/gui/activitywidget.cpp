@@ -94,6 +94,12 @@ ActivityWidget::ActivityWidget(QWidget *parent)
     connect(_copyBtn, &QAbstractButton::clicked, this, &ActivityWidget::copyToClipboard);
 
     connect(_model, &QAbstractItemModel::rowsInserted, this, &ActivityWidget::rowsInserted);
+    // Refreshes that didn't bring new activities don't insert rows
+    connect(_model, &ActivityListModel::activityJobStatusCode, this, &ActivityWidget::rowsInserted);
+
+    _notificationHandler = new ServerNotificationHandler(this);
+    connect(_notificationHandler, &ServerNotificationHandler::newNotificationList,
+        this, &ActivityWidget::slotBuildNotificationDisplay);
 
     connect(_ui->_activityList, &QListView::activated, this, &ActivityWidget::slotOpenFile);
 
@@ -113,14 +119,9 @@ void ActivityWidget::slotRefreshActivities(AccountState *ptr)
 
 void ActivityWidget::slotRefreshNotifications(AccountState *ptr)
 {
-    // start a server notification handler if no notification requests
-    // are running
+    // fetch the notifications if no notification requests are running
     if (_notificationRequestsRunning == 0) {
-        ServerNotificationHandler *snh = new ServerNotificationHandler;
-        connect(snh, &ServerNotificationHandler::newNotificationList,
-            this, &ActivityWidget::slotBuildNotificationDisplay);
-
-        snh->slotFetchNotifications(ptr);
+        _notificationHandler->slotFetchNotifications(ptr);
     } else {
         qCWarning(lcActivity) << "Notification request counter not zero.";
     }
@@ -129,6 +130,7 @@ void ActivityWidget::slotRefreshNotifications(AccountState *ptr)
 void ActivityWidget::slotRemoveAccount(AccountState *ptr)
 {
     _model->slotRemoveAccount(ptr);
+    _notificationHandler->slotRemoveAccount(ptr);
 }
 
 void ActivityWidget::showLabels()
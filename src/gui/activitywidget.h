@@ -40,6 +40,7 @@ class IssuesWidget;
 class JsonApiJob;
 class NotificationWidget;
 class ActivityListModel;
+class ServerNotificationHandler;
 
 namespace Ui {
     class ActivityWidget;
@@ -115,6 +116,7 @@ private:
     int _notificationRequestsRunning;
 
     ActivityListModel *_model;
+    ServerNotificationHandler *_notificationHandler;
     QVBoxLayout *_notificationsLayout;
 };
 
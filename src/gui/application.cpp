@@ -27,6 +27,7 @@
 #include "folder.h"
 #include "folderman.h"
 #include "logger.h"
+#include "tracelog.h"
 #include "configfile.h"
 #include "socketapi.h"
 #include "sslerrordialog.h"
@@ -74,6 +75,7 @@ namespace {
         "                         (to be used with --logdir)\n"
         "  --logflush           : flush the log file after every write.\n"
         "  --logdebug           : also output debug-level messages in the log.\n"
+        "  --tracefile <file>   : write a binary trace log to <file>, see tracedump.\n"
         "  --confdir <dirname>  : Use the given configuration folder.\n";
 
     QString applicationTrPath()
@@ -338,6 +340,11 @@ Application::~Application()
 
     // Remove the account from the account manager so it can be deleted.
     AccountManager::instance()->shutdown();
+
+    // The message handler may still log during static destruction, after
+    // the trace log's writer is gone
+    Logger::instance()->setTraceDebug(false);
+    TraceLog::instance()->stop();
 }
 
 void Application::slotAccountStateRemoved(AccountState *accountState)
@@ -473,6 +480,14 @@ void Application::setupLogging()
     logger->setLogExpire(_logExpire);
     logger->setLogFlush(_logFlush);
     logger->setLogDebug(_logDebug);
+    if (!_traceFile.isEmpty() && !TraceLog::instance()->isActive()) {
+        // Debug output is what the trace log is for
+        if (TraceLog::instance()->start(_traceFile)) {
+            logger->setTraceDebug(true);
+        } else {
+            qCWarning(lcApplication) << "Could not open trace file" << _traceFile;
+        }
+    }
     if (!logger->isLoggingToFile() && ConfigFile().automaticLogDir()) {
         logger->setupTemporaryFolderLogDir();
     }
@@ -538,6 +553,12 @@ void Application::parseOptions(const QStringList &options)
             } else {
                 showHint("Log expiration not specified");
             }
+        } else if (option == QLatin1String("--tracefile")) {
+            if (it.hasNext() && !it.peekNext().startsWith(QLatin1String("--"))) {
+                _traceFile = it.next();
+            } else {
+                showHint("Trace file not specified");
+            }
         } else if (option == QLatin1String("--logflush")) {
             _logFlush = true;
         } else if (option == QLatin1String("--logdebug")) {
@@ -37,6 +37,8 @@ ConnectionValidator::ConnectionValidator(AccountPtr account, QObject *parent)
     : QObject(parent)
     , _account(account)
     , _isCheckingServerAndAuth(false)
+    , _reportedFromCache(false)
+    , _serverInfoChanged(false)
 {
 }
 
@@ -84,6 +86,13 @@ void ConnectionValidator::systemProxyLookupDone(const QNetworkProxy &proxy)
 // The actual check
 void ConnectionValidator::slotCheckServerAndAuth()
 {
+    // Connect with the server info of the last run right after the
+    // credentials were checked, see slotAuthSuccess
+    if (_account->isServerInfoFromCache() && !_reportedFromCache) {
+        checkAuthentication();
+        return;
+    }
+
     CheckServerJob *checkJob = new CheckServerJob(_account, this);
     checkJob->setTimeout(timeoutToUseMsec);
     checkJob->setIgnoreCredentialFailure(true);
@@ -124,6 +133,12 @@ void ConnectionValidator::slotStatusFound(const QUrl &url, const QJsonObject &in
         return;
     }
 
+    // The authentication was checked before Connected was reported
+    if (_reportedFromCache) {
+        checkServerCapabilities();
+        return;
+    }
+
     // now check the authentication
     QTimer::singleShot(0, this, &ConnectionValidator::checkAuthentication);
 }
@@ -213,6 +228,14 @@ void ConnectionValidator::slotAuthSuccess()
         reportResult(Connected);
         return;
     }
+    if (_account->isServerInfoFromCache() && !_reportedFromCache) {
+        qCInfo(lcConnectionValidator) << "Connected with the cached server info of" << _account->url() << "revalidating it";
+        _account->setServerInfoFromCache(false);
+        _reportedFromCache = true;
+        emit connectionResult(Connected, _errors);
+        slotCheckServerAndAuth();
+        return;
+    }
     checkServerCapabilities();
 }
 
@@ -240,6 +263,9 @@ void ConnectionValidator::slotCapabilitiesRecieved(const QJsonDocument &json)
 {
     auto caps = json.object().value("ocs").toObject().value("data").toObject().value("capabilities").toObject();
     qCInfo(lcConnectionValidator) << "Server capabilities" << caps;
+    if (caps.toVariantMap() != _account->capabilities().raw()) {
+        _serverInfoChanged = true;
+    }
     _account->setCapabilities(caps.toVariantMap());
 
     // New servers also report the version in the capabilities
@@ -273,6 +299,9 @@ void ConnectionValidator::fetchUser()
 bool ConnectionValidator::setAndCheckServerVersion(const QString &version)
 {
     qCInfo(lcConnectionValidator) << _account->url() << "has server version" << version;
+    if (version != _account->serverVersion()) {
+        _serverInfoChanged = true;
+    }
     _account->setServerVersion(version);
 
     // We cannot deal with servers < 7.0.0
@@ -291,8 +320,11 @@ bool ConnectionValidator::setAndCheckServerVersion(const QString &version)
     // Actual decision if we should use HTTP/2 is done in AccessManager::createRequest
     if (auto job = qobject_cast<AbstractNetworkJob *>(sender())) {
         if (auto reply = job->reply()) {
-            _account->setHttp2Supported(
-                reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool());
+            bool http2Supported = reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool();
+            if (http2Supported != _account->isHttp2Supported()) {
+                _serverInfoChanged = true;
+            }
+            _account->setHttp2Supported(http2Supported);
         }
     }
 #endif
@@ -306,8 +338,9 @@ void ConnectionValidator::slotUserFetched(const QJsonDocument &json)
         _account->setDavUser(user);
     }
     QString displayName = json.object().value("ocs").toObject().value("data").toObject().value("display-name").toString();
-    if (!displayName.isEmpty()) {
+    if (!displayName.isEmpty() && displayName != _account->davDisplayName()) {
         _account->setDavDisplayName(displayName);
+        _serverInfoChanged = true;
     }
 #ifndef TOKEN_AUTH_ONLY
     AvatarJob *job = new AvatarJob(_account, _account->davUser(), 128, this);
@@ -329,7 +362,19 @@ void ConnectionValidator::slotAvatarImage(const QImage &img)
 
 void ConnectionValidator::reportResult(Status status)
 {
-    emit connectionResult(status, _errors);
+    // If the cached info didn't get us connected, check everything next time
+    if (_account)
+        _account->setServerInfoFromCache(false);
+
+    if (status == Connected && _isCheckingServerAndAuth && _serverInfoChanged) {
+        if (_reportedFromCache)
+            qCInfo(lcConnectionValidator) << "The cached server info of" << _account->url() << "was outdated";
+        _account->wantsAccountSaved(_account.data());
+    }
+
+    // Don't report Connected twice when the cached info was confirmed
+    if (!_reportedFromCache || status != Connected)
+        emit connectionResult(status, _errors);
     deleteLater();
 }
 
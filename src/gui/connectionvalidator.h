@@ -74,6 +74,14 @@ namespace OCC {
               +-> slotAvatarImage --> reportResult()
 
     \endcode
+
+ * When the account's server info was restored from the settings, see
+ * Account::isServerInfoFromCache(), checkServerAndAuth skips status.php and
+ * reports Connected as soon as slotAuthSuccess confirmed the credentials.
+ * Then it revalidates the server info by running the state machine from
+ * status.php on, skipping checkAuthentication. Failures found by the
+ * revalidation are reported as usual, Connected is not reported twice.
+ * The cached info is used for a single connection attempt only.
  */
 class ConnectionValidator : public QObject
 {
@@ -141,6 +149,12 @@ private:
     QStringList _errors;
     AccountPtr _account;
     bool _isCheckingServerAndAuth;
+
+    /// Connected was reported based on the cached server info, which is being revalidated
+    bool _reportedFromCache;
+
+    /// The server info differs from the one in the account, which needs to be saved
+    bool _serverInfoChanged;
 };
 }
 
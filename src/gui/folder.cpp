@@ -102,6 +102,10 @@ Folder::Folder(const FolderDefinition &definition,
         this, &Folder::slotLogPropagationStart);
     connect(_engine.data(), &SyncEngine::syncError, this, &Folder::slotSyncError);
 
+    // Other folders may sync at the same time
+    _engine->setNetworkJobBudget(FolderMan::instance()->networkJobBudget());
+    _engine->setBandwidthBuckets(FolderMan::instance()->uploadBucket(), FolderMan::instance()->downloadBucket());
+
     _scheduleSelfTimer.setSingleShot(true);
     _scheduleSelfTimer.setInterval(SyncEngine::minimumFileAgeForUpload);
     connect(&_scheduleSelfTimer, &QTimer::timeout,
@@ -520,6 +524,8 @@ void Folder::downloadVirtualFile(const QString &_relativepath)
         _journal.setFileRecord(record);
         // Make sure we go over that file during the discovery
         _journal.avoidReadFromDbOnNextSync(relativepath);
+        // A running sync downloads it right away, ahead of its queued jobs
+        _engine->downloadVirtualFileNow(record);
     } else if (record._type == ItemTypeDirectory) {
         _journal.markVirtualFileForDownloadRecursively(relativepath);
     } else {
@@ -765,6 +771,11 @@ void Folder::setSyncOptions()
 
     opt._deltaSyncEnabled = cfgFile.deltaSyncEnabled();
     opt._deltaSyncMinFileSize = cfgFile.deltaSyncMinFileSize();
+    opt._checksumTouchedFiles = cfgFile.checksumTouchedFiles();
+    opt._downloadSegments = cfgFile.downloadSegments();
+    opt._segmentedDownloadMinFileSize = cfgFile.segmentedDownloadMinFileSize();
+    opt._downloadWriteThread = cfgFile.downloadWriteThread();
+    opt._smallFilesFirst = cfgFile.smallFilesFirst();
 
     _engine->setSyncOptions(opt);
 }
@@ -789,6 +800,17 @@ void Folder::setDirtyNetworkLimits()
     }
 
     _engine->setNetworkLimits(uploadLimit, downloadLimit);
+
+    QString scheduleError;
+    auto schedule = BandwidthSchedule::fromString(cfg.bandwidthSchedule(), &scheduleError);
+    if (!scheduleError.isEmpty())
+        qCWarning(lcFolder) << scheduleError;
+    _engine->setBandwidthSchedule(schedule);
+
+    // Shared by all folders of the account
+    auto account = _accountState->account();
+    account->uploadBucket().setRate(qint64(cfg.accountUploadLimit(account->id())) * 1000);
+    account->downloadBucket().setRate(qint64(cfg.accountDownloadLimit(account->id())) * 1000);
 }
 
 void Folder::slotSyncError(const QString &message, ErrorCategory category)
@@ -817,7 +839,7 @@ void Folder::slotSyncFinished(bool success)
     } else {
         qCInfo(lcFolder) << "SyncEngine finished without problem.";
     }
-    _fileLog->finish();
+    _fileLog->finish(_engine->metrics());
     showSyncResultPopup();
 
     auto anotherSyncNeeded = _engine->isAnotherSyncNeeded();
@@ -30,6 +30,7 @@
 
 class QThread;
 class QSettings;
+class TestFolderMan;
 
 namespace OCC {
 
@@ -300,6 +301,12 @@ public slots:
     /** Ensures that the next sync performs a full local discovery. */
     void slotNextSyncFullLocalDiscovery();
 
+    /**
+     * The remote etag of the folder was retrieved, by its etagJob() or
+     * by a listing of its parent, schedules a sync if it changed.
+     */
+    void etagRetreived(const QString &);
+
 private slots:
     void slotSyncStarted();
     void slotSyncFinished(bool);
@@ -312,7 +319,6 @@ private slots:
     void slotItemCompleted(const SyncFileItemPtr &);
 
     void slotRunEtagJob();
-    void etagRetreived(const QString &);
     void etagRetreivedFromSyncEngine(const QString &);
 
     void slotEmitFinishedDelayed();
@@ -418,6 +424,8 @@ private:
      * Keeps track of locally dirty files so we can skip local discovery sometimes.
      */
     QScopedPointer<LocalDiscoveryTracker> _localDiscoveryTracker;
+
+    friend class ::TestFolderMan;
 };
 }
 
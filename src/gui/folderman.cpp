@@ -23,6 +23,7 @@
 #include "accountmanager.h"
 #include "filesystem.h"
 #include "lockwatcher.h"
+#include "networkjobs.h"
 #include "common/asserts.h"
 #include <syncengine.h>
 
@@ -41,6 +42,10 @@
 
 static const char versionC[] = "version";
 static const int maxFoldersVersion = 1;
+/// The number of etag requests that run at the same time
+static const int maxParallelEtagRequests = 6;
+/// Parents with more entries are not listed to check the etags of their folders
+static const int maxEtagListingEntries = 100;
 
 namespace OCC {
 
@@ -50,7 +55,7 @@ FolderMan *FolderMan::_instance = 0;
 
 FolderMan::FolderMan(QObject *parent)
     : QObject(parent)
-    , _currentSyncFolder(0)
+    , _networkJobBudget(ConfigFile().maxConcurrentNetworkJobs())
     , _syncEnabled(true)
     , _lockWatcher(new LockWatcher)
     , _navigationPaneHelper(this)
@@ -61,6 +66,8 @@ FolderMan::FolderMan(QObject *parent)
 
     _socketApi.reset(new SocketApi);
 
+    reloadSyncLimits();
+
     ConfigFile cfg;
     std::chrono::milliseconds polltime = cfg.remotePollInterval();
     qCInfo(lcFolderMan) << "setting remote poll timer interval to" << polltime.count() << "msec";
@@ -141,7 +148,7 @@ int FolderMan::unloadAndDeleteAllFolders()
     ASSERT(_folderMap.isEmpty());
 
     _lastSyncFolder = 0;
-    _currentSyncFolder = 0;
+    _currentSyncFolders.clear();
     _scheduledFolders.clear();
     emit folderListChanged(_folderMap);
     emit scheduleQueueChanged();
@@ -515,13 +522,14 @@ void FolderMan::slotFolderCanSyncChanged()
 // this really terminates the current sync process
 // ie. no questions, no prisoners
 // csync still remains in a stable state, regardless of that.
-void FolderMan::terminateSyncProcess()
+void FolderMan::terminateSyncProcess(Folder *folder)
 {
-    Folder *f = _currentSyncFolder;
-    if (f) {
-        // This will, indirectly and eventually, call slotFolderSyncFinished
-        // and thereby clear _currentSyncFolder.
-        f->slotTerminateSync();
+    // This will, indirectly and eventually, call slotFolderSyncFinished
+    // and thereby remove the folders from _currentSyncFolders.
+    foreach (Folder *f, _currentSyncFolders) {
+        if (!folder || f == folder) {
+            f->slotTerminateSync();
+        }
     }
 }
 
@@ -579,6 +587,7 @@ void FolderMan::scheduleFolder(Folder *f)
         emit folderSyncStateChange(f);
         _scheduledFolders.enqueue(f);
         emit scheduleQueueChanged();
+        f->accountState()->account()->warmUpConnection();
     } else {
         qCInfo(lcFolderMan) << "Sync for folder " << alias << " already scheduled, do not enqueue!";
     }
@@ -602,6 +611,7 @@ void FolderMan::scheduleFolderNext(Folder *f)
     emit folderSyncStateChange(f);
     _scheduledFolders.prepend(f);
     emit scheduleQueueChanged();
+    f->accountState()->account()->warmUpConnection();
 
     startScheduledSyncSoon();
 }
@@ -609,43 +619,129 @@ void FolderMan::scheduleFolderNext(Folder *f)
 void FolderMan::slotScheduleETagJob(const QString & /*alias*/, RequestEtagJob *job)
 {
     QObject::connect(job, &QObject::destroyed, this, &FolderMan::slotEtagJobDestroyed);
-    QMetaObject::invokeMethod(this, "slotRunOneEtagJob", Qt::QueuedConnection);
-    // maybe: add to queue
+    QMetaObject::invokeMethod(this, "slotRunEtagJobs", Qt::QueuedConnection);
 }
 
-void FolderMan::slotEtagJobDestroyed(QObject * /*o*/)
+void FolderMan::slotEtagJobDestroyed(QObject *o)
 {
-    // _currentEtagJob is automatically cleared
-    // maybe: remove from queue
-    QMetaObject::invokeMethod(this, "slotRunOneEtagJob", Qt::QueuedConnection);
+    _etagJobsInProgress.remove(o);
+    _etagRequests.remove(o);
+    QMetaObject::invokeMethod(this, "slotRunEtagJobs", Qt::QueuedConnection);
 }
 
-void FolderMan::slotRunOneEtagJob()
+// The remote path of the folder's parent directory, "/" is its own parent
+static QString remoteParentPath(Folder *folder)
 {
-    if (_currentEtagJob.isNull()) {
-        Folder *folder;
-        foreach (Folder *f, _folderMap) {
-            if (f->etagJob()) {
-                // Caveat: always grabs the first folder with a job, but we think this is Ok for now and avoids us having a seperate queue.
-                _currentEtagJob = f->etagJob();
-                folder = f;
-                break;
-            }
+    QString path = folder->remotePath();
+    while (path.endsWith(QLatin1Char('/')))
+        path.chop(1);
+    path = path.left(path.lastIndexOf(QLatin1Char('/')));
+    return path.isEmpty() ? QStringLiteral("/") : path;
+}
+
+void FolderMan::slotRunEtagJobs()
+{
+    // Group the folders with a waiting etag job by account and parent
+    // directory: one listing of the parent has the etags of all of them.
+    QMap<QPair<AccountState *, QString>, QList<Folder *>> waiting;
+    foreach (Folder *f, _folderMap) {
+        if (f->etagJob() && !_etagJobsInProgress.contains(f->etagJob())) {
+            waiting[qMakePair(f->accountState(), remoteParentPath(f))].append(f);
         }
-        if (_currentEtagJob.isNull()) {
-            //qCDebug(lcFolderMan) << "No more remote ETag check jobs to schedule.";
+    }
 
-            /* now it might be a good time to check for restarting... */
-            if (_currentSyncFolder == NULL && _appRestartRequired) {
-                restartApplication();
-            }
-        } else {
-            qCDebug(lcFolderMan) << "Scheduling" << folder->remoteUrl().toString() << "to check remote ETag";
-            _currentEtagJob->start(); // on destroy/end it will continue the queue via slotEtagJobDestroyed
+    if (waiting.isEmpty()) {
+        //qCDebug(lcFolderMan) << "No more remote ETag check jobs to schedule.";
+
+        /* now it might be a good time to check for restarting... */
+        if (_etagRequests.isEmpty() && !isAnySyncRunning() && _appRestartRequired) {
+            restartApplication();
+        }
+        return;
+    }
+
+    // on destroy/end the running requests continue via slotEtagJobDestroyed
+    for (auto it = waiting.constBegin(); it != waiting.constEnd(); ++it) {
+        if (it.value().size() > 1 && !_largeEtagParents.contains(it.key())) {
+            if (_etagRequests.size() >= maxParallelEtagRequests)
+                return;
+            startEtagListing(it.key().second, it.value());
+            continue;
+        }
+        // The listing of a large parent costs more than the folders' etag jobs
+        foreach (Folder *f, it.value()) {
+            if (_etagRequests.size() >= maxParallelEtagRequests)
+                return;
+            startEtagJob(f);
         }
     }
 }
 
+void FolderMan::startEtagJob(Folder *folder)
+{
+    RequestEtagJob *job = folder->etagJob();
+    qCDebug(lcFolderMan) << "Scheduling" << folder->remoteUrl().toString() << "to check remote ETag";
+    _etagJobsInProgress.insert(job);
+    _etagRequests.insert(job);
+    job->start(); // on destroy/end it will continue the queue via slotEtagJobDestroyed
+}
+
+void FolderMan::startEtagListing(const QString &parentPath, const QList<Folder *> &folders)
+{
+    AccountPtr account = folders.first()->accountState()->account();
+    qCDebug(lcFolderMan) << "Listing" << parentPath << "to check the remote ETags of" << folders.size() << "folders";
+
+    // The folders by the href of their entry in the listing. They are removed
+    // once their etag was found, the others fall back to their own etag job.
+    auto remaining = QSharedPointer<QHash<QString, QPointer<Folder>>>::create();
+    foreach (Folder *f, folders) {
+        _etagJobsInProgress.insert(f->etagJob());
+        QString href = f->remoteUrl().path(QUrl::FullyDecoded);
+        if (href.endsWith(QLatin1Char('/')))
+            href.chop(1);
+        remaining->insert(href, f);
+    }
+
+    auto job = new LsColJob(account, parentPath, this);
+    job->setProperties({ "getetag" });
+    job->setTimeout(60 * 1000);
+    const auto parent = qMakePair(folders.first()->accountState(), parentPath);
+    connect(job, &LsColJob::directoryListingIterated, this,
+        [this, remaining, parent, job, entries = 0](const QString &href, const QMap<QString, QString> &properties) mutable {
+            if (++entries == maxEtagListingEntries + 1) {
+                // Too large: stop downloading it, the folders that weren't
+                // found yet fall back to their etag jobs
+                qCInfo(lcFolderMan) << "Not listing" << parent.second << "for etags anymore, it has too many entries";
+                _largeEtagParents.insert(parent);
+                QTimer::singleShot(0, job, [job] {
+                    if (job->reply())
+                        job->reply()->abort();
+                });
+            }
+            auto it = remaining->find(href);
+            if (it == remaining->end() || !properties.contains(QStringLiteral("getetag")))
+                return;
+            if (Folder *f = *it) {
+                f->etagRetreived(properties.value(QStringLiteral("getetag")));
+                if (auto etagJob = f->etagJob())
+                    etagJob->deleteLater();
+            }
+            remaining->erase(it);
+        });
+    auto fallBack = [this, remaining] {
+        foreach (const QPointer<Folder> &f, *remaining) {
+            if (f && f->etagJob())
+                startEtagJob(f);
+        }
+        remaining->clear();
+    };
+    connect(job, &LsColJob::finishedWithoutError, this, fallBack);
+    connect(job, &LsColJob::finishedWithError, this, fallBack);
+    connect(job, &QObject::destroyed, this, &FolderMan::slotEtagJobDestroyed);
+    _etagRequests.insert(job);
+    job->start();
+}
+
 void FolderMan::slotAccountStateChanged()
 {
     AccountState *accountState = qobject_cast<AccountState *>(sender());
@@ -668,9 +764,10 @@ void FolderMan::slotAccountStateChanged()
         qCInfo(lcFolderMan) << "Account" << accountName << "disconnected or paused, "
                                                            "terminating or descheduling sync folders";
 
-        if (_currentSyncFolder
-            && _currentSyncFolder->accountState() == accountState) {
-            _currentSyncFolder->slotTerminateSync();
+        foreach (Folder *f, _currentSyncFolders) {
+            if (f->accountState() == accountState) {
+                f->slotTerminateSync();
+            }
         }
 
         QMutableListIterator<Folder *> it(_scheduledFolders);
@@ -705,7 +802,8 @@ void FolderMan::startScheduledSyncSoon()
     if (_scheduledFolders.empty()) {
         return;
     }
-    if (_currentSyncFolder) {
+    if (_currentSyncFolders.size() >= _maxConcurrentSyncs) {
+        // Called again once one of them finished
         return;
     }
 
@@ -743,11 +841,6 @@ void FolderMan::startScheduledSyncSoon()
   */
 void FolderMan::slotStartScheduledFolderSync()
 {
-    if (_currentSyncFolder) {
-        qCInfo(lcFolderMan) << "Currently folder " << _currentSyncFolder->remoteUrl().toString() << " is running, wait for finish!";
-        return;
-    }
-
     if (!_syncEnabled) {
         qCInfo(lcFolderMan) << "FolderMan: Syncing is disabled, no scheduling.";
         return;
@@ -758,30 +851,68 @@ void FolderMan::slotStartScheduledFolderSync()
         return;
     }
 
-    // Find the first folder in the queue that can be synced.
-    Folder *folder = 0;
-    while (!_scheduledFolders.isEmpty()) {
-        Folder *g = _scheduledFolders.dequeue();
-        if (g->canSync()) {
-            folder = g;
-            break;
+    // Start the folders in queue order, as many as the limits allow. Folders
+    // that can't start yet, for example because their account already
+    // syncs enough folders, keep their place in the queue.
+    QList<Folder *> foldersToStart;
+    QMutableListIterator<Folder *> it(_scheduledFolders);
+    while (it.hasNext()) {
+        Folder *folder = it.next();
+        if (!folder->canSync()) {
+            it.remove();
+            continue;
         }
+        if (!mayStartSync(folder)) {
+            if (_currentSyncFolders.contains(folder)) {
+                qCInfo(lcFolderMan) << "Folder" << folder->alias() << "is running, wait for finish!";
+            }
+            continue;
+        }
+        it.remove();
+        foldersToStart.append(folder);
+        _currentSyncFolders.append(folder);
     }
 
     emit scheduleQueueChanged();
 
-    // Start syncing this folder!
-    if (folder) {
+    // Start syncing these folders!
+    foreach (Folder *folder, foldersToStart) {
         // Safe to call several times, and necessary to try again if
         // the folder path didn't exist previously.
         folder->registerFolderWatcher();
         registerFolderWithSocketApi(folder);
 
-        _currentSyncFolder = folder;
         folder->startSync(QStringList());
     }
 }
 
+bool FolderMan::mayStartSync(Folder *folder) const
+{
+    if (_currentSyncFolders.contains(folder)) {
+        return false;
+    }
+
+    if (_currentSyncFolders.size() >= _maxConcurrentSyncs) {
+        return false;
+    }
+
+    int accountSyncs = 0;
+    foreach (Folder *f, _currentSyncFolders) {
+        if (f->accountState() == folder->accountState()) {
+            accountSyncs++;
+        }
+    }
+    return accountSyncs < _maxConcurrentSyncsPerAccount;
+}
+
+void FolderMan::reloadSyncLimits()
+{
+    ConfigFile cfg;
+    _maxConcurrentSyncs = qMax(1, cfg.maxConcurrentSyncs());
+    _maxConcurrentSyncsPerAccount = qMax(1, cfg.maxConcurrentSyncsPerAccount());
+    _networkJobBudget.setMaximum(cfg.maxConcurrentNetworkJobs());
+}
+
 void FolderMan::slotEtagPollTimerTimeout()
 {
     ConfigFile cfg;
@@ -791,7 +922,7 @@ void FolderMan::slotEtagPollTimerTimeout()
         if (!f) {
             continue;
         }
-        if (_currentSyncFolder == f) {
+        if (_currentSyncFolders.contains(f)) {
             continue;
         }
         if (_scheduledFolders.contains(f)) {
@@ -812,6 +943,12 @@ void FolderMan::slotEtagPollTimerTimeout()
 
 void FolderMan::slotRemoveFoldersForAccount(AccountState *accountState)
 {
+    QMutableSetIterator<QPair<AccountState *, QString>> parents(_largeEtagParents);
+    while (parents.hasNext()) {
+        if (parents.next().first == accountState)
+            parents.remove();
+    }
+
     QVarLengthArray<Folder *, 16> foldersToRemove;
     Folder::MapIterator i(_folderMap);
     while (i.hasNext()) {
@@ -903,10 +1040,15 @@ void FolderMan::slotScheduleFolderByTime()
 
 void FolderMan::slotFolderSyncStarted()
 {
+    auto f = qobject_cast<Folder *>(sender());
+    ASSERT(f);
+    if (!f)
+        return;
+
     qCInfo(lcFolderMan, ">========== Sync started for folder [%s] of account [%s] with remote [%s]",
-        qPrintable(_currentSyncFolder->shortGuiLocalPath()),
-        qPrintable(_currentSyncFolder->accountState()->account()->displayName()),
-        qPrintable(_currentSyncFolder->remoteUrl().toString()));
+        qPrintable(f->shortGuiLocalPath()),
+        qPrintable(f->accountState()->account()->displayName()),
+        qPrintable(f->remoteUrl().toString()));
 }
 
 /*
@@ -917,13 +1059,18 @@ void FolderMan::slotFolderSyncStarted()
   */
 void FolderMan::slotFolderSyncFinished(const SyncResult &)
 {
+    auto f = qobject_cast<Folder *>(sender());
+    ASSERT(f);
+    if (!f)
+        return;
+
     qCInfo(lcFolderMan, "<========== Sync finished for folder [%s] of account [%s] with remote [%s]",
-        qPrintable(_currentSyncFolder->shortGuiLocalPath()),
-        qPrintable(_currentSyncFolder->accountState()->account()->displayName()),
-        qPrintable(_currentSyncFolder->remoteUrl().toString()));
+        qPrintable(f->shortGuiLocalPath()),
+        qPrintable(f->accountState()->account()->displayName()),
+        qPrintable(f->remoteUrl().toString()));
 
-    _lastSyncFolder = _currentSyncFolder;
-    _currentSyncFolder = 0;
+    _lastSyncFolder = f;
+    _currentSyncFolders.removeAll(f);
 
     startScheduledSyncSoon();
 }
@@ -1049,10 +1196,10 @@ void FolderMan::removeFolder(Folder *f)
 
     qCInfo(lcFolderMan) << "Removing " << f->alias();
 
-    const bool currentlyRunning = (_currentSyncFolder == f);
+    const bool currentlyRunning = _currentSyncFolders.contains(f);
     if (currentlyRunning) {
         // abort the sync now
-        terminateSyncProcess();
+        terminateSyncProcess(f);
     }
 
     if (_scheduledFolders.removeAll(f) > 0) {
@@ -1169,6 +1316,10 @@ void FolderMan::setDirtyProxy()
 
 void FolderMan::setDirtyNetworkLimits()
 {
+    reloadSyncLimits();
+    // More folders may start now
+    startScheduledSyncSoon();
+
     foreach (Folder *f, _folderMap.values()) {
         // set only in busy folders. Otherwise they read the config anyway.
         if (f && f->isBusy()) {
@@ -1452,9 +1603,14 @@ QQueue<Folder *> FolderMan::scheduleQueue() const
     return _scheduledFolders;
 }
 
-Folder *FolderMan::currentSyncFolder() const
+QList<Folder *> FolderMan::currentSyncFolders() const
+{
+    return _currentSyncFolders;
+}
+
+bool FolderMan::isAnySyncRunning() const
 {
-    return _currentSyncFolder;
+    return !_currentSyncFolders.isEmpty();
 }
 
 void FolderMan::restartApplication()
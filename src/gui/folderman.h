@@ -23,6 +23,8 @@
 #include "folder.h"
 #include "folderwatcher.h"
 #include "navigationpanehelper.h"
+#include "networkjobbudget.h"
+#include "bandwidthmanager.h"
 #include "syncfileitem.h"
 
 class TestFolderMan;
@@ -49,7 +51,9 @@ class LockWatcher;
  *   (_folderWatchers and Folder::slotWatchedPathChanged())
  *
  * - The folder etag on the server has changed
- *   (_etagPollTimer)
+ *   (_etagPollTimer and slotRunEtagJobs(), which checks several folders in
+ *    parallel and the sibling folders of an account with one listing of
+ *    their parent, unless it has too many entries)
  *
  * - The locks of a monitored file are released
  *   (_lockWatcher and slotWatchedFileUnlocked())
@@ -57,6 +61,11 @@ class LockWatcher;
  * - There was a sync error or a follow-up sync is requested
  *   (_timeScheduler and slotScheduleFolderByTime()
  *    and Folder::slotSyncFinished())
+ *
+ * Scheduled folders are started in queue order. Several of them may sync at
+ * the same time, up to ConfigFile::maxConcurrentSyncs() in total and
+ * ConfigFile::maxConcurrentSyncsPerAccount() per account. Their network jobs
+ * share _networkJobBudget.
  */
 class FolderMan : public QObject
 {
@@ -181,16 +190,32 @@ public:
     QQueue<Folder *> scheduleQueue() const;
 
     /**
-     * Access to the currently syncing folder.
+     * Access to the currently syncing folders.
      */
-    Folder *currentSyncFolder() const;
+    QList<Folder *> currentSyncFolders() const;
+
+    /** Whether any folder is currently syncing */
+    bool isAnySyncRunning() const;
+
+    /** Whether the limits on concurrent syncs allow the folder to start now */
+    bool mayStartSync(Folder *folder) const;
+
+    /** Reads the limits on concurrent syncs and network jobs from the config */
+    void reloadSyncLimits();
+
+    /** Bounds the network jobs of all concurrently syncing folders */
+    NetworkJobBudget *networkJobBudget() { return &_networkJobBudget; }
+
+    /** The absolute bandwidth limits apply to all concurrently syncing folders together */
+    BandwidthBucket *uploadBucket() { return &_uploadBucket; }
+    BandwidthBucket *downloadBucket() { return &_downloadBucket; }
 
     /** Removes all folders */
     int unloadAndDeleteAllFolders();
 
     /**
      * If enabled is set to false, no new folders will start to sync.
-     * The current one will finish.
+     * The current ones will finish.
      */
     void setSyncEnabled(bool);
 
@@ -207,11 +232,12 @@ public:
     void setDirtyNetworkLimits();
 
     /**
-     * Terminates the current folder sync.
+     * Terminates the sync of the folder, or all current folder syncs
+     * if it is null.
      *
      * It does not switch the folder to paused state.
      */
-    void terminateSyncProcess();
+    void terminateSyncProcess(Folder *folder = nullptr);
 
 signals:
     /**
@@ -261,7 +287,7 @@ private slots:
     void slotFolderSyncStarted();
     void slotFolderSyncFinished(const SyncResult &);
 
-    void slotRunOneEtagJob();
+    void slotRunEtagJobs();
     void slotEtagJobDestroyed(QObject *);
 
     // slot to take the next folder from queue and start syncing.
@@ -312,6 +338,12 @@ private:
     // makes the folder known to the socket api
     void registerFolderWithSocketApi(Folder *folder);
 
+    // starts the etag job of one folder
+    void startEtagJob(Folder *folder);
+
+    // checks the etags of several folders with one listing of their common parent
+    void startEtagListing(const QString &parentPath, const QList<Folder *> &folders);
+
     // restarts the application (Linux only)
     void restartApplication();
 
@@ -320,8 +352,13 @@ private:
     QSet<Folder *> _disabledFolders;
     Folder::Map _folderMap;
     QString _folderConfigPath;
-    Folder *_currentSyncFolder;
+    QList<Folder *> _currentSyncFolders;
     QPointer<Folder> _lastSyncFolder;
+    NetworkJobBudget _networkJobBudget;
+    int _maxConcurrentSyncs = 1;
+    int _maxConcurrentSyncsPerAccount = 1;
+    BandwidthBucket _uploadBucket;
+    BandwidthBucket _downloadBucket;
     bool _syncEnabled;
 
     /// Folder aliases from the settings that weren't read
@@ -329,8 +366,12 @@ private:
 
     /// Starts regular etag query jobs
     QTimer _etagPollTimer;
-    /// The currently running etag query
-    QPointer<RequestEtagJob> _currentEtagJob;
+    /// The folders' etag jobs that were started or are answered by a listing
+    QSet<QObject *> _etagJobsInProgress;
+    /// The running etag requests, etag jobs or listings of several folders' parent
+    QSet<QObject *> _etagRequests;
+    /// The parents whose folders get their own etag jobs instead of a listing, by account
+    QSet<QPair<AccountState *, QString>> _largeEtagParents;
 
     /// Watches files that couldn't be synced due to locks
     QScopedPointer<LockWatcher> _lockWatcher;
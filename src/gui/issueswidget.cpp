@@ -41,14 +41,14 @@
 namespace OCC {
 
 /**
- * If more issues are reported than this they will not show up
- * to avoid performance issues around sorting this many issues.
+ * If more issues are reported than this the oldest ones are dropped
+ * to bound the memory use.
  */
-static const int maxIssueCount = 50000;
+static const int maxIssueCount = 250000;
 
-static QPair<QString, QString> pathsWithIssuesKey(const ProtocolItem::ExtraData &data)
+static QPair<QString, QString> pathsWithIssuesKey(const ProtocolItem &item)
 {
-    return qMakePair(data.folderName, data.path);
+    return qMakePair(item._folderName, item._path);
 }
 
 IssuesWidget::IssuesWidget(QWidget *parent)
@@ -64,11 +64,28 @@ IssuesWidget::IssuesWidget(QWidget *parent)
     connect(ProgressDispatcher::instance(), &ProgressDispatcher::syncError,
         this, &IssuesWidget::addError);
 
-    connect(_ui->_treeWidget, &QTreeWidget::itemActivated, this, &IssuesWidget::slotOpenFile);
+    // Adjust copyToClipboard() when making changes here!
+    QStringList header;
+    header << tr("Time");
+    header << tr("File");
+    header << tr("Folder");
+    header << tr("Issue");
+
+    _model = new ProtocolItemModel(maxIssueCount, header, this);
+    _sortModel = new ProtocolSortFilterProxyModel(_model, this);
+    _ui->_treeView->setModel(_sortModel);
+
+    auto updateIssueCount = [this]() { emit issueCountUpdated(_model->rowCount()); };
+    connect(_model, &QAbstractItemModel::rowsInserted, this, updateIssueCount);
+    connect(_model, &QAbstractItemModel::rowsRemoved, this, updateIssueCount);
+    connect(_model, &QAbstractItemModel::modelReset, this, updateIssueCount);
+    connect(_model, &ProtocolItemModel::itemsDropped, this, &IssuesWidget::slotItemsDropped);
+
+    connect(_ui->_treeView, &QTreeView::activated, this, &IssuesWidget::slotOpenFile);
     connect(_ui->copyIssuesButton, &QAbstractButton::clicked, this, &IssuesWidget::copyToClipboard);
 
-    _ui->_treeWidget->setContextMenuPolicy(Qt::CustomContextMenu);
-    connect(_ui->_treeWidget, &QTreeWidget::customContextMenuRequested, this, &IssuesWidget::slotItemContextMenu);
+    _ui->_treeView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(_ui->_treeView, &QTreeView::customContextMenuRequested, this, &IssuesWidget::slotItemContextMenu);
 
     connect(_ui->showIgnores, &QAbstractButton::toggled, this, &IssuesWidget::slotRefreshIssues);
     connect(_ui->showWarnings, &QAbstractButton::toggled, this, &IssuesWidget::slotRefreshIssues);
@@ -85,38 +102,24 @@ IssuesWidget::IssuesWidget(QWidget *parent)
     connect(FolderMan::instance(), &FolderMan::folderListChanged,
         this, &IssuesWidget::slotUpdateFolderFilters);
 
-
-    // Adjust copyToClipboard() when making changes here!
-    QStringList header;
-    header << tr("Time");
-    header << tr("File");
-    header << tr("Folder");
-    header << tr("Issue");
-
     int timestampColumnExtra = 0;
 #ifdef Q_OS_WIN
     timestampColumnExtra = 20; // font metrics are broken on Windows, see #4721
 #endif
 
-    _ui->_treeWidget->setHeaderLabels(header);
     int timestampColumnWidth =
         ActivityItemDelegate::rowHeight() // icon
-        + _ui->_treeWidget->fontMetrics().width(ProtocolItem::timeString(QDateTime::currentDateTime()))
+        + _ui->_treeView->fontMetrics().width(ProtocolItem::timeString(QDateTime::currentDateTime()))
         + timestampColumnExtra;
-    _ui->_treeWidget->setColumnWidth(0, timestampColumnWidth);
-    _ui->_treeWidget->setColumnWidth(1, 180);
-    _ui->_treeWidget->setColumnCount(4);
-    _ui->_treeWidget->setRootIsDecorated(false);
-    _ui->_treeWidget->setTextElideMode(Qt::ElideMiddle);
-    _ui->_treeWidget->header()->setObjectName("ActivityErrorListHeader");
+    _ui->_treeView->setColumnWidth(0, timestampColumnWidth);
+    _ui->_treeView->setColumnWidth(1, 180);
+    _ui->_treeView->setRootIsDecorated(false);
+    _ui->_treeView->setTextElideMode(Qt::ElideMiddle);
+    _ui->_treeView->header()->setObjectName("ActivityErrorListHeader");
 #if defined(Q_OS_MAC)
-    _ui->_treeWidget->setMinimumWidth(400);
+    _ui->_treeView->setMinimumWidth(400);
 #endif
 
-    _reenableSorting.setInterval(5000);
-    connect(&_reenableSorting, &QTimer::timeout, this,
-        [this]() { _ui->_treeWidget->setSortingEnabled(true); });
-
     _ui->_tooManyIssuesWarning->hide();
     connect(this, &IssuesWidget::issueCountUpdated, this,
         [this](int count) { _ui->_tooManyIssuesWarning->setVisible(count >= maxIssueCount); });
@@ -135,16 +138,16 @@ IssuesWidget::~IssuesWidget()
 void IssuesWidget::showEvent(QShowEvent *ev)
 {
     ConfigFile cfg;
-    cfg.restoreGeometryHeader(_ui->_treeWidget->header());
+    cfg.restoreGeometryHeader(_ui->_treeView->header());
 
     // Sorting by section was newly enabled. But if we restore the header
     // from a state where sorting was disabled, both of these flags will be
     // false and sorting will be impossible!
-    _ui->_treeWidget->header()->setSectionsClickable(true);
-    _ui->_treeWidget->header()->setSortIndicatorShown(true);
+    _ui->_treeView->header()->setSectionsClickable(true);
+    _ui->_treeView->header()->setSortIndicatorShown(true);
 
     // Switch back to "first important, then by time" ordering
-    _ui->_treeWidget->sortByColumn(0, Qt::DescendingOrder);
+    _ui->_treeView->sortByColumn(0, Qt::DescendingOrder);
 
     QWidget::showEvent(ev);
 }
@@ -152,89 +155,65 @@ void IssuesWidget::showEvent(QShowEvent *ev)
 void IssuesWidget::hideEvent(QHideEvent *ev)
 {
     ConfigFile cfg;
-    cfg.saveGeometryHeader(_ui->_treeWidget->header());
+    cfg.saveGeometryHeader(_ui->_treeView->header());
     QWidget::hideEvent(ev);
 }
 
-static bool persistsUntilLocalDiscovery(QTreeWidgetItem *item)
+static bool persistsUntilLocalDiscovery(const ProtocolItem &item)
 {
-    const auto data = ProtocolItem::extraData(item);
-    return data.status == SyncFileItem::Conflict
-        || (data.status == SyncFileItem::FileIgnored && data.direction == SyncFileItem::Up);
+    return item._status == SyncFileItem::Conflict
+        || (item._status == SyncFileItem::FileIgnored && item._direction == SyncFileItem::Up);
 }
 
-void IssuesWidget::cleanItems(const std::function<bool(QTreeWidgetItem *)> &shouldDelete)
+void IssuesWidget::cleanItems(const std::function<bool(const ProtocolItem &)> &shouldDelete)
 {
-    _ui->_treeWidget->setSortingEnabled(false);
-
     // The issue list is a state, clear it and let the next sync fill it
     // with ignored files and propagation errors.
-    int itemCnt = _ui->_treeWidget->topLevelItemCount();
-    for (int cnt = itemCnt - 1; cnt >= 0; cnt--) {
-        QTreeWidgetItem *item = _ui->_treeWidget->topLevelItem(cnt);
-        if (shouldDelete(item)) {
-            _pathsWithIssues.remove(pathsWithIssuesKey(ProtocolItem::extraData(item)));
-            delete item;
-        }
+    _model->removeIf([&](const ProtocolItem &item) {
+        if (!shouldDelete(item))
+            return false;
+        _pathsWithIssues.remove(pathsWithIssuesKey(item));
+        return true;
+    });
+    for (auto it = _droppedConflicts.begin(); it != _droppedConflicts.end();) {
+        if (shouldDelete(it.value()))
+            it = _droppedConflicts.erase(it);
+        else
+            ++it;
     }
-
-    _ui->_treeWidget->setSortingEnabled(true);
-
-    // update the tabtext
-    emit(issueCountUpdated(_ui->_treeWidget->topLevelItemCount()));
 }
 
-void IssuesWidget::addItem(QTreeWidgetItem *item)
+void IssuesWidget::addItem(ProtocolItem item)
 {
-    if (!item)
-        return;
-
-    int count = _ui->_treeWidget->topLevelItemCount();
-    if (count >= maxIssueCount) {
-        delete item;
-        return;
+    // Wipe any existing message for the same folder and path
+    const auto key = pathsWithIssuesKey(item);
+    if (_pathsWithIssues.contains(key)) {
+        _model->removeFirst([&](const ProtocolItem &other) {
+            return other._path == item._path && other._folderName == item._folderName;
+        });
     }
 
-    _ui->_treeWidget->setSortingEnabled(false);
-    _reenableSorting.start();
-
-    // Insert item specific errors behind the others
-    int insertLoc = 0;
-    if (!item->text(1).isEmpty()) {
-        for (int i = 0; i < count; ++i) {
-            if (_ui->_treeWidget->topLevelItem(i)->text(1).isEmpty()) {
-                insertLoc = i + 1;
-            } else {
-                break;
-            }
-        }
-    }
+    _droppedConflicts.remove(key);
+    _pathsWithIssues.insert(key);
+    _model->addItem(std::move(item));
+}
 
-    // Wipe any existing message for the same folder and path
-    auto newData = ProtocolItem::extraData(item);
-    if (_pathsWithIssues.contains(pathsWithIssuesKey(newData))) {
-        for (int i = 0; i < count; ++i) {
-            auto otherItem = _ui->_treeWidget->topLevelItem(i);
-            auto otherData = ProtocolItem::extraData(otherItem);
-            if (otherData.path == newData.path && otherData.folderName == newData.folderName) {
-                delete otherItem;
-                break;
-            }
-        }
+void IssuesWidget::slotItemsDropped(const QVector<ProtocolItem> &items)
+{
+    for (const auto &item : items) {
+        const auto key = pathsWithIssuesKey(item);
+        _pathsWithIssues.remove(key);
+        if (item._status == SyncFileItem::Conflict)
+            _droppedConflicts.insert(key, item);
     }
-
-    _ui->_treeWidget->insertTopLevelItem(insertLoc, item);
-    _pathsWithIssues.insert(pathsWithIssuesKey(newData));
-    item->setHidden(!shouldBeVisible(item, currentAccountFilter(), currentFolderFilter()));
-    emit issueCountUpdated(_ui->_treeWidget->topLevelItemCount());
 }
 
-void IssuesWidget::slotOpenFile(QTreeWidgetItem *item, int)
+void IssuesWidget::slotOpenFile(const QModelIndex &index)
 {
-    QString fileName = item->text(1);
+    const auto &item = _sortModel->item(index);
     if (Folder *folder = ProtocolItem::folder(item)) {
         // folder->path() always comes back with trailing path
-        QString fullPath = folder->path() + fileName;
+        QString fullPath = folder->path() + item._originalFile;
         if (QFile(fullPath).exists()) {
             showInFileManager(fullPath);
         }
@@ -251,8 +230,8 @@ void IssuesWidget::slotProgressInfo(const QString &folder, const ProgressInfo &p
             return;
         const auto &engine = f->syncEngine();
         const auto style = engine.lastLocalDiscoveryStyle();
-        cleanItems([&](QTreeWidgetItem *item) {
-            if (ProtocolItem::extraData(item).folderName != folder)
+        cleanItems([&](const ProtocolItem &item) {
+            if (item._folderName != folder)
                 return false;
             if (style == LocalDiscoveryStyle::FilesystemOnly)
                 return true;
@@ -260,10 +239,10 @@ void IssuesWidget::slotProgressInfo(const QString &folder, const ProgressInfo &p
                 return true;
 
             // Definitely wipe the entry if the file no longer exists
-            if (!QFileInfo(f->path() + ProtocolItem::extraData(item).path).exists())
+            if (!QFileInfo(f->path() + item._path).exists())
                 return true;
 
-            auto path = QFileInfo(ProtocolItem::extraData(item).path).dir().path();
+            auto path = QFileInfo(item._path).dir().path();
             if (path == ".")
                 path.clear();
 
@@ -274,15 +253,18 @@ void IssuesWidget::slotProgressInfo(const QString &folder, const ProgressInfo &p
         // We keep track very well of pending conflicts.
         // Inform other components about them.
         QStringList conflicts;
-        auto tree = _ui->_treeWidget;
-        for (int i = 0; i < tree->topLevelItemCount(); ++i) {
-            auto item = tree->topLevelItem(i);
-            auto data = ProtocolItem::extraData(item);
-            if (data.folderName == folder
-                && data.status == SyncFileItem::Conflict) {
-                conflicts.append(data.path);
+        _model->flush();
+        for (int i = 0; i < _model->rowCount(); ++i) {
+            const auto &item = _model->item(i);
+            if (item._folderName == folder
+                && item._status == SyncFileItem::Conflict) {
+                conflicts.append(item._path);
             }
         }
+        for (const auto &item : _droppedConflicts) {
+            if (item._folderName == folder)
+                conflicts.append(item._path);
+        }
         emit ProgressDispatcher::instance()->folderConflicts(folder, conflicts);
 
         _ui->_conflictHelp->setHidden(Theme::instance()->conflictHelpUrl().isEmpty() || conflicts.isEmpty());
@@ -293,24 +275,39 @@ void IssuesWidget::slotItemCompleted(const QString &folder, const SyncFileItemPt
 {
     if (!item->showInIssuesTab())
         return;
-    QTreeWidgetItem *line = ProtocolItem::create(folder, *item);
-    if (!line)
+    if (!FolderMan::instance()->folder(folder))
         return;
-    addItem(line);
+    addItem(ProtocolItem::create(folder, *item));
 }
 
 void IssuesWidget::slotRefreshIssues()
 {
-    auto tree = _ui->_treeWidget;
-    auto filterFolderAlias = currentFolderFilter();
-    auto filterAccount = currentAccountFilter();
+    const auto filterFolderAlias = currentFolderFilter();
+    const auto filterAccount = currentAccountFilter();
+    const bool showIgnores = _ui->showIgnores->isChecked();
+    const bool showWarnings = _ui->showWarnings->isChecked();
 
-    for (int i = 0; i < tree->topLevelItemCount(); ++i) {
-        auto item = tree->topLevelItem(i);
-        item->setHidden(!shouldBeVisible(item, filterAccount, filterFolderAlias));
+    // Resolve the account filter once instead of for every item
+    QSet<QString> accountFolders;
+    if (filterAccount) {
+        for (auto folder : FolderMan::instance()->map()) {
+            if (folder->accountState() == filterAccount)
+                accountFolders.insert(folder->alias());
+        }
     }
 
-    _ui->_treeWidget->setColumnHidden(2, !filterFolderAlias.isEmpty());
+    _sortModel->setFilter([=](const ProtocolItem &item) {
+        const auto status = item._status;
+        if (!showIgnores && status == SyncFileItem::FileIgnored)
+            return false;
+        if (!showWarnings && (status == SyncFileItem::SoftError || status == SyncFileItem::Restoration))
+            return false;
+        if (filterAccount && !accountFolders.contains(item._folderName))
+            return false;
+        return filterFolderAlias.isEmpty() || filterFolderAlias == item._folderName;
+    });
+
+    _ui->_treeView->setColumnHidden(2, !filterFolderAlias.isEmpty());
 }
 
 void IssuesWidget::slotAccountAdded(AccountState *account)
@@ -330,11 +327,24 @@ void IssuesWidget::slotAccountRemoved(AccountState *account)
 
 void IssuesWidget::slotItemContextMenu(const QPoint &pos)
 {
-    auto item = _ui->_treeWidget->itemAt(pos);
-    if (!item)
+    auto index = _ui->_treeView->indexAt(pos);
+    if (!index.isValid())
         return;
-    auto globalPos = _ui->_treeWidget->viewport()->mapToGlobal(pos);
-    ProtocolItem::openContextMenu(globalPos, item, this);
+    const auto &item = _sortModel->item(index);
+    auto menu = ProtocolItem::createContextMenu(item, this);
+
+    if (item._errorCategory == ErrorCategory::InsufficientRemoteStorage) {
+        auto folderAlias = item._folderName;
+        auto retry = menu->addAction(tr("Retry all uploads"));
+        connect(retry, &QAction::triggered,
+            this, [this, folderAlias]() { retryInsufficentRemoteStorageErrors(folderAlias); });
+    }
+
+    if (menu->actions().isEmpty()) {
+        delete menu;
+        return;
+    }
+    menu->popup(_ui->_treeView->viewport()->mapToGlobal(pos));
 }
 
 void IssuesWidget::updateAccountChoiceVisibility()
@@ -355,27 +365,6 @@ QString IssuesWidget::currentFolderFilter() const
     return _ui->filterFolder->currentData().toString();
 }
 
-bool IssuesWidget::shouldBeVisible(QTreeWidgetItem *item, AccountState *filterAccount,
-    const QString &filterFolderAlias) const
-{
-    bool visible = true;
-    auto data = ProtocolItem::extraData(item);
-    auto status = data.status;
-    visible &= (_ui->showIgnores->isChecked() || status != SyncFileItem::FileIgnored);
-    visible &= (_ui->showWarnings->isChecked()
-        || (status != SyncFileItem::SoftError
-               && status != SyncFileItem::Restoration));
-
-    const auto &folderalias = data.folderName;
-    if (filterAccount) {
-        auto folder = FolderMan::instance()->folder(folderalias);
-        visible &= folder && folder->accountState() == filterAccount;
-    }
-    visible &= (filterFolderAlias.isEmpty() || filterFolderAlias == folderalias);
-
-    return visible;
-}
-
 void IssuesWidget::slotUpdateFolderFilters()
 {
     auto account = _ui->filterAccount->currentData().value<AccountState *>();
@@ -422,34 +411,36 @@ void IssuesWidget::slotUpdateFolderFilters()
 
 void IssuesWidget::storeSyncIssues(QTextStream &ts)
 {
-    int topLevelItems = _ui->_treeWidget->topLevelItemCount();
-
-    for (int i = 0; i < topLevelItems; i++) {
-        QTreeWidgetItem *child = _ui->_treeWidget->topLevelItem(i);
-        if (child->isHidden())
-            continue;
+    _model->flush();
+    auto data = [this](int row, int column) {
+        return _sortModel->index(row, column).data(Qt::DisplayRole).toString();
+    };
+
+    // Only the visible issues, in the order they are shown
+    int rows = _sortModel->rowCount();
+    for (int i = 0; i < rows; i++) {
         ts << right
            // time stamp
            << qSetFieldWidth(20)
-           << child->data(0, Qt::DisplayRole).toString()
+           << data(i, 0)
            // separator
            << qSetFieldWidth(0) << ","
 
            // file name
            << qSetFieldWidth(64)
-           << child->data(1, Qt::DisplayRole).toString()
+           << data(i, 1)
            // separator
            << qSetFieldWidth(0) << ","
 
            // folder
            << qSetFieldWidth(30)
-           << child->data(2, Qt::DisplayRole).toString()
+           << data(i, 2)
            // separator
            << qSetFieldWidth(0) << ","
 
            // action
            << qSetFieldWidth(15)
-           << child->data(3, Qt::DisplayRole).toString()
+           << data(i, 3)
            << qSetFieldWidth(0)
            << endl;
     }
@@ -476,57 +467,13 @@ void IssuesWidget::addError(const QString &folderAlias, const QString &message,
     if (!folder)
         return;
 
-    QStringList columns;
-    QDateTime timestamp = QDateTime::currentDateTime();
-    const QString timeStr = ProtocolItem::timeString(timestamp);
-    const QString longTimeStr = ProtocolItem::timeString(timestamp, QLocale::LongFormat);
-
-    columns << timeStr;
-    columns << ""; // no "File" entry
-    columns << folder->shortGuiLocalPath();
-    columns << message;
-
-    QIcon icon = Theme::instance()->syncStateIcon(SyncResult::Error);
-
-    QTreeWidgetItem *twitem = new ProtocolItem(columns);
-    twitem->setData(0, Qt::SizeHintRole, QSize(0, ActivityItemDelegate::rowHeight()));
-    twitem->setIcon(0, icon);
-    twitem->setToolTip(0, longTimeStr);
-    twitem->setToolTip(3, message);
-    ProtocolItem::ExtraData data;
-    data.timestamp = timestamp;
-    data.folderName = folderAlias;
-    data.status = SyncFileItem::NormalError;
-    ProtocolItem::setExtraData(twitem, data);
-
-    addItem(twitem);
-    addErrorWidget(twitem, message, category);
-}
-
-void IssuesWidget::addErrorWidget(QTreeWidgetItem *item, const QString &message, ErrorCategory category)
-{
-    QWidget *widget = 0;
-    if (category == ErrorCategory::InsufficientRemoteStorage) {
-        widget = new QWidget;
-        auto layout = new QHBoxLayout;
-        widget->setLayout(layout);
-
-        auto label = new ElidedLabel(message, widget);
-        label->setElideMode(Qt::ElideMiddle);
-        layout->addWidget(label);
-
-        auto button = new QPushButton("Retry all uploads", widget);
-        button->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Expanding);
-        auto folderAlias = ProtocolItem::extraData(item).folderName;
-        connect(button, &QPushButton::clicked,
-            this, [this, folderAlias]() { retryInsufficentRemoteStorageErrors(folderAlias); });
-        layout->addWidget(button);
-    }
-
-    if (widget) {
-        item->setText(3, QString());
-    }
-    _ui->_treeWidget->setItemWidget(item, 3, widget);
+    ProtocolItem item;
+    item._timestamp = QDateTime::currentMSecsSinceEpoch();
+    item._folderName = folderAlias;
+    item._message = message;
+    item._status = SyncFileItem::NormalError;
+    item._errorCategory = category;
+    addItem(std::move(item));
 }
 
 void IssuesWidget::retryInsufficentRemoteStorageErrors(const QString &folderAlias)
@@ -22,6 +22,7 @@
 
 #include "progressdispatcher.h"
 #include "owncloudgui.h"
+#include "protocolitemmodel.h"
 
 #include "ui_issueswidget.h"
 
@@ -54,7 +55,7 @@ public slots:
     void addError(const QString &folderAlias, const QString &message, ErrorCategory category);
     void slotProgressInfo(const QString &folder, const ProgressInfo &progress);
     void slotItemCompleted(const QString &folder, const SyncFileItemPtr &item);
-    void slotOpenFile(QTreeWidgetItem *item, int);
+    void slotOpenFile(const QModelIndex &index);
 
 protected:
     void showEvent(QShowEvent *);
@@ -75,24 +76,22 @@ private:
     void updateAccountChoiceVisibility();
     AccountState *currentAccountFilter() const;
     QString currentFolderFilter() const;
-    bool shouldBeVisible(QTreeWidgetItem *item, AccountState *filterAccount,
-        const QString &filterFolderAlias) const;
-    void cleanItems(const std::function<bool(QTreeWidgetItem *)> &shouldDelete);
-    void addItem(QTreeWidgetItem *item);
-
-    /// Add the special error widget for the category, if any
-    void addErrorWidget(QTreeWidgetItem *item, const QString &message, ErrorCategory category);
+    void cleanItems(const std::function<bool(const ProtocolItem &)> &shouldDelete);
+    void addItem(ProtocolItem item);
+    void slotItemsDropped(const QVector<ProtocolItem> &items);
 
     /// Wipes all insufficient remote storgage blacklist entries
     void retryInsufficentRemoteStorageErrors(const QString &folderAlias);
 
-    /// Each insert disables sorting, this timer reenables it
-    QTimer _reenableSorting;
-
     /// Optimization: keep track of all folder/paths pairs that have an associated issue
     QSet<QPair<QString, QString>> _pathsWithIssues;
 
+    /// Conflicts that were dropped from the model, they are still reported in folderConflicts()
+    QHash<QPair<QString, QString>, ProtocolItem> _droppedConflicts;
+
     Ui::IssuesWidget *_ui;
+    ProtocolItemModel *_model;
+    ProtocolSortFilterProxyModel *_sortModel;
 };
 }
 
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include <QMenu>
+#include <QRegExp>
+
+#include "protocolitemmodel.h"
+#include "protocolwidget.h"
+#include "activityitemdelegate.h"
+#include "accountstate.h"
+#include "folder.h"
+#include "folderman.h"
+#include "guiutility.h"
+#include "syncresult.h"
+#include "theme.h"
+
+#include <tuple>
+
+namespace OCC {
+
+// New items are collected for this long before they are inserted into the model
+static const int flushIntervalMs = 200;
+
+QString ProtocolItem::timeString(QDateTime dt, QLocale::FormatType format)
+{
+    const QLocale loc = QLocale::system();
+    QString dtFormat = loc.dateTimeFormat(format);
+    static const QRegExp re("(HH|H|hh|h):mm(?!:s)");
+    dtFormat.replace(re, "\\1:mm:ss");
+    return loc.toString(dt, dtFormat);
+}
+
+ProtocolItem ProtocolItem::create(const QString &folder, const SyncFileItem &item)
+{
+    ProtocolItem protocolItem;
+    protocolItem._timestamp = QDateTime::currentMSecsSinceEpoch();
+    protocolItem._path = item._file;
+    // Share the data in the common case
+    protocolItem._originalFile = item._originalFile == item._file ? item._file : item._originalFile;
+    protocolItem._folderName = folder;
+
+    // If the error string is set, it's prefered because it is a useful user message.
+    protocolItem._message = item._errorString;
+    if (protocolItem._message.isEmpty()) {
+        protocolItem._message = Progress::asResultString(item);
+    }
+
+    protocolItem._status = item._status;
+    protocolItem._size = item._size;
+    protocolItem._direction = item._direction;
+    protocolItem._sizeDependent = ProgressInfo::isSizeDependent(item);
+    return protocolItem;
+}
+
+SyncJournalFileRecord ProtocolItem::syncJournalRecord(const ProtocolItem &item)
+{
+    SyncJournalFileRecord rec;
+    auto f = folder(item);
+    if (!f)
+        return rec;
+    f->journalDb()->getFileRecord(item._path, &rec);
+    return rec;
+}
+
+Folder *ProtocolItem::folder(const ProtocolItem &item)
+{
+    return FolderMan::instance()->folder(item._folderName);
+}
+
+QMenu *ProtocolItem::createContextMenu(const ProtocolItem &item, QWidget *parent)
+{
+    auto menu = new QMenu(parent);
+    menu->setAttribute(Qt::WA_DeleteOnClose);
+
+    auto f = folder(item);
+    if (f) {
+        AccountPtr account = f->accountState()->account();
+        auto rec = syncJournalRecord(item);
+        // rec might not be valid
+
+        if (rec.isValid()) {
+            // "Open in Browser" action
+            auto openInBrowser = menu->addAction(ProtocolWidget::tr("Open in browser"));
+            QObject::connect(openInBrowser, &QAction::triggered, parent, [parent, account, rec]() {
+                fetchPrivateLinkUrl(account, rec._path, rec.legacyDeriveNumericFileId(), parent,
+                    [parent](const QString &url) {
+                        Utility::openBrowser(url, parent);
+                    });
+            });
+        }
+    }
+
+    // More actions will be conditionally added to the context menu here later
+
+    return menu;
+}
+
+ProtocolItemModel::ProtocolItemModel(int maxItems, const QStringList &headers, QObject *parent)
+    : QAbstractTableModel(parent)
+    , _items(maxItems)
+    , _headers(headers)
+    , _errorIcon(Theme::instance()->syncStateIcon(SyncResult::Error))
+    , _warningIcon(Theme::instance()->syncStateIcon(SyncResult::Problem))
+{
+    _flushTimer.setSingleShot(true);
+    _flushTimer.setInterval(flushIntervalMs);
+    connect(&_flushTimer, &QTimer::timeout, this, &ProtocolItemModel::flush);
+}
+
+int ProtocolItemModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _items.size();
+}
+
+int ProtocolItemModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : _headers.size();
+}
+
+QVariant ProtocolItemModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= _items.size())
+        return QVariant();
+    const auto &item = _items.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case TimeColumn:
+            return ProtocolItem::timeString(item.timestamp());
+        case FileColumn:
+            return Utility::fileNameForGuiUse(item._originalFile);
+        case FolderColumn:
+            if (auto f = ProtocolItem::folder(item))
+                return f->shortGuiLocalPath();
+            return QVariant();
+        case ActionColumn:
+            return item._message;
+        case SizeColumn:
+            if (item._sizeDependent)
+                return Utility::octetsToString(item._size);
+            return QVariant();
+        }
+        break;
+    case Qt::ToolTipRole:
+        // Warning: The data and tooltips on the columns define an implicit
+        // interface and can only be changed with care.
+        switch (index.column()) {
+        case TimeColumn:
+            return ProtocolItem::timeString(item.timestamp(), QLocale::LongFormat);
+        case FileColumn:
+            if (!item._path.isEmpty())
+                return item._path;
+            break;
+        case ActionColumn:
+            return item._message;
+        }
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == TimeColumn) {
+            const auto status = item._status;
+            if (status == SyncFileItem::NormalError
+                || status == SyncFileItem::FatalError
+                || status == SyncFileItem::DetailError
+                || status == SyncFileItem::BlacklistedError) {
+                return _errorIcon;
+            } else if (Progress::isWarningKind(status)) {
+                return _warningIcon;
+            }
+        }
+        break;
+    case Qt::SizeHintRole:
+        if (index.column() == TimeColumn)
+            return QSize(0, ActivityItemDelegate::rowHeight());
+        break;
+    }
+    return QVariant();
+}
+
+QVariant ProtocolItemModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole)
+        return _headers.value(section);
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+void ProtocolItemModel::addItem(ProtocolItem item)
+{
+    _pending.push_back(std::move(item));
+    if (!_flushTimer.isActive())
+        _flushTimer.start();
+}
+
+void ProtocolItemModel::flush()
+{
+    _flushTimer.stop();
+    if (_pending.empty())
+        return;
+
+    QVector<ProtocolItem> dropped;
+
+    // Only the newest items of a huge batch would survive anyway
+    const int maxItems = _items.capacity();
+    auto first = _pending.begin();
+    if (static_cast<int>(_pending.size()) > maxItems)
+        first = _pending.end() - maxItems;
+    const int count = static_cast<int>(_pending.end() - first);
+
+    // Make room by dropping the oldest items
+    const int overflow = _items.size() + count - maxItems;
+    if (overflow > 0) {
+        dropped.reserve(overflow);
+        for (int row = 0; row < overflow; ++row)
+            dropped.append(std::move(_items[row]));
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        _items.removeFirst(overflow);
+        endRemoveRows();
+    }
+    for (auto it = _pending.begin(); it != first; ++it)
+        dropped.append(std::move(*it));
+
+    beginInsertRows(QModelIndex(), _items.size(), _items.size() + count - 1);
+    for (auto it = first; it != _pending.end(); ++it)
+        _items.append(std::move(*it));
+    endInsertRows();
+    _pending.clear();
+
+    if (!dropped.isEmpty())
+        emit itemsDropped(dropped);
+}
+
+bool ProtocolItemModel::removeFirst(const std::function<bool(const ProtocolItem &)> &pred)
+{
+    flush();
+    for (int row = 0; row < _items.size(); ++row) {
+        if (pred(_items.at(row))) {
+            beginRemoveRows(QModelIndex(), row, row);
+            _items.removeAt(row);
+            endRemoveRows();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProtocolItemModel::removeIf(const std::function<bool(const ProtocolItem &)> &pred)
+{
+    flush();
+    // Removing scattered rows one by one is quadratic in views and proxies,
+    // resetting is cheaper.
+    beginResetModel();
+    _items.removeIf(pred);
+    endResetModel();
+}
+
+ProtocolSortFilterProxyModel::ProtocolSortFilterProxyModel(ProtocolItemModel *model, QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , _model(model)
+{
+    setSourceModel(model);
+}
+
+void ProtocolSortFilterProxyModel::setFilter(const Filter &filter)
+{
+    _filter = filter;
+    invalidateFilter();
+}
+
+const ProtocolItem &ProtocolSortFilterProxyModel::item(const QModelIndex &index) const
+{
+    return _model->item(mapToSource(index).row());
+}
+
+bool ProtocolSortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &) const
+{
+    return !_filter || _filter(_model->item(sourceRow));
+}
+
+bool ProtocolSortFilterProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+    const auto &leftItem = _model->item(left.row());
+    const auto &rightItem = _model->item(right.row());
+    switch (left.column()) {
+    case ProtocolItemModel::TimeColumn:
+        // Items with empty "File" column are larger than others,
+        // otherwise sort by time (this uses lexicographic ordering)
+        return std::make_tuple(leftItem._path.isEmpty(), leftItem._timestamp)
+            < std::make_tuple(rightItem._path.isEmpty(), rightItem._timestamp);
+    case ProtocolItemModel::SizeColumn:
+        return leftItem._size < rightItem._size;
+    }
+    return QSortFilterProxyModel::lessThan(left, right);
+}
+}
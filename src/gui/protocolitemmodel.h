@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef PROTOCOLITEMMODEL_H
+#define PROTOCOLITEMMODEL_H
+
+#include <QAbstractTableModel>
+#include <QDateTime>
+#include <QIcon>
+#include <QLocale>
+#include <QSortFilterProxyModel>
+#include <QTimer>
+#include <functional>
+
+#include "common/ringbuffer.h"
+#include "common/syncjournalfilerecord.h"
+#include "progressdispatcher.h"
+#include "syncfileitem.h"
+
+class QMenu;
+
+namespace OCC {
+
+class Folder;
+
+/**
+ * @brief One entry of the protocol and issue lists
+ *
+ * Kept small since there may be a lot of them: the texts of the folder and
+ * time columns are only built when they are displayed.
+ *
+ * @ingroup gui
+ */
+struct ProtocolItem
+{
+    ProtocolItem()
+        : _status(SyncFileItem::NoStatus)
+        , _direction(SyncFileItem::None)
+        , _sizeDependent(false)
+    {
+    }
+
+    // Shared with IssueWidget
+    static ProtocolItem create(const QString &folder, const SyncFileItem &item);
+    static QString timeString(QDateTime dt, QLocale::FormatType format = QLocale::NarrowFormat);
+
+    static SyncJournalFileRecord syncJournalRecord(const ProtocolItem &item);
+    static Folder *folder(const ProtocolItem &item);
+
+    /**
+     * Builds the context menu for the item, callers may add more actions.
+     *
+     * The menu deletes itself when closed. It may be empty, callers
+     * should delete it instead of showing it then.
+     */
+    static QMenu *createContextMenu(const ProtocolItem &item, QWidget *parent);
+
+    QDateTime timestamp() const { return QDateTime::fromMSecsSinceEpoch(_timestamp); }
+
+    QString _path; // the path in the sync folder, empty for folder wide errors
+    QString _originalFile;
+    QString _folderName; // the folder alias
+    QString _message;
+    qint64 _timestamp = 0; // msecs since epoch
+    quint64 _size = 0;
+    SyncFileItem::Status _status BITFIELD(4);
+    SyncFileItem::Direction _direction BITFIELD(3);
+    bool _sizeDependent BITFIELD(1);
+    ErrorCategory _errorCategory = ErrorCategory::Normal;
+};
+
+/**
+ * @brief Flat model of ProtocolItems for the protocol and issue lists
+ *
+ * The items are stored in a RingBuffer that drops the oldest items once
+ * the maximum is reached. Items are added in batches to keep views and
+ * proxy models from doing their bookkeeping once per item.
+ *
+ * @ingroup gui
+ */
+class ProtocolItemModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    enum Column {
+        TimeColumn,
+        FileColumn,
+        FolderColumn,
+        ActionColumn,
+        SizeColumn
+    };
+
+    /** headers defines the column count, the size column is optional */
+    ProtocolItemModel(int maxItems, const QStringList &headers, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const Q_DECL_OVERRIDE;
+
+    const ProtocolItem &item(int row) const { return _items.at(row); }
+    int maxItems() const { return _items.capacity(); }
+
+    /** Queues the item, it becomes visible with the next flush() */
+    void addItem(ProtocolItem item);
+
+    /** Inserts all queued items into the model */
+    void flush();
+
+    /** Removes the first item for which pred is true, returns whether there was one */
+    bool removeFirst(const std::function<bool(const ProtocolItem &)> &pred);
+
+    /** Removes all items for which pred is true */
+    void removeIf(const std::function<bool(const ProtocolItem &)> &pred);
+
+signals:
+    /** The oldest items were dropped to stay within maxItems() */
+    void itemsDropped(const QVector<ProtocolItem> &items);
+
+private:
+    RingBuffer<ProtocolItem> _items;
+    std::vector<ProtocolItem> _pending;
+    QTimer _flushTimer;
+    QStringList _headers;
+    QIcon _errorIcon;
+    QIcon _warningIcon;
+};
+
+/**
+ * @brief Sorting and filtering on top of a ProtocolItemModel
+ *
+ * Sorting by time moves the folder wide entries to the top, see lessThan().
+ *
+ * @ingroup gui
+ */
+class ProtocolSortFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    using Filter = std::function<bool(const ProtocolItem &)>;
+
+    explicit ProtocolSortFilterProxyModel(ProtocolItemModel *model, QObject *parent = nullptr);
+
+    /** Only the items for which filter returns true are shown */
+    void setFilter(const Filter &filter);
+
+    const ProtocolItem &item(const QModelIndex &index) const;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const Q_DECL_OVERRIDE;
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const Q_DECL_OVERRIDE;
+
+private:
+    ProtocolItemModel *_model;
+    Filter _filter;
+};
+}
+
+#endif // PROTOCOLITEMMODEL_H
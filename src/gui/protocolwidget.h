@@ -21,6 +21,7 @@
 
 #include "progressdispatcher.h"
 #include "owncloudgui.h"
+#include "protocolitemmodel.h"
 
 #include "ui_protocolwidget.h"
 
@@ -34,49 +35,6 @@ namespace Ui {
 }
 class Application;
 
-/**
- * The items used in the protocol and issue QTreeWidget
- *
- * Special sorting: It allows items for global entries to be moved to the top if the
- * sorting section is the "Time" column.
- */
-class ProtocolItem : public QTreeWidgetItem
-{
-public:
-    using QTreeWidgetItem::QTreeWidgetItem;
-
-    // Shared with IssueWidget
-    static ProtocolItem *create(const QString &folder, const SyncFileItem &item);
-    static QString timeString(QDateTime dt, QLocale::FormatType format = QLocale::NarrowFormat);
-
-    struct ExtraData
-    {
-        ExtraData()
-            : status(SyncFileItem::NoStatus)
-            , direction(SyncFileItem::None)
-        {
-        }
-
-        QString path;
-        QString folderName;
-        QDateTime timestamp;
-        quint64 size = 0;
-        SyncFileItem::Status status BITFIELD(4);
-        SyncFileItem::Direction direction BITFIELD(3);
-    };
-
-    static ExtraData extraData(const QTreeWidgetItem *item);
-    static void setExtraData(QTreeWidgetItem *item, const ExtraData &data);
-
-    static SyncJournalFileRecord syncJournalRecord(QTreeWidgetItem *item);
-    static Folder *folder(QTreeWidgetItem *item);
-
-    static void openContextMenu(QPoint globalPos, QTreeWidgetItem *item, QWidget *parent);
-
-private:
-    bool operator<(const QTreeWidgetItem &other) const override;
-};
-
 /**
  * @brief The ProtocolWidget class
  * @ingroup gui
@@ -93,7 +51,7 @@ public:
 
 public slots:
     void slotItemCompleted(const QString &folder, const SyncFileItemPtr &item);
-    void slotOpenFile(QTreeWidgetItem *item, int);
+    void slotOpenFile(const QModelIndex &index);
 
 protected:
     void showEvent(QShowEvent *);
@@ -107,6 +65,8 @@ signals:
 
 private:
     Ui::ProtocolWidget *_ui;
+    ProtocolItemModel *_model;
+    ProtocolSortFilterProxyModel *_sortModel;
 };
 }
 #endif // PROTOCOLWIDGET_H
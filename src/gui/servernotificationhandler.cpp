@@ -35,7 +35,6 @@ void ServerNotificationHandler::slotFetchNotifications(AccountState *ptr)
 {
     // check connectivity and credentials
     if (!(ptr && ptr->isConnected() && ptr->account() && ptr->account()->credentials() && ptr->account()->credentials()->ready())) {
-        deleteLater();
         return;
     }
     // check if the account has notifications enabled. If the capabilities are
@@ -43,32 +42,53 @@ void ServerNotificationHandler::slotFetchNotifications(AccountState *ptr)
     if (ptr->account()->capabilities().isValid()) {
         if (!ptr->account()->capabilities().notificationsAvailable()) {
             qCInfo(lcServerNotification) << "Account" << ptr->account()->displayName() << "does not have notifications enabled.";
-            deleteLater();
             return;
         }
     }
 
     // if the previous notification job has finished, start next.
-    _notificationJob = new JsonApiJob(ptr->account(), notificationsPath, this);
-    QObject::connect(_notificationJob.data(), &JsonApiJob::jsonReceived,
+    if (_notificationJobs.value(ptr)) {
+        return;
+    }
+    auto job = new JsonApiJob(ptr->account(), notificationsPath, this);
+    QObject::connect(job, &JsonApiJob::jsonReceived,
         this, &ServerNotificationHandler::slotNotificationsReceived);
-    _notificationJob->setProperty("AccountStatePtr", QVariant::fromValue<AccountState *>(ptr));
+    QObject::connect(job, &JsonApiJob::notModified, this, [this, ptr, job] {
+        if (_notificationJobs.value(ptr) == job)
+            qCDebug(lcServerNotification) << "Notifications of" << ptr->account()->displayName() << "didn't change";
+    });
+    job->setProperty("AccountStatePtr", QVariant::fromValue<AccountState *>(ptr));
+    job->setIfNoneMatch(_etags.value(ptr));
+    _notificationJobs[ptr] = job;
+
+    job->start();
+}
 
-    _notificationJob->start();
+void ServerNotificationHandler::slotRemoveAccount(AccountState *ptr)
+{
+    // A running fetch is ignored when it finishes
+    _notificationJobs.remove(ptr);
+    _etags.remove(ptr);
 }
 
 void ServerNotificationHandler::slotNotificationsReceived(const QJsonDocument &json, int statusCode)
 {
+    auto job = qobject_cast<JsonApiJob *>(sender());
+    AccountState *ai = qvariant_cast<AccountState *>(job->property("AccountStatePtr"));
+    if (_notificationJobs.value(ai) != job) {
+        // The account was removed
+        return;
+    }
+
     if (statusCode != 200) {
         qCWarning(lcServerNotification) << "Notifications failed with status code " << statusCode;
-        deleteLater();
+        _etags.remove(ai);
         return;
     }
+    _etags[ai] = job->etag();
 
     auto notifies = json.object().value("ocs").toObject().value("data").toArray();
 
-    AccountState *ai = qvariant_cast<AccountState *>(sender()->property("AccountStatePtr"));
-
     ActivityList list;
 
     foreach (auto element, notifies) {
@@ -76,6 +96,7 @@ void ServerNotificationHandler::slotNotificationsReceived(const QJsonDocument &j
         auto json = element.toObject();
         a._type = Activity::NotificationType;
         a._accName = ai->account()->displayName();
+        a._accountId = ai->account()->id();
         a._id = json.value("notification_id").toInt();
         a._subject = json.value("subject").toString();
         a._message = json.value("message").toString();
@@ -109,7 +130,5 @@ void ServerNotificationHandler::slotNotificationsReceived(const QJsonDocument &j
         list.append(a);
     }
     emit newNotificationList(list);
-
-    deleteLater();
 }
 }
@@ -23,6 +23,13 @@ class QJsonDocument;
 
 namespace OCC {
 
+/**
+ * @brief Fetches the notifications of the accounts
+ * @ingroup gui
+ *
+ * newNotificationList() is only emitted when an account's notifications
+ * changed since the last fetch, unchanged lists aren't transferred again.
+ */
 class ServerNotificationHandler : public QObject
 {
     Q_OBJECT
@@ -34,12 +41,17 @@ signals:
 
 public slots:
     void slotFetchNotifications(AccountState *ptr);
+    void slotRemoveAccount(AccountState *ptr);
 
 private slots:
     void slotNotificationsReceived(const QJsonDocument &json, int statusCode);
 
 private:
-    QPointer<JsonApiJob> _notificationJob;
+    /** The running fetch of each account */
+    QMap<AccountState *, QPointer<JsonApiJob>> _notificationJobs;
+
+    /** The ETag of each account's last notification list */
+    QMap<AccountState *, QByteArray> _etags;
 };
 }
 
@@ -58,7 +58,7 @@
 // This is the version that is returned when the client asks for the VERSION.
 // The first number should be changed if there is an incompatible change that breaks old clients.
 // The second number should be changed when there are new features.
-#define MIRALL_SOCKET_API_VERSION "1.1"
+#define MIRALL_SOCKET_API_VERSION "1.2"
 
 static inline QString removeTrailingSlash(QString path)
 {
@@ -88,6 +88,13 @@ namespace OCC {
 Q_LOGGING_CATEGORY(lcSocketApi, "gui.socketapi", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPublicLink, "gui.socketapi.publiclink", QtInfoMsg)
 
+// Status pushes are collected for this long before they are sent, a path
+// that changes several times within the window is only sent once.
+static const int statusPushIntervalMs = 200;
+
+// Don't queue more status pushes on a socket that still has this much unsent data
+static const qint64 maxPendingSocketBytes = 64 * 1024;
+
 class BloomFilter
 {
     // Initialize with m=1024 bits and k=2 (high and low 16 bits of a qHash).
@@ -143,10 +150,59 @@ public:
         }
     }
 
-    void sendMessageIfDirectoryMonitored(const QString &message, uint systemDirectoryHash) const
+    /** Sends several lines with as few writes as the platform allows */
+    void sendMessages(const QStringList &messages) const
+    {
+        if (messages.isEmpty())
+            return;
+#ifdef Q_OS_MAC
+        // The macOS IPC is message based and the extension expects exactly one line per message
+        for (const auto &message : messages)
+            sendMessage(message);
+#else
+        sendMessage(messages.join(QLatin1Char('\n')));
+#endif
+    }
+
+    bool isDirectoryMonitored(uint systemDirectoryHash) const
     {
-        if (_monitoredDirectoriesBloomFilter.isHashMaybeStored(systemDirectoryHash))
-            sendMessage(message, false);
+        return _monitoredDirectoriesBloomFilter.isHashMaybeStored(systemDirectoryHash);
+    }
+
+    /** Queues a status push, replacing any pending one for the same path */
+    void queueStatusMessage(const QString &systemPath, const QString &message)
+    {
+        auto it = _pendingStatusMessages.find(systemPath);
+        if (it == _pendingStatusMessages.end()) {
+            _pendingStatusPaths.append(systemPath);
+            _pendingStatusMessages.insert(systemPath, message);
+        } else {
+            *it = message;
+        }
+    }
+
+    bool hasPendingStatusMessages() const { return !_pendingStatusPaths.isEmpty(); }
+
+    /**
+     * Sends all queued status pushes at once, in the order their paths were first queued.
+     *
+     * Returns false and keeps them queued while the peer isn't reading fast enough.
+     */
+    bool flushStatusMessages()
+    {
+        if (_pendingStatusPaths.isEmpty())
+            return true;
+        if (socket->bytesToWrite() > maxPendingSocketBytes)
+            return false;
+
+        QStringList messages;
+        messages.reserve(_pendingStatusPaths.size());
+        for (const auto &path : _pendingStatusPaths)
+            messages.append(_pendingStatusMessages.value(path));
+        _pendingStatusPaths.clear();
+        _pendingStatusMessages.clear();
+        sendMessages(messages);
+        return true;
     }
 
     void registerMonitoredDirectory(uint systemDirectoryHash)
@@ -156,6 +212,9 @@ public:
 
 private:
     BloomFilter _monitoredDirectoriesBloomFilter;
+
+    QStringList _pendingStatusPaths;
+    QHash<QString, QString> _pendingStatusMessages;
 };
 
 struct ListenerHasSocketPred
@@ -216,6 +275,10 @@ SocketApi::SocketApi(QObject *parent)
 
     connect(&_localServer, &SocketApiServer::newConnection, this, &SocketApi::slotNewConnection);
 
+    _statusPushTimer.setSingleShot(true);
+    _statusPushTimer.setInterval(statusPushIntervalMs);
+    connect(&_statusPushTimer, &QTimer::timeout, this, &SocketApi::slotFlushStatusPushes);
+
     // folder watcher
     connect(FolderMan::instance(), &FolderMan::folderSyncStateChange, this, &SocketApi::slotUpdateFolderView);
 }
@@ -352,6 +415,8 @@ void SocketApi::slotUpdateFolderView(Folder *f)
 
 void SocketApi::broadcastMessage(const QString &msg, bool doWait)
 {
+    // Keep the order: status pushes that are still queued were emitted before msg
+    slotFlushStatusPushes();
     foreach (auto &listener, _listeners) {
         listener.sendMessage(msg, doWait);
     }
@@ -403,8 +468,26 @@ void SocketApi::broadcastStatusPushMessage(const QString &systemPath, SyncFileSt
     QString msg = buildMessage(QLatin1String("STATUS"), systemPath, fileStatus.toSocketAPIString());
     Q_ASSERT(!systemPath.endsWith('/'));
     uint directoryHash = qHash(systemPath.left(systemPath.lastIndexOf('/')));
-    foreach (auto &listener, _listeners) {
-        listener.sendMessageIfDirectoryMonitored(msg, directoryHash);
+    for (auto &listener : _listeners) {
+        if (listener.isDirectoryMonitored(directoryHash))
+            listener.queueStatusMessage(systemPath, msg);
+    }
+    // Don't restart a running timer, pushes must not be delayed indefinitely
+    if (!_statusPushTimer.isActive())
+        _statusPushTimer.start();
+}
+
+void SocketApi::slotFlushStatusPushes()
+{
+    bool pending = false;
+    for (auto &listener : _listeners) {
+        if (!listener.flushStatusMessages())
+            pending = true;
+    }
+    if (pending) {
+        _statusPushTimer.start();
+    } else {
+        _statusPushTimer.stop();
     }
 }
 
@@ -436,6 +519,33 @@ void SocketApi::command_RETRIEVE_FILE_STATUS(const QString &argument, SocketList
     listener->sendMessage(message);
 }
 
+void SocketApi::command_RETRIEVE_DIRECTORY_STATUS(const QString &argument, SocketListener *listener)
+{
+    auto dirData = FileData::get(argument);
+    if (!dirData.folder) {
+        // this can happen in offline mode e.g.: nothing to worry about
+        listener->sendMessage(QLatin1String("STATUS:NOP:") % QDir::toNativeSeparators(argument));
+        return;
+    }
+
+    // Same as for RETRIEVE_FILE_STATUS of one of the entries
+    listener->registerMonitoredDirectory(qHash(dirData.localPath));
+
+    const QStringList entries = QDir(dirData.localPath).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    auto &tracker = dirData.folder->syncEngine().syncFileStatusTracker();
+    tracker.prefetchDirectory(dirData.folderRelativePath, entries);
+
+    const QString relativePrefix = dirData.folderRelativePath.isEmpty() ? QString() : dirData.folderRelativePath + QLatin1Char('/');
+    const QString nativePrefix = QDir::toNativeSeparators(dirData.localPath + QLatin1Char('/'));
+    QStringList messages;
+    messages.reserve(entries.size());
+    for (const auto &entry : entries) {
+        messages.append(QLatin1String("STATUS:") % tracker.fileStatus(relativePrefix + entry).toSocketAPIString()
+            % QLatin1Char(':') % nativePrefix % entry);
+    }
+    listener->sendMessages(messages);
+}
+
 void SocketApi::command_SHARE(const QString &localFile, SocketListener *listener)
 {
     processShareRequest(localFile, listener, ShareDialogStartPage::UsersAndGroups);
@@ -17,6 +17,7 @@
 #include "syncrunfilelog.h"
 #include "common/utility.h"
 #include "filesystem.h"
+#include "syncmetrics.h"
 #include <qfileinfo.h>
 
 namespace OCC {
@@ -175,11 +176,14 @@ void SyncRunFileLog::logLap(const QString &name)
          << ", total: " << _totalDuration.elapsed() << " msec)" << endl;
 }
 
-void SyncRunFileLog::finish()
+void SyncRunFileLog::finish(const SyncMetrics &metrics)
 {
     _out << "#=#=#=# Syncrun finished " << dateTimeStr(QDateTime::currentDateTimeUtc())
          << " (last step: " << _lapDuration.elapsed() << " msec"
          << ", total: " << _totalDuration.elapsed() << " msec)" << endl;
     _file->close();
+
+    // Unlike the log, the metrics file only describes the most recent run
+    metrics.writeJson(_file->fileName() + QLatin1String(".metrics.json"));
 }
 }
@@ -24,6 +24,7 @@
 
 namespace OCC {
 class SyncFileItem;
+class SyncMetrics;
 
 /**
  * @brief The SyncRunFileLog class
@@ -36,7 +37,8 @@ public:
     void start(const QString &folderPath);
     void logItem(const SyncFileItem &item);
     void logLap(const QString &name);
-    void finish();
+    /** Closes the log and writes the metrics of the run to <log>.metrics.json */
+    void finish(const SyncMetrics &metrics);
 
 protected:
 private:
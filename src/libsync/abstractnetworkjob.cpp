@@ -30,6 +30,7 @@
 #include <QMetaEnum>
 
 #include "common/asserts.h"
+#include "contentencoding.h"
 #include "networkjobs.h"
 #include "account.h"
 #include "owncloudpropagator.h"
@@ -277,6 +278,13 @@ QString AbstractNetworkJob::errorStringParsingBody(QByteArray *body)
     }
 
     QByteArray replyBody = reply()->readAll();
+    // QNAM leaves the body compressed if the job asked for a Content-Encoding itself
+    if (!reply()->request().rawHeader("Accept-Encoding").isEmpty()) {
+        ContentDecoder decoder(reply()->rawHeader("Content-Encoding"));
+        QByteArray decoded;
+        if (decoder.decode(replyBody, &decoded))
+            replyBody = decoded;
+    }
     if (body) {
         *body = replyBody;
     }
@@ -18,6 +18,8 @@
 #include <QNetworkProxy>
 #include <QAuthenticator>
 #include <QSslConfiguration>
+#include <QSslCertificate>
+#include <QCryptographicHash>
 #include <QNetworkCookie>
 #include <QNetworkCookieJar>
 #include <QNetworkConfiguration>
@@ -25,12 +27,20 @@
 
 #include "cookiejar.h"
 #include "accessmanager.h"
+#include "account.h"
+#include "tlssessioncache.h"
 #include "common/utility.h"
 
+#include <atomic>
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcAccessManager, "sync.accessmanager", QtInfoMsg)
 
+static std::atomic<quint64> s_requests(0);
+static std::atomic<quint64> s_tlsHandshakes(0);
+static std::atomic<quint64> s_tlsHandshakesWithTicket(0);
+
 AccessManager::AccessManager(QObject *parent)
     : QNetworkAccessManager(parent)
 {
@@ -60,6 +70,15 @@ void AccessManager::setRawCookie(const QByteArray &rawCookie, const QUrl &url)
     jar->setCookiesFromUrl(cookieList, url);
 }
 
+AccessManager::ConnectionStatistics AccessManager::connectionStatistics()
+{
+    ConnectionStatistics stats;
+    stats._requests = s_requests.load();
+    stats._tlsHandshakes = s_tlsHandshakes.load();
+    stats._tlsHandshakesWithTicket = s_tlsHandshakesWithTicket.load();
+    return stats;
+}
+
 static QByteArray generateRequestId()
 {
     // Use a UUID with the starting and ending curly brace removed.
@@ -100,7 +119,64 @@ QNetworkReply *AccessManager::createRequest(QNetworkAccessManager::Operation op,
     }
 #endif
 
-    return QNetworkAccessManager::createRequest(op, newRequest, outgoingData);
+    // Offer the session of an earlier connection to the server, it may have
+    // been made by another AccessManager or before a restart
+    bool offeredTicket = false;
+    const bool encrypted = newRequest.url().scheme() == QLatin1String("https")
+        || newRequest.url().scheme() == QLatin1String("preconnect-https");
+    QString identity;
+    const bool shareSession = encrypted && tlsSessionIdentity(newRequest, &identity);
+    if (encrypted) {
+        QSslConfiguration sslConfig = newRequest.sslConfiguration();
+        sslConfig.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+        if (shareSession && sslConfig.sessionTicket().isEmpty()) {
+            sslConfig.setSessionTicket(TlsSessionCache::instance()->ticket(newRequest.url(), identity));
+        }
+        offeredTicket = !sslConfig.sessionTicket().isEmpty();
+        newRequest.setSslConfiguration(sslConfig);
+    }
+    if (!newRequest.url().scheme().startsWith(QLatin1String("preconnect-")))
+        ++s_requests;
+
+    QNetworkReply *reply = QNetworkAccessManager::createRequest(op, newRequest, outgoingData);
+    if (encrypted) {
+        // Only emitted for requests that opened a new connection
+        connect(reply, &QNetworkReply::encrypted, this, [offeredTicket] {
+            ++s_tlsHandshakes;
+            if (offeredTicket)
+                ++s_tlsHandshakesWithTicket;
+        });
+    }
+    if (shareSession) {
+        connect(reply, &QNetworkReply::finished, this, [reply, identity] {
+            const QSslConfiguration sslConfig = reply->sslConfiguration();
+            TlsSessionCache::instance()->storeTicket(reply->url(), identity, sslConfig.sessionTicket(),
+                sslConfig.sessionTicketLifeTimeHint());
+        });
+    }
+    return reply;
+}
+
+void AccessManager::setAccount(Account *account)
+{
+    _account = account;
+    _isAccountManager = true;
+}
+
+bool AccessManager::tlsSessionIdentity(const QNetworkRequest &request, QString *identity) const
+{
+    identity->clear();
+    if (_isAccountManager) {
+        // A new account, or one that is being removed
+        if (!_account || _account->id().isEmpty())
+            return false;
+        *identity = _account->id();
+    }
+    const QSslCertificate certificate = request.sslConfiguration().localCertificate();
+    if (!certificate.isNull()) {
+        *identity += QLatin1Char('/') + QString::fromLatin1(certificate.digest(QCryptographicHash::Sha256).toHex());
+    }
+    return true;
 }
 
 } // namespace OCC
@@ -17,12 +17,15 @@
 
 #include "owncloudlib.h"
 #include <QNetworkAccessManager>
+#include <QPointer>
 
 class QByteArray;
 class QUrl;
 
 namespace OCC {
 
+class Account;
+
 /**
  * @brief The AccessManager class
  * @ingroup libsync
@@ -36,8 +39,38 @@ public:
 
     void setRawCookie(const QByteArray &rawCookie, const QUrl &url);
 
+    /**
+     * The account whose requests this manager sends.
+     *
+     * The TLS sessions shared through TlsSessionCache are only resumed by
+     * managers of the same account, and only once the account got an id.
+     * Managers without an account share them with each other.
+     */
+    void setAccount(Account *account);
+
+    /** Who the request's connection authenticates as, false if its TLS session mustn't be shared */
+    bool tlsSessionIdentity(const QNetworkRequest &request, QString *identity) const;
+
+    /** How well the connections of all AccessManagers are reused */
+    struct ConnectionStatistics
+    {
+        /// Requests sent, without the warm-ups
+        quint64 _requests = 0;
+        /// Connections that needed a TLS handshake, the other requests reused one
+        quint64 _tlsHandshakes = 0;
+        /// TLS handshakes that could resume a session, see TlsSessionCache
+        quint64 _tlsHandshakesWithTicket = 0;
+    };
+
+    /** The totals since the start of the process */
+    static ConnectionStatistics connectionStatistics();
+
 protected:
     QNetworkReply *createRequest(QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData = 0) Q_DECL_OVERRIDE;
+
+private:
+    QPointer<Account> _account;
+    bool _isAccountManager = false;
 };
 
 } // namespace OCC
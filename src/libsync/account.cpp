@@ -156,18 +156,7 @@ void Account::setCredentials(AbstractCredentials *cred)
     _credentials.reset(cred);
     cred->setAccount(this);
 
-    // Note: This way the QNAM can outlive the Account and Credentials.
-    // This is necessary to avoid issues with the QNAM being deleted while
-    // processing slotHandleSslErrors().
-    _am = QSharedPointer<QNetworkAccessManager>(_credentials->createQNAM(), &QObject::deleteLater);
-
-    if (jar) {
-        _am->setCookieJar(jar);
-    }
-    connect(_am.data(), SIGNAL(sslErrors(QNetworkReply *, QList<QSslError>)),
-        SLOT(slotHandleSslErrors(QNetworkReply *, QList<QSslError>)));
-    connect(_am.data(), &QNetworkAccessManager::proxyAuthenticationRequired,
-        this, &Account::proxyAuthenticationRequired);
+    createNetworkAccessManager(jar);
     connect(_credentials.data(), &AbstractCredentials::fetched,
         this, &Account::slotCredentialsFetched);
     connect(_credentials.data(), &AbstractCredentials::asked,
@@ -219,19 +208,45 @@ void Account::resetNetworkAccessManager()
     }
 
     qCDebug(lcAccount) << "Resetting QNAM";
-    QNetworkCookieJar *jar = _am->cookieJar();
+    createNetworkAccessManager(_am->cookieJar());
+    _lastConnectionWarmUp.invalidate();
+}
 
+void Account::createNetworkAccessManager(QNetworkCookieJar *jar)
+{
     // Use a QSharedPointer to allow locking the life of the QNAM on the stack.
     // Make it call deleteLater to make sure that we can return to any QNAM stack frames safely.
+    // This way the QNAM can also outlive the Account and Credentials, which is
+    // necessary to avoid issues with the QNAM being deleted while processing
+    // slotHandleSslErrors().
     _am = QSharedPointer<QNetworkAccessManager>(_credentials->createQNAM(), &QObject::deleteLater);
 
-    _am->setCookieJar(jar); // takes ownership of the old cookie jar
+    if (jar) {
+        _am->setCookieJar(jar); // takes ownership of the old cookie jar
+    }
+    if (auto am = qobject_cast<AccessManager *>(_am.data())) {
+        am->setAccount(this);
+    }
     connect(_am.data(), SIGNAL(sslErrors(QNetworkReply *, QList<QSslError>)),
         SLOT(slotHandleSslErrors(QNetworkReply *, QList<QSslError>)));
     connect(_am.data(), &QNetworkAccessManager::proxyAuthenticationRequired,
         this, &Account::proxyAuthenticationRequired);
 }
 
+void Account::warmUpConnection()
+{
+    if (!_am || (_lastConnectionWarmUp.isValid() && _lastConnectionWarmUp.elapsed() < 60 * 1000))
+        return;
+    _lastConnectionWarmUp.start();
+
+    // Goes through AccessManager::createRequest, which offers a cached TLS session
+    if (_url.scheme() == QLatin1String("https")) {
+        _am->connectToHostEncrypted(_url.host(), _url.port(443), getOrCreateSslConfig());
+    } else {
+        _am->connectToHost(_url.host(), _url.port(80));
+    }
+}
+
 QNetworkAccessManager *Account::networkAccessManager()
 {
     return _am.data();
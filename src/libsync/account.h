@@ -26,6 +26,7 @@
 #include <QSslCipher>
 #include <QSslError>
 #include <QSharedPointer>
+#include <QElapsedTimer>
 
 #ifndef TOKEN_AUTH_ONLY
 #include <QPixmap>
@@ -34,11 +35,14 @@
 #include "common/utility.h"
 #include <memory>
 #include "capabilities.h"
+#include "bandwidthmanager.h"
 
 class QSettings;
 class QNetworkReply;
 class QUrl;
 class QNetworkAccessManager;
+class QNetworkCookieJar;
+class TestTlsSessionCache;
 
 namespace OCC {
 
@@ -218,17 +222,37 @@ public:
     bool isHttp2Supported() { return _http2Supported; }
     void setHttp2Supported(bool value) { _http2Supported = value; }
 
+    /** Whether the capabilities, server version and user info were restored
+     * from the settings and not confirmed by the server since.
+     *
+     * ConnectionValidator then only checks the credentials before reporting
+     * the account as connected, and revalidates the rest afterwards.
+     */
+    bool isServerInfoFromCache() const { return _serverInfoFromCache; }
+    void setServerInfoFromCache(bool value) { _serverInfoFromCache = value; }
+
     void clearCookieJar();
     void lendCookieJarTo(QNetworkAccessManager *guest);
     QString cookieJarPath();
 
     void resetNetworkAccessManager();
+
+    /** Opens a connection to the server ahead of the requests that will use
+     * it, so they don't wait for the DNS lookup and the TCP and TLS handshakes.
+     *
+     * Does nothing if it was called within the last minute.
+     */
+    void warmUpConnection();
     QNetworkAccessManager *networkAccessManager();
     QSharedPointer<QNetworkAccessManager> sharedNetworkAccessManager();
 
     /// Called by network jobs on credential errors, emits invalidCredentials()
     void handleInvalidCredentials();
 
+    /** Rate limits shared by the transfers of all syncs of this account */
+    BandwidthBucket &uploadBucket() { return _uploadBucket; }
+    BandwidthBucket &downloadBucket() { return _downloadBucket; }
+
 public slots:
     /// Used when forgetting credentials
     void clearQNAMCache();
@@ -262,6 +286,8 @@ protected Q_SLOTS:
 private:
     Account(QObject *parent = 0);
     void setSharedThis(AccountPtr sharedThis);
+    /// Creates _am from the credentials, with the given cookie jar if there is one
+    void createNetworkAccessManager(QNetworkCookieJar *jar);
 
     QWeakPointer<Account> _sharedThis;
     QString _id;
@@ -290,6 +316,10 @@ private:
     QSharedPointer<QNetworkAccessManager> _am;
     QScopedPointer<AbstractCredentials> _credentials;
     bool _http2Supported = false;
+    bool _serverInfoFromCache = false;
+    QElapsedTimer _lastConnectionWarmUp;
+    BandwidthBucket _uploadBucket;
+    BandwidthBucket _downloadBucket;
 
     /// Certificates that were explicitly rejected by the user
     QList<QSslCertificate> _rejectedCertificates;
@@ -298,6 +328,7 @@ private:
 
     QString _davPath; // defaults to value from theme, might be overwritten in brandings
     friend class AccountManager;
+    friend class ::TestTlsSessionCache;
 };
 }
 
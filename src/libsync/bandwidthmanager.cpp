@@ -16,7 +16,9 @@
 #include "propagatedownload.h"
 #include "propagateupload.h"
 #include "propagatorjobs.h"
+#include "account.h"
 #include "common/utility.h"
+#include "common/asserts.h"
 
 #ifdef Q_OS_WIN
 #include <windef.h>
@@ -27,6 +29,8 @@
 #include <QTimer>
 #include <QObject>
 
+#include <limits>
+
 namespace OCC {
 
 Q_LOGGING_CATEGORY(lcBandwidthManager, "sync.bandwidthmanager", QtInfoMsg)
@@ -44,6 +48,72 @@ static qint64 relativeLimitMeasuringTimerIntervalMsec = 1000 * 2;
 //  * For relative limiting, do less measuring and more delaying+giving quota
 //  * For relative limiting, smoothen measurements
 
+void BandwidthBucket::setRate(qint64 bytesPerSecond)
+{
+    bytesPerSecond = qMax<qint64>(0, bytesPerSecond);
+    if (bytesPerSecond == _rate)
+        return;
+    if (!isLimited()) {
+        // A new limit starts with a full bucket
+        _tokens = bytesPerSecond;
+        _lastRefill.start();
+    } else {
+        refill();
+        _tokens = qMin(_tokens, bytesPerSecond);
+    }
+    _rate = bytesPerSecond;
+}
+
+void BandwidthBucket::refill()
+{
+    const qint64 elapsedMsec = _lastRefill.restart();
+    _tokens = qMin(_rate, _tokens + elapsedMsec * _rate / 1000);
+}
+
+qint64 BandwidthBucket::available()
+{
+    if (!isLimited())
+        return std::numeric_limits<qint64>::max();
+    refill();
+    return _tokens;
+}
+
+void BandwidthBucket::consume(qint64 bytes)
+{
+    if (isLimited())
+        _tokens = qMax<qint64>(0, _tokens - bytes);
+}
+
+qint64 BandwidthBucket::share()
+{
+    if (!isLimited())
+        return available();
+    return available() / qMax(1, _consumers);
+}
+
+// Takes what may be sent now out of the bucket of the limit and the one of the account
+static qint64 takeQuota(BandwidthBucket &limit, BandwidthBucket *account)
+{
+    qint64 quota = limit.share();
+    if (account)
+        quota = qMin(quota, account->share());
+    limit.consume(quota);
+    if (account)
+        account->consume(quota);
+    return quota;
+}
+
+static void setConsumer(BandwidthBucket &bucket, bool *isConsumer, bool consuming)
+{
+    if (consuming == *isConsumer)
+        return;
+    if (consuming)
+        bucket.addConsumer();
+    else
+        bucket.removeConsumer();
+    *isConsumer = consuming;
+}
+
 BandwidthManager::BandwidthManager(OwncloudPropagator *p)
     : QObject()
     , _propagator(p)
@@ -55,6 +125,8 @@ BandwidthManager::BandwidthManager(OwncloudPropagator *p)
 {
     _currentUploadLimit = _propagator->_uploadLimit.fetchAndAddAcquire(0);
     _currentDownloadLimit = _propagator->_downloadLimit.fetchAndAddAcquire(0);
+    _uploadBucket->setRate(usingAbsoluteUploadLimit() ? _currentUploadLimit : 0);
+    _downloadBucket->setRate(usingAbsoluteDownloadLimit() ? _currentDownloadLimit : 0);
 
     QObject::connect(&_switchingTimer, &QTimer::timeout, this, &BandwidthManager::switchingTimerExpired);
     _switchingTimer.setInterval(10 * 1000);
@@ -63,7 +135,9 @@ BandwidthManager::BandwidthManager(OwncloudPropagator *p)
 
     // absolute uploads/downloads
     QObject::connect(&_absoluteLimitTimer, &QTimer::timeout, this, &BandwidthManager::absoluteLimitTimerExpired);
-    _absoluteLimitTimer.setInterval(1000);
+    // The quota is given out in small slices so one transfer can't use
+    // up the whole second before the others got a turn
+    _absoluteLimitTimer.setInterval(200);
     _absoluteLimitTimer.start();
 
     // Relative uploads
@@ -89,6 +163,67 @@ BandwidthManager::BandwidthManager(OwncloudPropagator *p)
 
 BandwidthManager::~BandwidthManager()
 {
+    setConsumer(*_uploadBucket, &_limitUploadConsumer, false);
+    setConsumer(*_downloadBucket, &_limitDownloadConsumer, false);
+    if (_account) {
+        setConsumer(_account->uploadBucket(), &_uploadConsumer, false);
+        setConsumer(_account->downloadBucket(), &_downloadConsumer, false);
+    }
+}
+
+void BandwidthManager::setSharedBuckets(BandwidthBucket *upload, BandwidthBucket *download)
+{
+    ASSERT(!_limitUploadConsumer && !_limitDownloadConsumer);
+    _uploadBucket = upload ? upload : &_ownUploadBucket;
+    _downloadBucket = download ? download : &_ownDownloadBucket;
+    if (usingAbsoluteUploadLimit())
+        _uploadBucket->setRate(_currentUploadLimit);
+    if (usingAbsoluteDownloadLimit())
+        _downloadBucket->setRate(_currentDownloadLimit);
+}
+
+void BandwidthManager::applyLimitMode(UploadDevice *ud)
+{
+    if (usingRelativeUploadLimit()) {
+        ud->setBandwidthLimited(true);
+        ud->setChoked(true);
+    } else if (usingAbsoluteUploadLimit() || usingAccountUploadLimit()) {
+        ud->setBandwidthLimited(true);
+        ud->setChoked(false);
+    } else {
+        ud->setBandwidthLimited(false);
+        ud->setChoked(false);
+    }
+}
+
+void BandwidthManager::applyLimitMode(GETJob *j)
+{
+    if (usingRelativeDownloadLimit()) {
+        j->setBandwidthLimited(true);
+        j->setChoked(true);
+    } else if (usingAbsoluteDownloadLimit() || usingAccountDownloadLimit()) {
+        j->setBandwidthLimited(true);
+        j->setChoked(false);
+    } else {
+        j->setBandwidthLimited(false);
+        j->setChoked(false);
+    }
+}
+
+void BandwidthManager::updateConsumers()
+{
+    // Only the syncs that are transferring get a share of a shared limit
+    setConsumer(*_uploadBucket, &_limitUploadConsumer,
+        usingAbsoluteUploadLimit() && !_absoluteUploadDeviceList.isEmpty());
+    setConsumer(*_downloadBucket, &_limitDownloadConsumer,
+        usingAbsoluteDownloadLimit() && !_downloadJobList.isEmpty());
+
+    if (!_account)
+        return;
+    setConsumer(_account->uploadBucket(), &_uploadConsumer,
+        usingAccountUploadLimit() && !_absoluteUploadDeviceList.isEmpty());
+    setConsumer(_account->downloadBucket(), &_downloadConsumer,
+        usingAccountDownloadLimit() && !_downloadJobList.isEmpty());
 }
 
 void BandwidthManager::registerUploadDevice(UploadDevice *p)
@@ -96,17 +231,7 @@ void BandwidthManager::registerUploadDevice(UploadDevice *p)
     _absoluteUploadDeviceList.append(p);
     _relativeUploadDeviceList.append(p);
     QObject::connect(p, &QObject::destroyed, this, &BandwidthManager::unregisterUploadDevice);
-
-    if (usingAbsoluteUploadLimit()) {
-        p->setBandwidthLimited(true);
-        p->setChoked(false);
-    } else if (usingRelativeUploadLimit()) {
-        p->setBandwidthLimited(true);
-        p->setChoked(true);
-    } else {
-        p->setBandwidthLimited(false);
-        p->setChoked(false);
-    }
+    applyLimitMode(p);
 }
 
 void BandwidthManager::unregisterUploadDevice(QObject *o)
@@ -124,17 +249,7 @@ void BandwidthManager::registerDownloadJob(GETJob *j)
 {
     _downloadJobList.append(j);
     QObject::connect(j, &QObject::destroyed, this, &BandwidthManager::unregisterDownloadJob);
-
-    if (usingAbsoluteDownloadLimit()) {
-        j->setBandwidthLimited(true);
-        j->setChoked(false);
-    } else if (usingRelativeDownloadLimit()) {
-        j->setBandwidthLimited(true);
-        j->setChoked(true);
-    } else {
-        j->setBandwidthLimited(false);
-        j->setChoked(false);
-    }
+    applyLimitMode(j);
 }
 
 void BandwidthManager::unregisterDownloadJob(QObject *o)
@@ -337,54 +452,59 @@ void BandwidthManager::relativeDownloadDelayTimerExpired()
 
 void BandwidthManager::switchingTimerExpired()
 {
-    qint64 newUploadLimit = _propagator->_uploadLimit.fetchAndAddAcquire(0);
-    if (newUploadLimit != _currentUploadLimit) {
-        qCInfo(lcBandwidthManager) << "Upload Bandwidth limit changed" << _currentUploadLimit << newUploadLimit;
+    reloadLimits();
+}
+
+void BandwidthManager::reloadLimits()
+{
+    if (!_account)
+        _account = _propagator->account();
+
+    int newUploadLimit = 0;
+    int newDownloadLimit = 0;
+    _propagator->networkLimits(&newUploadLimit, &newDownloadLimit);
+    const bool accountUploadLimited = _account && _account->uploadBucket().isLimited();
+    const bool accountDownloadLimited = _account && _account->downloadBucket().isLimited();
+
+    if (newUploadLimit != _currentUploadLimit || accountUploadLimited != _accountUploadLimited) {
+        qCInfo(lcBandwidthManager) << "Upload Bandwidth limit changed" << _currentUploadLimit << newUploadLimit
+                                   << "account limit" << accountUploadLimited;
         _currentUploadLimit = newUploadLimit;
+        _accountUploadLimited = accountUploadLimited;
+        _uploadBucket->setRate(usingAbsoluteUploadLimit() ? _currentUploadLimit : 0);
         Q_FOREACH (UploadDevice *ud, _relativeUploadDeviceList) {
-            if (newUploadLimit == 0) {
-                ud->setBandwidthLimited(false);
-                ud->setChoked(false);
-            } else if (newUploadLimit > 0) {
-                ud->setBandwidthLimited(true);
-                ud->setChoked(false);
-            } else if (newUploadLimit < 0) {
-                ud->setBandwidthLimited(true);
-                ud->setChoked(true);
-            }
+            applyLimitMode(ud);
         }
     }
-    qint64 newDownloadLimit = _propagator->_downloadLimit.fetchAndAddAcquire(0);
-    if (newDownloadLimit != _currentDownloadLimit) {
-        qCInfo(lcBandwidthManager) << "Download Bandwidth limit changed" << _currentDownloadLimit << newDownloadLimit;
+    if (newDownloadLimit != _currentDownloadLimit || accountDownloadLimited != _accountDownloadLimited) {
+        qCInfo(lcBandwidthManager) << "Download Bandwidth limit changed" << _currentDownloadLimit << newDownloadLimit
+                                   << "account limit" << accountDownloadLimited;
         _currentDownloadLimit = newDownloadLimit;
+        _accountDownloadLimited = accountDownloadLimited;
+        _downloadBucket->setRate(usingAbsoluteDownloadLimit() ? _currentDownloadLimit : 0);
         Q_FOREACH (GETJob *j, _downloadJobList) {
-            if (usingAbsoluteDownloadLimit()) {
-                j->setBandwidthLimited(true);
-                j->setChoked(false);
-            } else if (usingRelativeDownloadLimit()) {
-                j->setBandwidthLimited(true);
-                j->setChoked(true);
-            } else {
-                j->setBandwidthLimited(false);
-                j->setChoked(false);
-            }
+            applyLimitMode(j);
         }
     }
+    updateConsumers();
 }
 
 void BandwidthManager::absoluteLimitTimerExpired()
 {
-    if (usingAbsoluteUploadLimit() && _absoluteUploadDeviceList.count() > 0) {
-        qint64 quotaPerDevice = _currentUploadLimit / qMax(1, _absoluteUploadDeviceList.count());
+    updateConsumers();
+
+    if ((usingAbsoluteUploadLimit() || usingAccountUploadLimit()) && _absoluteUploadDeviceList.count() > 0) {
+        qint64 quota = takeQuota(*_uploadBucket, usingAccountUploadLimit() ? &_account->uploadBucket() : nullptr);
+        qint64 quotaPerDevice = quota / _absoluteUploadDeviceList.count();
         qCDebug(lcBandwidthManager) << quotaPerDevice << _absoluteUploadDeviceList.count() << _currentUploadLimit;
         Q_FOREACH (UploadDevice *device, _absoluteUploadDeviceList) {
             device->giveBandwidthQuota(quotaPerDevice);
             qCDebug(lcBandwidthManager) << "Gave " << quotaPerDevice / 1024.0 << " kB to" << device;
         }
     }
-    if (usingAbsoluteDownloadLimit() && _downloadJobList.count() > 0) {
-        qint64 quotaPerJob = _currentDownloadLimit / qMax(1, _downloadJobList.count());
+    if ((usingAbsoluteDownloadLimit() || usingAccountDownloadLimit()) && _downloadJobList.count() > 0) {
+        qint64 quota = takeQuota(*_downloadBucket, usingAccountDownloadLimit() ? &_account->downloadBucket() : nullptr);
+        qint64 quotaPerJob = quota / _downloadJobList.count();
         qCDebug(lcBandwidthManager) << quotaPerJob << _downloadJobList.count() << _currentDownloadLimit;
         Q_FOREACH (GETJob *j, _downloadJobList) {
             j->giveBandwidthQuota(quotaPerJob);
@@ -15,9 +15,13 @@
 #ifndef BANDWIDTHMANAGER_H
 #define BANDWIDTHMANAGER_H
 
+#include "owncloudlib.h"
+#include "accountfwd.h"
+
 #include <QObject>
 #include <QLinkedList>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QIODevice>
 
 namespace OCC {
@@ -26,6 +30,46 @@ class UploadDevice;
 class GETJob;
 class OwncloudPropagator;
 
+/**
+ * @brief A token bucket for limiting a transfer rate
+ *
+ * The bucket fills up with rate() bytes per second, up to one second
+ * worth of bytes. Transfers may only send what they took out of it.
+ *
+ * A bucket can be shared by the bandwidth managers of several syncs, see
+ * Account::uploadBucket(). Each of them registers as a consumer while it
+ * has transfers and takes its share().
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT BandwidthBucket
+{
+public:
+    /** Bytes per second, 0 for no limit */
+    qint64 rate() const { return _rate; }
+    void setRate(qint64 bytesPerSecond);
+    bool isLimited() const { return _rate > 0; }
+
+    /** The bytes that may be sent now */
+    qint64 available();
+    void consume(qint64 bytes);
+
+    void addConsumer() { ++_consumers; }
+    void removeConsumer() { --_consumers; }
+    int consumerCount() const { return _consumers; }
+
+    /** The part of available() one of the consumers may take */
+    qint64 share();
+
+private:
+    void refill();
+
+    qint64 _rate = 0;
+    qint64 _tokens = 0;
+    QElapsedTimer _lastRefill;
+    int _consumers = 0;
+};
+
 /**
  * @brief The BandwidthManager class
  * @ingroup libsync
@@ -42,6 +86,27 @@ public:
     bool usingAbsoluteDownloadLimit() { return _currentDownloadLimit > 0; }
     bool usingRelativeDownloadLimit() { return _currentDownloadLimit < 0; }
 
+    // The account limits are shared with the other syncs of the account.
+    // They don't apply while a relative limit is in use.
+    bool usingAccountUploadLimit() { return _accountUploadLimited && !usingRelativeUploadLimit(); }
+    bool usingAccountDownloadLimit() { return _accountDownloadLimited && !usingRelativeDownloadLimit(); }
+
+    /**
+     * Draw the absolute limits from these buckets instead of ones of this sync.
+     *
+     * The other syncs using them get their share, so the limits apply to all
+     * of them together. Must be called before the first transfer.
+     */
+    void setSharedBuckets(BandwidthBucket *upload, BandwidthBucket *download);
+
+    /**
+     * Applies the propagator's and the account's current limits.
+     *
+     * They are checked every 10 seconds, see switchingTimerExpired(). The
+     * SyncEngine calls this once it set up the propagator, so the first
+     * transfers are limited as well.
+     */
+    void reloadLimits();
 
 public slots:
     void registerUploadDevice(UploadDevice *);
@@ -60,6 +125,10 @@ public slots:
     void relativeDownloadDelayTimerExpired();
 
 private:
+    void applyLimitMode(UploadDevice *ud);
+    void applyLimitMode(GETJob *j);
+    void updateConsumers();
+
     // for switching between absolute and relative bw limiting
     QTimer _switchingTimer;
 
@@ -99,6 +168,21 @@ private:
     qint64 _relativeDownloadLimitProgressAtMeasuringRestart;
 
     qint64 _currentDownloadLimit;
+
+    // for absolute limits, of this sync unless setSharedBuckets() was called
+    BandwidthBucket _ownUploadBucket;
+    BandwidthBucket _ownDownloadBucket;
+    BandwidthBucket *_uploadBucket = &_ownUploadBucket;
+    BandwidthBucket *_downloadBucket = &_ownDownloadBucket;
+    bool _limitUploadConsumer = false;
+    bool _limitDownloadConsumer = false;
+
+    // for the limits of the account, see Account::uploadBucket()
+    AccountPtr _account;
+    bool _accountUploadLimited = false;
+    bool _accountDownloadLimited = false;
+    bool _uploadConsumer = false;
+    bool _downloadConsumer = false;
 };
 }
 
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "bandwidthschedule.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+
+namespace OCC {
+
+static const int allDays = 0xfe; // bits 1 to 7
+
+// Day of the week as in QDate::dayOfWeek(), 0 if invalid
+static int parseDay(const QString &day)
+{
+    static const QStringList names = { "mon", "tue", "wed", "thu", "fri", "sat", "sun" };
+    int index = names.indexOf(day.toLower());
+    if (index >= 0)
+        return index + 1;
+    bool ok = false;
+    int number = day.toInt(&ok);
+    return ok && number >= 1 && number <= 7 ? number : 0;
+}
+
+// Bit mask of the days, 0 if invalid
+static int parseDays(const QString &days)
+{
+    if (days == QLatin1String("*"))
+        return allDays;
+    int result = 0;
+    foreach (const QString &item, days.split(QLatin1Char(','))) {
+        const auto range = item.split(QLatin1Char('-'));
+        if (range.size() > 2)
+            return 0;
+        const int first = parseDay(range.first());
+        const int last = parseDay(range.last());
+        if (!first || !last)
+            return 0;
+        // "sat-mon" wraps around the end of the week
+        for (int day = first;; day = day % 7 + 1) {
+            result |= 1 << day;
+            if (day == last)
+                break;
+        }
+    }
+    return result;
+}
+
+static bool parseLimit(const QString &limit, int *result)
+{
+    bool ok = false;
+    if (limit.endsWith(QLatin1Char('%'))) {
+        int percent = limit.left(limit.size() - 1).toInt(&ok);
+        if (!ok || percent < 1 || percent > 100)
+            return false;
+        *result = -percent;
+        return true;
+    }
+    int kbytes = limit.toInt(&ok);
+    if (!ok || kbytes < 0 || kbytes > 1000 * 1000)
+        return false;
+    *result = kbytes * 1000;
+    return true;
+}
+
+bool BandwidthSchedule::Rule::matches(const QDateTime &dateTime) const
+{
+    const int day = dateTime.date().dayOfWeek();
+    const QTime time = dateTime.time();
+    if (start == end)
+        return days & (1 << day);
+    if (start < end)
+        return (days & (1 << day)) && time >= start && time < end;
+
+    // The window started on the previous day
+    const int previousDay = (day + 5) % 7 + 1;
+    return ((days & (1 << day)) && time >= start) || ((days & (1 << previousDay)) && time < end);
+}
+
+BandwidthSchedule BandwidthSchedule::fromString(const QString &schedule, QString *error)
+{
+    BandwidthSchedule result;
+    foreach (const QString &ruleString, schedule.split(QLatin1Char(';'), QString::SkipEmptyParts)) {
+        const auto fields = ruleString.simplified().split(QLatin1Char(' '));
+        if (fields.size() == 1 && fields.first().isEmpty())
+            continue;
+
+        Rule rule;
+        const auto times = fields.value(1).split(QLatin1Char('-'));
+        bool valid = fields.size() == 4 && times.size() == 2;
+        if (valid) {
+            rule.days = parseDays(fields[0]);
+            rule.start = QTime::fromString(times[0], QStringLiteral("H:mm"));
+            rule.end = QTime::fromString(times[1], QStringLiteral("H:mm"));
+            // "24:00" is the end of the day
+            if (times[1] == QLatin1String("24:00"))
+                rule.end = QTime(0, 0);
+            valid = rule.days && rule.start.isValid() && rule.end.isValid()
+                && parseLimit(fields[2], &rule.uploadLimit)
+                && parseLimit(fields[3], &rule.downloadLimit);
+        }
+        if (!valid) {
+            if (error) {
+                *error = QCoreApplication::translate("BandwidthSchedule", "Invalid bandwidth schedule rule: %1")
+                             .arg(ruleString.trimmed());
+            }
+            return BandwidthSchedule();
+        }
+        result._rules.append(rule);
+    }
+    return result;
+}
+
+const BandwidthSchedule::Rule *BandwidthSchedule::ruleAt(const QDateTime &dateTime) const
+{
+    for (const auto &rule : _rules) {
+        if (rule.matches(dateTime))
+            return &rule;
+    }
+    return nullptr;
+}
+}
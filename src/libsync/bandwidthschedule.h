@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QDateTime>
+#include <QString>
+#include <QTime>
+#include <QVector>
+
+namespace OCC {
+
+/**
+ * @brief Bandwidth limits that apply at certain times of the week
+ *
+ * A schedule is a list of rules separated by ';'. Each rule has the form
+ *
+ *     <days> <start>-<end> <upload> <download>
+ *
+ * for example "mon-fri 08:00-18:00 100 50%". The days are a list of day
+ * names or ranges like "mon,wed" or "sat-sun", or "*" for every day. If the
+ * end is before the start the window continues on the next day, "fri
+ * 22:00-06:00" ends on Saturday morning. A start equal to the end is the
+ * whole day.
+ *
+ * A limit is either a rate in kB/s, a percentage for a relative limit, or 0
+ * for no limit.
+ *
+ * The first rule that matches wins. Outside of all rules the configured
+ * limits apply.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT BandwidthSchedule
+{
+public:
+    struct Rule
+    {
+        int days = 0; // bit n is set for QDate::dayOfWeek() n
+        QTime start;
+        QTime end;
+        // In the units of SyncEngine::setNetworkLimits(): bytes per second
+        // if positive, a negated percentage if negative, 0 for no limit
+        int uploadLimit = 0;
+        int downloadLimit = 0;
+
+        bool matches(const QDateTime &dateTime) const;
+    };
+
+    /**
+     * Parses a schedule as described above.
+     *
+     * Returns an empty schedule and sets error if the string is invalid.
+     */
+    static BandwidthSchedule fromString(const QString &schedule, QString *error = nullptr);
+
+    bool isEmpty() const { return _rules.isEmpty(); }
+    const QVector<Rule> &rules() const { return _rules; }
+
+    /** The rule in effect at that time, or null if none is */
+    const Rule *ruleAt(const QDateTime &dateTime) const;
+
+private:
+    QVector<Rule> _rules;
+};
+}
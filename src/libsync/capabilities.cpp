@@ -91,6 +91,11 @@ bool Capabilities::isValid() const
     return !_capabilities.isEmpty();
 }
 
+QVariantMap Capabilities::raw() const
+{
+    return _capabilities;
+}
+
 QList<QByteArray> Capabilities::supportedChecksumTypes() const
 {
     QList<QByteArray> list;
@@ -164,4 +169,19 @@ QString Capabilities::zsyncSupportedVersion() const
 {
     return _capabilities[QStringLiteral("dav")].toMap()[QStringLiteral("zsync")].toString();
 }
+
+bool Capabilities::serverSideCopy() const
+{
+    return _capabilities[QStringLiteral("dav")].toMap()[QStringLiteral("serverSideCopy")].toBool();
+}
+
+bool Capabilities::gzipUploads() const
+{
+    return _capabilities[QStringLiteral("dav")].toMap()[QStringLiteral("uploadCompression")].toStringList().contains(QStringLiteral("gzip"));
+}
+
+bool Capabilities::chunkReferences() const
+{
+    return _capabilities[QStringLiteral("dav")].toMap()[QStringLiteral("chunkReferences")].toBool();
+}
 }
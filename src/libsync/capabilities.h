@@ -122,6 +122,36 @@ public:
      */
     bool uploadConflictFiles() const;
 
+    /**
+     * Whether a new file whose content is already on the server may be
+     * created with a COPY of the existing file instead of an upload.
+     *
+     * Path: dav/serverSideCopy
+     * Default: false
+     */
+    bool serverSideCopy() const;
+
+    /**
+     * Whether the server accepts upload chunks with "Content-Encoding: gzip".
+     *
+     * Path: dav/uploadCompression
+     * Default: []
+     * Example: ["gzip"]
+     */
+    bool gzipUploads() const;
+
+    /**
+     * Whether a chunk of a chunked upload can be a byte range of the file
+     * that is being replaced instead of uploaded data.
+     *
+     * Path: dav/chunkReferences
+     * Default: false
+     */
+    bool chunkReferences() const;
+
+    /// The capabilities as reported by the server, for persisting them
+    QVariantMap raw() const;
+
 private:
     QVariantMap _capabilities;
 };
@@ -82,6 +82,10 @@ static const char useUploadLimitC[] = "BWLimit/useUploadLimit";
 static const char useDownloadLimitC[] = "BWLimit/useDownloadLimit";
 static const char uploadLimitC[] = "BWLimit/uploadLimit";
 static const char downloadLimitC[] = "BWLimit/downloadLimit";
+static const char accountUploadLimitC[] = "BWLimit/accountUploadLimit";
+static const char accountDownloadLimitC[] = "BWLimit/accountDownloadLimit";
+static const char accountsC[] = "Accounts";
+static const char bandwidthScheduleC[] = "BWLimit/schedule";
 
 static const char newBigFolderSizeLimitC[] = "newBigFolderSizeLimit";
 static const char useNewBigFolderSizeLimitC[] = "useNewBigFolderSizeLimit";
@@ -90,6 +94,14 @@ static const char moveToTrashC[] = "moveToTrash";
 
 static const char deltaSyncEnabledC[] = "DeltaSync/enabled";
 static const char deltaSyncMinimumFileSizeC[] = "DeltaSync/minFileSize";
+static const char checksumTouchedFilesC[] = "checksumTouchedFiles";
+static const char downloadSegmentsC[] = "SegmentedDownload/segments";
+static const char segmentedDownloadMinimumFileSizeC[] = "SegmentedDownload/minFileSize";
+static const char downloadWriteThreadC[] = "downloadWriteThread";
+static const char smallFilesFirstC[] = "smallFilesFirst";
+static const char maxConcurrentSyncsC[] = "ConcurrentSyncs/maxFolders";
+static const char maxConcurrentSyncsPerAccountC[] = "ConcurrentSyncs/maxFoldersPerAccount";
+static const char maxConcurrentNetworkJobsC[] = "ConcurrentSyncs/maxNetworkJobs";
 
 static const char maxLogLinesC[] = "Logging/maxLogLines";
 
@@ -714,6 +726,47 @@ void ConfigFile::setDownloadLimit(int kbytes)
     setValue(downloadLimitC, kbytes);
 }
 
+static QString accountGroup(const QString &accountId)
+{
+    return accountId.isEmpty() ? QString() : QLatin1String(accountsC) + QLatin1Char('/') + accountId;
+}
+
+int ConfigFile::accountUploadLimit(const QString &accountId) const
+{
+    const QVariant fallback = accountId.isEmpty() ? QVariant(0) : QVariant(accountUploadLimit(QString()));
+    return getValue(accountUploadLimitC, accountGroup(accountId), fallback).toInt();
+}
+
+int ConfigFile::accountDownloadLimit(const QString &accountId) const
+{
+    const QVariant fallback = accountId.isEmpty() ? QVariant(0) : QVariant(accountDownloadLimit(QString()));
+    return getValue(accountDownloadLimitC, accountGroup(accountId), fallback).toInt();
+}
+
+void ConfigFile::setAccountUploadLimit(const QString &accountId, int kbytes)
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    settings.beginGroup(accountGroup(accountId));
+    settings.setValue(QLatin1String(accountUploadLimitC), kbytes);
+}
+
+void ConfigFile::setAccountDownloadLimit(const QString &accountId, int kbytes)
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    settings.beginGroup(accountGroup(accountId));
+    settings.setValue(QLatin1String(accountDownloadLimitC), kbytes);
+}
+
+QString ConfigFile::bandwidthSchedule() const
+{
+    return getValue(bandwidthScheduleC).toString();
+}
+
+void ConfigFile::setBandwidthSchedule(const QString &schedule)
+{
+    setValue(bandwidthScheduleC, schedule);
+}
+
 QPair<bool, quint64> ConfigFile::newBigFolderSizeLimit() const
 {
     auto defaultValue = Theme::instance()->newBigFolderSizeLimit();
@@ -770,6 +823,94 @@ void ConfigFile::setDeltaSyncMinFileSize(quint64 bytes)
     setValue(deltaSyncMinimumFileSizeC, bytes);
 }
 
+bool ConfigFile::checksumTouchedFiles() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(checksumTouchedFilesC), true).toBool();
+}
+
+void ConfigFile::setChecksumTouchedFiles(bool enabled)
+{
+    setValue(checksumTouchedFilesC, enabled);
+}
+
+int ConfigFile::downloadSegments() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return qMax(1, settings.value(QLatin1String(downloadSegmentsC), 4).toInt());
+}
+
+void ConfigFile::setDownloadSegments(int segments)
+{
+    setValue(downloadSegmentsC, segments);
+}
+
+quint64 ConfigFile::segmentedDownloadMinFileSize() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(segmentedDownloadMinimumFileSizeC), 100 * 1024 * 1024).toLongLong(); // default to 100 MiB
+}
+
+void ConfigFile::setSegmentedDownloadMinFileSize(quint64 bytes)
+{
+    setValue(segmentedDownloadMinimumFileSizeC, bytes);
+}
+
+bool ConfigFile::downloadWriteThread() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(downloadWriteThreadC), true).toBool();
+}
+
+void ConfigFile::setDownloadWriteThread(bool enabled)
+{
+    setValue(downloadWriteThreadC, enabled);
+}
+
+bool ConfigFile::smallFilesFirst() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(smallFilesFirstC), true).toBool();
+}
+
+void ConfigFile::setSmallFilesFirst(bool enabled)
+{
+    setValue(smallFilesFirstC, enabled);
+}
+
+int ConfigFile::maxConcurrentSyncs() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(maxConcurrentSyncsC), 3).toInt();
+}
+
+void ConfigFile::setMaxConcurrentSyncs(int folders)
+{
+    setValue(maxConcurrentSyncsC, folders);
+}
+
+int ConfigFile::maxConcurrentSyncsPerAccount() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(maxConcurrentSyncsPerAccountC), 2).toInt();
+}
+
+void ConfigFile::setMaxConcurrentSyncsPerAccount(int folders)
+{
+    setValue(maxConcurrentSyncsPerAccountC, folders);
+}
+
+int ConfigFile::maxConcurrentNetworkJobs() const
+{
+    QSettings settings(configFile(), QSettings::IniFormat);
+    return settings.value(QLatin1String(maxConcurrentNetworkJobsC), 24).toInt();
+}
+
+void ConfigFile::setMaxConcurrentNetworkJobs(int jobs)
+{
+    setValue(maxConcurrentNetworkJobsC, jobs);
+}
+
 bool ConfigFile::promptDeleteFiles() const
 {
     QSettings settings(configFile(), QSettings::IniFormat);
@@ -126,6 +126,18 @@ public:
     int downloadLimit() const;
     void setUploadLimit(int kbytes);
     void setDownloadLimit(int kbytes);
+    /** Limits for all folders of an account together, in kbyte/s, 0 for none
+     *
+     * They are stored with the account's settings. Accounts without their
+     * own limit use the one set with an empty accountId.
+     */
+    int accountUploadLimit(const QString &accountId) const;
+    int accountDownloadLimit(const QString &accountId) const;
+    void setAccountUploadLimit(const QString &accountId, int kbytes);
+    void setAccountDownloadLimit(const QString &accountId, int kbytes);
+    /** See BandwidthSchedule for the format */
+    QString bandwidthSchedule() const;
+    void setBandwidthSchedule(const QString &schedule);
     /** [checked, size in MB] **/
     QPair<bool, quint64> newBigFolderSizeLimit() const;
     void setNewBigFolderSizeLimit(bool isChecked, quint64 mbytes);
@@ -137,6 +149,33 @@ public:
     quint64 deltaSyncMinFileSize() const; // bytes
     void setDeltaSyncMinFileSize(quint64 bytes);
 
+    /** Whether local files with only a new mtime are checksummed instead of uploaded */
+    bool checksumTouchedFiles() const;
+    void setChecksumTouchedFiles(bool enabled);
+
+    /** segmented downloads of large files, 1 segment disables them */
+    int downloadSegments() const;
+    void setDownloadSegments(int segments);
+    quint64 segmentedDownloadMinFileSize() const; // bytes
+    void setSegmentedDownloadMinFileSize(quint64 bytes);
+
+    /** Whether downloads are written to disk from a worker thread */
+    bool downloadWriteThread() const;
+    void setDownloadWriteThread(bool enabled);
+
+    /** Whether small files may overtake large transfers during propagation */
+    bool smallFilesFirst() const;
+    void setSmallFilesFirst(bool enabled);
+
+    /** How many folders sync at the same time, in total and per account */
+    int maxConcurrentSyncs() const;
+    void setMaxConcurrentSyncs(int folders);
+    int maxConcurrentSyncsPerAccount() const;
+    void setMaxConcurrentSyncsPerAccount(int folders);
+    /** The network jobs of all concurrently syncing folders are bounded by this */
+    int maxConcurrentNetworkJobs() const;
+    void setMaxConcurrentNetworkJobs(int jobs);
+
 
     /** If we should move the files deleted on the server in the trash  */
     bool moveToTrash() const;
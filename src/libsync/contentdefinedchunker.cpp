@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "contentdefinedchunker.h"
+#include "owncloudpropagator.h"
+#include "account.h"
+#include "capabilities.h"
+#include "common/filesystembase.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QFile>
+
+#include <array>
+
+namespace OCC {
+
+// The hash covers this many bytes, older bytes are shifted out
+static const int gearWindow = 64;
+
+/*
+ * Random values for each byte, from splitmix64 with a fixed seed.
+ *
+ * The chunk boundaries depend on this table, changing it makes the chunks
+ * stored in the journals of existing installations useless.
+ */
+static const quint64 *gearTable()
+{
+    static const auto table = [] {
+        std::array<quint64, 256> t;
+        quint64 state = Q_UINT64_C(0x6f776e436c6f7564);
+        for (auto &value : t) {
+            state += Q_UINT64_C(0x9e3779b97f4a7c15);
+            quint64 z = state;
+            z = (z ^ (z >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+            z = (z ^ (z >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+            value = z ^ (z >> 31);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
+class ContentDefinedChunker::State
+{
+public:
+    explicit State(const ContentDefinedChunker &chunker)
+        : _chunker(chunker)
+        , _gear(gearTable())
+        , _sha(QCryptographicHash::Sha1)
+    {
+    }
+
+    void feed(const char *data, qint64 size)
+    {
+        qint64 segmentStart = 0;
+        qint64 i = 0;
+        while (i < size) {
+            // The bytes before the last window ahead of the minimum size
+            // can't end a chunk and are not part of the hash there
+            qint64 skip = qMin(size - i, _chunker._minSize - gearWindow - _length);
+            if (skip > 0) {
+                i += skip;
+                _length += skip;
+                continue;
+            }
+
+            _hash = (_hash << 1) + _gear[uchar(data[i])];
+            ++i;
+            ++_length;
+            if ((_length >= _chunker._minSize && (_hash & _chunker._mask) == 0) || _length >= _chunker._maxSize) {
+                _sha.addData(data + segmentStart, int(i - segmentStart));
+                segmentStart = i;
+                finishChunk();
+            }
+        }
+        _sha.addData(data + segmentStart, int(size - segmentStart));
+    }
+
+    Chunks finish()
+    {
+        if (_length > 0)
+            finishChunk();
+        return _chunks;
+    }
+
+private:
+    void finishChunk()
+    {
+        SyncJournalDb::ContentChunk chunk;
+        chunk._offset = _offset;
+        chunk._size = _length;
+        chunk._hash = _sha.result();
+        _chunks.append(chunk);
+
+        _offset += _length;
+        _length = 0;
+        _hash = 0;
+        _sha.reset();
+    }
+
+    const ContentDefinedChunker &_chunker;
+    const quint64 *_gear;
+    QCryptographicHash _sha;
+    quint64 _hash = 0;
+    qint64 _offset = 0; // offset of the current chunk
+    qint64 _length = 0; // bytes in the current chunk so far
+    Chunks _chunks;
+};
+
+ContentDefinedChunker::ContentDefinedChunker(qint64 averageSize)
+    : _minSize(qMax<qint64>(averageSize / 4, 2 * gearWindow))
+    , _maxSize(qMax(averageSize * 4, _minSize + 1))
+{
+    // After the minimum size a boundary is expected every 2^bits bytes,
+    // use the largest 2^bits that keeps the chunks below the average size.
+    int bits = 1;
+    while ((qint64(2) << bits) <= averageSize - _minSize)
+        ++bits;
+    // The high bits of the hash depend on the whole window, the low ones
+    // only on the last few bytes
+    _mask = ~quint64(0) << (64 - bits);
+}
+
+ContentDefinedChunker::Result ContentDefinedChunker::chunkFile(const QString &fileName) const
+{
+    Result result;
+    QFile file(fileName);
+    QString error;
+    if (!FileSystem::openAndSeekFileSharedRead(&file, &error, 0)) {
+        result.errorString = error;
+        return result;
+    }
+
+    State state(*this);
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    while (true) {
+        qint64 read = file.read(buffer.data(), buffer.size());
+        if (read < 0) {
+            result.errorString = QCoreApplication::translate("ContentDefinedChunker", "Could not read %1: %2")
+                                     .arg(fileName, file.errorString());
+            return result;
+        }
+        if (read == 0)
+            break;
+        state.feed(buffer.constData(), read);
+    }
+    result.chunks = state.finish();
+    return result;
+}
+
+ContentDefinedChunker::Chunks ContentDefinedChunker::chunkData(const QByteArray &data) const
+{
+    State state(*this);
+    state.feed(data.constData(), data.size());
+    return state.finish();
+}
+
+bool isContentChunkingEnabled(OwncloudPropagator *propagator, const SyncFileItemPtr &item)
+{
+    if (!propagator->account()->capabilities().chunkReferences()) {
+        qCInfo(lcPropagator) << "[content chunking disabled] Lack of server support.";
+        return false;
+    }
+    if (item->_remotePerm.hasPermission(RemotePermissions::IsMounted) || item->_remotePerm.hasPermission(RemotePermissions::IsMountedSub)) {
+        qCInfo(lcPropagator) << "[content chunking disabled] External storage not supported.";
+        return false;
+    }
+    if (!propagator->syncOptions()._deltaSyncEnabled) {
+        qCInfo(lcPropagator) << "[content chunking disabled] Client configuration option.";
+        return false;
+    }
+    if (item->_size < propagator->syncOptions()._deltaSyncMinFileSize) {
+        qCInfo(lcPropagator) << "[content chunking disabled] File size is smaller than minimum.";
+        return false;
+    }
+
+    return true;
+}
+}
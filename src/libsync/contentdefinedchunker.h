@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+#include "common/syncjournaldb.h"
+#include "syncfileitem.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace OCC {
+
+class OwncloudPropagator;
+
+/**
+ * @brief Splits file data into chunks at content-defined boundaries
+ *
+ * The boundaries are found with a rolling "gear" hash over the last 64
+ * bytes, so they only depend on the data around them. Inserting or
+ * removing bytes changes the chunks around the edit, the chunks before
+ * and after it stay the same - unlike chunks at fixed offsets, which all
+ * change after an insertion.
+ *
+ * Chunks are between a quarter and four times the average size, only the
+ * last chunk of a file can be smaller.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT ContentDefinedChunker
+{
+public:
+    using Chunks = QVector<SyncJournalDb::ContentChunk>;
+
+    struct Result
+    {
+        Chunks chunks;
+        QString errorString; // empty on success
+    };
+
+    explicit ContentDefinedChunker(qint64 averageSize = 1024 * 1024);
+
+    /** Chunks the data of a whole file, may be run on the I/O executor */
+    Result chunkFile(const QString &fileName) const;
+
+    Chunks chunkData(const QByteArray &data) const;
+
+    qint64 minSize() const { return _minSize; }
+    qint64 maxSize() const { return _maxSize; }
+
+private:
+    class State;
+
+    qint64 _minSize;
+    qint64 _maxSize;
+    quint64 _mask;
+};
+
+/**
+ * Whether an upload may send only the chunks the server doesn't have yet.
+ *
+ * Needs the server's "chunkReferences" capability and the same client
+ * configuration as zsync, which takes precedence if the server supports both.
+ *
+ * @ingroup libsync
+ */
+bool isContentChunkingEnabled(OwncloudPropagator *propagator, const SyncFileItemPtr &item);
+}
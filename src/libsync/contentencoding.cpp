@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "config.h"
+#include "contentencoding.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QSet>
+
+#ifdef ZLIB_FOUND
+#include <zlib.h>
+#else
+struct z_stream_s
+{
+};
+#endif
+
+namespace OCC {
+
+QByteArray ContentEncoding::acceptEncoding()
+{
+#ifdef ZLIB_FOUND
+    return QByteArrayLiteral("gzip, deflate");
+#else
+    return QByteArray();
+#endif
+}
+
+QByteArray ContentEncoding::gzip(const QByteArray &data)
+{
+#ifdef ZLIB_FOUND
+    z_stream stream = {};
+    // 16 + MAX_WBITS: write a gzip header and trailer instead of the zlib ones
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return QByteArray();
+
+    QByteArray result;
+    result.resize(int(deflateBound(&stream, uLong(data.size()))));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = uInt(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(result.data());
+    stream.avail_out = uInt(result.size());
+    int ret = deflate(&stream, Z_FINISH);
+    result.resize(int(stream.total_out));
+    deflateEnd(&stream);
+    if (ret != Z_STREAM_END)
+        return QByteArray();
+    return result;
+#else
+    Q_UNUSED(data);
+    return QByteArray();
+#endif
+}
+
+bool ContentEncoding::isLikelyCompressible(const QString &fileName)
+{
+    static const QSet<QString> compressedSuffixes = {
+        "7z", "avi", "bz2", "cab", "deb", "docx", "dmg", "epub", "flac", "gif",
+        "gz", "heic", "jar", "jpeg", "jpg", "m4a", "m4v", "mkv", "mov", "mp3",
+        "mp4", "odp", "ods", "odt", "ogg", "opus", "pdf", "png", "pptx", "rar",
+        "rpm", "tgz", "webm", "webp", "xlsx", "xz", "zip", "zst"
+    };
+    return !compressedSuffixes.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+ContentDecoder::ContentDecoder(const QByteArray &contentEncoding)
+{
+    auto encoding = contentEncoding.trimmed().toLower();
+    if (encoding.isEmpty() || encoding == "identity") {
+        _mode = Identity;
+        return;
+    }
+#ifdef ZLIB_FOUND
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        _mode = Gzip;
+        return;
+    }
+    if (encoding == "deflate") {
+        _mode = Deflate;
+        return;
+    }
+#endif
+    _errorString = QCoreApplication::translate("ContentDecoder", "Unsupported content encoding: %1")
+                       .arg(QString::fromLatin1(contentEncoding));
+}
+
+ContentDecoder::~ContentDecoder()
+{
+#ifdef ZLIB_FOUND
+    if (_initialized)
+        inflateEnd(_stream.get());
+#endif
+}
+
+bool ContentDecoder::init(const QByteArray &start)
+{
+#ifdef ZLIB_FOUND
+    int windowBits = MAX_WBITS;
+    if (_mode == Gzip) {
+        windowBits += 16;
+    } else {
+        // "deflate" is supposed to be zlib wrapped, but some servers send
+        // raw deflate data. A zlib header is a multiple of 31.
+        auto cmf = uchar(start[0]);
+        auto flg = uchar(start[1]);
+        if ((cmf & 0x0f) != Z_DEFLATED || (cmf * 256 + flg) % 31 != 0)
+            windowBits = -MAX_WBITS;
+    }
+    _stream.reset(new z_stream_s());
+    if (inflateInit2(_stream.get(), windowBits) != Z_OK) {
+        _errorString = QCoreApplication::translate("ContentDecoder", "Could not initialize decompression");
+        return false;
+    }
+    _initialized = true;
+    return true;
+#else
+    Q_UNUSED(start);
+    return false;
+#endif
+}
+
+bool ContentDecoder::decode(const QByteArray &data, QByteArray *out)
+{
+    if (!_errorString.isEmpty())
+        return false;
+    if (_mode == Identity) {
+        out->append(data);
+        return true;
+    }
+#ifdef ZLIB_FOUND
+    QByteArray input = data;
+    if (!_initialized) {
+        _pending.append(data);
+        if (_pending.size() < 2)
+            return true;
+        input = _pending;
+        _pending.clear();
+        if (!init(input))
+            return false;
+    }
+
+    if (_streamEnd)
+        return true;
+
+    _stream->next_in = reinterpret_cast<Bytef *>(input.data());
+    _stream->avail_in = uInt(input.size());
+    char buffer[64 * 1024];
+    do {
+        _stream->next_out = reinterpret_cast<Bytef *>(buffer);
+        _stream->avail_out = sizeof(buffer);
+        int ret = inflate(_stream.get(), Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            _errorString = QCoreApplication::translate("ContentDecoder", "Corrupt compressed data: %1")
+                               .arg(QString::fromLatin1(_stream->msg ? _stream->msg : "unknown error"));
+            return false;
+        }
+        out->append(buffer, int(sizeof(buffer) - _stream->avail_out));
+        // Anything after the end of the stream is ignored
+        _streamEnd = ret == Z_STREAM_END;
+        if (ret == Z_BUF_ERROR)
+            break;
+        // A full buffer means inflate() may have more output for the same input
+    } while ((_stream->avail_in > 0 || _stream->avail_out == 0) && !_streamEnd);
+    return true;
+#else
+    Q_UNUSED(out);
+    return false;
+#endif
+}
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include <memory>
+
+struct z_stream_s;
+
+namespace OCC {
+
+/**
+ * @brief Helpers for compressed HTTP bodies
+ *
+ * QNAM only decompresses replies by itself if the request did not set
+ * Accept-Encoding, and then only hands out the data once it went through
+ * its own buffers. Jobs that want to process large bodies as they arrive
+ * set acceptEncoding() and decode the body with a ContentDecoder.
+ *
+ * All of this needs zlib, without it nothing is compressed.
+ *
+ * @ingroup libsync
+ */
+namespace ContentEncoding {
+    /** Value for the Accept-Encoding header, empty if decoding is not supported */
+    OWNCLOUDSYNC_EXPORT QByteArray acceptEncoding();
+
+    /**
+     * The data compressed for a "Content-Encoding: gzip" request body.
+     *
+     * Returns an empty array if compression is not supported or failed.
+     */
+    OWNCLOUDSYNC_EXPORT QByteArray gzip(const QByteArray &data);
+
+    /**
+     * Whether a file is worth compressing, judged by its suffix.
+     *
+     * Images, videos, archives and office documents are compressed already.
+     */
+    OWNCLOUDSYNC_EXPORT bool isLikelyCompressible(const QString &fileName);
+}
+
+/**
+ * @brief Decodes a gzip or deflate encoded body piece by piece
+ *
+ * Bodies without a Content-Encoding are passed through unchanged.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT ContentDecoder
+{
+public:
+    /** contentEncoding is the value of the reply's Content-Encoding header */
+    explicit ContentDecoder(const QByteArray &contentEncoding);
+    ~ContentDecoder();
+
+    /**
+     * Appends the decoded data of the next piece of the body to out.
+     *
+     * Returns false if the data is corrupt or the encoding is not supported,
+     * the rest of the body can't be decoded then.
+     */
+    bool decode(const QByteArray &data, QByteArray *out);
+
+    QString errorString() const { return _errorString; }
+
+private:
+    enum Mode {
+        Identity,
+        Gzip,
+        Deflate
+    };
+
+    bool init(const QByteArray &start);
+
+    Mode _mode = Identity;
+    std::unique_ptr<z_stream_s> _stream;
+    bool _initialized = false;
+    bool _streamEnd = false;
+    QByteArray _pending; // the start of a deflate body, until its format is known
+    QString _errorString;
+};
+}
@@ -22,6 +22,7 @@
 #include <QTextCodec>
 #include "vio/csync_vio_local.h"
 #include "common/checksums.h"
+#include "syncmetrics.h"
 #include "csync_exclude.h"
 #include "csync_util.h"
 
@@ -309,12 +310,13 @@ void ProcessDirectoryJob::processFile(PathTuple path,
 
 // Compute the checksum of the given file and assign the result in item->_checksumHeader
 // Returns true if the checksum was successfully computed
-static bool computeLocalChecksum(const QByteArray &header, const QString &path, const SyncFileItemPtr &item)
+static bool computeLocalChecksum(const QByteArray &header, const QString &path, const SyncFileItemPtr &item,
+    const ChecksumByteCounter &byteCounter)
 {
     auto type = parseChecksumHeaderType(header);
     if (!type.isEmpty()) {
         // TODO: compute async?
-        QByteArray checksum = ComputeChecksum::computeNow(path, type);
+        QByteArray checksum = ComputeChecksum::computeNow(path, type, byteCounter);
         if (!checksum.isEmpty()) {
             item->_checksumHeader = makeChecksumHeader(type, checksum);
             return true;
@@ -666,13 +668,40 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
             item->_checksumHeader.clear();
             item->_size = localEntry.size;
             item->_modtime = localEntry.modtime;
-            _childModified = true;
 
-            // Checksum comparison at this stage is only enabled for .eml files,
+            // Checksum comparison at this stage is always enabled for .eml files,
             // check #4754 #4755
             bool isEmlFile = path._original.endsWith(QLatin1String(".eml"), Qt::CaseInsensitive);
-            if (isEmlFile && dbEntry._fileSize == localEntry.size && !dbEntry._checksumHeader.isEmpty()) {
-                if (computeLocalChecksum(dbEntry._checksumHeader, _discoveryData->_localDir + path._local, item)
+            bool sameSize = dbEntry._fileSize == localEntry.size && !dbEntry._checksumHeader.isEmpty();
+            if (sameSize && !isEmlFile && !noServerEntry && item->_type == ItemTypeFile
+                && _discoveryData->_syncOptions._checksumTouchedFiles) {
+                // Only the mtime may have changed (touch, build systems...): compare the
+                // content checksum in a thread to avoid uploading the file again.
+                auto checksumType = parseChecksumHeaderType(dbEntry._checksumHeader);
+                if (!checksumType.isEmpty()) {
+                    _pendingAsyncJobs++;
+                    _discoveryData->computeChecksumAsync(_discoveryData->_localDir + path._local, checksumType, this,
+                        [=](const QByteArray &checksum) {
+                            if (!checksum.isEmpty())
+                                item->_checksumHeader = makeChecksumHeader(checksumType, checksum);
+                            if (!checksum.isEmpty() && item->_checksumHeader == dbEntry._checksumHeader) {
+                                qCInfo(lcDisco) << "NOTE: Checksums are identical, file was only touched: " << path._local;
+                                item->_instruction = CSYNC_INSTRUCTION_UPDATE_METADATA;
+                            } else {
+                                item->_checksumHeader.clear();
+                                _childModified = true;
+                            }
+                            processFileFinalize(item, path, false, ParentDontExist, recurseQueryServer);
+                            _pendingAsyncJobs--;
+                            QTimer::singleShot(0, _discoveryData, &DiscoveryPhase::scheduleMoreJobs);
+                        });
+                    return;
+                }
+            }
+
+            _childModified = true;
+            if (sameSize && isEmlFile) {
+                if (computeLocalChecksum(dbEntry._checksumHeader, _discoveryData->_localDir + path._local, item, _discoveryData->_checksumBytes)
                         && item->_checksumHeader == dbEntry._checksumHeader) {
                     qCInfo(lcDisco) << "NOTE: Checksums are identical, file did not actually change: " << path._local;
                     item->_instruction = CSYNC_INSTRUCTION_UPDATE_METADATA;
@@ -726,7 +755,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
 
     // Check if it is a move
     OCC::SyncJournalFileRecord base;
-    if (!_discoveryData->_statedb->getFileRecordByInode(localEntry.inode, &base)) {
+    if (!_discoveryData->getFileRecordByInode(localEntry.inode, &base)) {
         dbError();
         return;
     }
@@ -742,7 +771,7 @@ void ProcessDirectoryJob::processFileAnalyzeLocalInfo(
 
     // Verify the checksum where possible
     if (isMove && !base._checksumHeader.isEmpty() && item->_type == ItemTypeFile) {
-        if (computeLocalChecksum(base._checksumHeader, _discoveryData->_localDir + path._original, item)) {
+        if (computeLocalChecksum(base._checksumHeader, _discoveryData->_localDir + path._original, item, _discoveryData->_checksumBytes)) {
             qCInfo(lcDisco) << "checking checksum of potential rename " << path._original << item->_checksumHeader << base._checksumHeader;
             isMove = item->_checksumHeader == base._checksumHeader;
         }
@@ -1166,9 +1195,13 @@ DiscoverySingleDirectoryJob *ProcessDirectoryJob::startAsyncServerQuery()
     connect(serverJob, &DiscoverySingleDirectoryJob::etag, this, &ProcessDirectoryJob::etag);
     _discoveryData->_currentlyActiveJobs++;
     _pendingAsyncJobs++;
-    connect(serverJob, &DiscoverySingleDirectoryJob::finished, this, [this, serverJob](const auto &results) {
+    QElapsedTimer propfindTimer;
+    propfindTimer.start();
+    connect(serverJob, &DiscoverySingleDirectoryJob::finished, this, [this, serverJob, propfindTimer](const auto &results) {
         _discoveryData->_currentlyActiveJobs--;
         _pendingAsyncJobs--;
+        if (_discoveryData->_metrics)
+            _discoveryData->_metrics->addPropfind(propfindTimer.elapsed(), bool(results));
         if (results) {
             _serverNormalQueryEntries = *results;
             _serverQueryDone = true;
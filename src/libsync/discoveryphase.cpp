@@ -18,12 +18,15 @@
 #include "account.h"
 #include "common/asserts.h"
 #include "common/checksums.h"
+#include "common/syncjournaldb.h"
 
 #include <csync_exclude.h>
 
 #include <QLoggingCategory>
 #include <QUrl>
 #include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 #include <cstring>
 
 
@@ -166,6 +169,48 @@ QPair<bool, QByteArray> DiscoveryPhase::findAndCancelDeletedJob(const QString &o
     return { result, oldEtag };
 }
 
+DiscoveryPhase::~DiscoveryPhase()
+{
+    // Don't start checksum computations nobody waits for anymore and make
+    // the running ones stop at their next read, the thread pool waits for
+    // them. Aborting a sync must not wait for hashing big files.
+    _checksumAbort = true;
+    _checksumThreadPool.clear();
+}
+
+void DiscoveryPhase::computeChecksumAsync(const QString &filePath, const QByteArray &checksumType,
+    QObject *context, const std::function<void(const QByteArray &)> &callback)
+{
+    _checksumThreadPool.setMaxThreadCount(qMax(1, _syncOptions._touchedFilesChecksumThreads));
+
+    auto watcher = new QFutureWatcher<QByteArray>(context);
+    connect(watcher, &QFutureWatcherBase::finished, context, [watcher, callback] {
+        watcher->deleteLater();
+        callback(watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run(&_checksumThreadPool, ComputeChecksum::computeNow, filePath, checksumType, _checksumBytes,
+        static_cast<const std::atomic<bool> *>(&_checksumAbort)));
+}
+
+bool DiscoveryPhase::getFileRecordByInode(quint64 inode, SyncJournalFileRecord *rec)
+{
+    if (!_journalInodesLoaded) {
+        QElapsedTimer timer;
+        timer.start();
+        if (!_statedb->listInodes([this](quint64 inode) { _journalInodes.insert(inode); }))
+            return false;
+        _journalInodesLoaded = true;
+        qCInfo(lcDiscovery) << "Read" << _journalInodes.size() << "inodes from the journal in" << timer.elapsed() << "ms";
+    }
+
+    if (!_journalInodes.contains(inode)) {
+        // Reset the output var like SyncJournalDb does
+        rec->_path.clear();
+        return true;
+    }
+    return _statedb->getFileRecordByInode(inode, rec);
+}
+
 void DiscoveryPhase::startJob(ProcessDirectoryJob *job)
 {
     ENFORCE(!_currentRootJob);
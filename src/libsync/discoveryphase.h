@@ -22,11 +22,13 @@
 #include <QSet>
 #include "networkjobs.h"
 #include <QMutex>
+#include <QThreadPool>
 #include <QWaitCondition>
 #include <QLinkedList>
 #include <deque>
 #include "syncoptions.h"
 #include "syncfileitem.h"
+#include "common/checksums.h"
 
 class ExcludedFiles;
 
@@ -40,6 +42,7 @@ enum class LocalDiscoveryStyle {
 
 class Account;
 class SyncJournalDb;
+class SyncJournalFileRecord;
 class ProcessDirectoryJob;
 
 /**
@@ -124,6 +127,8 @@ public:
     QByteArray _dataFingerprint;
 };
 
+class SyncMetrics;
+
 class DiscoveryPhase : public QObject
 {
     Q_OBJECT
@@ -160,13 +165,44 @@ class DiscoveryPhase : public QObject
      */
     QPair<bool, QByteArray> findAndCancelDeletedJob(const QString &originalPath);
 
+    /** Computes the checksum of a local file without blocking the discovery
+     *
+     * At most _syncOptions._touchedFilesChecksumThreads computations run at the
+     * same time, the others are queued. The callback is called in this thread,
+     * unless context was deleted in the meantime.
+     */
+    void computeChecksumAsync(const QString &filePath, const QByteArray &checksumType,
+        QObject *context, const std::function<void(const QByteArray &)> &callback);
+
+    /** Like SyncJournalDb::getFileRecordByInode(), for local rename detection
+     *
+     * The inodes of the journal are read in one query on the first call, so
+     * the many new local files that aren't renames don't need a query each.
+     * The journal doesn't get new entries during discovery.
+     */
+    bool getFileRecordByInode(quint64 inode, SyncJournalFileRecord *rec);
+
+    QSet<quint64> _journalInodes;
+    bool _journalInodesLoaded = false;
+
+    // Set on destruction to stop the running computeChecksumAsync() computations,
+    // declared before the pool so it outlives them
+    std::atomic<bool> _checksumAbort { false };
+
+    // Runs the computeChecksumAsync() computations
+    QThreadPool _checksumThreadPool;
+
 public:
+    ~DiscoveryPhase();
+
     // input
     QString _localDir; // absolute path to the local directory. ends with '/'
     QString _remoteFolder; // remote folder, ends with '/'
     SyncJournalDb *_statedb;
     AccountPtr _account;
     SyncOptions _syncOptions;
+    SyncMetrics *_metrics = nullptr;
+    ChecksumByteCounter _checksumBytes; // may be null
     QStringList _selectiveSyncBlackList;
     QStringList _selectiveSyncWhiteList;
     ExcludedFiles *_excludes;
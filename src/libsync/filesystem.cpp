@@ -29,6 +29,12 @@ extern "C" int c_utimes(const char *, const struct timeval *);
 #include "std/c_string.h"
 #include "std/c_utf8.h"
 
+#if defined(Q_OS_LINUX) || defined(Q_OS_MAC)
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
 namespace OCC {
 
 bool FileSystem::fileEquals(const QString &fn1, const QString &fn2)
@@ -189,5 +195,35 @@ bool FileSystem::removeRecursively(const QString &path, const std::function<void
     return allRemoved;
 }
 
+bool FileSystem::preallocate(QFile &file, qint64 size)
+{
+#if defined(Q_OS_LINUX) || defined(Q_OS_MAC)
+    const int fd = file.handle();
+    const qint64 missing = size - file.size();
+    if (fd == -1 || missing <= 0)
+        return false;
+#if defined(Q_OS_LINUX)
+    if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size) != 0) {
+        qCDebug(lcFileSystem) << "fallocate failed for" << file.fileName() << strerror(errno);
+        return false;
+    }
+#else
+    // Try to get a contiguous area first
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, missing, 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+            qCDebug(lcFileSystem) << "F_PREALLOCATE failed for" << file.fileName() << strerror(errno);
+            return false;
+        }
+    }
+#endif
+    return true;
+#else
+    Q_UNUSED(file);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
 
 } // namespace OCC
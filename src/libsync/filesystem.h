@@ -91,6 +91,16 @@ namespace FileSystem {
     bool OWNCLOUDSYNC_EXPORT removeRecursively(const QString &path,
         const std::function<void(const QString &path, bool isDir)> &onDeleted = nullptr,
         QStringList *errors = nullptr);
+
+    /**
+     * @brief Reserves disk space for the first size bytes of an open file
+     *
+     * The file size is not changed. Allocating the space upfront lets the file
+     * system place a file that is written piece by piece in few extents.
+     *
+     * Only supported on Linux and macOS. Returns true if the space was reserved.
+     */
+    bool OWNCLOUDSYNC_EXPORT preallocate(QFile &file, qint64 size);
 }
 
 /** @} */
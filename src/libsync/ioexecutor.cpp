@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "ioexecutor.h"
+
+namespace OCC {
+
+IoExecutor::IoExecutor()
+{
+    // A single thread keeps the tasks in submission order
+    _pool.setMaxThreadCount(1);
+    // Don't tear the thread down between the operations of a sync
+    _pool.setExpiryTimeout(-1);
+}
+
+IoExecutor::~IoExecutor()
+{
+    // Nobody waits for the results of the queued tasks anymore
+    _pool.clear();
+    _pool.waitForDone();
+}
+
+void IoExecutor::waitForDone()
+{
+    _pool.waitForDone();
+}
+}
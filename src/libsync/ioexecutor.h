@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace OCC {
+
+/**
+ * @brief Runs local file system operations off the main thread
+ *
+ * Operations on slow file systems, like network shares, would otherwise
+ * block the event loop and stall all running transfers.
+ *
+ * Tasks run one at a time in the order they were submitted, so they keep
+ * the ordering they had when they ran on the main thread. They must only
+ * touch the file system and their own copies of the data they need: the
+ * journal and the jobs are only accessed from the callbacks, which run on
+ * the main thread.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT IoExecutor
+{
+public:
+    IoExecutor();
+
+    /** Waits for the running task, the queued ones are dropped */
+    ~IoExecutor();
+
+    /**
+     * Runs task() on the I/O thread and then callback(result) on the
+     * thread of context.
+     *
+     * The callback is not called if context is destroyed before the
+     * task finishes or if the task was dropped. The task must return
+     * a value.
+     */
+    template <typename Task, typename Callback>
+    void run(QObject *context, Task task, Callback callback)
+    {
+        using Result = decltype(task());
+        auto watcher = new QFutureWatcher<Result>(context);
+        QObject::connect(watcher, &QFutureWatcherBase::finished, context, [watcher, callback] {
+            watcher->deleteLater();
+            if (!watcher->isCanceled())
+                callback(watcher->result());
+        });
+        watcher->setFuture(QtConcurrent::run(&_pool, task));
+    }
+
+    /** Blocks until all submitted tasks have finished, for tests */
+    void waitForDone();
+
+private:
+    QThreadPool _pool;
+};
+}
@@ -13,6 +13,7 @@
  */
 
 #include "logger.h"
+#include "tracelog.h"
 
 #include "config.h"
 
@@ -30,7 +31,19 @@ namespace OCC {
 
 static void mirallLogCatcher(QtMsgType type, const QMessageLogContext &ctx, const QString &message)
 {
+    // The trace log only copies the raw message, formatting happens offline
+    auto traceLog = TraceLog::instance();
+    if (traceLog->isActive()) {
+        traceLog->message(type, ctx.category, message);
+    }
+
     auto logger = Logger::instance();
+    // Debug messages of our categories may only be enabled for the trace log
+    if (type == QtDebugMsg && logger->traceDebug() && !logger->logDebug()) {
+        const QLatin1String category(ctx.category ? ctx.category : "");
+        if (category.startsWith(QLatin1String("sync.")) || category.startsWith(QLatin1String("gui.")))
+            return;
+    }
     if (!logger->isNoop()) {
         logger->doLog(qFormatLogMessage(type, ctx, message));
     }
@@ -196,8 +209,14 @@ void Logger::setLogFlush(bool flush)
 
 void Logger::setLogDebug(bool debug)
 {
-    QLoggingCategory::setFilterRules(debug ? QStringLiteral("sync.*.debug=true\ngui.*.debug=true") : QString());
     _logDebug = debug;
+    QLoggingCategory::setFilterRules(_logDebug || _traceDebug ? QStringLiteral("sync.*.debug=true\ngui.*.debug=true") : QString());
+}
+
+void Logger::setTraceDebug(bool debug)
+{
+    _traceDebug = debug;
+    setLogDebug(_logDebug);
 }
 
 QString Logger::temporaryFolderLogDirPath() const
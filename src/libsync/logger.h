@@ -67,6 +67,10 @@ public:
     bool logDebug() const { return _logDebug; }
     void setLogDebug(bool debug);
 
+    /** Enables debug messages for the trace log only, the text log keeps its level */
+    bool traceDebug() const { return _traceDebug; }
+    void setTraceDebug(bool debug);
+
     /** Returns where the automatic logdir would be */
     QString temporaryFolderLogDirPath() const;
 
@@ -103,6 +107,7 @@ private:
     bool _doFileFlush;
     int _logExpire;
     bool _logDebug;
+    bool _traceDebug = false;
     QScopedPointer<QTextStream> _logstream;
     mutable QMutex _mutex;
     QString _logDirectory;
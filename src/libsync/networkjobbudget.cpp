@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "networkjobbudget.h"
+#include "owncloudpropagator.h"
+
+#include <QLoggingCategory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcNetworkJobBudget, "sync.networkjobbudget", QtInfoMsg)
+
+NetworkJobBudget::NetworkJobBudget(int maximum)
+    : _maximum(qMax(1, maximum))
+{
+}
+
+void NetworkJobBudget::setMaximum(int maximum)
+{
+    _maximum = qMax(1, maximum);
+    wakeWaiting(nullptr);
+}
+
+void NetworkJobBudget::addPropagator(OwncloudPropagator *propagator)
+{
+    if (!_propagators.contains(propagator))
+        _propagators.append(propagator);
+}
+
+void NetworkJobBudget::removePropagator(OwncloudPropagator *propagator)
+{
+    _propagators.removeAll(propagator);
+    _waiting.removeAll(propagator);
+    // Its jobs don't count anymore
+    wakeWaiting(nullptr);
+}
+
+int NetworkJobBudget::activeJobCount() const
+{
+    int count = 0;
+    for (auto propagator : _propagators)
+        count += propagator->_activeJobList.count();
+    return count;
+}
+
+int NetworkJobBudget::fairShare() const
+{
+    return qMax(1, _maximum / qMax(1, _propagators.count()));
+}
+
+bool NetworkJobBudget::mayStartJob(OwncloudPropagator *propagator)
+{
+    if (activeJobCount() < _maximum) {
+        bool othersWaiting = false;
+        for (auto waiting : _waiting) {
+            if (waiting != propagator)
+                othersWaiting = true;
+        }
+        if (!othersWaiting || propagator->_activeJobList.count() < fairShare()) {
+            _waiting.removeAll(propagator);
+            return true;
+        }
+    }
+
+    if (!_waiting.contains(propagator)) {
+        qCDebug(lcNetworkJobBudget) << "All" << _maximum << "network job slots are in use, waiting";
+        _waiting.append(propagator);
+    }
+    return false;
+}
+
+void NetworkJobBudget::stopWaiting(OwncloudPropagator *propagator)
+{
+    _waiting.removeAll(propagator);
+}
+
+void NetworkJobBudget::jobFinished(OwncloudPropagator *propagator)
+{
+    wakeWaiting(propagator);
+}
+
+void NetworkJobBudget::wakeWaiting(OwncloudPropagator *except)
+{
+    for (auto propagator : _waiting) {
+        if (propagator == except)
+            continue;
+        // Queued, so the propagators don't wake each other recursively
+        QMetaObject::invokeMethod(propagator, "scheduleNextJobImpl", Qt::QueuedConnection);
+    }
+}
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QList>
+
+namespace OCC {
+
+class OwncloudPropagator;
+
+/**
+ * @brief Bounds the number of network jobs of all running syncs
+ *
+ * Each propagator limits its own active jobs, see
+ * OwncloudPropagator::hardMaximumActiveJob(). When several folders sync at
+ * the same time the propagators additionally share this budget, so the
+ * aggregate number of active jobs stays below maximum().
+ *
+ * A propagator that can't get a slot is woken up once another propagator's
+ * job finished. Propagators that are waiting take precedence over the ones
+ * that already use more than their fair share of the budget, so a folder with
+ * many long transfers can't starve the others.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT NetworkJobBudget
+{
+public:
+    explicit NetworkJobBudget(int maximum);
+
+    int maximum() const { return _maximum; }
+    void setMaximum(int maximum);
+
+    /** The propagator's active jobs count against the budget from now on */
+    void addPropagator(OwncloudPropagator *propagator);
+    void removePropagator(OwncloudPropagator *propagator);
+
+    /** The number of active jobs of all propagators */
+    int activeJobCount() const;
+
+    /**
+     * Whether the propagator may start another job now.
+     *
+     * If not, the propagator will schedule its next job again once a slot
+     * might have become free.
+     */
+    bool mayStartJob(OwncloudPropagator *propagator);
+
+    /**
+     * The propagator has nothing to start right now, don't wake it anymore.
+     *
+     * Its own jobs finishing will make it schedule again.
+     */
+    void stopWaiting(OwncloudPropagator *propagator);
+
+    /** The number of propagators waiting for a slot */
+    int waitingCount() const { return _waiting.count(); }
+
+    /** Called when a job of the propagator finished, wakes the waiting ones */
+    void jobFinished(OwncloudPropagator *propagator);
+
+private:
+    int fairShare() const;
+    void wakeWaiting(OwncloudPropagator *except);
+
+    int _maximum;
+    QList<OwncloudPropagator *> _propagators;
+    QList<OwncloudPropagator *> _waiting;
+};
+}
@@ -29,6 +29,7 @@
 #include <QCoreApplication>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <cctype>
 #ifndef TOKEN_AUTH_ONLY
 #include <QPainter>
 #endif
@@ -181,102 +182,165 @@ LsColXMLParser::LsColXMLParser()
 }
 
 bool LsColXMLParser::parse(const QByteArray &xml, QHash<QString, qint64> *sizes, const QString &expectedPath)
+{
+    start(sizes, expectedPath);
+    return addData(xml) && finish();
+}
+
+void LsColXMLParser::start(QHash<QString, qint64> *sizes, const QString &expectedPath)
+{
+    _reader.clear();
+    _reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
+    _unparsed.clear();
+    _xmlStart.clear();
+    _sizes = sizes;
+    _expectedPath = expectedPath;
+    _folders.clear();
+    _currentHref.clear();
+    _currentTmpProperties.clear();
+    _currentHttp200Properties.clear();
+    _currentPropsHaveHttp200 = false;
+    _insidePropstat = false;
+    _insideProp = false;
+    _insideMultiStatus = false;
+}
+
+// The position after the last </response> end tag in data, whatever its
+// namespace prefix, or 0 if there is none
+static int endOfLastResponse(const QByteArray &data)
+{
+    static const QByteArray tag = QByteArrayLiteral("response>");
+    int pos = data.lastIndexOf(tag);
+    while (pos > 0) {
+        int i = pos - 1;
+        if (data[i] == ':') {
+            --i;
+            while (i > 0 && data[i] != '/' && data[i] != '<' && data[i] != '>' && !isspace(uchar(data[i])))
+                --i;
+        }
+        if (i > 0 && data[i] == '/' && data[i - 1] == '<')
+            return pos + tag.size();
+        pos = data.lastIndexOf(tag, pos - 1);
+    }
+    return 0;
+}
+
+bool LsColXMLParser::addData(const QByteArray &xml)
+{
+    if (_xmlStart.size() < 1024)
+        _xmlStart += xml.left(1024 - _xmlStart.size());
+
+    // Only complete response elements are handed to the reader: the properties
+    // are read with readElementText() and readContentsAsString(), which can't
+    // continue if the data runs out in the middle of an element.
+    _unparsed += xml;
+    int end = endOfLastResponse(_unparsed);
+    if (end == 0)
+        return true;
+    _reader.addData(_unparsed.left(end));
+    _unparsed.remove(0, end);
+    return parseAvailable(false);
+}
+
+bool LsColXMLParser::finish()
+{
+    _reader.addData(_unparsed);
+    _unparsed.clear();
+    if (!parseAvailable(true))
+        return false;
+
+    if (!_insideMultiStatus) {
+        qCWarning(lcLsColJob) << "ERROR no WebDAV response?" << _xmlStart;
+        return false;
+    }
+    emit directoryListingSubfolders(_folders);
+    emit finishedWithoutError();
+    return true;
+}
+
+bool LsColXMLParser::parseAvailable(bool atEnd)
 {
     // Parse DAV response
-    QXmlStreamReader reader(xml);
-    reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
-
-    QStringList folders;
-    QString currentHref;
-    QMap<QString, QString> currentTmpProperties;
-    QMap<QString, QString> currentHttp200Properties;
-    bool currentPropsHaveHttp200 = false;
-    bool insidePropstat = false;
-    bool insideProp = false;
-    bool insideMultiStatus = false;
-
-    while (!reader.atEnd()) {
-        QXmlStreamReader::TokenType type = reader.readNext();
-        QString name = reader.name().toString();
+    while (!_reader.atEnd()) {
+        QXmlStreamReader::TokenType type = _reader.readNext();
+        QString name = _reader.name().toString();
         // Start elements with DAV:
-        if (type == QXmlStreamReader::StartElement && reader.namespaceUri() == QLatin1String("DAV:")) {
+        if (type == QXmlStreamReader::StartElement && _reader.namespaceUri() == QLatin1String("DAV:")) {
             if (name == QLatin1String("href")) {
                 // We don't use URL encoding in our request URL (which is the expected path) (QNAM will do it for us)
                 // but the result will have URL encoding..
-                QString hrefString = QString::fromUtf8(QByteArray::fromPercentEncoding(reader.readElementText().toUtf8()));
-                if (!hrefString.startsWith(expectedPath)) {
-                    qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << expectedPath;
+                QString hrefString = QString::fromUtf8(QByteArray::fromPercentEncoding(_reader.readElementText().toUtf8()));
+                if (!hrefString.startsWith(_expectedPath)) {
+                    qCWarning(lcLsColJob) << "Invalid href" << hrefString << "expected starting with" << _expectedPath;
                     return false;
                 }
-                currentHref = hrefString;
+                _currentHref = hrefString;
             } else if (name == QLatin1String("response")) {
             } else if (name == QLatin1String("propstat")) {
-                insidePropstat = true;
-            } else if (name == QLatin1String("status") && insidePropstat) {
-                QString httpStatus = reader.readElementText();
+                _insidePropstat = true;
+            } else if (name == QLatin1String("status") && _insidePropstat) {
+                QString httpStatus = _reader.readElementText();
                 if (httpStatus.startsWith("HTTP/1.1 200")) {
-                    currentPropsHaveHttp200 = true;
+                    _currentPropsHaveHttp200 = true;
                 } else {
-                    currentPropsHaveHttp200 = false;
+                    _currentPropsHaveHttp200 = false;
                 }
             } else if (name == QLatin1String("prop")) {
-                insideProp = true;
+                _insideProp = true;
                 continue;
             } else if (name == QLatin1String("multistatus")) {
-                insideMultiStatus = true;
+                _insideMultiStatus = true;
                 continue;
             }
         }
 
-        if (type == QXmlStreamReader::StartElement && insidePropstat && insideProp) {
+        if (type == QXmlStreamReader::StartElement && _insidePropstat && _insideProp) {
             // All those elements are properties
-            QString propertyContent = readContentsAsString(reader);
+            QString propertyContent = readContentsAsString(_reader);
             if (name == QLatin1String("resourcetype") && propertyContent.contains("collection")) {
-                folders.append(currentHref);
+                _folders.append(_currentHref);
             } else if (name == QLatin1String("size")) {
                 bool ok = false;
                 auto s = propertyContent.toLongLong(&ok);
-                if (ok && sizes) {
-                    sizes->insert(currentHref, s);
+                if (ok && _sizes) {
+                    _sizes->insert(_currentHref, s);
                 }
             }
-            currentTmpProperties.insert(reader.name().toString(), propertyContent);
+            _currentTmpProperties.insert(_reader.name().toString(), propertyContent);
         }
 
         // End elements with DAV:
         if (type == QXmlStreamReader::EndElement) {
-            if (reader.namespaceUri() == QLatin1String("DAV:")) {
-                if (reader.name() == "response") {
-                    if (currentHref.endsWith('/')) {
-                        currentHref.chop(1);
+            if (_reader.namespaceUri() == QLatin1String("DAV:")) {
+                if (_reader.name() == "response") {
+                    if (_currentHref.endsWith('/')) {
+                        _currentHref.chop(1);
                     }
-                    emit directoryListingIterated(currentHref, currentHttp200Properties);
-                    currentHref.clear();
-                    currentHttp200Properties.clear();
-                } else if (reader.name() == "propstat") {
-                    insidePropstat = false;
-                    if (currentPropsHaveHttp200) {
-                        currentHttp200Properties = QMap<QString, QString>(currentTmpProperties);
+                    emit directoryListingIterated(_currentHref, _currentHttp200Properties);
+                    _currentHref.clear();
+                    _currentHttp200Properties.clear();
+                } else if (_reader.name() == "propstat") {
+                    _insidePropstat = false;
+                    if (_currentPropsHaveHttp200) {
+                        _currentHttp200Properties = QMap<QString, QString>(_currentTmpProperties);
                     }
-                    currentTmpProperties.clear();
-                    currentPropsHaveHttp200 = false;
-                } else if (reader.name() == "prop") {
-                    insideProp = false;
+                    _currentTmpProperties.clear();
+                    _currentPropsHaveHttp200 = false;
+                } else if (_reader.name() == "prop") {
+                    _insideProp = false;
                 }
             }
         }
     }
 
-    if (reader.hasError()) {
+    if (!atEnd && _reader.error() == QXmlStreamReader::PrematureEndOfDocumentError) {
+        // Continues with the next addData()
+        return true;
+    }
+    if (_reader.hasError()) {
         // XML Parser error? Whatever had been emitted before will come as directoryListingIterated
-        qCWarning(lcLsColJob) << "ERROR" << reader.errorString() << xml;
-        return false;
-    } else if (!insideMultiStatus) {
-        qCWarning(lcLsColJob) << "ERROR no WebDAV response?" << xml;
+        qCWarning(lcLsColJob) << "ERROR" << _reader.errorString() << _xmlStart;
         return false;
-    } else {
-        emit directoryListingSubfolders(folders);
-        emit finishedWithoutError();
     }
     return true;
 }
@@ -328,6 +392,10 @@ void LsColJob::start()
 
     QNetworkRequest req;
     req.setRawHeader("Depth", "1");
+    // Listings of large directories are big but compress very well
+    auto acceptEncoding = ContentEncoding::acceptEncoding();
+    if (!acceptEncoding.isEmpty())
+        req.setRawHeader("Accept-Encoding", acceptEncoding);
     QByteArray xml("<?xml version=\"1.0\" ?>\n"
                    "<d:propfind xmlns:d=\"DAV:\" xmlns:oc=\"http://owncloud.org/ns\">\n"
                    "  <d:prop>\n"
@@ -336,37 +404,67 @@ void LsColJob::start()
     QBuffer *buf = new QBuffer(this);
     buf->setData(xml);
     buf->open(QIODevice::ReadOnly);
+    QNetworkReply *reply;
     if (_url.isValid()) {
-        sendRequest("PROPFIND", _url, req, buf);
+        reply = sendRequest("PROPFIND", _url, req, buf);
     } else {
-        sendRequest("PROPFIND", makeDavUrl(path()), req, buf);
+        reply = sendRequest("PROPFIND", makeDavUrl(path()), req, buf);
     }
+    connect(reply, &QIODevice::readyRead, this, &LsColJob::slotReadyRead);
+
+    connect(&_parser, &LsColXMLParser::directoryListingSubfolders,
+        this, &LsColJob::directoryListingSubfolders, Qt::UniqueConnection);
+    connect(&_parser, &LsColXMLParser::directoryListingIterated,
+        this, &LsColJob::directoryListingIterated, Qt::UniqueConnection);
+    connect(&_parser, &LsColXMLParser::finishedWithError,
+        this, &LsColJob::finishedWithError, Qt::UniqueConnection);
+    connect(&_parser, &LsColXMLParser::finishedWithoutError,
+        this, &LsColJob::finishedWithoutError, Qt::UniqueConnection);
     AbstractNetworkJob::start();
 }
 
-// TODO: Instead of doing all in this slot, we should iteratively parse in readyRead(). This
-// would allow us to be more asynchronous in processing while data is coming from the network,
-// not all in one big blob at the end.
+static bool isMultiStatusXml(QNetworkReply *reply)
+{
+    QString contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+    int httpCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    return httpCode == 207 && contentType.contains("application/xml; charset=utf-8");
+}
+
+// The listing is decoded and parsed while it is downloaded, the entries are
+// emitted as soon as they are complete.
+void LsColJob::slotReadyRead()
+{
+    if (!_decoder) {
+        if (!isMultiStatusXml(reply()))
+            return; // leave the body to finished() and errorStringParsingBody()
+        _decoder.reset(new ContentDecoder(reply()->rawHeader("Content-Encoding")));
+        _parseFailed = false;
+        QString expectedPath = reply()->request().url().path(); // something like "/owncloud/remote.php/webdav/folder"
+        _parser.start(&_sizes, expectedPath);
+    }
+
+    QByteArray data = reply()->readAll();
+    if (_parseFailed)
+        return;
+    QByteArray xml;
+    if (!_decoder->decode(data, &xml)) {
+        qCWarning(lcLsColJob) << "Could not decode the reply:" << _decoder->errorString();
+        _parseFailed = true;
+    } else if (!_parser.addData(xml)) {
+        _parseFailed = true;
+    }
+}
+
 bool LsColJob::finished()
 {
     qCInfo(lcLsColJob) << "LSCOL of" << reply()->request().url() << "FINISHED WITH STATUS"
                        << replyStatusString();
 
-    QString contentType = reply()->header(QNetworkRequest::ContentTypeHeader).toString();
     int httpCode = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-    if (httpCode == 207 && contentType.contains("application/xml; charset=utf-8")) {
-        LsColXMLParser parser;
-        connect(&parser, &LsColXMLParser::directoryListingSubfolders,
-            this, &LsColJob::directoryListingSubfolders);
-        connect(&parser, &LsColXMLParser::directoryListingIterated,
-            this, &LsColJob::directoryListingIterated);
-        connect(&parser, &LsColXMLParser::finishedWithError,
-            this, &LsColJob::finishedWithError);
-        connect(&parser, &LsColXMLParser::finishedWithoutError,
-            this, &LsColJob::finishedWithoutError);
-
-        QString expectedPath = reply()->request().url().path(); // something like "/owncloud/remote.php/webdav/folder"
-        if (!parser.parse(reply()->readAll(), &_sizes, expectedPath)) {
+    if (isMultiStatusXml(reply())) {
+        // Whatever did not come with a readyRead()
+        slotReadyRead();
+        if (_parseFailed || !_parser.finish()) {
             // XML parse error
             emit finishedWithError(reply());
         }
@@ -540,6 +638,9 @@ void PropfindJob::start()
     // Also possibly useful for avoiding false timeouts.
     req.setPriority(QNetworkRequest::HighPriority);
     req.setRawHeader("Depth", "0");
+    auto acceptEncoding = ContentEncoding::acceptEncoding();
+    if (!acceptEncoding.isEmpty())
+        req.setRawHeader("Accept-Encoding", acceptEncoding);
     QByteArray propStr;
     foreach (const QByteArray &prop, properties) {
         if (prop.contains(':')) {
@@ -580,8 +681,16 @@ bool PropfindJob::finished()
     int http_result_code = reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
 
     if (http_result_code == 207) {
+        ContentDecoder decoder(reply()->rawHeader("Content-Encoding"));
+        QByteArray xml;
+        if (!decoder.decode(reply()->readAll(), &xml)) {
+            qCWarning(lcPropfindJob) << "Could not decode the reply:" << decoder.errorString();
+            emit finishedWithError(reply());
+            return true;
+        }
+
         // Parse DAV response
-        QXmlStreamReader reader(reply());
+        QXmlStreamReader reader(xml);
         reader.addExtraNamespaceDeclaration(QXmlStreamNamespaceDeclaration("d", "DAV:"));
 
         QVariantMap items;
@@ -781,10 +890,23 @@ void JsonApiJob::addQueryParams(const QUrlQuery &params)
     _additionalParams = params;
 }
 
+void JsonApiJob::setIfNoneMatch(const QByteArray &etag)
+{
+    _ifNoneMatch = etag;
+}
+
+QByteArray JsonApiJob::etag() const
+{
+    return reply() ? reply()->rawHeader("ETag") : QByteArray();
+}
+
 void JsonApiJob::start()
 {
     QNetworkRequest req;
     req.setRawHeader("OCS-APIREQUEST", "true");
+    if (!_ifNoneMatch.isEmpty()) {
+        req.setRawHeader("If-None-Match", _ifNoneMatch);
+    }
     auto query = _additionalParams;
     query.addQueryItem(QLatin1String("format"), QLatin1String("json"));
     QUrl url = Utility::concatUrlPath(account()->url(), path(), query);
@@ -799,6 +921,12 @@ bool JsonApiJob::finished()
 
     int statusCode = 0;
 
+    if (!_ifNoneMatch.isEmpty()
+        && reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        emit notModified();
+        return true;
+    }
+
     if (reply()->error() != QNetworkReply::NoError) {
         qCWarning(lcJsonApiJob) << "Network error: " << path() << errorString() << reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute);
         emit jsonReceived(QJsonDocument(), statusCode);
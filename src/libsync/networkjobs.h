@@ -17,9 +17,12 @@
 #define NETWORKJOBS_H
 
 #include "abstractnetworkjob.h"
+#include "contentencoding.h"
 #include "result.h"
 #include <QUrlQuery>
+#include <QXmlStreamReader>
 #include <functional>
+#include <memory>
 
 class QUrl;
 class QJsonObject;
@@ -56,11 +59,37 @@ public:
 
     bool parse(const QByteArray &xml, QHash<QString, qint64> *sizes, const QString &expectedPath);
 
+    /**
+     * Incremental parsing: start(), then addData() whenever a piece of the
+     * reply arrived and finish() at the end. Returns false on errors, the
+     * entries are emitted as soon as they are complete.
+     */
+    void start(QHash<QString, qint64> *sizes, const QString &expectedPath);
+    bool addData(const QByteArray &xml);
+    bool finish();
+
 signals:
     void directoryListingSubfolders(const QStringList &items);
     void directoryListingIterated(const QString &name, const QMap<QString, QString> &properties);
     void finishedWithError(QNetworkReply *reply);
     void finishedWithoutError();
+
+private:
+    bool parseAvailable(bool atEnd);
+
+    QXmlStreamReader _reader;
+    QByteArray _unparsed; // data after the last complete response element
+    QByteArray _xmlStart; // for the error log
+    QHash<QString, qint64> *_sizes = nullptr;
+    QString _expectedPath;
+    QStringList _folders;
+    QString _currentHref;
+    QMap<QString, QString> _currentTmpProperties;
+    QMap<QString, QString> _currentHttp200Properties;
+    bool _currentPropsHaveHttp200 = false;
+    bool _insidePropstat = false;
+    bool _insideProp = false;
+    bool _insideMultiStatus = false;
 };
 
 class OWNCLOUDSYNC_EXPORT LsColJob : public AbstractNetworkJob
@@ -91,10 +120,16 @@ signals:
 
 private slots:
     virtual bool finished() Q_DECL_OVERRIDE;
+    void slotReadyRead();
 
 private:
     QList<QByteArray> _properties;
     QUrl _url; // Used instead of path() if the url is specified in the constructor
+
+    // The listing is parsed while it is downloaded, see slotReadyRead()
+    LsColXMLParser _parser;
+    std::unique_ptr<ContentDecoder> _decoder;
+    bool _parseFailed = false;
 };
 
 /**
@@ -344,6 +379,18 @@ public:
      */
     void addQueryParams(const QUrlQuery &params);
 
+    /**
+     * @brief setIfNoneMatch - only get the answer if it changed
+     * @param etag: the etag() of an earlier answer to the same call
+     *
+     * If the answer is still the same, notModified() is emitted instead of
+     * jsonReceived().
+     */
+    void setIfNoneMatch(const QByteArray &etag);
+
+    /** The ETag header of the answer, empty if the server didn't send one */
+    QByteArray etag() const;
+
 public slots:
     void start() Q_DECL_OVERRIDE;
 
@@ -358,8 +405,14 @@ signals:
      */
     void jsonReceived(const QJsonDocument &json, int statusCode);
 
+    /**
+     * @brief notModified - the answer didn't change since setIfNoneMatch()'s etag
+     */
+    void notModified();
+
 private:
     QUrlQuery _additionalParams;
+    QByteArray _ifNoneMatch;
 };
 
 /**
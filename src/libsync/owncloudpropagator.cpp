@@ -25,6 +25,9 @@
 #include "filesystem.h"
 #include "common/utility.h"
 #include "account.h"
+#include "tracelog.h"
+#include "syncmetrics.h"
+#include "networkjobbudget.h"
 #include "common/asserts.h"
 
 #ifdef Q_OS_WIN
@@ -47,6 +50,10 @@ Q_LOGGING_CATEGORY(lcPropagator, "sync.propagator", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcDirectory, "sync.propagator.directory", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcCleanupPolls, "sync.propagator.cleanuppolls", QtInfoMsg)
 
+/* How many of a directory's jobs the scheduling policy may hold back before
+ * the remaining tasks aren't searched for a job that may start */
+static const int maximumHeldBackJobs = 100;
+
 qint64 criticalFreeSpaceLimit()
 {
     qint64 value = 50 * 1000 * 1000LL;
@@ -75,15 +82,33 @@ qint64 freeSpaceLimit()
 
 OwncloudPropagator::~OwncloudPropagator()
 {
+    if (_networkJobBudget)
+        _networkJobBudget->removePropagator(this);
 }
 
 
+void OwncloudPropagator::networkLimits(int *upload, int *download)
+{
+    if (!_bandwidthSchedule.isEmpty()) {
+        if (auto rule = _bandwidthSchedule.ruleAt(QDateTime::currentDateTime())) {
+            *upload = rule->uploadLimit;
+            *download = rule->downloadLimit;
+            return;
+        }
+    }
+    *upload = _uploadLimit.fetchAndAddAcquire(0);
+    *download = _downloadLimit.fetchAndAddAcquire(0);
+}
+
 int OwncloudPropagator::maximumActiveTransferJob()
 {
-    if (_downloadLimit.fetchAndAddAcquire(0) != 0
-        || _uploadLimit.fetchAndAddAcquire(0) != 0
-        || !_syncOptions._parallelNetworkJobs) {
-        // disable parallelism when there is a network limit.
+    int uploadLimit = 0;
+    int downloadLimit = 0;
+    networkLimits(&uploadLimit, &downloadLimit);
+    if (uploadLimit < 0 || downloadLimit < 0 || !_syncOptions._parallelNetworkJobs) {
+        // disable parallelism for relative limits: they measure the speed
+        // of one transfer at a time. Absolute limits are shared out between
+        // the transfers by the BandwidthManager.
         return 1;
     }
     return qMin(3, qCeil(_syncOptions._parallelNetworkJobs / 2.));
@@ -276,6 +301,21 @@ void PropagateItemJob::done(SyncFileItem::Status statusArg, const QString &error
         qCWarning(lcPropagator) << "Could not complete propagation of" << _item->destination() << "by" << this << "with status" << _item->_status << "and error:" << _item->_errorString;
     else
         qCInfo(lcPropagator) << "Completed propagation of" << _item->destination() << "by" << this << "with status" << _item->_status;
+
+    const qint64 propagationTime = _propagationTimer.isValid() ? _propagationTimer.elapsed() : -1;
+    auto traceLog = TraceLog::instance();
+    if (traceLog->isActive()) {
+        traceLog->event("propagation", _item->destination(), metaObject()->className(),
+            qint64(_item->_size), propagationTime);
+    }
+    if (propagator()->_metrics && _item->_status == SyncFileItem::Success) {
+        // Only downloads and uploads move the file content
+        const bool transfersContent = _item->_instruction == CSYNC_INSTRUCTION_NEW
+            || _item->_instruction == CSYNC_INSTRUCTION_SYNC
+            || _item->_instruction == CSYNC_INSTRUCTION_CONFLICT;
+        propagator()->_metrics->addTransfer(metaObject()->className(),
+            transfersContent && !_item->isDirectory() ? qint64(_item->_size) : 0, qMax<qint64>(0, propagationTime));
+    }
     emit propagator()->itemCompleted(_item);
     emit finished(_item->_status);
 
@@ -373,6 +413,9 @@ void OwncloudPropagator::start(const SyncFileItemVector &items)
      * In order to do that we loop over the items. (which are sorted by destination)
      * When we enter a directory, we can create the directory job and push it on the stack. */
 
+    if (_networkJobBudget)
+        _networkJobBudget->addPropagator(this);
+
     _rootJob.reset(new PropagateDirectory(this));
     QStack<QPair<QString /* directory name */, PropagateDirectory * /* job */>> directories;
     directories.push(qMakePair(QString(), _rootJob.data()));
@@ -502,6 +545,26 @@ void OwncloudPropagator::setSyncOptions(const SyncOptions &syncOptions)
 {
     _syncOptions = syncOptions;
     _chunkSize = syncOptions._initialChunkSize;
+    if (syncOptions._smallFilesFirst) {
+        setSchedulingPolicy(new SmallFilesFirstSchedulingPolicy(syncOptions._largeFileSize));
+    } else {
+        setSchedulingPolicy(new TreeOrderSchedulingPolicy);
+    }
+}
+
+void OwncloudPropagator::setSchedulingPolicy(SchedulingPolicy *policy)
+{
+    _schedulingPolicy.reset(policy);
+}
+
+QList<PropagateItemJob *> OwncloudPropagator::scheduledActiveJobs() const
+{
+    QList<PropagateItemJob *> jobs;
+    for (auto job : _activeJobList) {
+        if (job->_priority != PropagatorJob::InteractivePriority)
+            jobs.append(job);
+    }
+    return jobs;
 }
 
 bool OwncloudPropagator::localFileNameClash(const QString &relFile)
@@ -595,9 +658,36 @@ QString OwncloudPropagator::addVirtualFileSuffix(const QString &fileName) const
 
 void OwncloudPropagator::scheduleNextJob()
 {
+    // This is called whenever a job finished: the other folders' propagators
+    // may be waiting for that slot
+    if (_networkJobBudget)
+        _networkJobBudget->jobFinished(this);
     QTimer::singleShot(0, this, &OwncloudPropagator::scheduleNextJobImpl);
 }
 
+PropagatorJob::InteractiveStart OwncloudPropagator::startInteractively(const QString &file)
+{
+    if (!_rootJob || _abortRequested.fetchAndAddRelaxed(0))
+        return PropagatorJob::NotInPropagation;
+    return _rootJob->startInteractively(file);
+}
+
+bool OwncloudPropagator::hasJobFor(const QString &file) const
+{
+    return _rootJob && _rootJob->hasJobFor(file);
+}
+
+bool OwncloudPropagator::addInteractiveJob(const SyncFileItemPtr &item)
+{
+    if (!_rootJob || _abortRequested.fetchAndAddRelaxed(0))
+        return false;
+    QScopedPointer<PropagateItemJob> job(createJob(item));
+    if (!job || !_rootJob->_subJobs.runInteractively(job.data()))
+        return false;
+    job.take();
+    return true;
+}
+
 void OwncloudPropagator::scheduleNextJobImpl()
 {
     // TODO: If we see that the automatic up-scaling has a bad impact we
@@ -605,27 +695,25 @@ void OwncloudPropagator::scheduleNextJobImpl()
     // Down-scaling on slow networks? https://github.com/owncloud/client/issues/3382
     // Making sure we do up/down at same time? https://github.com/owncloud/client/issues/1633
 
-    if (_activeJobList.count() < maximumActiveTransferJob()) {
-        if (_rootJob->scheduleSelfOrChild()) {
-            scheduleNextJob();
-        }
-    } else if (_activeJobList.count() < hardMaximumActiveJob()) {
-        int likelyFinishedQuicklyCount = 0;
-        // NOTE: Only counts the first 3 jobs! Then for each
-        // one that is likely finished quickly, we can launch another one.
-        // When a job finishes another one will "move up" to be one of the first 3 and then
-        // be counted too.
-        for (int i = 0; i < maximumActiveTransferJob() && i < _activeJobList.count(); i++) {
-            if (_activeJobList.at(i)->isLikelyFinishedQuickly()) {
-                likelyFinishedQuicklyCount++;
-            }
-        }
-        if (_activeJobList.count() < maximumActiveTransferJob() + likelyFinishedQuicklyCount) {
-            qCDebug(lcPropagator) << "Can pump in another request! activeJobs =" << _activeJobList.count();
-            if (_rootJob->scheduleSelfOrChild()) {
-                scheduleNextJob();
-            }
-        }
+    // Interactive jobs were started ahead of everything else and don't take
+    // the slots of the queued jobs.
+    // Which of the queued jobs start within hardMaximumActiveJob() is up to
+    // the scheduling policy, see SchedulingPolicy.
+    // A propagator that doesn't start anything here mustn't stay among the
+    // budget's waiting ones: it would be woken for every job of the other
+    // folders and take precedence over them.
+    if (scheduledActiveJobs().count() >= hardMaximumActiveJob()
+        || !_schedulingPolicy->mayStartAnyJob(this)) {
+        if (_networkJobBudget)
+            _networkJobBudget->stopWaiting(this);
+        return;
+    }
+    if (_networkJobBudget && !_networkJobBudget->mayStartJob(this))
+        return;
+    if (_rootJob->scheduleSelfOrChild()) {
+        scheduleNextJob();
+    } else if (_networkJobBudget) {
+        _networkJobBudget->stopWaiting(this);
     }
 }
 
@@ -803,24 +891,35 @@ bool PropagatorCompositeJob::scheduleSelfOrChild()
     }
 
     // Now it's our turn, check if we have something left to do.
-    // First, convert a task to a job if necessary
-    while (_jobsToDo.isEmpty() && !_tasksToDo.isEmpty()) {
-        SyncFileItemPtr nextTask = _tasksToDo.first();
-        _tasksToDo.remove(0);
-        PropagatorJob *job = propagator()->createJob(nextTask);
-        if (!job) {
-            qCWarning(lcDirectory) << "Useless task found for file" << nextTask->destination() << "instruction" << nextTask->_instruction;
-            continue;
+    // Run the next job that the scheduling policy lets start, converting the
+    // tasks to jobs as they are needed. The jobs it holds back stay queued and
+    // may be overtaken, unless everything after them has to wait for them.
+    SchedulingPolicy *policy = propagator()->schedulingPolicy();
+    int i = 0;
+    while (true) {
+        if (i == _jobsToDo.size()) {
+            // Don't turn all the tasks into jobs only to find nothing that may start
+            if (_tasksToDo.isEmpty() || i >= maximumHeldBackJobs)
+                break;
+            SyncFileItemPtr nextTask = _tasksToDo.first();
+            _tasksToDo.remove(0);
+            PropagatorJob *job = propagator()->createJob(nextTask);
+            if (!job) {
+                qCWarning(lcDirectory) << "Useless task found for file" << nextTask->destination() << "instruction" << nextTask->_instruction;
+                continue;
+            }
+            appendJob(job);
         }
-        appendJob(job);
-        break;
-    }
-    // Then run the next job
-    if (!_jobsToDo.isEmpty()) {
-        PropagatorJob *nextJob = _jobsToDo.first();
-        _jobsToDo.remove(0);
-        _runningJobs.append(nextJob);
-        return possiblyRunNextJob(nextJob);
+        PropagatorJob *nextJob = _jobsToDo.at(i);
+        if (policy->mayStartJob(propagator(), nextJob)) {
+            _jobsToDo.remove(i);
+            _runningJobs.append(nextJob);
+            return possiblyRunNextJob(nextJob);
+        }
+        if (nextJob->parallelism() == WaitForFinished) {
+            break;
+        }
+        ++i;
     }
 
     // If neither us or our children had stuff left to do we could hang. Make sure
@@ -867,11 +966,123 @@ void PropagatorCompositeJob::finalize()
     // multiple times on the event loop, ignore the duplicate calls.
     if (_state == Finished)
         return;
+    // An interactive job may have been started since this was posted,
+    // slotSubJobFinished() finalizes once it is done
+    if (!_runningJobs.isEmpty())
+        return;
 
     _state = Finished;
     emit finished(_hasError == SyncFileItem::NoStatus ? SyncFileItem::Success : _hasError);
 }
 
+// Only new or changed files are downloaded ahead of the other jobs: they
+// don't depend on their siblings, unlike moves, removals or uploads.
+static bool canStartInteractively(const SyncFileItem &item)
+{
+    return item._direction == SyncFileItem::Down && !item.isDirectory()
+        && (item._instruction == CSYNC_INSTRUCTION_NEW || item._instruction == CSYNC_INSTRUCTION_SYNC);
+}
+
+static bool isInDirectory(const QString &file, const QString &directory)
+{
+    return directory.isEmpty() || file.startsWith(directory + QLatin1Char('/'));
+}
+
+PropagatorJob::InteractiveStart PropagatorCompositeJob::startInteractively(const QString &file)
+{
+    if (_state == Finished)
+        return NotInPropagation;
+
+    bool mustWait = false;
+    foreach (PropagatorJob *job, _runningJobs) {
+        if (auto itemJob = qobject_cast<PropagateItemJob *>(job)) {
+            if (itemJob->_item->_file == file)
+                return CannotStartYet;
+        } else if (auto dirJob = qobject_cast<PropagateDirectory *>(job)) {
+            if (isInDirectory(file, dirJob->_item->_file)) {
+                auto result = dirJob->startInteractively(file);
+                if (result != NotInPropagation)
+                    return result;
+            }
+        }
+        if (job->parallelism() == WaitForFinished)
+            mustWait = true;
+    }
+
+    for (int i = 0; i < _jobsToDo.size(); ++i) {
+        PropagatorJob *job = _jobsToDo.at(i);
+        if (auto itemJob = qobject_cast<PropagateItemJob *>(job)) {
+            if (itemJob->_item->_file != file)
+                continue;
+            if (mustWait || !canStartInteractively(*itemJob->_item))
+                return CannotStartYet;
+            _jobsToDo.remove(i);
+            runInteractively(job);
+            return Started;
+        } else if (auto dirJob = qobject_cast<PropagateDirectory *>(job)) {
+            // The directory isn't created yet
+            if (dirJob->_item->_file == file || isInDirectory(file, dirJob->_item->_file))
+                return CannotStartYet;
+        }
+    }
+
+    for (int i = 0; i < _tasksToDo.size(); ++i) {
+        SyncFileItemPtr item = _tasksToDo.at(i);
+        if (item->_file != file)
+            continue;
+        if (mustWait || !canStartInteractively(*item))
+            return CannotStartYet;
+        PropagatorJob *job = propagator()->createJob(item);
+        if (!job)
+            return CannotStartYet;
+        _tasksToDo.remove(i);
+        runInteractively(job);
+        return Started;
+    }
+
+    return NotInPropagation;
+}
+
+bool PropagatorCompositeJob::hasJobFor(const QString &file) const
+{
+    if (_state == Finished)
+        return false;
+
+    auto jobIsFor = [&file](PropagatorJob *job) {
+        if (auto itemJob = qobject_cast<PropagateItemJob *>(job))
+            return itemJob->_item->_file == file;
+        if (auto dirJob = qobject_cast<PropagateDirectory *>(job))
+            return dirJob->hasJobFor(file);
+        return false;
+    };
+    foreach (PropagatorJob *job, _runningJobs) {
+        if (jobIsFor(job))
+            return true;
+    }
+    foreach (PropagatorJob *job, _jobsToDo) {
+        if (jobIsFor(job))
+            return true;
+    }
+    foreach (const SyncFileItemPtr &item, _tasksToDo) {
+        if (item->_file == file)
+            return true;
+    }
+    return false;
+}
+
+bool PropagatorCompositeJob::runInteractively(PropagatorJob *job)
+{
+    if (_state == Finished)
+        return false;
+
+    qCInfo(lcDirectory) << "Starting" << job << "ahead of the queued jobs";
+    job->setAssociatedComposite(this);
+    job->_priority = InteractivePriority;
+    _runningJobs.append(job);
+    possiblyRunNextJob(job);
+    return true;
+}
+
 qint64 PropagatorCompositeJob::committedDiskSpace() const
 {
     qint64 needed = 0;
@@ -909,6 +1120,25 @@ PropagatorJob::JobParallelism PropagateDirectory::parallelism()
 }
 
 
+PropagatorJob::InteractiveStart PropagateDirectory::startInteractively(const QString &file)
+{
+    if (_state == Finished)
+        return NotInPropagation;
+    // The sub jobs wait for the directory to be created
+    if (_firstJob)
+        return CannotStartYet;
+    return _subJobs.startInteractively(file);
+}
+
+bool PropagateDirectory::hasJobFor(const QString &file) const
+{
+    if (_state == Finished)
+        return false;
+    if (_item->_file == file)
+        return true;
+    return isInDirectory(file, _item->_file) && _subJobs.hasJobFor(file);
+}
+
 bool PropagateDirectory::scheduleSelfOrChild()
 {
     if (_state == Finished) {
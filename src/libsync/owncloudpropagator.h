@@ -29,13 +29,19 @@
 #include "syncfileitem.h"
 #include "common/syncjournaldb.h"
 #include "bandwidthmanager.h"
+#include "bandwidthschedule.h"
+#include "ioexecutor.h"
 #include "accountfwd.h"
 #include "syncoptions.h"
+#include "schedulingpolicy.h"
 
 namespace OCC {
 
 Q_DECLARE_LOGGING_CATEGORY(lcPropagator)
 
+class SyncMetrics;
+class NetworkJobBudget;
+
 /** Free disk space threshold below which syncs will abort and not even start.
  */
 qint64 criticalFreeSpaceLimit();
@@ -91,6 +97,25 @@ public:
 
     virtual JobParallelism parallelism() { return FullParallelism; }
 
+    enum JobPriority {
+
+        /** Scheduled in the order of the sync tree, within the limits of
+            OwncloudPropagator::scheduleNextJobImpl() */
+        NormalPriority,
+
+        /** Requested by the user, who waits for it. Started right away
+            ahead of the queued jobs and not counted against the limits. */
+        InteractivePriority,
+    };
+    JobPriority _priority = NormalPriority;
+
+    /** See OwncloudPropagator::startInteractively() */
+    enum InteractiveStart {
+        NotInPropagation,
+        Started,
+        CannotStartYet
+    };
+
     /**
      * For "small" jobs
      */
@@ -178,6 +203,9 @@ protected slots:
 private:
     QScopedPointer<PropagateItemJob> _restoreJob;
 
+    /// Time since the job was started, for the trace log
+    QElapsedTimer _propagationTimer;
+
 public:
     PropagateItemJob(OwncloudPropagator *propagator, const SyncFileItemPtr &item)
         : PropagatorJob(propagator)
@@ -195,6 +223,7 @@ public:
         qCInfo(lcPropagator) << "Starting" << instruction_str << "propagation of" << _item->_file << "by" << this;
 
         _state = Running;
+        _propagationTimer.start();
         QMetaObject::invokeMethod(this, "start"); // We could be in a different thread (neon jobs)
         return true;
     }
@@ -238,6 +267,15 @@ public:
         _tasksToDo.append(item);
     }
 
+    /** Starts the queued job for the file, in this job or its subdirectories, right away */
+    InteractiveStart startInteractively(const QString &file);
+
+    /** Whether there is a queued or running job for the file, in this job or its subdirectories */
+    bool hasJobFor(const QString &file) const;
+
+    /** Starts the job right away with InteractivePriority, it becomes our sub job */
+    bool runInteractively(PropagatorJob *job);
+
     virtual bool scheduleSelfOrChild() Q_DECL_OVERRIDE;
     virtual JobParallelism parallelism() Q_DECL_OVERRIDE;
 
@@ -304,6 +342,12 @@ public:
         _subJobs.appendTask(item);
     }
 
+    /** Starts the queued job for the file right away, if the directory is already created */
+    InteractiveStart startInteractively(const QString &file);
+
+    /** Whether the directory or one of its sub jobs is for the file and not finished yet */
+    bool hasJobFor(const QString &file) const;
+
     virtual bool scheduleSelfOrChild() Q_DECL_OVERRIDE;
     virtual JobParallelism parallelism() Q_DECL_OVERRIDE;
     virtual void abort(PropagatorJob::AbortType abortType) Q_DECL_OVERRIDE
@@ -378,6 +422,7 @@ public:
         , _anotherSyncNeeded(false)
         , _chunkSize(10 * 1000 * 1000) // 10 MB, overridden in setSyncOptions
         , _account(account)
+        , _schedulingPolicy(new TreeOrderSchedulingPolicy)
     {
         qRegisterMetaType<PropagatorJob::AbortType>("PropagatorJob::AbortType");
     }
@@ -391,8 +436,16 @@ public:
 
     QAtomicInt _downloadLimit;
     QAtomicInt _uploadLimit;
+    /** Overrides the limits above while one of its rules applies */
+    BandwidthSchedule _bandwidthSchedule;
     BandwidthManager _bandwidthManager;
 
+    /** The limits in effect now, in the units of SyncEngine::setNetworkLimits() */
+    void networkLimits(int *upload, int *download);
+
+    /** Runs the local file system operations of the jobs */
+    IoExecutor _ioExecutor;
+
     QAtomicInt _abortRequested; // boolean set by the main thread to abort.
 
     /** The list of currently active jobs.
@@ -403,9 +456,28 @@ public:
      */
     QList<PropagateItemJob *> _activeJobList;
 
+    /** The active jobs that count against the limits, which are all but
+     * the interactive ones, see PropagatorJob::InteractivePriority */
+    QList<PropagateItemJob *> scheduledActiveJobs() const;
+
+    /** Decides which queued jobs may start, set up by setSyncOptions() */
+    SchedulingPolicy *schedulingPolicy() const { return _schedulingPolicy.data(); }
+
+    /** Replaces the scheduling policy, takes ownership */
+    void setSchedulingPolicy(SchedulingPolicy *policy);
+
     /** We detected that another sync is required after this one */
     bool _anotherSyncNeeded;
 
+    /** Where finished jobs record their transfers, may be null */
+    SyncMetrics *_metrics = nullptr;
+
+    /** Shared with the propagators of other folders, may be null */
+    NetworkJobBudget *_networkJobBudget = nullptr;
+
+    /** Counts the bytes the jobs hash for checksums, may be null */
+    ChecksumByteCounter _checksumBytes;
+
     /** Per-folder quota guesses.
      *
      * This starts out empty. When an upload in a folder fails due to insufficent
@@ -458,6 +530,27 @@ public:
     PropagateItemJob *createJob(const SyncFileItemPtr &item);
 
     void scheduleNextJob();
+
+    /**
+     * Starts the queued job for the file right away, ahead of the other
+     * queued jobs.
+     *
+     * Returns CannotStartYet if the job is already running or has to wait
+     * for its parent directory or a job it depends on.
+     */
+    PropagatorJob::InteractiveStart startInteractively(const QString &file);
+
+    /** Whether the propagation has a job for the file that didn't finish yet, without starting it */
+    bool hasJobFor(const QString &file) const;
+
+    /**
+     * Propagates an item that is not part of this propagation right away,
+     * for example a virtual file the user wants to open.
+     *
+     * Returns false if the propagation already finished.
+     */
+    bool addInteractiveJob(const SyncFileItemPtr &item);
+
     void reportProgress(const SyncFileItem &, quint64 bytes);
     void reportFileTotal(const SyncFileItem &item, quint64 newSize);
 
@@ -550,6 +643,7 @@ private:
     AccountPtr _account;
     QScopedPointer<PropagateDirectory> _rootJob;
     SyncOptions _syncOptions;
+    QScopedPointer<SchedulingPolicy> _schedulingPolicy;
 };
 
 
@@ -22,6 +22,7 @@
 #include "common/utility.h"
 #include "filesystem.h"
 #include "propagatorjobs.h"
+#include "networkjobbudget.h"
 #include "common/checksums.h"
 #include "common/asserts.h"
 
@@ -29,6 +30,7 @@
 #include <QNetworkAccessManager>
 #include <QFileInfo>
 #include <QDir>
+#include <QtConcurrent>
 #include <cmath>
 
 #ifdef Q_OS_UNIX
@@ -40,6 +42,18 @@ namespace OCC {
 Q_LOGGING_CATEGORY(lcGetJob, "sync.networkjob.get", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPropagateDownload, "sync.propagator.download", QtInfoMsg)
 
+// How often the progress of segmented downloads is written to the journal
+static const int segmentsSaveIntervalMs = 5 * 1000;
+
+static QByteArray transmissionChecksumHeader(QNetworkReply *reply)
+{
+    auto checksumHeader = findBestChecksum(reply->rawHeader(checkSumHeaderC));
+    auto contentMd5Header = reply->rawHeader(contentMd5HeaderC);
+    if (checksumHeader.isEmpty() && !contentMd5Header.isEmpty())
+        checksumHeader = "MD5:" + contentMd5Header;
+    return checksumHeader;
+}
+
 // Always coming in with forward slashes.
 // In csync_excluded_no_ctx we ignore all files with longer than 254 chars
 // This function also adds a dot at the beginning of the filename to hide the file on OS X and Linux
@@ -65,6 +79,108 @@ QString OWNCLOUDSYNC_EXPORT createDownloadTmpFileName(const QString &previous)
     }
 }
 
+static QString writeBatch(QFile *device, const QByteArray &data)
+{
+    if (device->write(data) != data.size()) {
+        const QString error = device->errorString();
+        return error.isEmpty() ? QStringLiteral("Write error") : error;
+    }
+    return QString();
+}
+
+// The downloads' disk writes, separate from the global pool that also
+// computes checksums, so neither waits for the other
+static QThreadPool *downloadWritePool()
+{
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool;
+        pool->setMaxThreadCount(4);
+        return pool;
+    }();
+    return pool;
+}
+
+DownloadSink::DownloadSink(QFile *device, qint64 batchSize, bool writeInThread,
+    const std::function<void()> &writeFinished)
+    : _device(device)
+    , _batchSize(batchSize)
+    , _writeInThread(writeInThread)
+    , _writeFinished(writeFinished)
+    , _position(device->pos())
+{
+    if (_batchSize > 0 && !_writeInThread)
+        _buffer.reserve(_batchSize);
+    QObject::connect(&_pendingWrite, &QFutureWatcherBase::finished, [this] { slotWriteFinished(); });
+}
+
+DownloadSink::~DownloadSink()
+{
+    // The worker still uses the device
+    if (_pendingSize > 0)
+        _pendingWrite.waitForFinished();
+}
+
+bool DownloadSink::write(const char *data, qint64 size)
+{
+    if (!_errorString.isEmpty())
+        return false;
+
+    if (_batchSize <= 0) {
+        if (_device->write(data, size) != size) {
+            _errorString = _device->errorString();
+            return false;
+        }
+        _position += size;
+        return true;
+    }
+
+    _buffer.append(data, size);
+    // Only one batch is written at a time, the next one waits in the
+    // buffer, see isFull()
+    if (_buffer.size() >= _batchSize && _pendingSize == 0)
+        startWrite();
+    return _errorString.isEmpty();
+}
+
+bool DownloadSink::writeQueued()
+{
+    if (_errorString.isEmpty() && _pendingSize == 0 && !_buffer.isEmpty())
+        startWrite();
+    return _errorString.isEmpty();
+}
+
+void DownloadSink::startWrite()
+{
+    _pendingSize = _buffer.size();
+    if (_writeInThread) {
+        _pendingWrite.setFuture(QtConcurrent::run(downloadWritePool(), writeBatch, _device, _buffer));
+        _buffer = QByteArray();
+        return;
+    }
+
+    _errorString = writeBatch(_device, _buffer);
+    _buffer.resize(0); // keeps the reserved capacity
+    if (_errorString.isEmpty())
+        _position += _pendingSize;
+    _pendingSize = 0;
+}
+
+void DownloadSink::slotWriteFinished()
+{
+    if (_pendingSize == 0)
+        return;
+    _errorString = _pendingWrite.result();
+    if (_errorString.isEmpty())
+        _position += _pendingSize;
+    _pendingSize = 0;
+
+    // Continue with the batch that was collected meanwhile
+    if (_errorString.isEmpty() && _buffer.size() >= _batchSize)
+        startWrite();
+    if (_writeFinished)
+        _writeFinished();
+}
+
 // DOES NOT take ownership of the device.
 GETFileJob::GETFileJob(AccountPtr account, const QString &path, QFile *device,
     const QMap<QByteArray, QByteArray> &headers, const QByteArray &expectedEtagForResume,
@@ -93,7 +209,11 @@ GETFileJob::GETFileJob(AccountPtr account, const QUrl &url, QFile *device,
 
 void GETFileJob::start()
 {
-    if (_resumeStart > 0) {
+    if (_rangeEnd > 0) {
+        _headers["Range"] = "bytes=" + QByteArray::number(_resumeStart) + '-' + QByteArray::number(_rangeEnd - 1);
+        _headers["Accept-Ranges"] = "bytes";
+        qCDebug(lcGetJob) << "Get range " << _headers["Range"];
+    } else if (_resumeStart > 0) {
         _headers["Range"] = "bytes=" + QByteArray::number(_resumeStart) + '-';
         _headers["Accept-Ranges"] = "bytes";
         qCDebug(lcGetJob) << "Retry with range " << _headers["Range"];
@@ -192,6 +312,14 @@ void GETFileJob::slotMetaDataChanged()
 
     quint64 start = 0;
     QByteArray ranges = reply()->rawHeader("Content-Range");
+    if (_rangeEnd > 0 && ranges.isEmpty()) {
+        // Writing the whole file at the range's position would corrupt the download
+        qCWarning(lcGetJob) << "Server ignored the range request" << _headers["Range"];
+        _errorString = tr("Server does not support range requests");
+        _errorStatus = SyncFileItem::NormalError;
+        reply()->abort();
+        return;
+    }
     if (!ranges.isEmpty()) {
         QRegExp rx("bytes (\\d+)-");
         if (rx.indexIn(ranges) >= 0) {
@@ -223,9 +351,27 @@ void GETFileJob::slotMetaDataChanged()
         _lastModified = Utility::qDateTimeToTime_t(lastModified.toDateTime());
     }
 
+    // Reading continues once the sink wrote what it has
+    _sink.reset(new DownloadSink(_device, _writeBatchSize, _writeInThread, [this] {
+        QMetaObject::invokeMethod(this, "slotReadyRead", Qt::QueuedConnection);
+    }));
     _saveBodyToFile = true;
 }
 
+bool GETFileJob::flushBody()
+{
+    // The data has to be on disk before anyone looks at the file
+    if (_sink && !_sink->writeQueued()) {
+        qCWarning(lcGetJob) << "Error while writing to file" << _sink->errorString();
+        if (_errorString.isEmpty()) {
+            _errorString = _sink->errorString();
+            _errorStatus = SyncFileItem::NormalError;
+        }
+        return true;
+    }
+    return !_sink || _sink->isIdle();
+}
+
 void GETJob::setBandwidthManager(BandwidthManager *bwm)
 {
     _bandwidthManager = bwm;
@@ -252,8 +398,10 @@ void GETJob::giveBandwidthQuota(qint64 q)
 
 qint64 GETFileJob::currentDownloadPosition()
 {
-    if (_device && _device->pos() > 0 && _device->pos() > qint64(_resumeStart)) {
-        return _device->pos();
+    // The device may be written to from another thread, ask the sink
+    const qint64 pos = _sink ? _sink->position() : (_device ? _device->pos() : 0);
+    if (pos > 0 && pos > qint64(_resumeStart)) {
+        return pos;
     }
     return _resumeStart;
 }
@@ -266,6 +414,12 @@ void GETFileJob::slotReadyRead()
     QByteArray buffer(bufferSize, Qt::Uninitialized);
 
     while (reply()->bytesAvailable() > 0 && _saveBodyToFile) {
+        if (_sink && _sink->isFull()) {
+            // Applies backpressure: the reply stops reading from the network
+            // while its small read buffer is full
+            qCDebug(lcGetJob) << "Waiting for the disk";
+            break;
+        }
         if (_bandwidthChoked) {
             qCWarning(lcGetJob) << "Download choked";
             break;
@@ -290,11 +444,10 @@ void GETFileJob::slotReadyRead()
         }
 
         if (_device->isOpen()) {
-            qint64 w = _device->write(buffer.constData(), r);
-            if (w != r) {
-                _errorString = _device->errorString();
+            if (!_sink->write(buffer.constData(), r)) {
+                _errorString = _sink->errorString();
                 _errorStatus = SyncFileItem::NormalError;
-                qCWarning(lcGetJob) << "Error while writing to file" << w << r << _errorString;
+                qCWarning(lcGetJob) << "Error while writing to file" << r << _errorString;
                 reply()->abort();
                 return;
             }
@@ -302,6 +455,9 @@ void GETFileJob::slotReadyRead()
     }
 
     if (reply()->isFinished() && (reply()->bytesAvailable() == 0 || !_saveBodyToFile)) {
+        // Called again when the write finished
+        if (!flushBody())
+            return;
         qCDebug(lcGetJob) << "Actually finished!";
         if (_bandwidthManager) {
             _bandwidthManager->unregisterDownloadJob(this);
@@ -336,6 +492,12 @@ QString GETJob::errorString() const
     return AbstractNetworkJob::errorString();
 }
 
+PropagateDownloadFile::~PropagateDownloadFile()
+{
+    // The job may still write to _tmpFile from a worker thread, see DownloadSink
+    delete _job.data();
+}
+
 void PropagateDownloadFile::start()
 {
     if (propagator()->_abortRequested.fetchAndAddRelaxed(0))
@@ -381,6 +543,7 @@ void PropagateDownloadFile::start()
         qCDebug(lcPropagateDownload) << _item->_file << "may not need download, computing checksum";
         auto computeChecksum = new ComputeChecksum(this);
         computeChecksum->setChecksumType(parseChecksumHeaderType(_item->_checksumHeader));
+        computeChecksum->setByteCounter(propagator()->_checksumBytes);
         connect(computeChecksum, &ComputeChecksum::done,
             this, &PropagateDownloadFile::conflictChecksumComputed);
         computeChecksum->start(propagator()->getFilePath(_item->_file));
@@ -433,22 +596,36 @@ void PropagateDownloadFile::startDownload()
         } else {
             tmpFileName = progressInfo._tmpfile;
             _expectedEtagForResume = progressInfo._etag;
+            _segments = propagator()->_journal->getDownloadSegments(_item->_file);
         }
     }
 
+    // A partial download continues the way it was started
+    const bool segmented = !_segments.isEmpty()
+        || (tmpFileName.isEmpty() && isSegmentedDownloadEnabled());
+
     if (tmpFileName.isEmpty()) {
         tmpFileName = createDownloadTmpFileName(_item->_file);
     }
 
     _tmpFile.setFileName(propagator()->getFilePath(tmpFileName));
-    if (!_tmpFile.open(QIODevice::Append | QIODevice::Unbuffered)) {
+    if (segmented) {
+        if (!prepareSegments())
+            return;
+    } else if (!_tmpFile.open(QIODevice::Append | QIODevice::Unbuffered)) {
         done(SyncFileItem::NormalError, _tmpFile.errorString());
         return;
     }
 
     FileSystem::setFileHidden(_tmpFile.fileName(), true);
 
-    _resumeStart = _tmpFile.size();
+    if (segmented) {
+        _resumeStart = 0;
+        for (const auto &segment : _segments)
+            _resumeStart += segment._received;
+    } else {
+        _resumeStart = _tmpFile.size();
+    }
     if (_resumeStart > 0) {
         if (_resumeStart == _item->_size) {
             qCInfo(lcPropagateDownload) << "File is already complete, no need to download";
@@ -487,9 +664,19 @@ void PropagateDownloadFile::startDownload()
         pi._tmpfile = tmpFileName;
         pi._valid = true;
         propagator()->_journal->setDownloadInfo(_item->_file, pi);
+        if (segmented)
+            propagator()->_journal->setDownloadSegments(_item->_file, _segments);
         propagator()->_journal->commit("download file start");
     }
 
+    if (segmented) {
+        startSegmentedDownload();
+        return;
+    }
+
+    // Keeps the file from being fragmented by the many appends
+    FileSystem::preallocate(_tmpFile, _item->_size);
+
     if (_item->_remotePerm.hasPermission(RemotePermissions::HasZSyncMetadata) && isZsyncPropagationEnabled(propagator(), _item)) {
         if (_item->_previousSize) {
             // Retrieve zsync metadata file from the server
@@ -557,6 +744,8 @@ void PropagateDownloadFile::startFullDownload()
             url,
             &_tmpFile, headers, _expectedEtagForResume, _resumeStart, this);
     }
+    const auto &options = propagator()->syncOptions();
+    qobject_cast<GETFileJob *>(_job.data())->setWriteBatching(options._downloadWriteBatchSize, options._downloadWriteThread);
     _job->setBandwidthManager(&propagator()->_bandwidthManager);
     connect(_job.data(), &GETJob::finishedSignal, this, &PropagateDownloadFile::slotGetFinished);
     connect(qobject_cast<GETFileJob *>(_job.data()), &GETFileJob::downloadProgress,
@@ -721,19 +910,25 @@ void PropagateDownloadFile::slotGetFinished()
         return;
     }
 
+    readConflictHeaders(job->reply());
+    validateTransmissionChecksum(transmissionChecksumHeader(job->reply()));
+}
+
+void PropagateDownloadFile::readConflictHeaders(QNetworkReply *reply)
+{
     // Did the file come with conflict headers? If so, store them now!
     // If we download conflict files but the server doesn't send conflict
     // headers, the record will be established by SyncEngine::conflictRecordMaintenance.
     // (we can't reliably determine the file id of the base file here,
     // it might still be downloaded in a parallel job and not exist in
     // the database yet!)
-    if (job->reply()->rawHeader("OC-Conflict") == "1") {
+    if (reply->rawHeader("OC-Conflict") == "1") {
         _conflictRecord.path = _item->_file.toUtf8();
-        _conflictRecord.initialBasePath = job->reply()->rawHeader("OC-ConflictInitialBasePath");
-        _conflictRecord.baseFileId = job->reply()->rawHeader("OC-ConflictBaseFileId");
-        _conflictRecord.baseEtag = job->reply()->rawHeader("OC-ConflictBaseEtag");
+        _conflictRecord.initialBasePath = reply->rawHeader("OC-ConflictInitialBasePath");
+        _conflictRecord.baseFileId = reply->rawHeader("OC-ConflictBaseFileId");
+        _conflictRecord.baseEtag = reply->rawHeader("OC-ConflictBaseEtag");
 
-        auto mtimeHeader = job->reply()->rawHeader("OC-ConflictBaseMtime");
+        auto mtimeHeader = reply->rawHeader("OC-ConflictBaseMtime");
         if (!mtimeHeader.isEmpty())
             _conflictRecord.baseModtime = mtimeHeader.toLongLong();
 
@@ -741,22 +936,272 @@ void PropagateDownloadFile::slotGetFinished()
         // successfully, much further down. Here we just grab the headers because the
         // job will be deleted later.
     }
+}
 
+void PropagateDownloadFile::validateTransmissionChecksum(const QByteArray &checksumHeader)
+{
     // Do checksum validation for the download. If there is no checksum header, the validator
     // will also emit the validated() signal to continue the flow in slot transmissionChecksumValidated()
     // as this is (still) also correct.
     ValidateChecksumHeader *validator = new ValidateChecksumHeader(this);
+    validator->setByteCounter(propagator()->_checksumBytes);
     connect(validator, &ValidateChecksumHeader::validated,
         this, &PropagateDownloadFile::transmissionChecksumValidated);
     connect(validator, &ValidateChecksumHeader::validationFailed,
         this, &PropagateDownloadFile::slotChecksumFail);
-    auto checksumHeader = findBestChecksum(job->reply()->rawHeader(checkSumHeaderC));
-    auto contentMd5Header = job->reply()->rawHeader(contentMd5HeaderC);
-    if (checksumHeader.isEmpty() && !contentMd5Header.isEmpty())
-        checksumHeader = "MD5:" + contentMd5Header;
     validator->start(_tmpFile.fileName(), checksumHeader);
 }
 
+// Every segment is a transfer of its own, there are no more segments than
+// transfers the propagator may run at the same time
+static int segmentCount(OwncloudPropagator *propagator)
+{
+    return qMin(propagator->syncOptions()._downloadSegments, propagator->maximumActiveTransferJob());
+}
+
+bool PropagateDownloadFile::isSegmentedDownloadEnabled()
+{
+    const auto &options = propagator()->syncOptions();
+    if (_rangesUnsupported
+        || segmentCount(propagator()) < 2
+        || _item->_size == 0
+        || _item->_size < options._segmentedDownloadMinFileSize
+        || !_item->_directDownloadUrl.isEmpty()) {
+        return false;
+    }
+    // A zsync download only transfers the changed parts, prefer it
+    return !(_item->_previousSize
+        && _item->_remotePerm.hasPermission(RemotePermissions::HasZSyncMetadata)
+        && isZsyncPropagationEnabled(propagator(), _item));
+}
+
+bool PropagateDownloadFile::prepareSegments()
+{
+    const qint64 size = _item->_size;
+
+    // The temporary file is preallocated, anything else means it was tampered with
+    if (!_segments.isEmpty() && _tmpFile.size() != size) {
+        qCWarning(lcPropagateDownload) << "Temporary file of segmented download has an unexpected size, restarting" << _tmpFile.fileName();
+        _segments.clear();
+    }
+
+    if (_segments.isEmpty()) {
+        const int count = segmentCount(propagator());
+        const qint64 segmentSize = (size + count - 1) / count;
+        for (qint64 start = 0; start < size; start += segmentSize) {
+            SyncJournalDb::DownloadSegment segment;
+            segment._start = start;
+            segment._end = qMin(start + segmentSize, size);
+            _segments.append(segment);
+        }
+    }
+
+    // The segments write to their own positions of the file, so it needs its final size
+    // upfront. Allocate the space first, so the file isn't only sparse.
+    if (!_tmpFile.open(QIODevice::ReadWrite)) {
+        done(SyncFileItem::NormalError, _tmpFile.errorString());
+        return false;
+    }
+    if (_tmpFile.size() != size) {
+        FileSystem::preallocate(_tmpFile, size);
+        if (!_tmpFile.resize(size)) {
+            done(SyncFileItem::NormalError, _tmpFile.errorString());
+            return false;
+        }
+    }
+    _tmpFile.close();
+    return true;
+}
+
+void PropagateDownloadFile::startSegmentedDownload()
+{
+    qCInfo(lcPropagateDownload) << "Downloading" << _item->_file << "in" << _segments.size() << "segments";
+
+    _segmentJobs.fill(QPointer<GETFileJob>(), _segments.size());
+    _segmentsSavedTimer.start();
+    startPendingSegments();
+}
+
+bool PropagateDownloadFile::startPendingSegments()
+{
+    // Like chunked uploads, each segment counts as an active job. The first
+    // one takes the slot the download was scheduled with, the others only
+    // start while the propagator and the NetworkJobBudget have slots left.
+    // Otherwise they wait for a running segment to finish.
+    auto budget = propagator()->_networkJobBudget;
+    int running = 0;
+    for (const auto &job : _segmentJobs) {
+        if (job)
+            ++running;
+    }
+    for (int i = 0; i < _segments.size(); ++i) {
+        if (_segmentJobs.at(i) || _segments.at(i).remaining() <= 0)
+            continue;
+        if (running > 0
+            && (propagator()->_activeJobList.count() >= propagator()->maximumActiveTransferJob()
+                   || (budget && budget->activeJobCount() >= budget->maximum()))) {
+            break;
+        }
+        if (!startSegment(i))
+            return false;
+        ++running;
+    }
+    return true;
+}
+
+bool PropagateDownloadFile::startSegment(int index)
+{
+    const auto &segment = _segments.at(index);
+    const qint64 start = segment._start + segment._received;
+    auto device = new QFile(_tmpFile.fileName());
+    if (!device->open(QIODevice::ReadWrite | QIODevice::Unbuffered) || !device->seek(start)) {
+        const QString error = device->errorString();
+        delete device;
+        abortSegments();
+        propagator()->_activeJobList.removeAll(this);
+        done(SyncFileItem::NormalError, error);
+        return false;
+    }
+
+    // Every segment checks that it gets the same version of the file
+    const auto &options = propagator()->syncOptions();
+    auto job = new GETFileJob(propagator()->account(),
+        propagator()->_remoteFolder + _item->_file,
+        device, QMap<QByteArray, QByteArray>(), _item->_etag, start, this);
+    device->setParent(job); // closed together with the job
+    job->setRangeEnd(segment._end);
+    job->setWriteBatching(options._downloadWriteBatchSize, options._downloadWriteThread);
+    job->setBandwidthManager(&propagator()->_bandwidthManager);
+    connect(job, &GETJob::finishedSignal, this, [this, index] { slotSegmentFinished(index); });
+    connect(job, &GETFileJob::downloadProgress, this, &PropagateDownloadFile::slotSegmentProgress);
+    _segmentJobs[index] = job;
+    propagator()->_activeJobList.append(this);
+    job->start();
+    return true;
+}
+
+void PropagateDownloadFile::slotSegmentFinished(int index)
+{
+    GETFileJob *job = _segmentJobs.value(index);
+    ASSERT(job);
+    auto &segment = _segments[index];
+    segment._received = qint64(job->currentDownloadPosition()) - segment._start;
+
+    QNetworkReply *reply = job->reply();
+    if (reply->error() != QNetworkReply::NoError) {
+        const bool rangeIgnored = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200;
+        abortSegments();
+
+        if (rangeIgnored) {
+            qCWarning(lcPropagateDownload) << "Server does not support range requests, downloading" << _item->_file << "in one piece";
+            propagator()->_activeJobList.removeAll(this);
+            FileSystem::remove(_tmpFile.fileName());
+            propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
+            _rangesUnsupported = true;
+            _segments.clear();
+            _expectedEtagForResume.clear();
+            startDownload();
+            return;
+        }
+
+        // Keep what was received for the next attempt and do the usual
+        // error handling with the failed segment, which releases one slot
+        propagator()->_activeJobList.removeAll(this);
+        propagator()->_activeJobList.append(this);
+        saveSegments();
+        _job = job;
+        slotGetFinished();
+        return;
+    }
+
+    if (segment.remaining() != 0) {
+        qCWarning(lcPropagateDownload) << "Segment" << segment._start << segment._end << "of" << _item->_file
+                                       << "has the wrong length" << segment._received;
+        const bool overflow = segment.remaining() < 0;
+        abortSegments();
+        propagator()->_activeJobList.removeAll(this);
+        if (overflow) {
+            // Writing more than was requested may have damaged another segment
+            FileSystem::remove(_tmpFile.fileName());
+            propagator()->_journal->setDownloadInfo(_item->_file, SyncJournalDb::DownloadInfo());
+        } else {
+            saveSegments();
+        }
+        propagator()->_anotherSyncNeeded = true;
+        done(SyncFileItem::SoftError, tr("The file could not be downloaded completely."));
+        return;
+    }
+    _segmentJobs[index] = nullptr;
+    propagator()->_activeJobList.removeOne(this);
+
+    // All segments get the same headers, as they are for the same version of the file
+    _item->_httpErrorCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    _item->_responseTimeStamp = job->responseTimestamp();
+    _item->_requestId = job->requestId();
+    if (job->lastModified()) {
+        _item->_modtime = job->lastModified();
+    }
+    if (_segmentsChecksumHeader.isEmpty()) {
+        _segmentsChecksumHeader = transmissionChecksumHeader(reply);
+    }
+    readConflictHeaders(reply);
+
+    // The finished segment's slot goes to the next one
+    if (!startPendingSegments())
+        return;
+    for (const auto &other : _segmentJobs) {
+        if (other) {
+            saveSegments();
+            return;
+        }
+    }
+
+    qCInfo(lcPropagateDownload) << "All segments of" << _item->_file << "were downloaded";
+    saveSegments();
+    validateTransmissionChecksum(_segmentsChecksumHeader);
+}
+
+void PropagateDownloadFile::slotSegmentProgress()
+{
+    qint64 received = 0;
+    for (int i = 0; i < _segments.size(); ++i) {
+        auto &segment = _segments[i];
+        if (auto job = _segmentJobs.at(i)) {
+            segment._received = qBound<qint64>(segment._received,
+                job->currentDownloadPosition() - segment._start, segment._end - segment._start);
+        }
+        received += segment._received;
+    }
+    _downloadProgress = received - _resumeStart;
+    propagator()->reportProgress(*_item, received);
+
+    if (_segmentsSavedTimer.elapsed() > segmentsSaveIntervalMs)
+        saveSegments();
+}
+
+void PropagateDownloadFile::abortSegments()
+{
+    for (int i = 0; i < _segmentJobs.size(); ++i) {
+        GETFileJob *job = _segmentJobs.at(i);
+        if (!job)
+            continue;
+        _segmentJobs[i] = nullptr;
+        auto &segment = _segments[i];
+        segment._received = qBound<qint64>(0,
+            job->currentDownloadPosition() - segment._start, segment._end - segment._start);
+        disconnect(job, nullptr, this, nullptr);
+        if (job->reply())
+            job->reply()->abort();
+    }
+}
+
+void PropagateDownloadFile::saveSegments()
+{
+    propagator()->_journal->setDownloadSegments(_item->_file, _segments);
+    propagator()->_journal->commit("download segments");
+    _segmentsSavedTimer.restart();
+}
+
 void PropagateDownloadFile::slotChecksumFail(const QString &errMsg)
 {
     FileSystem::remove(_tmpFile.fileName());
@@ -875,6 +1320,7 @@ void PropagateDownloadFile::transmissionChecksumValidated(const QByteArray &chec
     // Compute the content checksum.
     auto computeChecksum = new ComputeChecksum(this);
     computeChecksum->setChecksumType(theContentChecksumType);
+    computeChecksum->setByteCounter(propagator()->_checksumBytes);
 
     connect(computeChecksum, &ComputeChecksum::done,
         this, &PropagateDownloadFile::contentChecksumComputed);
@@ -900,8 +1346,20 @@ void PropagateDownloadFile::downloadFinished()
         return;
     }
 
-    bool isConflict = _item->_instruction == CSYNC_INSTRUCTION_CONFLICT
-        && (QFileInfo(fn).isDir() || !FileSystem::fileEquals(fn, _tmpFile.fileName()));
+    if (_item->_instruction != CSYNC_INSTRUCTION_CONFLICT) {
+        finalizeDownload(false);
+        return;
+    }
+
+    // Comparing the contents may take a while
+    const QString tmpFileName = _tmpFile.fileName();
+    propagator()->_ioExecutor.run(this,
+        [fn, tmpFileName] { return QFileInfo(fn).isDir() || !FileSystem::fileEquals(fn, tmpFileName); },
+        [this](bool isConflict) { finalizeDownload(isConflict); });
+}
+
+void PropagateDownloadFile::finalizeDownload(bool isConflict)
+{
     if (isConflict) {
         QString error;
         if (!propagator()->createConflict(_item, _associatedComposite, &error)) {
@@ -910,41 +1368,72 @@ void PropagateDownloadFile::downloadFinished()
         }
     }
 
-    FileSystem::setModTime(_tmpFile.fileName(), _item->_modtime);
-    // We need to fetch the time again because some file systems such as FAT have worse than a second
-    // Accuracy, and we really need the time from the file system. (#3103)
-    _item->_modtime = FileSystem::getModTime(_tmpFile.fileName());
+    const QString fn = propagator()->getFilePath(_item->_file);
+    const QString tmpFileName = _tmpFile.fileName();
+    const time_t modtime = _item->_modtime;
+    const qint64 expectedSize = _item->_previousSize;
+    const time_t expectedMtime = _item->_previousModtime;
+    const bool readOnly = !_item->_remotePerm.isNull() && !_item->_remotePerm.hasPermission(RemotePermissions::CanWrite);
 
-    if (FileSystem::fileExists(fn)) {
-        // Preserve the existing file permissions.
-        QFileInfo existingFile(fn);
-        if (existingFile.permissions() != _tmpFile.permissions()) {
-            _tmpFile.setPermissions(existingFile.permissions());
-        }
-        preserveGroupOwnership(_tmpFile.fileName(), existingFile);
-
-        // Check whether the existing file has changed since the discovery
-        // phase by comparing size and mtime to the previous values. This
-        // is necessary to avoid overwriting user changes that happened between
-        // the discovery phase and now.
-        const qint64 expectedSize = _item->_previousSize;
-        const time_t expectedMtime = _item->_previousModtime;
-        if (!FileSystem::verifyFileUnchanged(fn, expectedSize, expectedMtime)) {
-            propagator()->_anotherSyncNeeded = true;
-            done(SyncFileItem::SoftError, tr("File has changed since discovery"));
-            return;
-        }
-    }
+    emit propagator()->touchedFile(fn);
+    propagator()->_ioExecutor.run(this,
+        [fn, tmpFileName, modtime, expectedSize, expectedMtime, readOnly] {
+            FinalizeResult result;
+            FileSystem::setModTime(tmpFileName, modtime);
+            // We need to fetch the time again because some file systems such as FAT have worse than a second
+            // Accuracy, and we really need the time from the file system. (#3103)
+            result.modtime = FileSystem::getModTime(tmpFileName);
+
+            if (FileSystem::fileExists(fn)) {
+                // Preserve the existing file permissions.
+                QFileInfo existingFile(fn);
+                if (existingFile.permissions() != QFile::permissions(tmpFileName)) {
+                    QFile::setPermissions(tmpFileName, existingFile.permissions());
+                }
+                preserveGroupOwnership(tmpFileName, existingFile);
+
+                // Check whether the existing file has changed since the discovery
+                // phase by comparing size and mtime to the previous values. This
+                // is necessary to avoid overwriting user changes that happened between
+                // the discovery phase and now.
+                if (!FileSystem::verifyFileUnchanged(fn, expectedSize, expectedMtime)) {
+                    result.changedSinceDiscovery = true;
+                    return result;
+                }
+            }
 
-    // Apply the remote permissions
-    FileSystem::setFileReadOnlyWeak(_tmpFile.fileName(), !_item->_remotePerm.isNull() && !_item->_remotePerm.hasPermission(RemotePermissions::CanWrite));
+            // Apply the remote permissions
+            FileSystem::setFileReadOnlyWeak(tmpFileName, readOnly);
 
-    QString error;
-    emit propagator()->touchedFile(fn);
-    // The fileChanged() check is done above to generate better error messages.
-    if (!FileSystem::uncheckedRenameReplace(_tmpFile.fileName(), fn, &error)) {
-        qCWarning(lcPropagateDownload) << QString("Rename failed: %1 => %2").arg(_tmpFile.fileName()).arg(fn);
+            // The fileChanged() check is done above to generate better error messages.
+            result.renamed = FileSystem::uncheckedRenameReplace(tmpFileName, fn, &result.renameError);
+            if (!result.renamed) {
+                qCWarning(lcPropagateDownload) << QString("Rename failed: %1 => %2").arg(tmpFileName).arg(fn);
+                result.locked = FileSystem::isFileLocked(fn);
+                return result;
+            }
+            FileSystem::setFileHidden(fn, false);
+
+            // Maybe we downloaded a newer version of the file than we thought we would...
+            // Get up to date information for the journal.
+            result.size = FileSystem::getSize(fn);
+            return result;
+        },
+        [this, isConflict](const FinalizeResult &result) { downloadFinalized(isConflict, result); });
+}
+
+void PropagateDownloadFile::downloadFinalized(bool isConflict, const FinalizeResult &result)
+{
+    QString fn = propagator()->getFilePath(_item->_file);
+    _item->_modtime = result.modtime;
 
+    if (result.changedSinceDiscovery) {
+        propagator()->_anotherSyncNeeded = true;
+        done(SyncFileItem::SoftError, tr("File has changed since discovery"));
+        return;
+    }
+
+    if (!result.renamed) {
         // If we moved away the original file due to a conflict but can't
         // put the downloaded file in its place, we are in a bad spot:
         // If we do nothing the next sync run will assume the user deleted
@@ -959,20 +1448,17 @@ void PropagateDownloadFile::downloadFinished()
 
         // If the file is locked, we want to retry this sync when it
         // becomes available again, otherwise try again directly
-        if (FileSystem::isFileLocked(fn)) {
+        if (result.locked) {
             emit propagator()->seenLockedFile(fn);
         } else {
             propagator()->_anotherSyncNeeded = true;
         }
 
-        done(SyncFileItem::SoftError, error);
+        done(SyncFileItem::SoftError, result.renameError);
         return;
     }
-    FileSystem::setFileHidden(fn, false);
 
-    // Maybe we downloaded a newer version of the file than we thought we would...
-    // Get up to date information for the journal.
-    _item->_size = FileSystem::getSize(fn);
+    _item->_size = result.size;
 
     // Maybe what we downloaded was a conflict file? If so, set a conflict record.
     // (the data was prepared in slotGetFinished above)
@@ -1033,6 +1519,13 @@ void PropagateDownloadFile::abort(PropagatorJob::AbortType abortType)
     if (_job && _job->reply())
         _job->reply()->abort();
 
+    // The first aborted segment stops the others, see slotSegmentFinished()
+    const auto segmentJobs = _segmentJobs;
+    for (const auto &job : segmentJobs) {
+        if (job && job->reply())
+            job->reply()->abort();
+    }
+
     if (abortType == AbortType::Asynchronous) {
         emit abortFinished();
     }
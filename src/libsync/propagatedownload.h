@@ -19,6 +19,11 @@
 
 #include <QBuffer>
 #include <QFile>
+#include <QFuture>
+#include <QFutureWatcher>
+
+#include <functional>
+#include <memory>
 
 namespace OCC {
 
@@ -129,6 +134,69 @@ signals:
 };
 
 
+/**
+ * @brief Writes the body of a download to its file in large batches
+ *
+ * The network delivers the body in small pieces, writing each of them costs
+ * a syscall. The sink collects them and writes batchSize bytes at once,
+ * optionally from a worker thread, so the event loop doesn't wait for the
+ * disk. One batch is written while the next one is collected.
+ *
+ * The sink never waits for the worker thread. When the next batch is
+ * complete before the previous one is written, isFull() tells the caller
+ * to stop reading until the writeFinished callback is called.
+ *
+ * The device must not be used by others until isIdle() and must outlive
+ * the sink.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT DownloadSink
+{
+public:
+    /// A batchSize of 0 writes every piece directly.
+    DownloadSink(QFile *device, qint64 batchSize, bool writeInThread,
+        const std::function<void()> &writeFinished = std::function<void()>());
+    /// Waits for a running write, data that wasn't written is lost.
+    ~DownloadSink();
+
+    /** Queues the data for writing, returns false if a write failed */
+    bool write(const char *data, qint64 size);
+
+    /** Whether the caller should stop passing data until the running write finished */
+    bool isFull() const { return _pendingSize > 0 && _buffer.size() >= _batchSize; }
+
+    /**
+     * Starts writing all queued data, returns false if a write failed.
+     *
+     * With writeInThread the data is only on disk once isIdle(), call
+     * this again from the writeFinished callback until then.
+     */
+    bool writeQueued();
+
+    /** Whether all data was written */
+    bool isIdle() const { return _pendingSize == 0 && _buffer.isEmpty(); }
+
+    /** The position in the file up to which data was written */
+    qint64 position() const { return _position; }
+
+    QString errorString() const { return _errorString; }
+
+private:
+    void startWrite();
+    void slotWriteFinished();
+
+    QFile *_device;
+    qint64 _batchSize;
+    bool _writeInThread;
+    std::function<void()> _writeFinished;
+    QByteArray _buffer;
+    QFutureWatcher<QString> _pendingWrite; // the error string, empty on success
+    qint64 _pendingSize = 0; // bytes in _pendingWrite
+    qint64 _position;
+    QString _errorString;
+};
+
 /**
  * @brief Downloads the remote file via GET
  * @ingroup libsync
@@ -140,12 +208,18 @@ class GETFileJob : public GETJob
     QMap<QByteArray, QByteArray> _headers;
     QByteArray _expectedEtagForResume;
     quint64 _resumeStart;
+    quint64 _rangeEnd = 0;
     QUrl _directDownloadUrl;
     bool _hasEmittedFinishedSignal;
 
     /// Will be set to true once we've seen a 2xx response header
     bool _saveBodyToFile = false;
 
+    /// Writes the body to _device once _saveBodyToFile is set
+    std::unique_ptr<DownloadSink> _sink;
+    qint64 _writeBatchSize = 0;
+    bool _writeInThread = false;
+
 public:
     // DOES NOT take ownership of the device.
     explicit GETFileJob(AccountPtr account, const QString &path, QFile *device,
@@ -163,6 +237,9 @@ public:
     {
         if (_saveBodyToFile && reply()->bytesAvailable()) {
             return false;
+        } else if (!flushBody()) {
+            // slotReadyRead() finishes once the data is written
+            return false;
         } else {
             if (!_hasEmittedFinishedSignal) {
                 emit finishedSignal();
@@ -179,6 +256,29 @@ public:
         return _resumeStart;
     }
 
+    /**
+     * Only download the bytes before end (exclusive), 0 means up to the end of the file.
+     *
+     * The server has to support range requests then: the job fails if it
+     * replies with the whole file.
+     */
+    void setRangeEnd(quint64 end) { _rangeEnd = end; }
+
+    /**
+     * How the body is written to the device, see DownloadSink.
+     *
+     * Default: every piece is written directly.
+     */
+    void setWriteBatching(qint64 batchSize, bool writeInThread)
+    {
+        _writeBatchSize = batchSize;
+        _writeInThread = writeInThread;
+    }
+
+private:
+    /// Writes the rest of the body, returns false while it isn't on disk yet
+    bool flushBody();
+
 private slots:
     void slotReadyRead();
     void slotMetaDataChanged();
@@ -205,6 +305,18 @@ signals:
     |                         checksum differs?                      |
     +-> startDownload() <--------------------------------------------+
         +                                                            |
+        +-> isSegmentedDownloadEnabled()?                            |
+        |   +                                                        |
+        |   +-+ yes +> startSegmentedDownload()                      |
+        |                +                                           |
+        |                +-> run a GETFileJob per range, as slots    |
+        |                    become free                             |
+        |                                                            |
+        |      done?+> slotSegmentFinished()                         |
+        |                +                                           |
+        |                +-> on error: slotGetFinished()             |
+        |                +-> all done: validate checksum header      |
+        |                                                            |
         +-> isZsyncPropagationEnabled()?                             |
             +                                                        |
             +-+ yes +> local file exists?                            |
@@ -231,7 +343,15 @@ signals:
                             +                                        |
                             +-> downloadFinished()                   |
                                    +                                 |
-                +------------------+                                 |
+                                   +-> check for a conflict          |
+                                                                     |
+                  done?+> finalizeDownload()                         |
+                            +                                        |
+                            +-> rename the temporary file            |
+                                                                     |
+                  done?+> downloadFinalized()                        |
+                            +                                        |
+                +-----------+                                        |
                 |                                                    |
                 +-> updateMetadata() <-------------------------------+
 
@@ -251,6 +371,7 @@ public:
         , _deleteExisting(false)
     {
     }
+    ~PropagateDownloadFile();
     void start() Q_DECL_OVERRIDE;
     qint64 committedDiskSpace() const Q_DECL_OVERRIDE;
 
@@ -277,6 +398,15 @@ private slots:
     void startFullDownload();
     /// Called when the GETJob finishes
     void slotGetFinished();
+    /// Called to download the ranges in _segments in parallel
+    void startSegmentedDownload();
+    /// Starts the segments that aren't downloaded yet, as far as there are free slots.
+    /// False if the download failed.
+    bool startPendingSegments();
+    bool startSegment(int index);
+    /// Called when the GETFileJob of the segment at index finishes
+    void slotSegmentFinished(int index);
+    void slotSegmentProgress();
     /// Called when the we have finished getting the zsync metadata file
     void slotZsyncGetMetaFinished(QNetworkReply *reply);
     /// Called when the download's checksum header was validated
@@ -293,6 +423,35 @@ private slots:
 
 private:
     void deleteExistingFolder();
+    void readConflictHeaders(QNetworkReply *reply);
+    void validateTransmissionChecksum(const QByteArray &checksumHeader);
+
+    /// The outcome of the file system work of finalizeDownload()
+    struct FinalizeResult
+    {
+        time_t modtime = 0; // as stored by the file system
+        bool changedSinceDiscovery = false;
+        bool renamed = false; // whether the temporary file was moved in place
+        QString renameError;
+        bool locked = false; // whether the target was locked if the rename failed
+        qint64 size = 0;
+    };
+
+    /// Moves the downloaded file in place on the I/O executor
+    void finalizeDownload(bool isConflict);
+    void downloadFinalized(bool isConflict, const FinalizeResult &result);
+
+    /**
+     * Whether the file is fetched as several ranges over parallel
+     * connections, see SyncOptions::_downloadSegments.
+     */
+    bool isSegmentedDownloadEnabled();
+    /// Sets up _segments and the preallocated temporary file
+    bool prepareSegments();
+    /// Stops all running segment jobs, keeping their progress in _segments
+    void abortSegments();
+    /// Persists the progress in _segments in the journal
+    void saveSegments();
 
     quint64 _resumeStart;
     qint64 _downloadProgress;
@@ -301,6 +460,12 @@ private:
     bool _deleteExisting;
     ConflictRecord _conflictRecord;
 
+    QVector<SyncJournalDb::DownloadSegment> _segments;
+    QVector<QPointer<GETFileJob>> _segmentJobs; // the running job of each segment
+    QByteArray _segmentsChecksumHeader;
+    QElapsedTimer _segmentsSavedTimer;
+    bool _rangesUnsupported = false; // the server ignored a range request
+
     QElapsedTimer _stopwatch;
 };
 }
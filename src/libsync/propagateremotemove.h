@@ -58,6 +58,7 @@ public:
     void start() Q_DECL_OVERRIDE;
     void abort(PropagatorJob::AbortType abortType) Q_DECL_OVERRIDE;
     JobParallelism parallelism() Q_DECL_OVERRIDE { return _item->isDirectory() ? WaitForFinished : FullParallelism; }
+    bool isLikelyFinishedQuickly() Q_DECL_OVERRIDE { return !_item->isDirectory(); }
 
     /**
      * Rename the directory in the selective sync list
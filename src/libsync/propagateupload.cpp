@@ -17,6 +17,7 @@
 #include "owncloudpropagator_p.h"
 #include "networkjobs.h"
 #include "account.h"
+#include "contentencoding.h"
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
 #include "common/utility.h"
@@ -39,6 +40,7 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcPutJob, "sync.networkjob.put", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPollJob, "sync.networkjob.poll", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcCopyJob, "sync.networkjob.copy", QtInfoMsg)
 Q_LOGGING_CATEGORY(lcPropagateUpload, "sync.propagator.upload", QtInfoMsg)
 
 /**
@@ -91,6 +93,38 @@ void PUTFileJob::start()
     AbstractNetworkJob::start();
 }
 
+CopyJob::CopyJob(AccountPtr account, const QString &path, const QString &destination,
+    const QMap<QByteArray, QByteArray> &extraHeaders, QObject *parent)
+    : AbstractNetworkJob(account, path, parent)
+    , _destination(destination)
+    , _extraHeaders(extraHeaders)
+{
+}
+
+void CopyJob::start()
+{
+    QNetworkRequest req;
+    req.setRawHeader("Destination", QUrl::toPercentEncoding(_destination, "/"));
+    for (auto it = _extraHeaders.constBegin(); it != _extraHeaders.constEnd(); ++it) {
+        req.setRawHeader(it.key(), it.value());
+    }
+    sendRequest("COPY", makeDavUrl(path()), req);
+
+    if (reply()->error() != QNetworkReply::NoError) {
+        qCWarning(lcCopyJob) << " Network error: " << reply()->errorString();
+    }
+    AbstractNetworkJob::start();
+}
+
+bool CopyJob::finished()
+{
+    qCInfo(lcCopyJob) << "COPY of" << reply()->request().url() << "FINISHED WITH STATUS"
+                      << replyStatusString();
+
+    emit finishedSignal();
+    return true;
+}
+
 void PollJob::start()
 {
     setTimeout(120 * 1000);
@@ -228,6 +262,7 @@ void PropagateUploadFileCommon::slotComputeContentChecksum()
     // Compute the content checksum.
     auto computeChecksum = new ComputeChecksum(this);
     computeChecksum->setChecksumType(checksumType);
+    computeChecksum->setByteCounter(propagator()->_checksumBytes);
 
     connect(computeChecksum, &ComputeChecksum::done,
         this, &PropagateUploadFileCommon::slotComputeTransmissionChecksum);
@@ -255,6 +290,7 @@ void PropagateUploadFileCommon::slotComputeTransmissionChecksum(const QByteArray
     } else {
         computeChecksum->setChecksumType(QByteArray());
     }
+    computeChecksum->setByteCounter(propagator()->_checksumBytes);
 
     connect(computeChecksum, &ComputeChecksum::done,
         this, &PropagateUploadFileCommon::slotStartUpload);
@@ -306,9 +342,100 @@ void PropagateUploadFileCommon::slotStartUpload(const QByteArray &transmissionCh
         return;
     }
 
+    if (startServerSideCopy())
+        return;
+
     doStartUpload();
 }
 
+bool PropagateUploadFileCommon::startServerSideCopy()
+{
+    // Typically a file that was copied inside the sync folder. Small files
+    // aren't worth the detour.
+    if (_item->_instruction != CSYNC_INSTRUCTION_NEW || _deleteExisting
+        || _item->_size < propagator()->smallFileSize()
+        || !propagator()->account()->capabilities().serverSideCopy()) {
+        return false;
+    }
+
+    // The conflict headers can only be sent along with an upload
+    if (propagator()->_journal->conflictRecord(_item->_file.toUtf8()).isValid())
+        return false;
+
+    // Equal size and checksum must be evidence enough that the content is
+    // the same. Without content checksums this may be the transmission
+    // checksum, only SHA1 and better qualify.
+    if (!parseChecksumHeaderType(_item->_checksumHeader).startsWith("SHA"))
+        return false;
+
+    SyncJournalFileRecord source;
+    const auto ownPath = _item->_file.toUtf8();
+    bool ok = propagator()->_journal->getFileRecordsByChecksum(_item->_checksumHeader,
+        [&](const SyncJournalFileRecord &rec) {
+            if (!source.isValid() && rec._type == ItemTypeFile && rec._path != ownPath
+                && rec._fileSize == _item->_size && !rec._fileId.isEmpty()) {
+                source = rec;
+            }
+        });
+    if (!ok || !source.isValid())
+        return false;
+
+    qCInfo(lcPropagateUpload) << "Server has the content of" << _item->_file << "as" << source._path << "- copying instead of uploading";
+
+    QMap<QByteArray, QByteArray> headers;
+    headers[QByteArrayLiteral("X-OC-Mtime")] = QByteArray::number(qint64(_item->_modtime));
+    // The content on the server must still be the one we know the checksum of
+    headers[QByteArrayLiteral("If-Match")] = '"' + source._etag + '"';
+    headers[QByteArrayLiteral("Overwrite")] = "F";
+
+    const QString destination = QDir::cleanPath(propagator()->account()->davUrl().path()
+        + propagator()->_remoteFolder + _item->_file);
+    auto job = new CopyJob(propagator()->account(),
+        propagator()->_remoteFolder + QString::fromUtf8(source._path), destination, headers, this);
+    _jobs.append(job);
+    connect(job, &CopyJob::finishedSignal, this, &PropagateUploadFileCommon::slotCopyJobFinished);
+    connect(job, &QObject::destroyed, this, &PropagateUploadFileCommon::slotJobDestroyed);
+    propagator()->_activeJobList.append(this);
+    job->start();
+    return true;
+}
+
+void PropagateUploadFileCommon::slotCopyJobFinished()
+{
+    propagator()->_activeJobList.removeOne(this);
+    auto job = qobject_cast<CopyJob *>(sender());
+    slotJobDestroyed(job); // remove it from the _jobs list
+
+    if (_aborting || propagator()->_abortRequested.fetchAndAddRelaxed(0))
+        return;
+
+    const int httpStatus = job->reply()->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const QByteArray fid = job->reply()->rawHeader("OC-FileID");
+    const QByteArray etag = getEtagFromReply(job->reply());
+    if (job->reply()->error() != QNetworkReply::NoError
+        || (httpStatus != 201 && httpStatus != 204)
+        || fid.isEmpty() || etag.isEmpty()) {
+        // The source may be gone or changed, or the server didn't tell us
+        // about the new file: a regular upload takes care of it.
+        qCInfo(lcPropagateUpload) << "Server side copy failed, uploading" << _item->_file << "instead"
+                                  << httpStatus << job->errorString();
+        doStartUpload();
+        return;
+    }
+
+    if (job->reply()->rawHeader("X-OC-MTime") != "accepted") {
+        qCWarning(lcPropagateUpload) << "Server did not accept the X-OC-MTime of the copy" << _item->_file;
+    }
+
+    _item->_httpErrorCode = httpStatus;
+    _item->_responseTimeStamp = job->responseTimestamp();
+    _item->_requestId = job->requestId();
+    _item->_fileId = fid;
+    _item->_etag = etag;
+    _finished = true;
+    finalize();
+}
+
 UploadDevice::UploadDevice(BandwidthManager *bwm)
     : _read(0)
     , _bandwidthManager(bwm)
@@ -330,24 +457,50 @@ UploadDevice::~UploadDevice()
 
 bool UploadDevice::prepareAndOpen(const QString &fileName, qint64 start, qint64 size)
 {
-    _data.clear();
-    _read = 0;
+    return openWithData(readFile(fileName, start, size));
+}
+
+UploadDevice::FileData UploadDevice::readFile(const QString &fileName, qint64 start, qint64 size, bool compress)
+{
+    FileData fileData;
 
     QFile file(fileName);
-    QString openError;
-    if (!FileSystem::openAndSeekFileSharedRead(&file, &openError, start)) {
-        setErrorString(openError);
-        return false;
-    }
+    if (!FileSystem::openAndSeekFileSharedRead(&file, &fileData.error, start))
+        return fileData;
 
     size = qBound(0ll, size, FileSystem::getSize(fileName) - start);
-    _data.resize(size);
-    auto read = file.read(_data.data(), size);
+    fileData.data.resize(size);
+    auto read = file.read(fileData.data.data(), size);
     if (read != size) {
-        setErrorString(file.errorString());
+        fileData.error = file.errorString();
+        fileData.data.clear();
+        return fileData;
+    }
+
+    if (compress && size >= 4 * 1024) {
+        // Only worth it if it saves at least a tenth of the upload
+        auto compressed = ContentEncoding::gzip(fileData.data);
+        if (!compressed.isEmpty() && compressed.size() < size - size / 10) {
+            fileData.data = compressed;
+            fileData.contentEncoding = "gzip";
+        }
+    }
+
+    fileData.ok = true;
+    return fileData;
+}
+
+bool UploadDevice::openWithData(const FileData &fileData)
+{
+    _data.clear();
+    _read = 0;
+
+    if (!fileData.ok) {
+        setErrorString(fileData.error);
         return false;
     }
 
+    _data = fileData.data;
     return QIODevice::open(QIODevice::ReadOnly);
 }
 
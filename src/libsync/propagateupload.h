@@ -16,6 +16,7 @@
 #include "owncloudpropagator.h"
 #include "networkjobs.h"
 #include "propagatecommonzsync.h"
+#include "contentdefinedchunker.h"
 
 #include <QBuffer>
 #include <QFile>
@@ -42,6 +43,29 @@ public:
     /** Reads the data from the file and opens the device */
     bool prepareAndOpen(const QString &fileName, qint64 start, qint64 size);
 
+    /** The file data of the device, see readFile() */
+    struct FileData
+    {
+        bool ok = false;
+        QByteArray data;
+        QString error;
+        // The Content-Encoding of data, empty if it is not compressed
+        QByteArray contentEncoding;
+    };
+
+    /**
+     * Reads the data for prepareAndOpen() or openWithData().
+     *
+     * With compress the data is gzip compressed if that makes it
+     * noticeably smaller.
+     *
+     * Safe to run on the I/O executor.
+     */
+    static FileData readFile(const QString &fileName, qint64 start, qint64 size, bool compress = false);
+
+    /** Opens the device with data from readFile(), false if reading had failed */
+    bool openWithData(const FileData &fileData);
+
     qint64 writeData(const char *, qint64) Q_DECL_OVERRIDE;
     qint64 readData(char *data, qint64 maxlen) Q_DECL_OVERRIDE;
     bool atEnd() const Q_DECL_OVERRIDE;
@@ -148,6 +172,29 @@ signals:
 
 };
 
+/**
+ * @brief Copies a file on the server
+ *
+ * Used instead of an upload when the server already has the content.
+ * @ingroup libsync
+ */
+class CopyJob : public AbstractNetworkJob
+{
+    Q_OBJECT
+    const QString _destination;
+    QMap<QByteArray, QByteArray> _extraHeaders;
+
+public:
+    explicit CopyJob(AccountPtr account, const QString &path, const QString &destination,
+        const QMap<QByteArray, QByteArray> &extraHeaders, QObject *parent = 0);
+
+    void start() Q_DECL_OVERRIDE;
+    bool finished() Q_DECL_OVERRIDE;
+
+signals:
+    void finishedSignal();
+};
+
 /**
  * @brief This job implements the asynchronous PUT
  *
@@ -195,6 +242,8 @@ signals:
  *         |
  *         v
  *    slotStartUpload()  -> doStartUpload()
+ *         |                        .
+ *         +--> startServerSideCopy()  (falls back to doStartUpload())
  *                                  .
  *                                  .
  *                                  v
@@ -245,6 +294,8 @@ private slots:
     void slotComputeTransmissionChecksum(const QByteArray &contentChecksumType, const QByteArray &contentChecksum);
     // transmission checksum computed, prepare the upload
     void slotStartUpload(const QByteArray &transmissionChecksumType, const QByteArray &transmissionChecksum);
+    // the COPY of startServerSideCopy() is done
+    void slotCopyJobFinished();
 
 public:
     virtual void doStartUpload() = 0;
@@ -295,6 +346,15 @@ protected:
 
     // Bases headers that need to be sent with every chunk
     QMap<QByteArray, QByteArray> headers();
+
+private:
+    /**
+     * If the server already has a file with the same content, copy it
+     * there instead of uploading.
+     *
+     * Returns false if that isn't possible and the upload should start.
+     */
+    bool startServerSideCopy();
 };
 
 /**
@@ -363,8 +423,8 @@ private:
 
     /** Amount of data that needs to be sent to the server in bytes.
      *
-     * For normal uploads this will be the file size, for zsync uploads it can
-     * be less.
+     * For normal uploads this will be the file size, for zsync and content
+     * chunked uploads it can be less.
      *
      * This value is intended to be comparable to _sent: it's always the total
      * amount of data that needs to be present at the server to finish the upload -
@@ -378,6 +438,8 @@ private:
     bool _removeJobError = false; /// if not null, there was an error removing the job
     bool _zsyncSupported = false; /// if zsync is supported this will be set to true
     bool _isZsyncMetadataUploadRunning = false; // flag to ensure that zsync metadata upload is complete before job is
+    bool _contentChunking = false; /// if set, only the content-defined chunks the server doesn't have are uploaded
+    ContentDefinedChunker::Chunks _contentChunks; /// the chunks of the local file, recorded in the journal after the upload
 
     // Map chunk number with its size  from the PROPFIND on resume.
     // (Only used from slotPropfindIterate/slotPropfindFinished because the LsColJob use signals to report data.)
@@ -397,6 +459,16 @@ private:
     };
     QVector<UploadRangeInfo> _rangesToUpload;
 
+    // Chunks the server copies from the version of the file that is replaced,
+    // they are sent before the ranges that need uploading.
+    struct ChunkReference
+    {
+        quint64 offset;
+        quint64 sourceOffset;
+        quint64 size;
+    };
+    QVector<ChunkReference> _chunkReferences;
+
     /**
      * Return the URL of a chunk.
      * If chunkOffset == -1, returns the URL of the parent folder containing the chunks
@@ -411,6 +483,12 @@ private:
      */
     bool markRangeAsDone(quint64 start, quint64 size);
 
+    /** Removes the chunk reference of exactly that offset and size, if there is one */
+    bool markReferenceAsDone(quint64 offset, quint64 size);
+
+    /** The path of the file on the server, as used for the MOVE destination */
+    QString remoteFilePath() const;
+
 public:
     PropagateUploadFileNG(OwncloudPropagator *propagator, const SyncFileItemPtr &item)
         : PropagateUploadFileCommon(propagator, item)
@@ -423,7 +501,12 @@ public:
 private:
     void doStartUploadNext();
     void startNewUpload();
+    /// Called with the content-defined chunks of the local file, if enabled
+    void startContentChunkedUpload(const ContentDefinedChunker::Result &result);
     void startNextChunk();
+    void startChunkReference();
+    /// Called when the data of the chunk started by startNextChunk() was read
+    void startChunkUpload(const QString &fileName, const UploadDevice::FileData &fileData);
     void doFinalMove();
 public slots:
     void abort(AbortType abortType) Q_DECL_OVERRIDE;
@@ -434,6 +517,7 @@ private slots:
     void slotDeleteJobFinished();
     void slotMkColFinished(QNetworkReply::NetworkError);
     void slotPutFinished();
+    void slotChunkReferenceFinished(QNetworkReply *reply);
     void slotZsyncGetMetaFinished(QNetworkReply *reply);
     void slotZsyncSeedFinished(void *zs);
     void slotZsyncSeedFailed(const QString &errorString);
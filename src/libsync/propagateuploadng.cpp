@@ -21,6 +21,7 @@ extern "C" {
 #include "owncloudpropagator_p.h"
 #include "networkjobs.h"
 #include "account.h"
+#include "contentencoding.h"
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
 #include "common/utility.h"
@@ -218,6 +219,15 @@ void PropagateUploadFileNG::doStartUpload()
         return;
     }
 
+    _contentChunking = !_zsyncSupported && isContentChunkingEnabled(propagator(), _item);
+    if (_contentChunking) {
+        const QString fileName = propagator()->getFilePath(_item->_file);
+        propagator()->_ioExecutor.run(this,
+            [fileName] { return ContentDefinedChunker().chunkFile(fileName); },
+            [this](const ContentDefinedChunker::Result &result) { startContentChunkedUpload(result); });
+        return;
+    }
+
     UploadRangeInfo rangeinfo = { 0, _item->_size };
     _rangesToUpload.append(rangeinfo);
     _bytesToUpload = _item->_size;
@@ -250,6 +260,70 @@ void PropagateUploadFileNG::slotZsyncGetMetaFinished(QNetworkReply *reply)
     QThreadPool::globalInstance()->start(run);
 }
 
+void PropagateUploadFileNG::startContentChunkedUpload(const ContentDefinedChunker::Result &result)
+{
+    if (_aborting || propagator()->_abortRequested.fetchAndAddRelaxed(0)) {
+        propagator()->_activeJobList.removeOne(this);
+        return;
+    }
+
+    _rangesToUpload.clear();
+    _chunkReferences.clear();
+    if (!result.errorString.isEmpty()) {
+        // The upload of the whole file will run into the same error and handle it
+        qCWarning(lcPropagateUpload) << "Could not chunk" << _item->_file << result.errorString;
+        _contentChunking = false;
+        UploadRangeInfo rangeinfo = { 0, _item->_size };
+        _rangesToUpload.append(rangeinfo);
+        _bytesToUpload = _item->_size;
+        doStartUploadNext();
+        return;
+    }
+    _contentChunks = result.chunks;
+
+    // The server still has the chunks of the last upload if the file wasn't
+    // changed since. The If header of the chunk references makes sure of that.
+    QHash<QByteArray, SyncJournalDb::ContentChunk> serverChunks;
+    QByteArray serverEtag;
+    const auto storedChunks = propagator()->_journal->getContentChunks(_item->_file, &serverEtag);
+    if (serverEtag == _item->_etag && headers().contains(QByteArrayLiteral("If-Match"))) {
+        for (const auto &chunk : storedChunks) {
+            if (!serverChunks.contains(chunk._hash))
+                serverChunks.insert(chunk._hash, chunk);
+        }
+    }
+
+    _bytesToUpload = 0;
+    for (const auto &chunk : _contentChunks) {
+        const quint64 offset = chunk._offset;
+        const quint64 size = chunk._size;
+        auto serverChunk = serverChunks.constFind(chunk._hash);
+        if (serverChunk != serverChunks.constEnd() && serverChunk->_size == chunk._size) {
+            const quint64 sourceOffset = serverChunk->_offset;
+            if (!_chunkReferences.isEmpty() && _chunkReferences.last().offset + _chunkReferences.last().size == offset
+                && _chunkReferences.last().sourceOffset + _chunkReferences.last().size == sourceOffset) {
+                _chunkReferences.last().size += size;
+            } else {
+                _chunkReferences.append({ offset, sourceOffset, size });
+            }
+        } else {
+            if (!_rangesToUpload.isEmpty() && _rangesToUpload.last().end() == offset) {
+                _rangesToUpload.last().size += size;
+            } else {
+                _rangesToUpload.append({ offset, size });
+            }
+            _bytesToUpload += size;
+        }
+    }
+
+    qCInfo(lcPropagateUpload) << "Content chunked" << _item->_file << "into" << _contentChunks.size() << "chunks,"
+                              << _bytesToUpload << "of" << _item->_size << "bytes need uploading,"
+                              << _chunkReferences.size() << "chunk references";
+    propagator()->reportFileTotal(*_item, _bytesToUpload);
+
+    doStartUploadNext();
+}
+
 void PropagateUploadFileNG::doStartUploadNext()
 {
     if (_zsyncSupported) {
@@ -306,6 +380,17 @@ void PropagateUploadFileNG::slotPropfindIterate(const QString &name, const QMap<
 }
 
 
+bool PropagateUploadFileNG::markReferenceAsDone(quint64 offset, quint64 size)
+{
+    for (auto iter = _chunkReferences.begin(); iter != _chunkReferences.end(); ++iter) {
+        if (iter->offset == offset && iter->size == size) {
+            _chunkReferences.erase(iter);
+            return true;
+        }
+    }
+    return false;
+}
+
 bool PropagateUploadFileNG::markRangeAsDone(quint64 start, quint64 size)
 {
     bool found = false;
@@ -340,6 +425,9 @@ void PropagateUploadFileNG::slotPropfindFinished()
             qCDebug(lcPropagateUpload) << "Reusing existing data:" << chunkOffset << chunkSize;
             _sent += chunkSize;
             _serverChunks.remove(chunkOffset);
+        } else if (markReferenceAsDone(chunkOffset, chunkSize)) {
+            qCDebug(lcPropagateUpload) << "Reusing existing chunk reference:" << chunkOffset << chunkSize;
+            _serverChunks.remove(chunkOffset);
         } else {
             qCDebug(lcPropagateUpload) << "Discarding existing data:" << chunkOffset << chunkSize;
         }
@@ -499,8 +587,7 @@ void PropagateUploadFileNG::doFinalMove()
     _finished = true;
 
     // Finish with a MOVE
-    QString destination = QDir::cleanPath(propagator()->account()->url().path() + QLatin1Char('/')
-        + propagator()->account()->davPath() + propagator()->_remoteFolder + _item->_file);
+    QString destination = remoteFilePath();
     auto headers = PropagateUploadFileCommon::headers();
 
     // "If-Match applies to the source, but we are interested in comparing the etag of the destination
@@ -511,7 +598,8 @@ void PropagateUploadFileNG::doFinalMove()
     if (!_transmissionChecksumHeader.isEmpty()) {
         headers[checkSumHeaderC] = _transmissionChecksumHeader;
     }
-    headers[QByteArrayLiteral("OC-Total-Length")] = QByteArray::number(_bytesToUpload);
+    // The chunk references are part of the chunks the server assembles
+    headers[QByteArrayLiteral("OC-Total-Length")] = QByteArray::number(_contentChunking ? _item->_size : _bytesToUpload);
     headers[QByteArrayLiteral("OC-Total-File-Length")] = QByteArray::number(_item->_size);
 
     QUrl source = _zsyncSupported ? Utility::concatUrlPath(chunkUrl(), QStringLiteral("/.file.zsync")) : Utility::concatUrlPath(chunkUrl(), QStringLiteral("/.file"));
@@ -533,6 +621,11 @@ void PropagateUploadFileNG::startNextChunk()
 
     ENFORCE(_bytesToUpload >= _sent, "Sent data exceeds file size");
 
+    if (!_chunkReferences.isEmpty()) {
+        startChunkReference();
+        return;
+    }
+
     // All ranges complete!
     if (_rangesToUpload.isEmpty()) {
         doFinalMove();
@@ -542,11 +635,90 @@ void PropagateUploadFileNG::startNextChunk()
     _currentChunkOffset = _rangesToUpload.first().start;
     _currentChunkSize = qMin(propagator()->_chunkSize, _rangesToUpload.first().size);
 
-    auto device = std::unique_ptr<UploadDevice>(new UploadDevice(&propagator()->_bandwidthManager));
     const QString fileName = propagator()->getFilePath(_item->_file);
+    const qint64 offset = _currentChunkOffset;
+    const qint64 size = _currentChunkSize;
+    const bool compress = propagator()->account()->capabilities().gzipUploads()
+        && ContentEncoding::isLikelyCompressible(fileName);
+
+    // The chunk is read (and compressed) on the I/O executor, the job is active meanwhile
+    propagator()->_activeJobList.append(this);
+    propagator()->_ioExecutor.run(this,
+        [fileName, offset, size, compress] { return UploadDevice::readFile(fileName, offset, size, compress); },
+        [this, fileName](const UploadDevice::FileData &fileData) { startChunkUpload(fileName, fileData); });
+}
+
+void PropagateUploadFileNG::startChunkReference()
+{
+    const auto &reference = _chunkReferences.first();
+
+    // The chunk is created from a byte range of the file on the server,
+    // as long as the file has the expected etag
+    const QByteArray source = QUrl::toPercentEncoding(remoteFilePath(), "/");
+    QNetworkRequest req;
+    req.setRawHeader("OC-Chunk-Offset", QByteArray::number(reference.offset));
+    req.setRawHeader("OC-Chunk-Source", source);
+    req.setRawHeader("OC-Chunk-Source-Range", "bytes=" + QByteArray::number(reference.sourceOffset)
+            + "-" + QByteArray::number(reference.sourceOffset + reference.size - 1));
+    req.setRawHeader("If", "<" + source + "> ([" + headers().value(QByteArrayLiteral("If-Match")) + "])");
+
+    propagator()->_activeJobList.append(this);
+    auto job = propagator()->account()->sendRequest("PUT", chunkUrl(reference.offset), req);
+    _jobs.append(job);
+    connect(job, &SimpleNetworkJob::finishedSignal, this, &PropagateUploadFileNG::slotChunkReferenceFinished);
+    connect(job, &QObject::destroyed, this, &PropagateUploadFileCommon::slotJobDestroyed);
+}
+
+void PropagateUploadFileNG::slotChunkReferenceFinished(QNetworkReply *reply)
+{
+    auto job = qobject_cast<SimpleNetworkJob *>(sender());
+    ASSERT(job);
+    slotJobDestroyed(job); // remove it from the _jobs list
+    propagator()->_activeJobList.removeOne(this);
+
+    if (_finished) {
+        return;
+    }
+
+    QNetworkReply::NetworkError err = reply->error();
+    if (err != QNetworkReply::NoError) {
+        const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        SyncFileItem::Status status = classifyError(err, httpStatus, &propagator()->_anotherSyncNeeded);
+        if (status == SyncFileItem::FatalError) {
+            _item->_requestId = job->requestId();
+            abortWithError(status, job->errorStringParsingBody());
+            return;
+        }
+
+        // The server can't provide the data (most likely the file changed),
+        // upload what is left of it instead
+        qCWarning(lcPropagateUpload) << "Chunk reference failed, uploading the data instead:" << _item->_file
+                                     << httpStatus << job->errorString();
+        propagator()->_journal->setContentChunks(_item->_file, QByteArray(), {});
+        for (const auto &reference : _chunkReferences) {
+            _rangesToUpload.append({ reference.offset, reference.size });
+            _bytesToUpload += reference.size;
+        }
+        _chunkReferences.clear();
+        propagator()->reportFileTotal(*_item, _bytesToUpload);
+    } else {
+        _chunkReferences.removeFirst();
+    }
+
+    startNextChunk();
+}
 
-    if (!device->prepareAndOpen(fileName, _currentChunkOffset, _currentChunkSize)) {
+void PropagateUploadFileNG::startChunkUpload(const QString &fileName, const UploadDevice::FileData &fileData)
+{
+    if (_aborting || propagator()->_abortRequested.fetchAndAddRelaxed(0)) {
+        propagator()->_activeJobList.removeOne(this);
+        return;
+    }
+
+    auto device = std::unique_ptr<UploadDevice>(new UploadDevice(&propagator()->_bandwidthManager));
+    if (!device->openWithData(fileData)) {
         qCWarning(lcPropagateUpload) << "Could not prepare upload device: " << device->errorString();
+        propagator()->_activeJobList.removeOne(this);
 
         // If the file is currently locked, we want to retry the sync
         // when it becomes available again.
@@ -560,6 +732,8 @@ void PropagateUploadFileNG::startNextChunk()
 
     QMap<QByteArray, QByteArray> headers;
     headers["OC-Chunk-Offset"] = QByteArray::number(_currentChunkOffset);
+    if (!fileData.contentEncoding.isEmpty())
+        headers["Content-Encoding"] = fileData.contentEncoding;
 
     QUrl url = chunkUrl(_currentChunkOffset);
 
@@ -568,13 +742,20 @@ void PropagateUploadFileNG::startNextChunk()
     PUTFileJob *job = new PUTFileJob(propagator()->account(), url, std::move(device), headers, 0, this);
     _jobs.append(job);
     connect(job, &PUTFileJob::finishedSignal, this, &PropagateUploadFileNG::slotPutFinished);
-    connect(job, &PUTFileJob::uploadProgress,
-        this, &PropagateUploadFileNG::slotUploadProgress);
+    if (fileData.contentEncoding.isEmpty()) {
+        connect(job, &PUTFileJob::uploadProgress,
+            this, &PropagateUploadFileNG::slotUploadProgress);
+    } else {
+        // The progress is that of the compressed body, scale it to the chunk
+        const qint64 chunkSize = _currentChunkSize;
+        connect(job, &PUTFileJob::uploadProgress, this, [this, chunkSize](qint64 sent, qint64 total) {
+            slotUploadProgress(total > 0 ? sent * chunkSize / total : sent, total);
+        });
+    }
     connect(job, &PUTFileJob::uploadProgress,
         devicePtr, &UploadDevice::slotJobUploadProgress);
     connect(job, &QObject::destroyed, this, &PropagateUploadFileCommon::slotJobDestroyed);
     job->start();
-    propagator()->_activeJobList.append(this);
 }
 
 void PropagateUploadFileNG::slotZsyncGenerationFinished(const QString &generatedFileName)
@@ -768,9 +949,19 @@ void PropagateUploadFileNG::slotMoveJobFinished()
         abortWithError(SyncFileItem::NormalError, tr("Missing ETag from server"));
         return;
     }
+    if (_contentChunking) {
+        // The next upload of this version only needs to send the chunks that changed
+        propagator()->_journal->setContentChunks(_item->_file, _item->_etag, _contentChunks);
+    }
     finalize();
 }
 
+QString PropagateUploadFileNG::remoteFilePath() const
+{
+    return QDir::cleanPath(propagator()->account()->url().path() + QLatin1Char('/')
+        + propagator()->account()->davPath() + propagator()->_remoteFolder + _item->_file);
+}
+
 void PropagateUploadFileNG::slotUploadProgress(qint64 sent, qint64 total)
 {
     // Completion is signaled with sent=0, total=0; avoid accidentally
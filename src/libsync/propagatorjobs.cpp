@@ -44,46 +44,35 @@ QByteArray localFileIdFromFullId(const QByteArray &id)
     return id.left(8);
 }
 
-/**
- * The code will update the database in case of error.
- * If everything goes well (no error, returns true), the caller is responsible for removing the entries
- * in the database.  But in case of error, we need to remove the entries from the database of the files
- * that were deleted.
- *
- * \a path is relative to propagator()->_localDir + _item->_file and should start with a slash
- */
-bool PropagateLocalRemove::removeRecursively(const QString &path)
+PropagateLocalRemove::RemoveResult PropagateLocalRemove::removeLocal(const QString &filename, bool moveToTrash, bool isDirectory)
 {
-    auto folderDir = propagator()->_localDir;
-    QString absolute = folderDir + _item->_file + path;
-    QStringList errors;
-    QList<QPair<QString, bool>> deleted;
-    bool success = FileSystem::removeRecursively(
-        absolute,
-        [this, &deleted](const QString &path, bool isDir) {
-            // by prepending, a folder deletion may be followed by content deletions
-            deleted.prepend(qMakePair(path, isDir));
-        },
-        &errors);
-
-    if (!success) {
-        // We need to delete the entries from the database now from the deleted vector.
-        // Do it while avoiding redundant delete calls to the journal.
-        QString deletedDir;
-        foreach (const auto &it, deleted) {
-            if (!it.first.startsWith(folderDir))
-                continue;
-            if (!deletedDir.isEmpty() && it.first.startsWith(deletedDir))
-                continue;
-            if (it.second) {
-                deletedDir = it.first;
-            }
-            propagator()->_journal->deleteFileRecord(it.first.mid(folderDir.size()), it.second);
+    RemoveResult result;
+    if (moveToTrash) {
+        if ((QDir(filename).exists() || FileSystem::fileExists(filename))
+            && !FileSystem::moveToTrash(filename, &result.error)) {
+            result.success = false;
+        }
+    } else if (isDirectory) {
+        if (QDir(filename).exists()) {
+            QStringList errors;
+            result.success = FileSystem::removeRecursively(
+                filename,
+                [&result](const QString &path, bool isDir) {
+                    // by prepending, a folder deletion may be followed by content deletions
+                    result.deleted.prepend(qMakePair(path, isDir));
+                },
+                &errors);
+            result.error = errors.join(", ");
+        }
+    } else {
+        if (FileSystem::fileExists(filename)
+            && !FileSystem::remove(filename, &result.error)) {
+            result.success = false;
         }
-
-        _error = errors.join(", ");
     }
-    return success;
+    if (result.success)
+        result.deleted.clear();
+    return result;
 }
 
 void PropagateLocalRemove::start()
@@ -101,27 +90,36 @@ void PropagateLocalRemove::start()
         return;
     }
 
-    QString removeError;
-    if (_moveToTrash) {
-        if ((QDir(filename).exists() || FileSystem::fileExists(filename))
-            && !FileSystem::moveToTrash(filename, &removeError)) {
-            done(SyncFileItem::NormalError, removeError);
-            return;
-        }
-    } else {
-        if (_item->isDirectory()) {
-            if (QDir(filename).exists() && !removeRecursively(QString())) {
-                done(SyncFileItem::NormalError, _error);
-                return;
-            }
-        } else {
-            if (FileSystem::fileExists(filename)
-                && !FileSystem::remove(filename, &removeError)) {
-                done(SyncFileItem::NormalError, removeError);
-                return;
+    const bool moveToTrash = _moveToTrash;
+    const bool isDirectory = _item->isDirectory();
+    propagator()->_ioExecutor.run(this,
+        [filename, moveToTrash, isDirectory] { return removeLocal(filename, moveToTrash, isDirectory); },
+        [this](const RemoveResult &result) { removeFinished(result); });
+}
+
+void PropagateLocalRemove::removeFinished(const RemoveResult &result)
+{
+    if (!result.success) {
+        // If everything goes well, removing the entry of the item removes the entries
+        // of its contents too. But if the recursive removal failed half way, the entries
+        // of the files that were deleted need to be removed now.
+        // Do it while avoiding redundant delete calls to the journal.
+        const auto folderDir = propagator()->_localDir;
+        QString deletedDir;
+        foreach (const auto &it, result.deleted) {
+            if (!it.first.startsWith(folderDir))
+                continue;
+            if (!deletedDir.isEmpty() && it.first.startsWith(deletedDir))
+                continue;
+            if (it.second) {
+                deletedDir = it.first;
             }
+            propagator()->_journal->deleteFileRecord(it.first.mid(folderDir.size()), it.second);
         }
+        done(SyncFileItem::NormalError, result.error);
+        return;
     }
+
     propagator()->reportProgress(*_item, 0);
     propagator()->_journal->deleteFileRecord(_item->_originalFile, _item->isDirectory());
     propagator()->_journal->commit("Local remove");
@@ -137,18 +135,10 @@ void PropagateLocalMkdir::start()
     QString newDirStr = QDir::toNativeSeparators(newDir.path());
 
     // When turning something that used to be a file into a directory
-    // we need to delete the file first.
-    QFileInfo fi(newDirStr);
-    if (fi.exists() && fi.isFile()) {
-        if (_deleteExistingFile) {
-            QString removeError;
-            if (!FileSystem::remove(newDirStr, &removeError)) {
-                done(SyncFileItem::NormalError,
-                    tr("could not delete file %1, error: %2")
-                        .arg(newDirStr, removeError));
-                return;
-            }
-        } else if (_item->_instruction == CSYNC_INSTRUCTION_CONFLICT) {
+    // we need to move it away first, see below for the deletion.
+    if (!_deleteExistingFile && _item->_instruction == CSYNC_INSTRUCTION_CONFLICT) {
+        QFileInfo fi(newDirStr);
+        if (fi.exists() && fi.isFile()) {
             QString error;
             if (!propagator()->createConflict(_item, _associatedComposite, &error)) {
                 done(SyncFileItem::SoftError, error);
@@ -163,8 +153,40 @@ void PropagateLocalMkdir::start()
         return;
     }
     emit propagator()->touchedFile(newDirStr);
-    QDir localDir(propagator()->_localDir);
-    if (!localDir.mkpath(_item->_file)) {
+
+    struct MkdirResult
+    {
+        QString removeError;
+        bool created = false;
+    };
+    const QString localDir = propagator()->_localDir;
+    const QString file = _item->_file;
+    const bool deleteExistingFile = _deleteExistingFile;
+    propagator()->_ioExecutor.run(this,
+        [newDirStr, localDir, file, deleteExistingFile] {
+            MkdirResult result;
+            QFileInfo fi(newDirStr);
+            if (deleteExistingFile && fi.exists() && fi.isFile()
+                && !FileSystem::remove(newDirStr, &result.removeError)) {
+                return result;
+            }
+            result.created = QDir(localDir).mkpath(file);
+            return result;
+        },
+        [this, newDirStr](const MkdirResult &result) {
+            mkdirFinished(newDirStr, result.removeError, result.created);
+        });
+}
+
+void PropagateLocalMkdir::mkdirFinished(const QString &newDirStr, const QString &removeError, bool created)
+{
+    if (!removeError.isEmpty()) {
+        done(SyncFileItem::NormalError,
+            tr("could not delete file %1, error: %2")
+                .arg(newDirStr, removeError));
+        return;
+    }
+    if (!created) {
         done(SyncFileItem::NormalError, tr("could not create folder %1").arg(newDirStr));
         return;
     }
@@ -223,13 +245,28 @@ void PropagateLocalRename::start()
 
         emit propagator()->touchedFile(existingFile);
         emit propagator()->touchedFile(targetFile);
-        QString renameError;
-        if (!FileSystem::rename(existingFile, targetFile, &renameError)) {
-            done(SyncFileItem::NormalError, renameError);
-            return;
-        }
+        propagator()->_ioExecutor.run(this,
+            [existingFile, targetFile] {
+                QString renameError;
+                if (!FileSystem::rename(existingFile, targetFile, &renameError) && renameError.isEmpty())
+                    renameError = tr("Could not rename %1").arg(QDir::toNativeSeparators(existingFile));
+                return renameError;
+            },
+            [this, targetFile](const QString &renameError) {
+                if (!renameError.isEmpty()) {
+                    done(SyncFileItem::NormalError, renameError);
+                    return;
+                }
+                updateMetadata(targetFile);
+            });
+        return;
     }
 
+    updateMetadata(targetFile);
+}
+
+void PropagateLocalRename::updateMetadata(const QString &targetFile)
+{
     SyncJournalFileRecord oldRecord;
     propagator()->_journal->getFileRecord(_item->_originalFile, &oldRecord);
     propagator()->_journal->deleteFileRecord(_item->_originalFile);
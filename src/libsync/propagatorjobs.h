@@ -42,8 +42,18 @@ public:
     void start() Q_DECL_OVERRIDE;
 
 private:
-    bool removeRecursively(const QString &path);
-    QString _error;
+    struct RemoveResult
+    {
+        bool success = true;
+        QString error;
+        // What was deleted before a recursive removal failed, parents first
+        QList<QPair<QString, bool>> deleted;
+    };
+
+    /** Does the file system work of start(), runs on the I/O executor */
+    static RemoveResult removeLocal(const QString &filename, bool moveToTrash, bool isDirectory);
+    void removeFinished(const RemoveResult &result);
+
     bool _moveToTrash;
 };
 
@@ -71,6 +81,8 @@ public:
     void setDeleteExistingFile(bool enabled);
 
 private:
+    void mkdirFinished(const QString &newDirStr, const QString &removeError, bool created);
+
     bool _deleteExistingFile;
 };
 
@@ -88,5 +100,8 @@ public:
     }
     void start() Q_DECL_OVERRIDE;
     JobParallelism parallelism() Q_DECL_OVERRIDE { return _item->isDirectory() ? WaitForFinished : FullParallelism; }
+
+private:
+    void updateMetadata(const QString &targetFile);
 };
 }
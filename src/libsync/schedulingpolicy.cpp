@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "schedulingpolicy.h"
+#include "owncloudpropagator.h"
+
+#include <QLoggingCategory>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcSchedulingPolicy, "sync.schedulingpolicy", QtInfoMsg)
+
+SchedulingPolicy::~SchedulingPolicy()
+{
+}
+
+bool TreeOrderSchedulingPolicy::mayStartAnyJob(OwncloudPropagator *propagator)
+{
+    int activeCount = 0;
+    int likelyFinishedQuicklyCount = 0;
+    foreach (PropagateItemJob *job, propagator->scheduledActiveJobs()) {
+        activeCount++;
+        if (job->isLikelyFinishedQuickly())
+            likelyFinishedQuicklyCount++;
+    }
+    if (activeCount - likelyFinishedQuicklyCount >= propagator->maximumActiveTransferJob())
+        return false;
+    if (activeCount >= propagator->maximumActiveTransferJob())
+        qCDebug(lcSchedulingPolicy) << "Can pump in another request! activeJobs =" << activeCount;
+    return true;
+}
+
+bool TreeOrderSchedulingPolicy::mayStartJob(OwncloudPropagator *, PropagatorJob *)
+{
+    return true;
+}
+
+SmallFilesFirstSchedulingPolicy::SmallFilesFirstSchedulingPolicy(quint64 largeFileSize)
+    : _largeFileSize(largeFileSize)
+{
+}
+
+bool SmallFilesFirstSchedulingPolicy::mayStartAnyJob(OwncloudPropagator *)
+{
+    // Even with all transfer slots in use there may be small files queued
+    return true;
+}
+
+bool SmallFilesFirstSchedulingPolicy::mayStartJob(OwncloudPropagator *propagator, PropagatorJob *job)
+{
+    // Directories are started so their contents can be searched
+    if (!qobject_cast<PropagateItemJob *>(job) || job->isLikelyFinishedQuickly())
+        return true;
+
+    int transferCount = 0;
+    int largeTransferCount = 0;
+    foreach (PropagateItemJob *activeJob, propagator->scheduledActiveJobs()) {
+        if (activeJob->isLikelyFinishedQuickly())
+            continue;
+        transferCount++;
+        if (isLargeTransfer(activeJob))
+            largeTransferCount++;
+    }
+    if (transferCount >= propagator->maximumActiveTransferJob())
+        return false;
+
+    // Keep a transfer slot for the files that are neither small nor large
+    if (isLargeTransfer(job)
+        && largeTransferCount >= qMax(1, propagator->maximumActiveTransferJob() - 1)) {
+        return false;
+    }
+    return true;
+}
+
+bool SmallFilesFirstSchedulingPolicy::isLargeTransfer(PropagatorJob *job) const
+{
+    auto itemJob = qobject_cast<PropagateItemJob *>(job);
+    if (!itemJob || itemJob->_item->isDirectory())
+        return false;
+    return itemJob->_item->_size >= _largeFileSize && !job->isLikelyFinishedQuickly();
+}
+}
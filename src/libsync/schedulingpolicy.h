@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QtGlobal>
+
+namespace OCC {
+
+class OwncloudPropagator;
+class PropagatorJob;
+
+/**
+ * @brief Decides which of the queued propagation jobs may start
+ *
+ * OwncloudPropagator::scheduleNextJobImpl() asks the policy whether it
+ * should look for a job at all and then searches the job tree in sync
+ * order. Jobs that mayStartJob() holds back stay queued and the jobs
+ * after them may start instead, except where the ordering is required:
+ * nothing overtakes a job that must finish before the next ones start,
+ * and the contents of a directory still wait for the directory itself.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT SchedulingPolicy
+{
+public:
+    virtual ~SchedulingPolicy();
+
+    /** Whether the job tree should be searched for a job to start.
+     *
+     * Only called while fewer than hardMaximumActiveJob() jobs are active.
+     */
+    virtual bool mayStartAnyJob(OwncloudPropagator *propagator) = 0;
+
+    /** Whether the queued job may start now, for jobs that are found
+     * while searching the job tree.
+     */
+    virtual bool mayStartJob(OwncloudPropagator *propagator, PropagatorJob *job) = 0;
+};
+
+/**
+ * @brief Starts the jobs strictly in the order of the sync tree
+ *
+ * Jobs that are likely finished quickly, like deletes, moves and small
+ * transfers, mostly wait for round trips: they may use all the slots up to
+ * hardMaximumActiveJob(), while the other jobs are limited to
+ * maximumActiveTransferJob(). Once these are busy, nothing starts until one
+ * of them finished, even if small files are queued behind a large one.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT TreeOrderSchedulingPolicy : public SchedulingPolicy
+{
+public:
+    bool mayStartAnyJob(OwncloudPropagator *propagator) Q_DECL_OVERRIDE;
+    bool mayStartJob(OwncloudPropagator *propagator, PropagatorJob *job) Q_DECL_OVERRIDE;
+};
+
+/**
+ * @brief Lets small files overtake the large transfers
+ *
+ * Jobs that are likely finished quickly always start while there is a free
+ * slot. Larger transfers are held back while maximumActiveTransferJob() of
+ * them are running, and the files of at least largeFileSize bytes get only
+ * part of these slots, so a single huge upload neither blocks the small
+ * documents queued behind it nor the medium sized files.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT SmallFilesFirstSchedulingPolicy : public SchedulingPolicy
+{
+public:
+    explicit SmallFilesFirstSchedulingPolicy(quint64 largeFileSize);
+
+    bool mayStartAnyJob(OwncloudPropagator *propagator) Q_DECL_OVERRIDE;
+    bool mayStartJob(OwncloudPropagator *propagator, PropagatorJob *job) Q_DECL_OVERRIDE;
+
+private:
+    bool isLargeTransfer(PropagatorJob *job) const;
+
+    quint64 _largeFileSize;
+};
+}
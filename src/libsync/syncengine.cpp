@@ -27,6 +27,7 @@
 #include "propagatedownload.h"
 #include "common/asserts.h"
 #include "discovery.h"
+#include "tracelog.h"
 
 #ifdef Q_OS_WIN
 #include <windows.h>
@@ -57,7 +58,6 @@ namespace OCC {
 Q_LOGGING_CATEGORY(lcEngine, "sync.engine", QtInfoMsg)
 
 static const int s_touchedFilesMaxAgeMs = 15 * 1000;
-bool SyncEngine::s_anySyncRunning = false;
 
 qint64 SyncEngine::minimumFileAgeForUpload = 2000;
 
@@ -383,14 +383,18 @@ void SyncEngine::startSync()
         }
     }
 
-    if (s_anySyncRunning || _syncRunning) {
+    if (_syncRunning) {
         ASSERT(false);
         return;
     }
 
-    s_anySyncRunning = true;
     _syncRunning = true;
     _anotherSyncNeeded = NoFollowUpSync;
+    _metrics.start();
+    _journalStatisticsAtStart = _journal->queryStatistics();
+    // A new counter, computations of the previous sync may still be running
+    _checksumBytes.reset(new std::atomic<quint64>(0));
+    _connectionStatisticsAtStart = AccessManager::connectionStatistics();
     _clearTouchedFilesTimer.stop();
 
     _hasNoneFiles = false;
@@ -498,6 +502,8 @@ void SyncEngine::startSync()
     _discoveryPhase->_localDir = _localPath;
     _discoveryPhase->_remoteFolder = _remotePath;
     _discoveryPhase->_syncOptions = _syncOptions;
+    _discoveryPhase->_metrics = &_metrics;
+    _discoveryPhase->_checksumBytes = _checksumBytes;
     _discoveryPhase->_shouldDiscoverLocaly = [this](const QString &s) { return shouldDiscoverLocally(s); };
     _discoveryPhase->_selectiveSyncBlackList = selectiveSyncBlackList;
     _discoveryPhase->_selectiveSyncWhiteList = _journal->getSelectiveSyncList(SyncJournalDb::SelectiveSyncWhiteList, &ok);
@@ -579,7 +585,10 @@ void SyncEngine::slotDiscoveryJobFinished()
         return;
     }
 
-    qCInfo(lcEngine) << "#### Discovery end #################################################### " << _stopWatch.addLapTime(QLatin1String("Discovery Finished")) << "ms";
+    const quint64 discoveryTime = _stopWatch.addLapTime(QLatin1String("Discovery Finished"));
+    _metrics.endPhase(SyncMetrics::Discovery);
+    qCInfo(lcEngine) << "#### Discovery end #################################################### " << discoveryTime << "ms";
+    TraceLog::instance()->event("sync.discovery", _localPath, QByteArray(), _syncItems.size(), qint64(discoveryTime));
 
     // Sanity check
     if (!_journal->isConnected()) {
@@ -656,6 +665,10 @@ void SyncEngine::slotDiscoveryJobFinished()
     _propagator = QSharedPointer<OwncloudPropagator>(
         new OwncloudPropagator(_account, _localPath, _remotePath, _journal));
     _propagator->setSyncOptions(_syncOptions);
+    _propagator->_metrics = &_metrics;
+    _propagator->_networkJobBudget = _networkJobBudget;
+    _propagator->_bandwidthManager.setSharedBuckets(_uploadBucket, _downloadBucket);
+    _propagator->_checksumBytes = _checksumBytes;
     connect(_propagator.data(), &OwncloudPropagator::itemCompleted,
         this, &SyncEngine::slotItemCompleted);
     connect(_propagator.data(), &OwncloudPropagator::progress,
@@ -671,6 +684,8 @@ void SyncEngine::slotDiscoveryJobFinished()
 
     // apply the network limits to the propagator
     setNetworkLimits(_uploadLimit, _downloadLimit);
+    setBandwidthSchedule(_bandwidthSchedule);
+    _propagator->_bandwidthManager.reloadLimits();
 
     deleteStaleDownloadInfos(_syncItems);
     deleteStaleUploadInfos(_syncItems);
@@ -681,6 +696,7 @@ void SyncEngine::slotDiscoveryJobFinished()
     if (_needsUpdate)
         emit(started());
 
+    _metrics.endPhase(SyncMetrics::Reconcile);
     _propagator->start(_syncItems);
     _syncItems.clear();
 
@@ -712,6 +728,18 @@ void SyncEngine::setNetworkLimits(int upload, int download)
     }
 }
 
+void SyncEngine::setBandwidthSchedule(const BandwidthSchedule &schedule)
+{
+    _bandwidthSchedule = schedule;
+
+    if (!_propagator)
+        return;
+
+    _propagator->_bandwidthSchedule = schedule;
+    if (!schedule.isEmpty())
+        qCInfo(lcEngine) << "Bandwidth schedule with" << schedule.rules().size() << "rules";
+}
+
 void SyncEngine::slotItemCompleted(const SyncFileItemPtr &item)
 {
     _progressInfo->setProgressComplete(*item);
@@ -745,20 +773,26 @@ void SyncEngine::slotFinished(bool success)
     _progressInfo->_status = ProgressInfo::Done;
     emit transmissionProgress(*_progressInfo);
 
+    _metrics.endPhase(SyncMetrics::Propagation);
     finalize(success);
 }
 
 void SyncEngine::finalize(bool success)
 {
+    _metrics.setJournalStatistics(_journalStatisticsAtStart, _journal->queryStatistics());
+    _metrics.setChecksumBytes(_checksumBytes ? _checksumBytes->load() : 0);
+    _metrics.setConnectionStatistics(_connectionStatisticsAtStart, AccessManager::connectionStatistics());
     _journal->close();
 
-    qCInfo(lcEngine) << "Sync run took " << _stopWatch.addLapTime(QLatin1String("Sync Finished")) << "ms";
+    const quint64 syncTime = _stopWatch.addLapTime(QLatin1String("Sync Finished"));
+    _metrics.finish(success);
+    qCInfo(lcEngine) << "Sync run took " << syncTime << "ms";
+    TraceLog::instance()->event("sync.finished", _localPath, success ? "success" : "failure", -1, qint64(syncTime));
     _stopWatch.stop();
 
     if (_discoveryPhase) {
         _discoveryPhase.take()->deleteLater();
     }
-    s_anySyncRunning = false;
     _syncRunning = false;
     emit finished(success);
 
@@ -938,6 +972,40 @@ void SyncEngine::abort()
     }
 }
 
+bool SyncEngine::downloadVirtualFileNow(const SyncJournalFileRecord &record)
+{
+    // Without a running propagation the next sync downloads it
+    if (!_syncRunning || !_propagator)
+        return false;
+
+    auto item = SyncFileItem::fromSyncJournalFileRecord(record);
+    auto suffix = _syncOptions._virtualFileSuffix;
+    if (item->_file.endsWith(suffix))
+        item->_file.chop(suffix.size());
+    item->_type = ItemTypeVirtualFileDownload;
+    item->_direction = SyncFileItem::Down;
+    item->_instruction = CSYNC_INSTRUCTION_NEW;
+
+    // The run has a job for the virtual file itself, leave it to the next sync
+    if (_propagator->hasJobFor(QString::fromUtf8(record._path)))
+        return false;
+
+    switch (_propagator->startInteractively(item->_file)) {
+    case PropagatorJob::Started:
+        return true;
+    case PropagatorJob::CannotStartYet:
+        return false;
+    case PropagatorJob::NotInPropagation:
+        break;
+    }
+
+    if (!_propagator->addInteractiveJob(item))
+        return false;
+    qCInfo(lcEngine) << "Downloading virtual file" << item->_file << "ahead of the queued jobs";
+    _progressInfo->adjustTotalsForFile(*item);
+    return true;
+}
+
 void SyncEngine::slotSummaryError(const QString &message)
 {
     if (_uniqueErrors.contains(message))
@@ -32,6 +32,8 @@
 #include "syncfilestatustracker.h"
 #include "accountfwd.h"
 #include "discoveryphase.h"
+#include "syncmetrics.h"
+#include "bandwidthschedule.h"
 #include "common/checksums.h"
 
 class QProcess;
@@ -41,6 +43,8 @@ namespace OCC {
 class SyncJournalFileRecord;
 class SyncJournalDb;
 class OwncloudPropagator;
+class NetworkJobBudget;
+class BandwidthBucket;
 class ProcessDirectoryJob;
 
 enum AnotherSyncNeeded {
@@ -63,19 +67,42 @@ public:
 
     Q_INVOKABLE void startSync();
     void setNetworkLimits(int upload, int download);
+    /** The limits of the schedule replace the network limits while one of its rules applies */
+    void setBandwidthSchedule(const BandwidthSchedule &schedule);
 
     /* Abort the sync.  Called from the main thread */
     void abort();
 
+    /**
+     * Downloads the virtual file of the db record right away, ahead of the
+     * queued jobs of the running propagation.
+     *
+     * Returns false if that's not possible, for example because no
+     * propagation is running. The next sync downloads it then.
+     */
+    bool downloadVirtualFileNow(const SyncJournalFileRecord &record);
+
     bool isSyncRunning() const { return _syncRunning; }
 
     SyncOptions syncOptions() const { return _syncOptions; }
     void setSyncOptions(const SyncOptions &options) { _syncOptions = options; }
+
+    /** The network job budget shared with the other folders' engines, may be null */
+    void setNetworkJobBudget(NetworkJobBudget *budget) { _networkJobBudget = budget; }
+    /** The buckets of the absolute network limits shared with the other folders' engines, may be null */
+    void setBandwidthBuckets(BandwidthBucket *upload, BandwidthBucket *download)
+    {
+        _uploadBucket = upload;
+        _downloadBucket = download;
+    }
     bool ignoreHiddenFiles() const { return _ignore_hidden_files; }
     void setIgnoreHiddenFiles(bool ignore) { _ignore_hidden_files = ignore; }
 
     ExcludedFiles &excludedFiles() { return *_excludedFiles; }
     Utility::StopWatch &stopWatch() { return _stopWatch; }
+
+    /** Metrics of the current or last sync run, complete once finished() was emitted */
+    const SyncMetrics &metrics() const { return _metrics; }
     SyncFileStatusTracker &syncFileStatusTracker() { return *_syncFileStatusTracker; }
 
     /* Returns whether another sync is needed to complete the sync */
@@ -206,8 +233,6 @@ private:
     // cleanup and emit the finished signal
     void finalize(bool success);
 
-    static bool s_anySyncRunning; //true when one sync is running somewhere (for debugging)
-
     // Must only be acessed during update and reconcile
     QVector<SyncFileItemPtr> _syncItems;
 
@@ -229,6 +254,13 @@ private:
     QScopedPointer<ExcludedFiles> _excludedFiles;
     QScopedPointer<SyncFileStatusTracker> _syncFileStatusTracker;
     Utility::StopWatch _stopWatch;
+    SyncMetrics _metrics;
+    NetworkJobBudget *_networkJobBudget = nullptr;
+    BandwidthBucket *_uploadBucket = nullptr;
+    BandwidthBucket *_downloadBucket = nullptr;
+    SqlDatabase::Statistics _journalStatisticsAtStart;
+    ChecksumByteCounter _checksumBytes; // of the current sync
+    AccessManager::ConnectionStatistics _connectionStatisticsAtStart;
 
     /**
      * check if we are allowed to propagate everything, and if we are not, adjust the instructions
@@ -254,6 +286,7 @@ private:
 
     int _uploadLimit;
     int _downloadLimit;
+    BandwidthSchedule _bandwidthSchedule;
 
     SyncOptions _syncOptions;
 
@@ -26,6 +26,9 @@ namespace OCC {
 
 Q_LOGGING_CATEGORY(lcStatusTracker, "sync.statustracker", QtInfoMsg)
 
+// Start over rather than growing without bounds, entries are refilled on demand
+static const int statusIndexMaxSize = 1000 * 1000;
+
 static int pathCompare( const QString& lhs, const QString& rhs )
 {
     // Should match Utility::fsCasePreserving, we want don't want to pay for the runtime check on every comparison.
@@ -119,6 +122,8 @@ SyncFileStatusTracker::SyncFileStatusTracker(SyncEngine *syncEngine)
     connect(syncEngine, &SyncEngine::finished, this, &SyncFileStatusTracker::slotSyncFinished);
     connect(syncEngine, &SyncEngine::started, this, &SyncFileStatusTracker::slotSyncEngineRunningChanged);
     connect(syncEngine, &SyncEngine::finished, this, &SyncFileStatusTracker::slotSyncEngineRunningChanged);
+    connect(&syncEngine->excludedFiles(), &ExcludedFiles::excludesChanged,
+        this, &SyncFileStatusTracker::slotExcludesChanged);
 }
 
 SyncFileStatus SyncFileStatusTracker::fileStatus(const QString &relativePath)
@@ -136,25 +141,100 @@ SyncFileStatus SyncFileStatusTracker::fileStatus(const QString &relativePath)
     // update the exclude list at runtime and doing it statically here removes
     // our ability to notify changes through the fileStatusChanged signal,
     // it's an acceptable compromize to treat all exclude types the same.
-    if (_syncEngine->excludedFiles().isExcluded(_syncEngine->localPath() + relativePath,
-            _syncEngine->localPath(),
-            _syncEngine->ignoreHiddenFiles())) {
+    if (_syncEngine->ignoreHiddenFiles() != _excludedCacheIgnoreHidden) {
+        _excludedCache.clear();
+        _excludedCacheIgnoreHidden = _syncEngine->ignoreHiddenFiles();
+    }
+    auto excludedIt = _excludedCache.constFind(relativePath);
+    if (excludedIt == _excludedCache.constEnd()) {
+        if (_excludedCache.size() >= statusIndexMaxSize)
+            _excludedCache.clear();
+        excludedIt = _excludedCache.insert(relativePath,
+            _syncEngine->excludedFiles().isExcluded(_syncEngine->localPath() + relativePath,
+                _syncEngine->localPath(),
+                _excludedCacheIgnoreHidden));
+    }
+    if (*excludedIt) {
         return SyncFileStatus(SyncFileStatus::StatusWarning);
     }
 
     if (_dirtyPaths.contains(relativePath))
         return SyncFileStatus::StatusSync;
 
-    // First look it up in the database to know if it's shared
-    SyncJournalFileRecord rec;
-    if (_syncEngine->journal()->getFileRecord(relativePath, &rec) && rec.isValid()) {
-        return resolveSyncAndErrorStatus(relativePath, rec._remotePerm.hasPermission(RemotePermissions::IsShared) ? Shared : NotShared);
+    // First look it up in the index or the database to know if it's shared
+    const qint64 phash = SyncJournalDb::getPHash(relativePath.toUtf8());
+    auto it = _statusIndex.constFind(phash);
+    if (it == _statusIndex.constEnd()) {
+        SyncJournalFileRecord rec;
+        if (!_syncEngine->journal()->getFileRecord(relativePath, &rec)) {
+            // Don't remember database errors
+            return resolveSyncAndErrorStatus(relativePath, NotShared, PathUnknown);
+        }
+        if (_statusIndex.size() >= statusIndexMaxSize)
+            _statusIndex.clear();
+        quint8 flags = NotInJournal;
+        if (rec.isValid())
+            flags = rec._remotePerm.hasPermission(RemotePermissions::IsShared) ? SharedInJournal : InJournal;
+        it = _statusIndex.insert(phash, flags);
     }
 
+    if (*it != NotInJournal)
+        return resolveSyncAndErrorStatus(relativePath, *it == SharedInJournal ? Shared : NotShared);
+
     // Must be a new file not yet in the database, check if it's syncing or has an error.
     return resolveSyncAndErrorStatus(relativePath, NotShared, PathUnknown);
 }
 
+void SyncFileStatusTracker::prefetchDirectory(const QString &relativeDir, const QStringList &childNames)
+{
+    ASSERT(!relativeDir.endsWith(QLatin1Char('/')));
+    const QString prefix = relativeDir.isEmpty() ? QString() : relativeDir + QLatin1Char('/');
+
+    if (_statusIndex.size() + childNames.size() >= statusIndexMaxSize)
+        _statusIndex.clear();
+
+    // Everything the journal doesn't know is a new file
+    QHash<qint64, quint8> children;
+    children.reserve(childNames.size());
+    for (const auto &name : childNames)
+        children.insert(SyncJournalDb::getPHash((prefix + name).toUtf8()), NotInJournal);
+
+    bool ok = _syncEngine->journal()->listFilesInPath(relativeDir.toUtf8(), [&](const SyncJournalFileRecord &rec) {
+        auto it = children.find(SyncJournalDb::getPHash(rec._path));
+        if (it != children.end())
+            *it = rec._remotePerm.hasPermission(RemotePermissions::IsShared) ? SharedInJournal : InJournal;
+    });
+    if (!ok)
+        return;
+
+    for (auto it = children.constBegin(); it != children.constEnd(); ++it)
+        _statusIndex.insert(it.key(), it.value());
+}
+
+void SyncFileStatusTracker::updateStatusIndex(const SyncFileItem &item, bool completed)
+{
+    if (item.isDirectory()
+        && (item._instruction == CSYNC_INSTRUCTION_REMOVE || item._instruction == CSYNC_INSTRUCTION_RENAME)) {
+        // The entries of all the children are affected, don't bother finding them
+        _statusIndex.clear();
+        return;
+    }
+
+    _statusIndex.remove(SyncJournalDb::getPHash(item._file.toUtf8()));
+    const qint64 phash = SyncJournalDb::getPHash(item.destination().toUtf8());
+    _statusIndex.remove(phash);
+
+    const quint8 sharedFlags = item._remotePerm.hasPermission(RemotePermissions::IsShared) ? SharedInJournal : InJournal;
+    if (!completed) {
+        // Only untouched items keep their journal entry for sure, the others
+        // are looked up again until they are done
+        if (item._instruction == CSYNC_INSTRUCTION_NONE)
+            _statusIndex.insert(phash, sharedFlags);
+    } else if (item._status == SyncFileItem::Success) {
+        _statusIndex.insert(phash, item._instruction == CSYNC_INSTRUCTION_REMOVE ? NotInJournal : sharedFlags);
+    }
+}
+
 void SyncFileStatusTracker::slotPathTouched(const QString &fileName)
 {
     QString folderPath = _syncEngine->localPath();
@@ -162,6 +242,8 @@ void SyncFileStatusTracker::slotPathTouched(const QString &fileName)
     ASSERT(fileName.startsWith(folderPath));
     QString localPath = fileName.mid(folderPath.size());
     _dirtyPaths.insert(localPath);
+    // It might have become hidden or changed its type
+    _excludedCache.remove(localPath);
 
     emit fileStatusChanged(fileName, SyncFileStatus::StatusSync);
 }
@@ -219,6 +301,7 @@ void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
     foreach (const SyncFileItemPtr &item, items) {
         qCDebug(lcStatusTracker) << "Investigating" << item->destination() << item->_status << item->_instruction;
         _dirtyPaths.remove(item->destination());
+        updateStatusIndex(*item, false);
 
         if (showErrorInSocketApi(*item)) {
             _syncProblems[item->_file] = SyncFileStatus::StatusError;
@@ -263,6 +346,7 @@ void SyncFileStatusTracker::slotAboutToPropagate(SyncFileItemVector &items)
 void SyncFileStatusTracker::slotItemCompleted(const SyncFileItemPtr &item)
 {
     qCDebug(lcStatusTracker) << "Item completed" << item->destination() << item->_status << item->_instruction;
+    updateStatusIndex(*item, true);
 
     if (showErrorInSocketApi(*item)) {
         _syncProblems[item->_file] = SyncFileStatus::StatusError;
@@ -294,6 +378,11 @@ void SyncFileStatusTracker::slotSyncFinished()
         emit fileStatusChanged(getSystemDestination(it.key()), fileStatus(it.key()));
 }
 
+void SyncFileStatusTracker::slotExcludesChanged()
+{
+    _excludedCache.clear();
+}
+
 void SyncFileStatusTracker::slotSyncEngineRunningChanged()
 {
     emit fileStatusChanged(getSystemDestination(QString()), resolveSyncAndErrorStatus(QString(), NotShared));
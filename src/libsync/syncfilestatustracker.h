@@ -21,6 +21,7 @@
 #include "syncfilestatus.h"
 #include <map>
 #include <QSet>
+#include <QStringList>
 
 namespace OCC {
 
@@ -38,6 +39,15 @@ public:
     explicit SyncFileStatusTracker(SyncEngine *syncEngine);
     SyncFileStatus fileStatus(const QString &relativePath);
 
+    /**
+     * Loads the status index entries of the given children of relativeDir
+     * with a single journal query.
+     *
+     * Meant to be called before asking fileStatus() for all files of a
+     * directory, as a file manager does when it opens one.
+     */
+    void prefetchDirectory(const QString &relativeDir, const QStringList &childNames);
+
 public slots:
     void slotPathTouched(const QString &fileName);
 
@@ -49,6 +59,7 @@ private slots:
     void slotItemCompleted(const SyncFileItemPtr &item);
     void slotSyncFinished();
     void slotSyncEngineRunningChanged();
+    void slotExcludesChanged();
 
 private:
     struct PathComparator {
@@ -65,6 +76,7 @@ private:
     SyncFileStatus resolveSyncAndErrorStatus(const QString &relativePath, SharedFlag sharedState, PathKnownFlag isPathKnown = PathKnown);
 
     void invalidateParentPaths(const QString &path);
+    void updateStatusIndex(const SyncFileItem &item, bool completed);
     QString getSystemDestination(const QString &relativePath);
     void incSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedState);
     void decSyncCountAndEmitStatusChanged(const QString &relativePath, SharedFlag sharedState);
@@ -77,6 +89,20 @@ private:
     // We'll show a file/directory as SYNC as long as its sync count is > 0.
     // A directory that starts/ends propagation will in turn increase/decrease its own parent by 1.
     QHash<QString, int> _syncCount;
+
+    // What fileStatus() would otherwise have to look up in the journal for every call,
+    // by path hash (see SyncJournalDb::getPHash). No entry means not looked up yet.
+    enum StatusIndexFlag : quint8 {
+        NotInJournal = 0,
+        InJournal = 1,
+        SharedInJournal = 2
+    };
+    QHash<qint64, quint8> _statusIndex;
+
+    // Verdicts of ExcludedFiles::isExcluded() by relative path, as that needs
+    // the regex engine and a look at the file system.
+    QHash<QString, bool> _excludedCache;
+    bool _excludedCacheIgnoreHidden = false;
 };
 }
 
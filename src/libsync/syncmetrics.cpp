@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "syncmetrics.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QSaveFile>
+
+#include <algorithm>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcMetrics, "sync.metrics", QtInfoMsg)
+
+const QVector<qint64> &LatencyHistogram::bucketUpperBounds()
+{
+    static const QVector<qint64> bounds = { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000 };
+    return bounds;
+}
+
+LatencyHistogram::LatencyHistogram()
+    : _buckets(bucketUpperBounds().size() + 1, 0)
+{
+}
+
+void LatencyHistogram::add(qint64 msecs)
+{
+    const auto &bounds = bucketUpperBounds();
+    auto it = std::lower_bound(bounds.begin(), bounds.end(), msecs);
+    _buckets[int(it - bounds.begin())]++;
+    _count++;
+    _totalMsecs += msecs;
+    _maxMsecs = qMax(_maxMsecs, msecs);
+}
+
+quint64 LatencyHistogram::bucketCount(qint64 upperBound) const
+{
+    if (upperBound < 0)
+        return _buckets.last();
+    int index = bucketUpperBounds().indexOf(upperBound);
+    return index < 0 ? 0 : _buckets[index];
+}
+
+QJsonObject LatencyHistogram::toJson() const
+{
+    const auto &bounds = bucketUpperBounds();
+    QJsonArray buckets;
+    for (int i = 0; i < _buckets.size(); ++i) {
+        QJsonObject bucket;
+        bucket.insert(QStringLiteral("le"), i < bounds.size() ? QJsonValue(double(bounds[i])) : QJsonValue(QStringLiteral("inf")));
+        bucket.insert(QStringLiteral("count"), double(_buckets[i]));
+        buckets.append(bucket);
+    }
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("count"), double(_count));
+    obj.insert(QStringLiteral("totalMsecs"), double(_totalMsecs));
+    obj.insert(QStringLiteral("maxMsecs"), double(_maxMsecs));
+    obj.insert(QStringLiteral("buckets"), buckets);
+    return obj;
+}
+
+void SyncMetrics::start()
+{
+    *this = SyncMetrics();
+    _timer.start();
+}
+
+void SyncMetrics::endPhase(Phase phase)
+{
+    if (!_timer.isValid())
+        return;
+    const qint64 now = _timer.elapsed();
+    _phaseMsecs[phase] = now - _phaseStart;
+    _phaseStart = now;
+}
+
+void SyncMetrics::finish(bool success)
+{
+    if (!_timer.isValid())
+        return;
+    _totalMsecs = _timer.elapsed();
+    _success = success;
+}
+
+void SyncMetrics::addPropfind(qint64 msecs, bool success)
+{
+    _propfindLatency.add(msecs);
+    if (!success)
+        _propfindErrors++;
+}
+
+void SyncMetrics::addTransfer(const QByteArray &jobType, qint64 bytes, qint64 msecs)
+{
+    auto &transfers = _transfers[jobType];
+    transfers._count++;
+    transfers._bytes += bytes;
+    transfers._msecs += msecs;
+}
+
+void SyncMetrics::setJournalStatistics(const SqlDatabase::Statistics &begin, const SqlDatabase::Statistics &end)
+{
+    // The journal reopens its database between syncs, in which case the
+    // counters restart from zero
+    if (end._queryCount < begin._queryCount) {
+        _journal = end;
+        return;
+    }
+    _journal._queryCount = end._queryCount - begin._queryCount;
+    _journal._rowCount = end._rowCount - begin._rowCount;
+    _journal._queryTimeNs = end._queryTimeNs - begin._queryTimeNs;
+}
+
+void SyncMetrics::setConnectionStatistics(const AccessManager::ConnectionStatistics &begin, const AccessManager::ConnectionStatistics &end)
+{
+    _connections._requests = end._requests - begin._requests;
+    _connections._tlsHandshakes = end._tlsHandshakes - begin._tlsHandshakes;
+    _connections._tlsHandshakesWithTicket = end._tlsHandshakesWithTicket - begin._tlsHandshakesWithTicket;
+}
+
+QJsonObject SyncMetrics::toJson() const
+{
+    QJsonObject phases;
+    phases.insert(QStringLiteral("discovery"), double(_phaseMsecs[Discovery]));
+    phases.insert(QStringLiteral("reconcile"), double(_phaseMsecs[Reconcile]));
+    phases.insert(QStringLiteral("propagation"), double(_phaseMsecs[Propagation]));
+    phases.insert(QStringLiteral("total"), double(_totalMsecs));
+
+    QJsonObject propfind = _propfindLatency.toJson();
+    propfind.insert(QStringLiteral("errors"), double(_propfindErrors));
+
+    QJsonObject journal;
+    journal.insert(QStringLiteral("queries"), double(_journal._queryCount));
+    journal.insert(QStringLiteral("rows"), double(_journal._rowCount));
+    journal.insert(QStringLiteral("msecs"), double(_journal._queryTimeNs / 1000000));
+
+    QJsonObject connections;
+    connections.insert(QStringLiteral("requests"), double(_connections._requests));
+    connections.insert(QStringLiteral("tlsHandshakes"), double(_connections._tlsHandshakes));
+    connections.insert(QStringLiteral("tlsHandshakesWithTicket"), double(_connections._tlsHandshakesWithTicket));
+
+    QJsonObject transfers;
+    for (auto it = _transfers.constBegin(); it != _transfers.constEnd(); ++it) {
+        QJsonObject job;
+        job.insert(QStringLiteral("count"), double(it->_count));
+        job.insert(QStringLiteral("bytes"), double(it->_bytes));
+        job.insert(QStringLiteral("msecs"), double(it->_msecs));
+        transfers.insert(QString::fromUtf8(it.key()), job);
+    }
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("success"), _success);
+    obj.insert(QStringLiteral("phaseMsecs"), phases);
+    obj.insert(QStringLiteral("propfind"), propfind);
+    obj.insert(QStringLiteral("journal"), journal);
+    obj.insert(QStringLiteral("checksumBytes"), double(_checksumBytes));
+    obj.insert(QStringLiteral("connections"), connections);
+    obj.insert(QStringLiteral("jobs"), transfers);
+    return obj;
+}
+
+bool SyncMetrics::writeJson(const QString &fileName) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcMetrics) << "Could not open" << fileName << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(toJson()).toJson());
+    if (!file.commit()) {
+        qCWarning(lcMetrics) << "Could not write" << fileName << file.errorString();
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef SYNCMETRICS_H
+#define SYNCMETRICS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMap>
+#include <QString>
+#include <QVector>
+
+#include "owncloudlib.h"
+#include "common/ownsql.h"
+#include "accessmanager.h"
+
+namespace OCC {
+
+/**
+ * @brief Latency histogram with fixed millisecond buckets
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void add(qint64 msecs);
+
+    quint64 count() const { return _count; }
+    qint64 totalMsecs() const { return _totalMsecs; }
+    qint64 maxMsecs() const { return _maxMsecs; }
+
+    /** Number of samples in the bucket with the given upper bound, -1 for the overflow bucket */
+    quint64 bucketCount(qint64 upperBound) const;
+
+    QJsonObject toJson() const;
+
+    static const QVector<qint64> &bucketUpperBounds();
+
+private:
+    QVector<quint64> _buckets; // one per upper bound plus the overflow bucket
+    quint64 _count = 0;
+    qint64 _totalMsecs = 0;
+    qint64 _maxMsecs = 0;
+};
+
+/**
+ * @brief Counters and timings collected during one sync run
+ *
+ * Owned by the SyncEngine and reset at the start of every sync. The discovery
+ * phase and the propagator record into it; everything happens on the thread
+ * of the SyncEngine so there is no locking.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT SyncMetrics
+{
+public:
+    enum Phase {
+        Discovery,
+        Reconcile,
+        Propagation
+    };
+
+    struct Transfers
+    {
+        quint64 _count = 0;
+        qint64 _bytes = 0;
+        qint64 _msecs = 0;
+    };
+
+    /** Clears all values and starts timing the discovery phase */
+    void start();
+
+    /** Ends the given phase; the next phase starts now */
+    void endPhase(Phase phase);
+
+    /** Stops the total timer, remaining phases keep their value */
+    void finish(bool success);
+
+    void addPropfind(qint64 msecs, bool success);
+    void addTransfer(const QByteArray &jobType, qint64 bytes, qint64 msecs);
+    void setJournalStatistics(const SqlDatabase::Statistics &begin, const SqlDatabase::Statistics &end);
+    void setChecksumBytes(quint64 bytes) { _checksumBytes = bytes; }
+    void setConnectionStatistics(const AccessManager::ConnectionStatistics &begin, const AccessManager::ConnectionStatistics &end);
+
+    qint64 phaseMsecs(Phase phase) const { return _phaseMsecs[phase]; }
+    qint64 totalMsecs() const { return _totalMsecs; }
+    quint64 propfindErrors() const { return _propfindErrors; }
+    const LatencyHistogram &propfindLatency() const { return _propfindLatency; }
+    const SqlDatabase::Statistics &journalStatistics() const { return _journal; }
+    quint64 checksumBytes() const { return _checksumBytes; }
+    const AccessManager::ConnectionStatistics &connectionStatistics() const { return _connections; }
+    const QMap<QByteArray, Transfers> &transfers() const { return _transfers; }
+
+    QJsonObject toJson() const;
+
+    /** Writes toJson() to fileName, replacing an existing file */
+    bool writeJson(const QString &fileName) const;
+
+private:
+    QElapsedTimer _timer;
+    qint64 _phaseStart = 0;
+    qint64 _phaseMsecs[Propagation + 1] = {};
+    qint64 _totalMsecs = 0;
+    bool _success = false;
+
+    quint64 _propfindErrors = 0;
+    LatencyHistogram _propfindLatency;
+
+    SqlDatabase::Statistics _journal;
+    quint64 _checksumBytes = 0;
+
+    // Of all the AccessManagers, other syncs running at the same time count too
+    AccessManager::ConnectionStatistics _connections;
+
+    QMap<QByteArray, Transfers> _transfers; // by job class name
+};
+}
+
+#endif // SYNCMETRICS_H
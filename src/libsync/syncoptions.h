@@ -69,6 +69,36 @@ struct SyncOptions
 
     /** What the minimum file size (in Bytes) is for delta-synchronization */
     quint64 _deltaSyncMinFileSize = 0;
+
+    /** Whether files with a new mtime but the same size are checksummed during
+     * discovery, so that files that were only touched are not uploaded again */
+    bool _checksumTouchedFiles = false;
+
+    /** The maximum number of files checksummed in parallel for _checksumTouchedFiles */
+    int _touchedFilesChecksumThreads = 2;
+
+    /** The number of ranges that are downloaded in parallel for large files,
+     * 1 disables segmented downloads */
+    int _downloadSegments = 1;
+
+    /** What the minimum file size (in Bytes) is for segmented downloads */
+    quint64 _segmentedDownloadMinFileSize = 100 * 1000 * 1000; // 100MB
+
+    /** Downloaded data is written to disk in batches of this many bytes,
+     * 0 writes every piece as it arrives from the network */
+    qint64 _downloadWriteBatchSize = 1024 * 1024; // 1MiB
+
+    /** Whether downloaded data is written to disk from a worker thread */
+    bool _downloadWriteThread = false;
+
+    /** Whether small files may overtake the large transfers, see
+     * SmallFilesFirstSchedulingPolicy. Otherwise the jobs start in the
+     * order of the sync tree. */
+    bool _smallFilesFirst = false;
+
+    /** What the minimum file size (in Bytes) is for a transfer to only get
+     * part of the transfer slots with _smallFilesFirst */
+    quint64 _largeFileSize = 100 * 1000 * 1000; // 100MB
 };
 
 
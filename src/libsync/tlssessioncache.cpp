@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "tlssessioncache.h"
+#include "configfile.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QUrl>
+
+namespace OCC {
+
+Q_LOGGING_CATEGORY(lcTlsSessionCache, "sync.tlssessioncache", QtInfoMsg)
+
+// Used when the server doesn't hint at the lifetime, and the upper bound otherwise
+static const int defaultLifetimeSecs = 60 * 60;
+static const int maximumLifetimeSecs = 24 * 60 * 60;
+
+// Servers that aren't used anymore are dropped once their tickets expired,
+// this only bounds the file in between
+static const int maximumEntries = 100;
+
+TlsSessionCache *TlsSessionCache::instance()
+{
+    static TlsSessionCache cache(ConfigFile().configPath() + QLatin1String("tls_sessions.json"));
+    return &cache;
+}
+
+TlsSessionCache::TlsSessionCache(const QString &fileName)
+    : _fileName(fileName)
+{
+}
+
+QString TlsSessionCache::key(const QUrl &url, const QString &identity)
+{
+    return url.host().toLower() + QLatin1Char(':') + QString::number(url.port(443))
+        + QLatin1Char(' ') + identity;
+}
+
+QByteArray TlsSessionCache::ticket(const QUrl &url, const QString &identity)
+{
+    QMutexLocker locker(&_mutex);
+    load();
+    auto it = _entries.constFind(key(url, identity));
+    if (it == _entries.constEnd() || it->_expires < QDateTime::currentDateTimeUtc())
+        return QByteArray();
+    return it->_ticket;
+}
+
+void TlsSessionCache::storeTicket(const QUrl &url, const QString &identity, const QByteArray &ticket, int lifetimeHintSecs)
+{
+    if (ticket.isEmpty())
+        return;
+
+    QMutexLocker locker(&_mutex);
+    load();
+    Entry &entry = _entries[key(url, identity)];
+    if (entry._ticket == ticket)
+        return;
+    entry._ticket = ticket;
+    int lifetime = lifetimeHintSecs > 0 ? qMin(lifetimeHintSecs, maximumLifetimeSecs) : defaultLifetimeSecs;
+    entry._expires = QDateTime::currentDateTimeUtc().addSecs(lifetime);
+    save();
+}
+
+void TlsSessionCache::load()
+{
+    if (_loaded)
+        return;
+    _loaded = true;
+
+    QFile file(_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    const QJsonObject hosts = QJsonDocument::fromJson(file.readAll()).object();
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    for (auto it = hosts.constBegin(); it != hosts.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        Entry entry;
+        entry._ticket = QByteArray::fromBase64(obj.value(QStringLiteral("ticket")).toString().toLatin1());
+        entry._expires = QDateTime::fromMSecsSinceEpoch(qint64(obj.value(QStringLiteral("expires")).toDouble()), Qt::UTC);
+        if (!entry._ticket.isEmpty() && entry._expires > now)
+            _entries.insert(it.key(), entry);
+    }
+    qCInfo(lcTlsSessionCache) << "Loaded" << _entries.count() << "TLS session tickets";
+}
+
+void TlsSessionCache::save()
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    for (auto it = _entries.begin(); it != _entries.end();) {
+        if (it->_expires < now) {
+            it = _entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (_entries.count() > maximumEntries) {
+        auto oldest = _entries.begin();
+        for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+            if (it->_expires < oldest->_expires)
+                oldest = it;
+        }
+        _entries.erase(oldest);
+    }
+
+    QJsonObject hosts;
+    for (auto it = _entries.constBegin(); it != _entries.constEnd(); ++it) {
+        QJsonObject obj;
+        obj.insert(QStringLiteral("ticket"), QString::fromLatin1(it->_ticket.toBase64()));
+        obj.insert(QStringLiteral("expires"), double(it->_expires.toMSecsSinceEpoch()));
+        hosts.insert(it.key(), obj);
+    }
+
+    // The tickets allow resuming the sessions, keep them private like the cookies
+    QSaveFile file(_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcTlsSessionCache) << "Could not open" << _fileName << file.errorString();
+        return;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    file.write(QJsonDocument(hosts).toJson(QJsonDocument::Compact));
+    if (!file.commit())
+        qCWarning(lcTlsSessionCache) << "Could not write" << _fileName << file.errorString();
+}
+}
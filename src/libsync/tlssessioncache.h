@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#pragma once
+
+#include "owncloudlib.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+class QUrl;
+
+namespace OCC {
+
+/**
+ * @brief Keeps TLS session tickets across network access managers and restarts
+ *
+ * The accounts, the updater and the other helpers each have their own
+ * AccessManager and thus their own connections. With the ticket of an
+ * earlier connection to the same server a new connection resumes the TLS
+ * session instead of doing a full handshake, which saves a round trip and
+ * the certificate exchange. The tickets are stored in the config directory,
+ * so the first requests after a restart can resume as well.
+ *
+ * AccessManager offers the cached ticket to new connections and stores the
+ * tickets it gets back, it may do so from any thread.
+ *
+ * A resumed session keeps the identity of the connection that created it.
+ * The tickets are therefore only shared between connections with the same
+ * identity, the account and the client certificate they use, see
+ * AccessManager::setAccount().
+ *
+ * The tickets contain the session secrets. Like the cookies, which grant
+ * access to the account as well, they are stored in a file that only the
+ * user can read. A ticket is used for at most a day, and only with the
+ * server and the identity it came from, which has to accept it again.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT TlsSessionCache
+{
+public:
+    /** The cache stored in ConfigFile::configPath() */
+    static TlsSessionCache *instance();
+
+    explicit TlsSessionCache(const QString &fileName);
+
+    /** The ticket for the url's host and port and the identity, empty if there is none or it expired */
+    QByteArray ticket(const QUrl &url, const QString &identity);
+
+    /** Remembers the ticket the server sent on a connection to url
+     *
+     * lifetimeHintSecs is the server's hint on how long the ticket may be
+     * used, 0 if it didn't give one.
+     */
+    void storeTicket(const QUrl &url, const QString &identity, const QByteArray &ticket, int lifetimeHintSecs);
+
+private:
+    struct Entry
+    {
+        QByteArray _ticket;
+        QDateTime _expires;
+    };
+
+    static QString key(const QUrl &url, const QString &identity);
+    void load();
+    void save();
+
+    QMutex _mutex;
+    QString _fileName;
+    QHash<QString, Entry> _entries;
+    bool _loaded = false;
+};
+}
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "tracelog.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <chrono>
+
+namespace OCC {
+
+// Note: nothing in here may use the logging macros, the Qt message
+// handler calls into TraceLog.
+
+const char TraceLog::magic[8] = { 'O', 'C', 'T', 'R', 'A', 'C', 'E', '1' };
+
+static const int defaultCapacity = 64 * 1024;
+
+// Wake the writer once this many records are pending; otherwise it
+// wakes up on its own every writerIntervalMs.
+static const int writerBatchSize = 4096;
+static const unsigned long writerIntervalMs = 500;
+
+static const char *msgTypeString(quint8 type)
+{
+    switch (type) {
+    case QtDebugMsg:
+        return "debug";
+    case QtInfoMsg:
+        return "info";
+    case QtWarningMsg:
+        return "warning";
+    case QtCriticalMsg:
+        return "critical";
+    case QtFatalMsg:
+        return "fatal";
+    }
+    return "unknown";
+}
+
+QString TraceRecord::toText() const
+{
+    QString text = QDateTime::fromMSecsSinceEpoch(_timestamp / 1000).toString(QStringLiteral("MM-dd hh:mm:ss:zzz"));
+    text += QLatin1Char(' ') + QString::number(_threadId, 16) + QLatin1Char(' ');
+    if (_kind == Message) {
+        text += QStringLiteral("[ %1 %2 ]:\t").arg(QLatin1String(msgTypeString(_msgType)), QString::fromUtf8(_name));
+        text += _message;
+        return text;
+    }
+
+    text += QStringLiteral("[ event %1 ]:\t").arg(QString::fromUtf8(_name));
+    QStringList fields;
+    if (!_file.isEmpty())
+        fields << QStringLiteral("file=") + _file;
+    if (!_job.isEmpty())
+        fields << QStringLiteral("job=") + QString::fromUtf8(_job);
+    if (_bytes >= 0)
+        fields << QStringLiteral("bytes=") + QString::number(_bytes);
+    if (_duration >= 0)
+        fields << QStringLiteral("duration=") + QString::number(_duration) + QStringLiteral("ms");
+    if (!_message.isEmpty())
+        fields << _message;
+    text += fields.join(QLatin1Char(' '));
+    return text;
+}
+
+QByteArray TraceRecord::toJson() const
+{
+    QJsonObject obj;
+    obj.insert(QStringLiteral("ts"), double(_timestamp));
+    obj.insert(QStringLiteral("thread"), QString::number(_threadId, 16));
+    if (_kind == Message) {
+        obj.insert(QStringLiteral("type"), QLatin1String(msgTypeString(_msgType)));
+        obj.insert(QStringLiteral("category"), QString::fromUtf8(_name));
+    } else {
+        obj.insert(QStringLiteral("event"), QString::fromUtf8(_name));
+    }
+    if (!_file.isEmpty())
+        obj.insert(QStringLiteral("file"), _file);
+    if (!_job.isEmpty())
+        obj.insert(QStringLiteral("job"), QString::fromUtf8(_job));
+    if (_bytes >= 0)
+        obj.insert(QStringLiteral("bytes"), double(_bytes));
+    if (_duration >= 0)
+        obj.insert(QStringLiteral("duration"), double(_duration));
+    if (!_message.isEmpty())
+        obj.insert(QStringLiteral("message"), _message);
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+static QDataStream &operator<<(QDataStream &stream, const TraceRecord &record)
+{
+    stream << record._timestamp << record._threadId << quint8(record._kind) << record._msgType
+           << record._name << record._file.toUtf8() << record._job
+           << record._bytes << record._duration << record._message.toUtf8();
+    return stream;
+}
+
+static QDataStream &operator>>(QDataStream &stream, TraceRecord &record)
+{
+    quint8 kind = 0;
+    QByteArray file;
+    QByteArray message;
+    stream >> record._timestamp >> record._threadId >> kind >> record._msgType
+        >> record._name >> file >> record._job
+        >> record._bytes >> record._duration >> message;
+    record._kind = static_cast<TraceRecord::Kind>(kind);
+    record._file = QString::fromUtf8(file);
+    record._message = QString::fromUtf8(message);
+    return stream;
+}
+
+class TraceLogWriter : public QThread
+{
+public:
+    explicit TraceLogWriter(TraceLog *log)
+        : _log(log)
+    {
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE { _log->writerLoop(); }
+
+private:
+    TraceLog *_log;
+};
+
+TraceLog *TraceLog::instance()
+{
+    static TraceLog log;
+    return &log;
+}
+
+TraceLog::TraceLog()
+{
+    _ring.resize(defaultCapacity);
+}
+
+TraceLog::~TraceLog()
+{
+    stop();
+}
+
+bool TraceLog::start(const QString &fileName)
+{
+    stop();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    _file.write(magic, sizeof(magic));
+
+    {
+        QMutexLocker lock(&_mutex);
+        _stopRequested = false;
+        _head = 0;
+        _count = 0;
+        _dropped = 0;
+        _droppedReported = 0;
+    }
+    _writer.reset(new TraceLogWriter(this));
+    _writer->start(QThread::LowPriority);
+    _active.store(1);
+    return true;
+}
+
+void TraceLog::stop()
+{
+    if (!_writer)
+        return;
+
+    _active.store(0);
+    {
+        QMutexLocker lock(&_mutex);
+        _stopRequested = true;
+        _cond.wakeOne();
+    }
+    _writer->wait();
+    _writer.reset();
+    _file.close();
+}
+
+void TraceLog::setCapacity(int capacity)
+{
+    QMutexLocker lock(&_mutex);
+    if (capacity <= 0 || _count > 0)
+        return;
+    _ring.resize(capacity);
+    _ring.squeeze();
+    _head = 0;
+}
+
+void TraceLog::append(TraceRecord &&record)
+{
+    QMutexLocker lock(&_mutex);
+    const int capacity = _ring.size();
+    if (_count == capacity) {
+        // Writer can't keep up: overwrite the oldest pending record
+        _head = (_head + 1) % capacity;
+        --_count;
+        ++_dropped;
+    }
+    _ring[(_head + _count) % capacity] = std::move(record);
+    ++_count;
+    if (_count == writerBatchSize)
+        _cond.wakeOne();
+}
+
+static qint64 currentTimestamp()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+void TraceLog::message(QtMsgType type, const char *category, const QString &message)
+{
+    if (!isActive())
+        return;
+
+    TraceRecord record;
+    record._timestamp = currentTimestamp();
+    record._threadId = quint64(quintptr(QThread::currentThreadId()));
+    record._kind = TraceRecord::Message;
+    record._msgType = quint8(type);
+    record._name = category;
+    record._message = message;
+    append(std::move(record));
+}
+
+void TraceLog::event(const char *name, const QString &file, const QByteArray &job, qint64 bytes, qint64 duration)
+{
+    if (!isActive())
+        return;
+
+    TraceRecord record;
+    record._timestamp = currentTimestamp();
+    record._threadId = quint64(quintptr(QThread::currentThreadId()));
+    record._kind = TraceRecord::Event;
+    record._name = name;
+    record._file = file;
+    record._job = job;
+    record._bytes = bytes;
+    record._duration = duration;
+    append(std::move(record));
+}
+
+quint64 TraceLog::droppedRecords() const
+{
+    QMutexLocker lock(&_mutex);
+    return _dropped;
+}
+
+void TraceLog::writerLoop()
+{
+    QVector<TraceRecord> pending;
+    forever {
+        bool stopping = false;
+        quint64 newlyDropped = 0;
+        {
+            QMutexLocker lock(&_mutex);
+            if (_count == 0 && !_stopRequested)
+                _cond.wait(&_mutex, writerIntervalMs);
+
+            const int capacity = _ring.size();
+            pending.reserve(_count);
+            for (int i = 0; i < _count; ++i)
+                pending.append(std::move(_ring[(_head + i) % capacity]));
+            _head = 0;
+            _count = 0;
+
+            newlyDropped = _dropped - _droppedReported;
+            _droppedReported = _dropped;
+            stopping = _stopRequested;
+        }
+
+        if (newlyDropped > 0) {
+            TraceRecord dropped;
+            dropped._timestamp = currentTimestamp();
+            dropped._kind = TraceRecord::Event;
+            dropped._name = "trace.dropped";
+            dropped._bytes = qint64(newlyDropped);
+            pending.append(std::move(dropped));
+        }
+
+        writeRecords(pending);
+        pending.clear();
+
+        if (stopping)
+            break;
+    }
+    _file.flush();
+}
+
+void TraceLog::writeRecords(const QVector<TraceRecord> &records)
+{
+    if (records.isEmpty())
+        return;
+
+    // Serialize into a memory buffer first so the file sees a few large writes
+    QByteArray buffer;
+    {
+        QDataStream stream(&buffer, QIODevice::WriteOnly);
+        stream.setVersion(QDataStream::Qt_5_6);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        for (const auto &record : records)
+            stream << record;
+    }
+    _file.write(buffer);
+    _file.flush();
+}
+
+bool readTraceLog(QIODevice *device, const std::function<void(const TraceRecord &)> &callback)
+{
+    if (device->read(sizeof(TraceLog::magic)) != QByteArray(TraceLog::magic, sizeof(TraceLog::magic)))
+        return false;
+
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    while (!stream.atEnd()) {
+        TraceRecord record;
+        stream >> record;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        callback(record);
+    }
+    return true;
+}
+
+} // namespace OCC
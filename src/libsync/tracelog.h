@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) by ownCloud GmbH
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <functional>
+
+#include "owncloudlib.h"
+
+class QIODevice;
+
+namespace OCC {
+
+/**
+ * @brief A single entry of the binary trace log
+ *
+ * Either a plain log message (as received by the Qt message handler) or a
+ * structured event emitted by the sync code, like a finished propagation job.
+ *
+ * @ingroup libsync
+ */
+struct OWNCLOUDSYNC_EXPORT TraceRecord
+{
+    enum Kind : quint8 {
+        Message = 0,
+        Event = 1
+    };
+
+    qint64 _timestamp = 0; // microseconds since epoch, UTC
+    quint64 _threadId = 0;
+    Kind _kind = Message;
+    quint8 _msgType = 0; // QtMsgType, for messages only
+
+    QByteArray _name; // the logging category for messages, the event name otherwise
+    QString _file;
+    QByteArray _job;
+    qint64 _bytes = -1;
+    qint64 _duration = -1; // in milliseconds
+    QString _message;
+
+    /** Human readable representation, matching the regular log file format */
+    QString toText() const;
+
+    /** One JSON object, without trailing newline */
+    QByteArray toJson() const;
+};
+
+/**
+ * @brief Asynchronous, low overhead trace log
+ *
+ * Producers only copy the record into a bounded ring buffer under a short
+ * lock; serialization and disk writes happen on a background thread. When
+ * the writer can't keep up, the oldest pending records are dropped and the
+ * number of dropped records is written to the log instead.
+ *
+ * The file format is a magic header followed by QDataStream encoded records,
+ * see readTraceLog() and the tracedump tool to convert it to text or JSONL.
+ *
+ * @ingroup libsync
+ */
+class OWNCLOUDSYNC_EXPORT TraceLog
+{
+public:
+    static TraceLog *instance();
+
+    /** Starts writing the trace to fileName. Returns false if it can't be opened. */
+    bool start(const QString &fileName);
+
+    /** Flushes all pending records and closes the file */
+    void stop();
+
+    /** Cheap check to avoid building records when tracing is off */
+    bool isActive() const { return _active.load(); }
+
+    void setCapacity(int capacity);
+
+    void append(TraceRecord &&record);
+
+    /** Records a log message, used by the Qt message handler */
+    void message(QtMsgType type, const char *category, const QString &message);
+
+    /** Records a structured event */
+    void event(const char *name, const QString &file = QString(), const QByteArray &job = QByteArray(),
+        qint64 bytes = -1, qint64 duration = -1);
+
+    /** Number of records that were dropped because the ring buffer was full */
+    quint64 droppedRecords() const;
+
+    static const char magic[8];
+
+private:
+    friend class TraceLogWriter;
+
+    TraceLog();
+    ~TraceLog();
+
+    /** Body of the writer thread */
+    void writerLoop();
+    void writeRecords(const QVector<TraceRecord> &records);
+
+    QAtomicInt _active;
+    bool _stopRequested = false;
+
+    mutable QMutex _mutex;
+    QWaitCondition _cond;
+    QVector<TraceRecord> _ring;
+    int _head = 0; // index of the oldest pending record
+    int _count = 0;
+    quint64 _dropped = 0;
+    quint64 _droppedReported = 0;
+
+    QFile _file;
+    QScopedPointer<QThread> _writer;
+};
+
+/**
+ * Reads a trace log written by TraceLog, calling callback for every record.
+ *
+ * Returns false if the device doesn't contain a trace log or is truncated.
+ */
+OWNCLOUDSYNC_EXPORT bool readTraceLog(QIODevice *device, const std::function<void(const TraceRecord &)> &callback);
+
+} // namespace OCC
+
+#endif // TRACELOG_H
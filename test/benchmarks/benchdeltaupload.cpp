@@ -0,0 +1,192 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+extern "C" {
+#include "libzsync/zsync.h"
+}
+
+#include <QtCore>
+
+#include <functional>
+
+#include "owncloudpropagator.h"
+#include "propagatecommonzsync.h"
+#include "contentdefinedchunker.h"
+
+using namespace OCC;
+
+// Size of the edited file in MB, can be given as first argument
+static const int defaultSizeMb = 64;
+
+// How much an upload of a new version of a file sends with zsync and with
+// content-defined chunks, for some typical edits. Both use 1 MB blocks.
+struct Edit
+{
+    const char *name;
+    std::function<void(QByteArray &)> apply;
+};
+
+static QByteArray randomData(int size, quint64 seed)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    quint64 x = seed;
+    for (int i = 0; i < size; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = char(x >> 32);
+    }
+    return data;
+}
+
+static bool writeFile(const QString &fileName, const QByteArray &data)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+struct Cost
+{
+    qint64 bytes = 0; // data and metadata sent
+    int requests = 0;
+    qint64 ms = 0; // time spent on the client
+};
+
+// What PropagateUploadFileNG does with zsync: fetch the metadata of the old
+// version, seed it with the new file, upload the missing ranges and the
+// metadata of the new version
+static Cost zsyncCost(const QString &oldFile, const QString &newFile, qint64 newSize)
+{
+    Cost cost;
+    QElapsedTimer timer;
+    timer.start();
+
+    auto generate = [](const QString &fileName) {
+        QByteArray metadata;
+        ZsyncGenerateRunnable generator(fileName);
+        QObject::connect(&generator, &ZsyncGenerateRunnable::finishedSignal, [&metadata](const QString &generated) {
+            QFile file(generated);
+            if (file.open(QIODevice::ReadOnly))
+                metadata = file.readAll();
+            file.remove();
+        });
+        generator.run();
+        return metadata;
+    };
+
+    auto oldMetadata = generate(oldFile);
+    void *state = nullptr;
+    ZsyncSeedRunnable seeder(oldMetadata, newFile, ZsyncMode::upload);
+    QObject::connect(&seeder, &ZsyncSeedRunnable::finishedSignal, [&state](void *zs) { state = zs; });
+    seeder.run();
+    if (!state)
+        return cost;
+    auto zs = static_cast<struct zsync_state *>(state);
+
+    int rangeCount = 0;
+    off_t *ranges = zsync_needed_byte_ranges(zs, &rangeCount, 0);
+    const qint64 remoteSize = zsync_file_length(zs);
+    const qint64 minSize = qMin(newSize, remoteSize);
+    for (int i = 0; i < rangeCount; ++i) {
+        const qint64 start = ranges[2 * i];
+        const qint64 end = qMin<qint64>(ranges[2 * i + 1] + 1, minSize);
+        if (start < minSize) {
+            cost.bytes += end - start;
+            ++cost.requests;
+        }
+    }
+    if (newSize > remoteSize) {
+        cost.bytes += newSize - remoteSize;
+        ++cost.requests;
+    }
+    free(ranges);
+    zsync_end(zs);
+
+    auto newMetadata = generate(newFile);
+    cost.ms = timer.elapsed();
+    // The metadata download, its upload and the MOVE
+    cost.bytes += oldMetadata.size() + newMetadata.size();
+    cost.requests += 3;
+    return cost;
+}
+
+// What PropagateUploadFileNG does with content-defined chunks: chunk the new
+// file, upload the ranges of unknown chunks and reference the others
+static Cost contentChunkingCost(const QString &oldFile, const QString &newFile)
+{
+    Cost cost;
+    ContentDefinedChunker chunker;
+    // The chunks of the old version come from the journal
+    QSet<QByteArray> known;
+    for (const auto &chunk : chunker.chunkFile(oldFile).chunks)
+        known.insert(chunk._hash);
+
+    QElapsedTimer timer;
+    timer.start();
+    const auto chunks = chunker.chunkFile(newFile).chunks;
+    cost.ms = timer.elapsed();
+
+    bool lastKnown = true;
+    for (int i = 0; i < chunks.size(); ++i) {
+        const bool isKnown = known.contains(chunks[i]._hash);
+        if (!isKnown)
+            cost.bytes += chunks[i]._size;
+        // Adjacent chunks of the same kind are merged; references to chunks
+        // that aren't adjacent in the old file are counted as merged too
+        if (i == 0 || isKnown != lastKnown)
+            ++cost.requests;
+        lastKnown = isKnown;
+    }
+    // The MOVE
+    cost.requests += 1;
+    return cost;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QLoggingCategory::setFilterRules(QStringLiteral("sync.*.info=false\nsync.*.debug=false"));
+
+    int sizeMb = defaultSizeMb;
+    if (argc > 1)
+        sizeMb = QByteArray(argv[1]).toInt();
+    const int size = sizeMb * 1000 * 1000;
+    const int middle = size / 2;
+
+    QVector<Edit> edits = {
+        { "INSERT AT START:", [](QByteArray &data) { data.prepend("x"); } },
+        { "INSERT IN MIDDLE:", [middle](QByteArray &data) { data.insert(middle, randomData(4096, 2)); } },
+        { "OVERWRITE IN MIDDLE:", [middle](QByteArray &data) { data.replace(middle, 4096, randomData(4096, 3)); } },
+        { "DELETE IN MIDDLE:", [middle](QByteArray &data) { data.remove(middle, 64 * 1024); } },
+        { "APPEND:", [](QByteArray &data) { data.append(randomData(1024 * 1024, 4)); } },
+        { "SCATTERED:", [](QByteArray &data) {
+             for (int i = 1; i <= 20; ++i)
+                 data.replace(int(qint64(data.size()) * i / 21), 100, randomData(100, 4 + i));
+         } },
+    };
+
+    QTemporaryDir dir;
+    const QString oldFile = dir.path() + QStringLiteral("/old");
+    const QString newFile = dir.path() + QStringLiteral("/new");
+    const auto original = randomData(size, 1);
+    bool result = writeFile(oldFile, original);
+
+    qDebug() << "Uploading edits of a" << sizeMb << "MB file";
+    for (const auto &edit : edits) {
+        auto data = original;
+        edit.apply(data);
+        result &= writeFile(newFile, data);
+
+        const auto zsync = zsyncCost(oldFile, newFile, data.size());
+        const auto cdc = contentChunkingCost(oldFile, newFile);
+        result &= zsync.requests > 0;
+        qDebug() << edit.name
+                 << "zsync" << zsync.bytes << "bytes" << zsync.requests << "requests" << zsync.ms << "ms;"
+                 << "content chunks" << cdc.bytes << "bytes" << cdc.requests << "requests" << cdc.ms << "ms";
+    }
+    return result ? 0 : -1;
+}
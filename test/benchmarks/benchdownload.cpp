@@ -0,0 +1,50 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+// Size of the downloaded file in MB, can be given as first argument
+static const qint64 defaultSizeMb = 2000;
+
+static bool download(qint64 size, qint64 batchSize, bool writeInThread, const char *name)
+{
+    FakeFolder fakeFolder{ FileInfo{} };
+    auto options = fakeFolder.syncEngine().syncOptions();
+    options._downloadWriteBatchSize = batchSize;
+    options._downloadWriteThread = writeInThread;
+    fakeFolder.syncEngine().setSyncOptions(options);
+    fakeFolder.remoteModifier().insert("big", size);
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool result = fakeFolder.syncOnce()
+        && FileSystem::getSize(fakeFolder.localPath() + "big") == size;
+    const auto elapsed = timer.elapsed();
+    qDebug() << name << result << elapsed << "ms" << (elapsed ? size / 1000 / elapsed : 0) << "MB/s";
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QLoggingCategory::setFilterRules(QStringLiteral("sync.*.info=false"));
+
+    qint64 sizeMb = defaultSizeMb;
+    if (argc > 1)
+        sizeMb = QByteArray(argv[1]).toLongLong();
+    const qint64 size = sizeMb * 1000 * 1000;
+    qDebug() << "Downloading" << sizeMb << "MB";
+
+    // Writing every piece as it arrives is how downloads used to be written
+    bool result = download(size, 0, false, "UNBATCHED:");
+    result &= download(size, 1024 * 1024, false, "BATCHED:");
+    result &= download(size, 1024 * 1024, true, "BATCHED IN THREAD:");
+    return result ? 0 : -1;
+}
@@ -0,0 +1,89 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QDebug>
+#include <QLoggingCategory>
+
+#include "common/syncjournaldb.h"
+#include "common/syncjournalfilerecord.h"
+
+using namespace OCC;
+
+// 10 files per directory, 10 subdirectories per directory, 6 levels: ~1.2M records
+static const int filesPerDir = 10;
+static const int dirsPerDir = 10;
+static const int maxDepth = 5;
+
+static int numRecords = 0;
+
+static void addRecords(SyncJournalDb &journal, int depth, const QByteArray &path)
+{
+    SyncJournalFileRecord record;
+    record._modtime = 1500000000;
+    record._etag = "etag";
+    record._fileId = "fileid";
+    record._remotePerm = RemotePermissions::fromDbValue("WDNVCKR");
+    for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum) {
+        const QByteArray name = "file" + QByteArray::number(fileNum);
+        record._path = path.isEmpty() ? name : path + '/' + name;
+        record._type = ItemTypeFile;
+        record._inode = ++numRecords;
+        journal.setFileRecord(record);
+    }
+    if (depth >= maxDepth)
+        return;
+    for (int dirNum = 1; dirNum <= dirsPerDir; ++dirNum) {
+        const QByteArray name = "dir" + QByteArray::number(dirNum);
+        const QByteArray subPath = path.isEmpty() ? name : path + '/' + name;
+        record._path = subPath;
+        record._type = ItemTypeDirectory;
+        record._inode = ++numRecords;
+        journal.setFileRecord(record);
+        addRecords(journal, depth + 1, subPath);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Every setFileRecord() is logged otherwise
+    QLoggingCategory::setFilterRules(QStringLiteral("sync.database.info=false"));
+    QTemporaryDir dir;
+    SyncJournalDb journal(dir.path() + "/.sync_bench.db");
+
+    QElapsedTimer timer;
+    timer.start();
+    addRecords(journal, 0, QByteArray());
+    journal.commit("bench");
+    qDebug() << "INSERT" << numRecords << "records:" << timer.restart() << "ms";
+
+    const QByteArrayList dirs = { "", "dir5", "dir5/dir5", "dir5/dir5/dir5", "dir5/dir5/dir5/dir5" };
+
+    int found = 0;
+    auto count = [&](const SyncJournalFileRecord &) { ++found; };
+
+    for (const auto &path : dirs) {
+        found = 0;
+        timer.restart();
+        for (int i = 0; i < 100; ++i)
+            journal.listFilesInPath(path, count);
+        qDebug() << "LIST" << path << found / 100 << "entries, 100 times:" << timer.elapsed() << "ms";
+    }
+
+    for (const auto &path : dirs) {
+        found = 0;
+        timer.restart();
+        journal.getFilesBelowPath(path, count);
+        qDebug() << "BELOW" << path << found << "entries:" << timer.elapsed() << "ms";
+    }
+
+    journal.close();
+    return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+// 2000 remote deletes and 2000 remote moves, each reply arrives after a
+// simulated round trip
+static const int numFiles = 2000;
+static const int roundTripMs = 20;
+
+static bool run(int parallelNetworkJobs)
+{
+    FakeFolder fakeFolder{ FileInfo{} };
+    SyncOptions syncOptions;
+    syncOptions._parallelNetworkJobs = parallelNetworkJobs;
+    fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+    auto &local = fakeFolder.localModifier();
+    local.mkdir("A");
+    for (int i = 0; i < numFiles; ++i) {
+        local.insert(QStringLiteral("A/del") + QString::number(i), 1);
+        local.insert(QStringLiteral("A/mv") + QString::number(i), 1);
+    }
+    bool result = fakeFolder.syncOnce();
+
+    int running = 0;
+    int maxRunning = 0;
+    QObject parent;
+    fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+        auto verb = request.attribute(QNetworkRequest::CustomVerbAttribute);
+        QNetworkReply *reply = nullptr;
+        if (verb == "DELETE" || op == QNetworkAccessManager::DeleteOperation)
+            reply = new DelayedReply<FakeDeleteReply>(roundTripMs, fakeFolder.remoteModifier(), op, request, &parent);
+        else if (verb == "MOVE")
+            reply = new DelayedReply<FakeMoveReply>(roundTripMs, fakeFolder.remoteModifier(), op, request, &parent);
+        if (reply) {
+            maxRunning = qMax(maxRunning, ++running);
+            QObject::connect(reply, &QNetworkReply::finished, &parent, [&running] { --running; });
+        }
+        return reply;
+    });
+
+    local.mkdir("B");
+    for (int i = 0; i < numFiles; ++i) {
+        local.remove(QStringLiteral("A/del") + QString::number(i));
+        local.rename(QStringLiteral("A/mv") + QString::number(i), QStringLiteral("B/mv") + QString::number(i));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    result &= fakeFolder.syncOnce();
+    qDebug() << "DELETE AND MOVE" << numFiles << "files each with" << parallelNetworkJobs << "parallel jobs:"
+             << result << timer.elapsed() << "ms" << maxRunning << "requests in flight at most";
+
+    result &= fakeFolder.currentLocalState() == fakeFolder.currentRemoteState();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Every discovered item and journal write is logged otherwise
+    QLoggingCategory::setFilterRules(QStringLiteral("sync.*.info=false"));
+
+    // The defaults for HTTP/1.1 and HTTP/2 connections, see Folder::setSyncOptions()
+    bool result = run(6);
+    result &= run(20);
+    return result ? 0 : -1;
+}
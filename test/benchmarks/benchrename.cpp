@@ -0,0 +1,85 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+// 100 directories with 1000 files each: a 100k-file subtree
+static const int numDirs = 100;
+static const int filesPerDir = 1000;
+
+static QString fileName(int fileNum)
+{
+    return QStringLiteral("file") + QString::number(fileNum);
+}
+
+static QString dirName(const QString &root, int dirNum)
+{
+    return root + QStringLiteral("/dir") + QString::number(dirNum);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Every discovered item and journal write is logged otherwise
+    QLoggingCategory::setFilterRules(QStringLiteral("sync.*.info=false"));
+
+    FakeFolder fakeFolder{ FileInfo{} };
+    auto &local = fakeFolder.localModifier();
+    local.mkdir("A");
+    for (int dirNum = 1; dirNum <= numDirs; ++dirNum) {
+        const auto dir = dirName("A", dirNum);
+        local.mkdir(dir);
+        for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum)
+            local.insert(dir + '/' + fileName(fileNum), 1);
+    }
+
+    auto queryCount = [&]() { return fakeFolder.syncJournal().queryStatistics()._queryCount; };
+
+    QElapsedTimer timer;
+    timer.start();
+    bool result = fakeFolder.syncOnce();
+    qDebug() << "INITIAL SYNC:" << result << timer.restart() << "ms";
+
+    // Moving the subtree itself is a single rename
+    auto queries = queryCount();
+    local.rename("A", "B");
+    result &= fakeFolder.syncOnce();
+    qDebug() << "MOVE SUBTREE:" << result << timer.restart() << "ms" << queryCount() - queries << "queries";
+
+    // Moving the files one by one into new directories, like 'mv B/dir1/* C/dir1/'
+    // does, makes every file a rename candidate
+    local.mkdir("C");
+    for (int dirNum = 1; dirNum <= numDirs; ++dirNum) {
+        local.mkdir(dirName("C", dirNum));
+        for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum) {
+            local.rename(dirName("B", dirNum) + '/' + fileName(fileNum),
+                dirName("C", dirNum) + '/' + fileName(fileNum));
+        }
+    }
+    timer.restart();
+    queries = queryCount();
+    result &= fakeFolder.syncOnce();
+    qDebug() << "MOVE FILES:" << result << timer.restart() << "ms" << queryCount() - queries << "queries";
+
+    // New files are no renames, they shouldn't cost a query each
+    local.mkdir("D");
+    for (int dirNum = 1; dirNum <= numDirs; ++dirNum) {
+        local.mkdir(dirName("D", dirNum));
+        for (int fileNum = 1; fileNum <= filesPerDir; ++fileNum)
+            local.insert(dirName("D", dirNum) + '/' + fileName(fileNum), 1);
+    }
+    timer.restart();
+    queries = queryCount();
+    result &= fakeFolder.syncOnce();
+    qDebug() << "NEW FILES:" << result << timer.restart() << "ms" << queryCount() - queries << "queries";
+
+    result &= fakeFolder.currentLocalState() == fakeFolder.currentRemoteState();
+    return result ? 0 : -1;
+}
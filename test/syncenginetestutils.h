@@ -7,6 +7,7 @@
 #pragma once
 
 #include "account.h"
+#include "contentencoding.h"
 #include "creds/abstractcredentials.h"
 #include "logger.h"
 #include "filesystem.h"
@@ -416,6 +417,11 @@ public:
     }
 
     Q_INVOKABLE void respond() {
+        // Like a server with compression enabled
+        if (request().rawHeader("Accept-Encoding").contains("gzip")) {
+            payload = OCC::ContentEncoding::gzip(payload);
+            setRawHeader("Content-Encoding", "gzip");
+        }
         setHeader(QNetworkRequest::ContentLengthHeader, payload.size());
         setHeader(QNetworkRequest::ContentTypeHeader, "application/xml; charset=utf-8");
         setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 207);
@@ -438,7 +444,7 @@ public:
     qint64 bytesAvailable() const override { return payload.size() + QIODevice::bytesAvailable(); }
     qint64 readData(char *data, qint64 maxlen) override {
         qint64 len = std::min(qint64{payload.size()}, maxlen);
-        strncpy(data, payload.constData(), len);
+        std::memcpy(data, payload.constData(), len);
         payload.remove(0, len);
         return len;
     }
@@ -546,7 +552,7 @@ public:
         QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
     }
 
-    Q_INVOKABLE void respond() {
+    Q_INVOKABLE virtual void respond() {
         setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 204);
         emit metaDataChanged();
         emit finished();
@@ -575,7 +581,7 @@ public:
         QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
     }
 
-    Q_INVOKABLE void respond() {
+    Q_INVOKABLE virtual void respond() {
         setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 201);
         emit metaDataChanged();
         emit finished();
@@ -585,13 +591,67 @@ public:
     qint64 readData(char *, qint64) override { return 0; }
 };
 
+class FakeCopyReply : public QNetworkReply
+{
+    Q_OBJECT
+    FileInfo *fileInfo = nullptr;
+    int httpStatus = 201;
+public:
+    FakeCopyReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
+    : QNetworkReply{parent} {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        open(QIODevice::ReadOnly);
+
+        QString fileName = getFilePathFromUrl(request.url());
+        Q_ASSERT(!fileName.isEmpty());
+        QString dest = getFilePathFromUrl(QUrl::fromEncoded(request.rawHeader("Destination")));
+        Q_ASSERT(!dest.isEmpty());
+
+        // If-Match applies to the source
+        const FileInfo *source = remoteRootFileInfo.find(fileName);
+        const QByteArray ifMatch = request.rawHeader("If-Match");
+        if (!source || source->isDir) {
+            httpStatus = 404;
+        } else if (!ifMatch.isEmpty() && ifMatch != '"' + source->etag.toLatin1() + '"') {
+            httpStatus = 412;
+        } else {
+            fileInfo = remoteRootFileInfo.create(dest, source->size, source->contentChar);
+            if (request.hasRawHeader("X-OC-Mtime"))
+                fileInfo->lastModified = OCC::Utility::qDateTimeFromTime_t(request.rawHeader("X-OC-Mtime").toLongLong());
+            else
+                fileInfo->lastModified = source->lastModified;
+            remoteRootFileInfo.find(dest, /*invalidate_etags=*/true);
+        }
+        QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+    }
+
+    Q_INVOKABLE void respond() {
+        if (fileInfo) {
+            setRawHeader("OC-ETag", fileInfo->etag.toLatin1());
+            setRawHeader("ETag", fileInfo->etag.toLatin1());
+            setRawHeader("OC-FileId", fileInfo->fileId);
+            setRawHeader("X-OC-MTime", "accepted");
+        } else {
+            setError(httpStatus == 404 ? ContentNotFoundError : UnknownContentError, "Fake copy error");
+        }
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, httpStatus);
+        emit metaDataChanged();
+        emit finished();
+    }
+
+    void abort() override { }
+    qint64 readData(char *, qint64) override { return 0; }
+};
+
 class FakeGetReply : public QNetworkReply
 {
     Q_OBJECT
 public:
     const FileInfo *fileInfo;
     char payload;
-    int size;
+    qint64 size;
     bool aborted = false;
 
     FakeGetReply(FileInfo &remoteRootFileInfo, QNetworkAccessManager::Operation op, const QNetworkRequest &request, QObject *parent)
@@ -607,7 +667,7 @@ public:
         QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
     }
 
-    Q_INVOKABLE void respond() {
+    Q_INVOKABLE virtual void respond() {
         if (aborted) {
             setError(OperationCanceledError, "Operation Canceled");
             emit metaDataChanged();
@@ -616,8 +676,20 @@ public:
         }
         payload = fileInfo->contentChar;
         size = fileInfo->size;
+        int status = 200;
+        qint64 start = 0;
+        qint64 end = size - 1;
+        const QByteArray range = request().rawHeader("Range");
+        if (!range.isEmpty() && sscanf(range.constData(), "bytes=%lld-%lld", &start, &end) >= 1
+            && start < size && start <= end) {
+            end = std::min(end, size - 1);
+            setRawHeader("Content-Range", "bytes " + QByteArray::number(start) + '-' + QByteArray::number(end)
+                    + '/' + QByteArray::number(size));
+            size = end - start + 1;
+            status = 206;
+        }
         setHeader(QNetworkRequest::ContentLengthHeader, size);
-        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, status);
         setRawHeader("OC-ETag", fileInfo->etag.toLatin1());
         setRawHeader("ETag", fileInfo->etag.toLatin1());
         setRawHeader("OC-FileId", fileInfo->fileId);
@@ -638,7 +710,7 @@ public:
     }
 
     qint64 readData(char *data, qint64 maxlen) override {
-        qint64 len = std::min(qint64{size}, maxlen);
+        qint64 len = std::min(size, maxlen);
         std::fill_n(data, len, payload);
         size -= len;
         return len;
@@ -981,6 +1053,43 @@ public:
     QByteArray _body;
 };
 
+// A successful reply with a fixed body, for requests outside of the WebDAV tree
+class FakePayloadReply : public QNetworkReply
+{
+    Q_OBJECT
+public:
+    FakePayloadReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request,
+                     const QByteArray &body, QObject *parent)
+    : QNetworkReply{parent}, _body(body) {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(op);
+        open(QIODevice::ReadOnly);
+        QMetaObject::invokeMethod(this, "respond", Qt::QueuedConnection);
+    }
+
+    Q_INVOKABLE void respond() {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+        emit metaDataChanged();
+        emit readyRead();
+        setFinished(true);
+        emit finished();
+    }
+
+    void abort() override { }
+    qint64 readData(char *buf, qint64 max) override {
+        max = qMin<qint64>(max, _body.size());
+        memcpy(buf, _body.constData(), max);
+        _body = _body.mid(max);
+        return max;
+    }
+    qint64 bytesAvailable() const override {
+        return _body.size() + QIODevice::bytesAvailable();
+    }
+
+    QByteArray _body;
+};
+
 // A reply that never responds
 class FakeHangingReply : public QNetworkReply
 {
@@ -1050,6 +1159,35 @@ public:
 
     void setOverride(const Override &override) { _override = override; }
 
+    // The request body, decompressed if it has a Content-Encoding
+    static QByteArray decodedPayload(const QNetworkRequest &request, QIODevice *outgoingData)
+    {
+        OCC::ContentDecoder decoder(request.rawHeader("Content-Encoding"));
+        QByteArray payload;
+        bool ok = decoder.decode(outgoingData->readAll(), &payload);
+        Q_ASSERT(ok);
+        Q_UNUSED(ok);
+        return payload;
+    }
+
+    // A chunk with the data of a byte range of an existing file, see the
+    // "chunkReferences" capability
+    QNetworkReply *chunkReferenceReply(Operation op, const QNetworkRequest &request)
+    {
+        const QString source = getFilePathFromUrl(QUrl::fromEncoded(request.rawHeader("OC-Chunk-Source")));
+        const FileInfo *sourceInfo = _remoteRootFileInfo.find(source);
+        if (!sourceInfo || request.rawHeader("If") != "<" + request.rawHeader("OC-Chunk-Source") + "> ([\"" + sourceInfo->etag.toLatin1() + "\"])")
+            return new FakeErrorReply{ op, request, this, 412 };
+
+        const auto range = request.rawHeader("OC-Chunk-Source-Range").mid(qstrlen("bytes=")).split('-');
+        Q_ASSERT(range.size() == 2);
+        const qint64 start = range[0].toLongLong();
+        const qint64 end = range[1].toLongLong();
+        if (start > end || end >= sourceInfo->size)
+            return new FakeErrorReply{ op, request, this, 416 };
+        return new FakePutReply{ _uploadFileInfo, op, request, QByteArray(int(end - start + 1), sourceInfo->contentChar), this };
+    }
+
 protected:
     QNetworkReply *createRequest(Operation op, const QNetworkRequest &request,
                                          QIODevice *outgoingData = 0) {
@@ -1071,8 +1209,10 @@ protected:
             return new FakePropfindReply{info, op, request, this};
         else if (verb == QLatin1String("GET") || op == QNetworkAccessManager::GetOperation)
             return new FakeGetReply{info, op, request, this};
+        else if ((verb == QLatin1String("PUT") || op == QNetworkAccessManager::PutOperation) && isUpload && request.hasRawHeader("OC-Chunk-Source"))
+            return chunkReferenceReply(op, request);
         else if (verb == QLatin1String("PUT") || op == QNetworkAccessManager::PutOperation)
-            return new FakePutReply{info, op, request, outgoingData->readAll(), this};
+            return new FakePutReply{info, op, request, decodedPayload(request, outgoingData), this};
         else if (verb == QLatin1String("MKCOL"))
             return new FakeMkcolReply{info, op, request, this};
         else if (verb == QLatin1String("DELETE") || op == QNetworkAccessManager::DeleteOperation)
@@ -1081,6 +1221,8 @@ protected:
             return new FakeMoveReply{info, op, request, this};
         else if (verb == QLatin1String("MOVE") && isUpload)
             return new FakeChunkMoveReply{ info, _remoteRootFileInfo, op, request, this };
+        else if (verb == QLatin1String("COPY") && !isUpload)
+            return new FakeCopyReply{ info, op, request, this };
         else {
             qDebug() << verb << outgoingData;
             Q_UNREACHABLE();
@@ -0,0 +1,253 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "bandwidthschedule.h"
+#include "bandwidthmanager.h"
+#include "owncloudpropagator.h"
+#include "propagateupload.h"
+#include "account.h"
+
+using namespace OCC;
+
+// 2018-01-01 was a Monday
+static QDateTime at(int dayOfWeek, const QString &time)
+{
+    return QDateTime(QDate(2018, 1, dayOfWeek), QTime::fromString(time, QStringLiteral("H:mm")));
+}
+
+class TestBandwidthSchedule : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testParse()
+    {
+        QString error;
+        auto schedule = BandwidthSchedule::fromString(QStringLiteral("mon-fri 8:00-18:00 100 50%; * 0:00-0:00 0 0"), &error);
+        QVERIFY(error.isEmpty());
+        QCOMPARE(schedule.rules().size(), 2);
+        const auto &rule = schedule.rules().first();
+        QCOMPARE(rule.start, QTime(8, 0));
+        QCOMPARE(rule.end, QTime(18, 0));
+        QCOMPARE(rule.uploadLimit, 100 * 1000);
+        QCOMPARE(rule.downloadLimit, -50);
+
+        QVERIFY(BandwidthSchedule::fromString(QString()).isEmpty());
+        QVERIFY(BandwidthSchedule::fromString(QStringLiteral(" ; ")).isEmpty());
+    }
+
+    void testParseErrors_data()
+    {
+        QTest::addColumn<QString>("schedule");
+
+        QTest::newRow("fields") << "mon 8:00-18:00 100";
+        QTest::newRow("day") << "mo 8:00-18:00 100 100";
+        QTest::newRow("range") << "mon-tue-wed 8:00-18:00 100 100";
+        QTest::newRow("time") << "mon 8:00-25:00 100 100";
+        QTest::newRow("limit") << "mon 8:00-18:00 fast 100";
+        QTest::newRow("percent") << "mon 8:00-18:00 100 150%";
+        QTest::newRow("second rule") << "mon 8:00-18:00 100 100; tue";
+    }
+
+    void testParseErrors()
+    {
+        QFETCH(QString, schedule);
+        QString error;
+        QVERIFY(BandwidthSchedule::fromString(schedule, &error).isEmpty());
+        QVERIFY(!error.isEmpty());
+    }
+
+    void testMatches()
+    {
+        auto schedule = BandwidthSchedule::fromString(QStringLiteral(
+            "sat-mon 10:00-12:00 1 1; fri 22:00-6:00 2 2; wed 0:00-24:00 3 3; 4 9:00-17:00 4 4; * 9:00-17:00 5 5"));
+        QCOMPARE(schedule.rules().size(), 5);
+        auto limitAt = [&](int day, const char *time) {
+            auto rule = schedule.ruleAt(at(day, QString::fromLatin1(time)));
+            return rule ? rule->uploadLimit / 1000 : 0;
+        };
+
+        // Day ranges wrap around the end of the week
+        QCOMPARE(limitAt(6, "11:00"), 1);
+        QCOMPARE(limitAt(7, "11:00"), 1);
+        QCOMPARE(limitAt(1, "11:00"), 1);
+        QCOMPARE(limitAt(1, "12:00"), 5);
+        QCOMPARE(limitAt(2, "11:00"), 5);
+
+        // The window continues after midnight
+        QCOMPARE(limitAt(5, "21:59"), 0);
+        QCOMPARE(limitAt(5, "22:00"), 2);
+        QCOMPARE(limitAt(6, "5:59"), 2);
+        QCOMPARE(limitAt(6, "6:00"), 0);
+        QCOMPARE(limitAt(5, "5:00"), 0);
+
+        // The whole day
+        QCOMPARE(limitAt(3, "0:00"), 3);
+        QCOMPARE(limitAt(3, "23:59"), 3);
+
+        // The first rule wins, days can be numbers
+        QCOMPARE(limitAt(4, "10:00"), 4);
+        QCOMPARE(limitAt(4, "8:00"), 0);
+    }
+
+    void testBucket()
+    {
+        BandwidthBucket bucket;
+        QVERIFY(!bucket.isLimited());
+        QVERIFY(bucket.available() > qint64(1) << 40);
+
+        // Starts with one second worth of bytes
+        bucket.setRate(100000);
+        QVERIFY(bucket.isLimited());
+        QCOMPARE(bucket.available(), qint64(100000));
+        bucket.consume(100000);
+        QVERIFY(bucket.available() < 10000);
+
+        // Refills with the rate, but not above one second worth
+        QTest::qWait(300);
+        const auto refilled = bucket.available();
+        QVERIFY(refilled >= 25000);
+        QVERIFY(refilled <= 100000);
+        QTest::qWait(1100);
+        QCOMPARE(bucket.available(), qint64(100000));
+
+        // Consumers share what's available
+        bucket.addConsumer();
+        bucket.addConsumer();
+        QCOMPARE(bucket.share(), qint64(50000));
+        bucket.removeConsumer();
+        QCOMPARE(bucket.share(), qint64(100000));
+
+        // A lower rate lowers what's available right away
+        bucket.setRate(1000);
+        QVERIFY(bucket.available() <= 1000);
+    }
+
+    void testSharedLimit()
+    {
+        QTemporaryDir dir;
+        SyncJournalDb journal(dir.path() + "/._sync_test.db");
+        auto account = Account::create();
+        BandwidthBucket uploadBucket;
+        BandwidthBucket downloadBucket;
+
+        // Two syncs with the same absolute upload limit, like concurrently
+        // syncing folders, see FolderMan::uploadBucket()
+        OwncloudPropagator propagator1(account, dir.path(), "", &journal);
+        OwncloudPropagator propagator2(account, dir.path(), "", &journal);
+        UploadDevice::FileData fileData;
+        fileData.ok = true;
+        fileData.data = QByteArray(1000000, 'A');
+        auto device1 = new UploadDevice(&propagator1._bandwidthManager);
+        auto device2 = new UploadDevice(&propagator2._bandwidthManager);
+        QVERIFY(device1->openWithData(fileData));
+        QVERIFY(device2->openWithData(fileData));
+        for (auto propagator : { &propagator1, &propagator2 }) {
+            propagator->_uploadLimit = 100000;
+            propagator->_bandwidthManager.setSharedBuckets(&uploadBucket, &downloadBucket);
+            propagator->_bandwidthManager.switchingTimerExpired();
+        }
+        QVERIFY(propagator1._bandwidthManager.usingAbsoluteUploadLimit());
+        QCOMPARE(uploadBucket.rate(), qint64(100000));
+        QCOMPARE(uploadBucket.consumerCount(), 2);
+
+        propagator1._bandwidthManager.absoluteLimitTimerExpired();
+        propagator2._bandwidthManager.absoluteLimitTimerExpired();
+        const auto read1 = device1->read(fileData.data.size()).size();
+        const auto read2 = device2->read(fileData.data.size()).size();
+
+        // Both get a part of the limit, but not more than it together
+        QVERIFY(read1 > 0);
+        QVERIFY(read2 > 0);
+        QVERIFY(read1 + read2 <= 100000);
+
+        // A finished sync's share goes to the others
+        delete device2;
+        propagator2._bandwidthManager.switchingTimerExpired();
+        QCOMPARE(uploadBucket.consumerCount(), 1);
+        delete device1;
+    }
+
+    void testLimitedFromTheStart()
+    {
+        QTemporaryDir dir;
+        SyncJournalDb journal(dir.path() + "/._sync_test.db");
+        auto account = Account::create();
+        account->downloadBucket().setRate(100000);
+        UploadDevice::FileData fileData;
+        fileData.ok = true;
+        fileData.data = QByteArray(1000000, 'A');
+
+        // Set up like by SyncEngine, before any timer ticked
+        OwncloudPropagator propagator(account, dir.path(), "", &journal);
+        propagator._uploadLimit = 100000;
+        propagator._bandwidthManager.reloadLimits();
+        QVERIFY(propagator._bandwidthManager.usingAbsoluteUploadLimit());
+        QVERIFY(propagator._bandwidthManager.usingAccountDownloadLimit());
+
+        // The first transfer waits for its quota
+        auto device = new UploadDevice(&propagator._bandwidthManager);
+        QVERIFY(device->openWithData(fileData));
+        QVERIFY(device->isBandwidthLimited());
+        QCOMPARE(device->read(fileData.data.size()).size(), 0);
+        delete device;
+    }
+
+    void testAccountLimit()
+    {
+        QTemporaryDir dir;
+        SyncJournalDb journal(dir.path() + "/._sync_test.db");
+        auto account = Account::create();
+        auto otherAccount = Account::create();
+        account->uploadBucket().setRate(100000);
+
+        // Two folders of the limited account and one of another account
+        OwncloudPropagator propagator1(account, dir.path(), "", &journal);
+        OwncloudPropagator propagator2(account, dir.path(), "", &journal);
+        OwncloudPropagator otherPropagator(otherAccount, dir.path(), "", &journal);
+        UploadDevice::FileData fileData;
+        fileData.ok = true;
+        fileData.data = QByteArray(1000000, 'A');
+        auto device1 = new UploadDevice(&propagator1._bandwidthManager);
+        auto device2 = new UploadDevice(&propagator2._bandwidthManager);
+        auto otherDevice = new UploadDevice(&otherPropagator._bandwidthManager);
+        QVERIFY(device1->openWithData(fileData));
+        QVERIFY(device2->openWithData(fileData));
+        QVERIFY(otherDevice->openWithData(fileData));
+        for (auto propagator : { &propagator1, &propagator2, &otherPropagator })
+            propagator->_bandwidthManager.switchingTimerExpired();
+        QVERIFY(propagator1._bandwidthManager.usingAccountUploadLimit());
+        QVERIFY(propagator2._bandwidthManager.usingAccountUploadLimit());
+        QVERIFY(!otherPropagator._bandwidthManager.usingAccountUploadLimit());
+        QCOMPARE(account->uploadBucket().consumerCount(), 2);
+
+        propagator1._bandwidthManager.absoluteLimitTimerExpired();
+        propagator2._bandwidthManager.absoluteLimitTimerExpired();
+        const auto read1 = device1->read(fileData.data.size()).size();
+        const auto read2 = device2->read(fileData.data.size()).size();
+
+        // The folders share the account's limit
+        QVERIFY(read1 > 0);
+        QVERIFY(read2 > 0);
+        QVERIFY(read1 + read2 <= 100000);
+
+        // The other account's folder isn't limited by it
+        QCOMPARE(otherDevice->read(fileData.data.size()).size(), fileData.data.size());
+
+        delete device1;
+        delete device2;
+        delete otherDevice;
+        propagator1._bandwidthManager.switchingTimerExpired();
+        propagator2._bandwidthManager.switchingTimerExpired();
+        QCOMPARE(account->uploadBucket().consumerCount(), 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestBandwidthSchedule)
+#include "testbandwidthschedule.moc"
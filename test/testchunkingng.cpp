@@ -573,6 +573,124 @@ private slots:
         QVERIFY(fakeFolder.syncOnce());
         QCOMPARE(nGET, 0);
     }
+
+    // With the capability, chunks of compressible files are uploaded gzip compressed
+    void testCompressedUpload()
+    {
+        if (ContentEncoding::acceptEncoding().isEmpty())
+            QSKIP("ZLIB not found.", SkipSingle);
+
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ { "chunking", "1.0" }, { "uploadCompression", QStringList{ "gzip" } } } } });
+        setChunkSize(fakeFolder.syncEngine(), 1 * 1000 * 1000);
+        const int size = 10 * 1000 * 1000; // 10 MB
+
+        int compressedChunks = 0;
+        qint64 bytesSent = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PutOperation || request.attribute(QNetworkRequest::CustomVerbAttribute) == "PUT") {
+                if (request.rawHeader("Content-Encoding") == "gzip")
+                    ++compressedChunks;
+                bytesSent += outgoingData->size();
+            }
+            return nullptr;
+        });
+
+        // The fake files are all the same character, but videos are not worth trying
+        fakeFolder.localModifier().insert("A/a0", size);
+        fakeFolder.localModifier().insert("A/video.mp4", size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.currentRemoteState().find("A/a0")->size, size);
+        QCOMPARE(compressedChunks, 10);
+        QVERIFY(bytesSent < size + size / 10);
+    }
+
+    // Only the content-defined chunks the server doesn't have are uploaded
+    void testContentChunkedUpload()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ { "chunking", "1.0" }, { "chunkReferences", true } } } });
+        SyncOptions options;
+        options._maxChunkSize = 1 * 1000 * 1000;
+        options._initialChunkSize = 1 * 1000 * 1000;
+        options._minChunkSize = 1 * 1000 * 1000;
+        options._deltaSyncEnabled = true;
+        options._deltaSyncMinFileSize = 0;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        const int size = 10 * 1000 * 1000; // 10 MB
+
+        qint64 bytesSent = 0;
+        int references = 0;
+        bool failReferences = false;
+        QSet<qint64> sourceStarts;
+        // The byte ranges of the file the chunks were made of, by their offset
+        QMap<qint64, qint64> chunkRanges;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::PutOperation)
+                return nullptr;
+            const qint64 offset = request.rawHeader("OC-Chunk-Offset").toLongLong();
+            if (request.hasRawHeader("OC-Chunk-Source")) {
+                ++references;
+                if (failReferences)
+                    return new FakeErrorReply{ op, request, this, 412 };
+                const auto range = request.rawHeader("OC-Chunk-Source-Range").mid(qstrlen("bytes=")).split('-');
+                const qint64 start = range.value(0).toLongLong();
+                const qint64 end = range.value(1).toLongLong();
+                sourceStarts.insert(start);
+                chunkRanges.insert(offset, end - start + 1);
+            } else {
+                bytesSent += outgoingData->size();
+                chunkRanges.insert(offset, outgoingData->size());
+            }
+            return nullptr;
+        });
+        // Whether the chunks make up the whole file, without gaps or overlaps
+        auto chunksCoverFile = [&](qint64 fileSize) {
+            qint64 end = 0;
+            for (auto it = chunkRanges.constBegin(); it != chunkRanges.constEnd(); ++it) {
+                if (it.key() != end)
+                    return false;
+                end += it.value();
+            }
+            return end == fileSize;
+        };
+
+        // The first upload has to send everything. The path needs to be
+        // percent-encoded in the headers that refer to the file.
+        const QString path = QString::fromUtf8("A/a \xc3\xa4");
+        fakeFolder.localModifier().insert(path, size);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(bytesSent, qint64(size));
+        QCOMPARE(references, 0);
+        QVERIFY(chunksCoverFile(size));
+
+        // Appending only changes the last chunk, the others are referenced
+        bytesSent = 0;
+        chunkRanges.clear();
+        fakeFolder.localModifier().appendByte(path);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(fakeFolder.currentRemoteState().find(path)->size, size + 1);
+        QVERIFY(references > 0);
+        QVERIFY(bytesSent > 0);
+        QVERIFY(bytesSent < size / 2);
+        QVERIFY(chunksCoverFile(size + 1));
+        // The file is a single repeated byte, so all full chunks are the same
+        // and refer to the first one
+        QCOMPARE(sourceStarts, QSet<qint64>{ 0 });
+
+        // If the server can't provide the referenced data, it is uploaded
+        bytesSent = 0;
+        references = 0;
+        failReferences = true;
+        fakeFolder.localModifier().appendByte(path);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(references, 1);
+        QCOMPARE(bytesSent, qint64(size + 2));
+    }
 };
 
 QTEST_GUILESS_MAIN(TestChunkingNG)
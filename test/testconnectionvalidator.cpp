@@ -0,0 +1,147 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include "connectionvalidator.h"
+#include "configfile.h"
+#include "account.h"
+
+using namespace OCC;
+
+class TestConnectionValidator : public QObject
+{
+    Q_OBJECT
+
+    QTemporaryDir _confDir;
+
+    // The server info of the last run, restored from the settings
+    AccountPtr cachedAccount(FakeQNAM *fakeQnam)
+    {
+        auto account = Account::create();
+        account->setUrl(QUrl(QStringLiteral("http://localhost/owncloud")));
+        account->setCredentials(new FakeCredentials{ fakeQnam });
+        account->setDavUser(QStringLiteral("admin"));
+        account->setDavDisplayName(QStringLiteral("Old Name"));
+        account->setServerVersion(QStringLiteral("10.0.0.0"));
+        account->setCapabilities({ { QStringLiteral("core"), QVariantMap{ { QStringLiteral("pollinterval"), 60 } } } });
+        account->setServerInfoFromCache(true);
+        return account;
+    }
+
+    // Answers the requests of the full check, the credentials check is a PROPFIND of the WebDAV root
+    static void setupServer(FakeQNAM *fakeQnam, QStringList *requests, const bool *maintenance)
+    {
+        fakeQnam->setOverride([=](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            const QString path = request.url().path();
+            requests->append(path);
+            if (path.endsWith(QLatin1String("/status.php"))) {
+                return new FakePayloadReply(op, request,
+                    QByteArray(R"({"installed":true,"maintenance":)") + (*maintenance ? "true" : "false")
+                        + R"(,"version":"10.1.0.0","versionstring":"10.1.0"})",
+                    fakeQnam);
+            }
+            if (path.endsWith(QLatin1String("/cloud/capabilities"))) {
+                return new FakePayloadReply(op, request,
+                    R"({"ocs":{"meta":{"status":"ok","statuscode":100,"message":null},"data":{"capabilities":)"
+                    R"({"core":{"pollinterval":60,"status":{"version":"10.1.0.0"}},"files":{"bigfilechunking":true}}}}})",
+                    fakeQnam);
+            }
+            if (path.endsWith(QLatin1String("/config"))) {
+                return new FakePayloadReply(op, request,
+                    R"({"ocs":{"meta":{"status":"ok","statuscode":100,"message":null},"data":{"host":"localhost"}}})",
+                    fakeQnam);
+            }
+            if (path.endsWith(QLatin1String("/cloud/user"))) {
+                return new FakePayloadReply(op, request,
+                    R"({"ocs":{"meta":{"status":"ok","statuscode":100,"message":null},"data":{"id":"admin","display-name":"New Name"}}})",
+                    fakeQnam);
+            }
+            if (path.contains(QLatin1String("/avatars/"))) {
+                return new FakeErrorReply(op, request, fakeQnam, 404);
+            }
+            return nullptr;
+        });
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(_confDir.isValid());
+        ConfigFile::setConfDir(_confDir.path()); // we don't want to pollute the user's config file
+    }
+
+    void testCachedServerInfo()
+    {
+        auto fakeQnam = new FakeQNAM(FileInfo{});
+        QStringList requests;
+        bool maintenance = false;
+        setupServer(fakeQnam, &requests, &maintenance);
+        auto account = cachedAccount(fakeQnam);
+        QSignalSpy saved(account.data(), &Account::wantsAccountSaved);
+
+        QList<ConnectionValidator::Status> results;
+        QStringList requestsWhenConnected;
+        QPointer<ConnectionValidator> validator = new ConnectionValidator(account);
+        connect(validator.data(), &ConnectionValidator::connectionResult, this,
+            [&](ConnectionValidator::Status status, const QStringList &) {
+                results.append(status);
+                requestsWhenConnected = requests;
+            });
+        validator->checkServerAndAuth();
+        QTRY_VERIFY(!validator);
+
+        // Connected right after the credentials check, and only once
+        QCOMPARE(results, QList<ConnectionValidator::Status>{ ConnectionValidator::Connected });
+        QCOMPARE(requestsWhenConnected.size(), 1);
+        QVERIFY(requestsWhenConnected.first().endsWith(QLatin1String("/remote.php/webdav/")));
+
+        // The revalidation ran and the changed info is saved
+        QVERIFY(requests.size() > 1);
+        QVERIFY(requests[1].endsWith(QLatin1String("/status.php")));
+        QVERIFY(saved.count() >= 1);
+        QCOMPARE(account->serverVersion(), QStringLiteral("10.1.0.0"));
+        QCOMPARE(account->davDisplayName(), QStringLiteral("New Name"));
+        QVERIFY(account->capabilities().raw().contains(QStringLiteral("files")));
+        QVERIFY(!account->isServerInfoFromCache());
+    }
+
+    void testRevalidationFailure()
+    {
+        auto fakeQnam = new FakeQNAM(FileInfo{});
+        QStringList requests;
+        bool maintenance = true;
+        setupServer(fakeQnam, &requests, &maintenance);
+        auto account = cachedAccount(fakeQnam);
+
+        QList<ConnectionValidator::Status> results;
+        QPointer<ConnectionValidator> validator = new ConnectionValidator(account);
+        connect(validator.data(), &ConnectionValidator::connectionResult, this,
+            [&](ConnectionValidator::Status status, const QStringList &) { results.append(status); });
+        validator->checkServerAndAuth();
+        QTRY_VERIFY(!validator);
+
+        // The failure found by the revalidation is reported after Connected
+        QCOMPARE(results, QList<ConnectionValidator::Status>({ ConnectionValidator::Connected, ConnectionValidator::MaintenanceMode }));
+        QVERIFY(!account->isServerInfoFromCache());
+
+        // The next check doesn't use the cache anymore
+        requests.clear();
+        results.clear();
+        maintenance = false;
+        validator = new ConnectionValidator(account);
+        connect(validator.data(), &ConnectionValidator::connectionResult, this,
+            [&](ConnectionValidator::Status status, const QStringList &) { results.append(status); });
+        validator->checkServerAndAuth();
+        QTRY_VERIFY(!validator);
+        QCOMPARE(results, QList<ConnectionValidator::Status>{ ConnectionValidator::Connected });
+        QVERIFY(requests.first().endsWith(QLatin1String("/status.php")));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestConnectionValidator)
+#include "testconnectionvalidator.moc"
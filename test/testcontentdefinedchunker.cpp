@@ -0,0 +1,121 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+
+#include "contentdefinedchunker.h"
+
+using namespace OCC;
+
+static QByteArray randomData(int size, quint64 seed)
+{
+    // xorshift, so the data doesn't depend on the platform's qrand()
+    QByteArray data(size, Qt::Uninitialized);
+    quint64 x = seed;
+    for (int i = 0; i < size; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        data[i] = char(x >> 32);
+    }
+    return data;
+}
+
+static QSet<QByteArray> hashes(const ContentDefinedChunker::Chunks &chunks)
+{
+    QSet<QByteArray> result;
+    for (const auto &chunk : chunks)
+        result.insert(chunk._hash);
+    return result;
+}
+
+class TestContentDefinedChunker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testChunkSizes()
+    {
+        ContentDefinedChunker chunker(64 * 1024);
+        const auto data = randomData(4 * 1024 * 1024, 1);
+        const auto chunks = chunker.chunkData(data);
+
+        QVERIFY(chunks.size() > 16);
+        qint64 offset = 0;
+        for (int i = 0; i < chunks.size(); ++i) {
+            const auto &chunk = chunks[i];
+            QCOMPARE(chunk._offset, offset);
+            QVERIFY(chunk._size <= chunker.maxSize());
+            if (i != chunks.size() - 1)
+                QVERIFY(chunk._size >= chunker.minSize());
+            QCOMPARE(chunk._hash, QCryptographicHash::hash(data.mid(int(offset), int(chunk._size)), QCryptographicHash::Sha1));
+            offset += chunk._size;
+        }
+        QCOMPARE(offset, qint64(data.size()));
+
+        // Data without any boundaries is cut at the maximum size
+        const auto uniformChunks = chunker.chunkData(QByteArray(int(3 * chunker.maxSize()), 'A'));
+        QVERIFY(uniformChunks.size() >= 3);
+    }
+
+    void testEditsKeepOtherChunks_data()
+    {
+        QTest::addColumn<int>("position");
+        QTest::addColumn<int>("removed");
+        QTest::addColumn<int>("inserted");
+
+        QTest::newRow("insert at start") << 0 << 0 << 1;
+        QTest::newRow("insert in middle") << 2000000 << 0 << 100;
+        QTest::newRow("remove in middle") << 2000000 << 5000 << 0;
+        QTest::newRow("overwrite in middle") << 3000000 << 10 << 10;
+        QTest::newRow("append") << 4 * 1024 * 1024 << 0 << 1000;
+    }
+
+    void testEditsKeepOtherChunks()
+    {
+        QFETCH(int, position);
+        QFETCH(int, removed);
+        QFETCH(int, inserted);
+
+        ContentDefinedChunker chunker(64 * 1024);
+        const auto data = randomData(4 * 1024 * 1024, 2);
+        auto edited = data;
+        edited.replace(position, removed, randomData(inserted, 3));
+
+        const auto chunks = chunker.chunkData(edited);
+        const auto known = hashes(chunker.chunkData(data));
+        qint64 newBytes = 0;
+        for (const auto &chunk : chunks) {
+            if (!known.contains(chunk._hash))
+                newBytes += chunk._size;
+        }
+        // Only the chunks around the edit change
+        QVERIFY(newBytes > 0);
+        QVERIFY(newBytes <= 2 * chunker.maxSize());
+    }
+
+    void testChunkFile()
+    {
+        // Larger than the buffer chunkFile() reads at a time
+        const auto data = randomData(3 * 1024 * 1024 + 17, 4);
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        file.write(data);
+        file.close();
+
+        ContentDefinedChunker chunker(64 * 1024);
+        const auto result = chunker.chunkFile(file.fileName());
+        QVERIFY(result.errorString.isEmpty());
+        QCOMPARE(hashes(result.chunks), hashes(chunker.chunkData(data)));
+        QCOMPARE(result.chunks.size(), chunker.chunkData(data).size());
+
+        QVERIFY(!chunker.chunkFile(file.fileName() + QStringLiteral(".missing")).errorString.isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestContentDefinedChunker)
+#include "testcontentdefinedchunker.moc"
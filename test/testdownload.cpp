@@ -19,7 +19,7 @@ class BrokenFakeGetReply : public FakeGetReply
     Q_OBJECT
 public:
     using FakeGetReply::FakeGetReply;
-    int fakeSize = stopAfter;
+    qint64 fakeSize = stopAfter;
 
     qint64 bytesAvailable() const override
     {
@@ -30,7 +30,7 @@ public:
 
     qint64 readData(char *data, qint64 maxlen) override
     {
-        qint64 len = std::min(qint64{ fakeSize }, maxlen);
+        qint64 len = std::min(fakeSize, maxlen);
         std::fill_n(data, len, payload);
         size -= len;
         fakeSize -= len;
@@ -90,6 +90,165 @@ private slots:
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
 
+    void testWriteBatching_data()
+    {
+        QTest::addColumn<qint64>("batchSize");
+        QTest::addColumn<bool>("writeInThread");
+
+        QTest::newRow("unbatched") << qint64(0) << false;
+        QTest::newRow("batched") << qint64(1024 * 1024) << false;
+        QTest::newRow("batched in thread") << qint64(1024 * 1024) << true;
+    }
+
+    void testWriteBatching()
+    {
+        QFETCH(qint64, batchSize);
+        QFETCH(bool, writeInThread);
+
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().setIgnoreHiddenFiles(true);
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._downloadWriteBatchSize = batchSize;
+        options._downloadWriteThread = writeInThread;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        fakeFolder.remoteModifier().insert("A/a0", 30 * 1000 * 1000);
+
+        // Whatever was received before the download broke off is on disk
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation && request.url().path().endsWith("A/a0")) {
+                return new BrokenFakeGetReply(fakeFolder.remoteModifier(), op, request, this);
+            }
+            return nullptr;
+        });
+        QVERIFY(!fakeFolder.syncOnce());
+
+        QByteArray ranges;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation && request.url().path().endsWith("A/a0")) {
+                ranges = request.rawHeader("Range");
+            }
+            return nullptr;
+        });
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(ranges, QByteArray("bytes=" + QByteArray::number(stopAfter) + "-"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
+    void testSegmentedDownload()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().setIgnoreHiddenFiles(true);
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._downloadSegments = 4;
+        options._segmentedDownloadMinFileSize = 1000 * 1000;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        QSignalSpy completeSpy(&fakeFolder.syncEngine(), SIGNAL(itemCompleted(const SyncFileItemPtr &)));
+        // There are no more segments than parallel transfers, see
+        // OwncloudPropagator::maximumActiveTransferJob()
+        const int segmentCount = 3;
+        const auto size = 30 * 1000 * 1000;
+        const auto segmentSize = size / segmentCount;
+        const auto lastStart = size - segmentSize;
+        fakeFolder.remoteModifier().insert("A/a0", size);
+        fakeFolder.remoteModifier().insert("A/small", 1000);
+
+        // The last segment breaks off after 3 MB. The segments only start
+        // while transfer slots are free, the last one may have to wait for
+        // the others.
+        QByteArrayList ranges;
+        int runningGets = 0;
+        int maxRunningGets = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::GetOperation)
+                return nullptr;
+            FakeGetReply *reply = nullptr;
+            if (request.url().path().endsWith("A/a0")) {
+                ranges.append(request.rawHeader("Range"));
+                if (request.rawHeader("Range").startsWith("bytes=" + QByteArray::number(lastStart) + '-'))
+                    reply = new BrokenFakeGetReply(fakeFolder.remoteModifier(), op, request, this);
+            }
+            if (request.url().path().endsWith("A/small")) {
+                ranges.append(request.rawHeader("Range"));
+            }
+            if (!reply)
+                reply = new FakeGetReply(fakeFolder.remoteModifier(), op, request, this);
+            // Aborted replies don't finish, they are only deleted
+            maxRunningGets = qMax(maxRunningGets, ++runningGets);
+            auto done = QSharedPointer<bool>::create(false);
+            auto release = [&runningGets, done] {
+                if (!*done)
+                    --runningGets;
+                *done = true;
+            };
+            connect(reply, &QNetworkReply::finished, release);
+            connect(reply, &QObject::destroyed, release);
+            return reply;
+        });
+
+        QVERIFY(!fakeFolder.syncOnce());
+        QCOMPARE(getItem(completeSpy, "A/a0")->_status, SyncFileItem::SoftError);
+        QVERIFY(fakeFolder.syncEngine().isAnotherSyncNeeded());
+        // One request per segment, small files are downloaded in one piece
+        QCOMPARE(ranges.size(), segmentCount + 1);
+        QVERIFY(ranges.contains(QByteArray()));
+        for (int i = 0; i < segmentCount; ++i) {
+            QVERIFY(ranges.contains("bytes=" + QByteArray::number(i * segmentSize) + '-'
+                + QByteArray::number((i + 1) * segmentSize - 1)));
+        }
+        // The segments don't take more slots than the propagator has
+        QVERIFY(maxRunningGets <= segmentCount);
+        auto segments = fakeFolder.syncJournal().getDownloadSegments("A/a0");
+        QCOMPARE(segments.size(), segmentCount);
+        QCOMPARE(segments.last()._received, qint64(stopAfter));
+
+        // The next sync resumes each segment where it stopped
+        ranges.clear();
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation && request.url().path().endsWith("A/a0"))
+                ranges.append(request.rawHeader("Range"));
+            return nullptr;
+        });
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(ranges.contains("bytes=" + QByteArray::number(lastStart + stopAfter) + '-' + QByteArray::number(size - 1)));
+        for (const auto &segment : segments) {
+            if (segment.remaining() == 0)
+                continue;
+            QVERIFY(ranges.contains("bytes=" + QByteArray::number(segment._start + segment._received) + '-'
+                + QByteArray::number(segment._end - 1)));
+        }
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(fakeFolder.syncJournal().getDownloadSegments("A/a0").isEmpty());
+        QVERIFY(!fakeFolder.syncJournal().getDownloadInfo("A/a0")._valid);
+    }
+
+    void testSegmentedDownloadRangesUnsupported()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.syncEngine().setIgnoreHiddenFiles(true);
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._downloadSegments = 4;
+        options._segmentedDownloadMinFileSize = 1000 * 1000;
+        fakeFolder.syncEngine().setSyncOptions(options);
+        fakeFolder.remoteModifier().insert("A/a0", 30 * 1000 * 1000);
+
+        // The server ignores the Range header, the file is downloaded in one piece
+        int unrangedGets = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation && request.url().path().endsWith("A/a0")) {
+                if (!request.hasRawHeader("Range"))
+                    ++unrangedGets;
+                QNetworkRequest withoutRange(request);
+                withoutRange.setRawHeader("Range", QByteArray());
+                return new FakeGetReply(fakeFolder.remoteModifier(), op, withoutRange, this);
+            }
+            return nullptr;
+        });
+
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(unrangedGets, 1);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     void testErrorMessage () {
         // This test's main goal is to test that the error string from the server is shown in the UI
 
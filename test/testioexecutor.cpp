@@ -0,0 +1,69 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <QtTest>
+
+#include "ioexecutor.h"
+
+using namespace OCC;
+
+class TestIoExecutor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRunsInOrder()
+    {
+        IoExecutor executor;
+        QObject context;
+        QList<int> results;
+        QSet<QThread *> taskThreads;
+        QMutex mutex;
+
+        for (int i = 0; i < 10; ++i) {
+            executor.run(&context,
+                [i, &taskThreads, &mutex] {
+                    QMutexLocker locker(&mutex);
+                    taskThreads.insert(QThread::currentThread());
+                    return i;
+                },
+                [&results](int result) {
+                    QCOMPARE(QThread::currentThread(), qApp->thread());
+                    results.append(result);
+                });
+        }
+        QTRY_COMPARE(results.size(), 10);
+        QCOMPARE(results, QList<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+        QVERIFY(!taskThreads.contains(qApp->thread()));
+    }
+
+    void testContextDestroyed()
+    {
+        IoExecutor executor;
+        auto context = new QObject;
+        QSemaphore started;
+        QSemaphore proceed;
+        bool called = false;
+
+        executor.run(context,
+            [&started, &proceed] {
+                started.release();
+                proceed.acquire();
+                return true;
+            },
+            [&called](bool) { called = true; });
+
+        started.acquire();
+        delete context;
+        proceed.release();
+        executor.waitForDone();
+        QCoreApplication::processEvents();
+        QVERIFY(!called);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestIoExecutor)
+#include "testioexecutor.moc"
@@ -0,0 +1,79 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include "networkjobbudget.h"
+#include <syncengine.h>
+
+using namespace OCC;
+
+class TestNetworkJobBudget : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testConcurrentSyncsShareBudget()
+    {
+        NetworkJobBudget budget(4);
+        FakeFolder fakeFolder1{ FileInfo{} };
+        FakeFolder fakeFolder2{ FileInfo{} };
+        int running = 0;
+        int maxRunning = 0;
+        QObject parent;
+
+        int running1 = 0;
+        int running2 = 0;
+        bool bothRunning = false;
+        auto setup = [&](FakeFolder &fakeFolder, int &folderRunning) {
+            SyncOptions syncOptions;
+            syncOptions._parallelNetworkJobs = 6;
+            fakeFolder.syncEngine().setSyncOptions(syncOptions);
+            fakeFolder.syncEngine().setNetworkJobBudget(&budget);
+            for (int i = 0; i < 20; ++i)
+                fakeFolder.localModifier().insert(QString("del%1").arg(i));
+            QVERIFY(fakeFolder.syncOnce());
+
+            fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+                if (op != QNetworkAccessManager::DeleteOperation)
+                    return nullptr;
+                auto reply = new DelayedReply<FakeDeleteReply>(50, fakeFolder.remoteModifier(), op, request, &parent);
+                maxRunning = qMax(maxRunning, ++running);
+                ++folderRunning;
+                bothRunning |= running1 > 0 && running2 > 0;
+                connect(reply, &QNetworkReply::finished, &parent, [&] { --running; --folderRunning; });
+                return reply;
+            });
+            for (int i = 0; i < 20; ++i)
+                fakeFolder.localModifier().remove(QString("del%1").arg(i));
+        };
+        setup(fakeFolder1, running1);
+        setup(fakeFolder2, running2);
+
+        QSignalSpy finished1(&fakeFolder1.syncEngine(), SIGNAL(finished(bool)));
+        QSignalSpy finished2(&fakeFolder2.syncEngine(), SIGNAL(finished(bool)));
+        fakeFolder1.scheduleSync();
+        fakeFolder2.scheduleSync();
+        QTRY_VERIFY_WITH_TIMEOUT(finished1.count() == 1 && finished2.count() == 1, 20000);
+        QVERIFY(finished1[0][0].toBool());
+        QVERIFY(finished2[0][0].toBool());
+
+        QCOMPARE(fakeFolder1.currentLocalState(), fakeFolder1.currentRemoteState());
+        QCOMPARE(fakeFolder2.currentLocalState(), fakeFolder2.currentRemoteState());
+        QCOMPARE(running, 0);
+        // Each folder alone would run 6 deletes at a time
+        QVERIFY(maxRunning <= 4);
+        // Neither folder hogs the whole budget
+        QVERIFY(bothRunning);
+        QCOMPARE(budget.activeJobCount(), 0);
+        // Finished propagators aren't woken anymore
+        QCOMPARE(budget.waitingCount(), 0);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestNetworkJobBudget)
+#include "testnetworkjobbudget.moc"
@@ -126,6 +126,55 @@ private slots:
         }
     }
 
+    void testTypedBinding() {
+        SqlQuery q(_db);
+        q.prepare("INSERT INTO addresses (id, name, address, entered) VALUES (?1, ?2, ?3, ?4);");
+        q.bindInt64(1, 4);
+        q.bindText(2, QByteArray("Zoë"));
+        q.bindText(3, QByteArray());
+        q.bindInt64(4, Q_INT64_C(1) << 40);
+        QVERIFY(q.exec());
+
+        SqlQuery s("SELECT name, address, entered FROM addresses WHERE id=?1", _db);
+        s.bindInt64(1, 4);
+        QVERIFY(s.exec());
+        QVERIFY(s.next());
+        QCOMPARE(s.baValueRaw(0), QByteArray("Zoë"));
+        QCOMPARE(s.stringValue(0), QString::fromUtf8("Zoë"));
+        QVERIFY(s.baValueRaw(1).isEmpty());
+        QCOMPARE(s.int64Value(2), quint64(1) << 40);
+    }
+
+    void testQueryCache() {
+        SqlQueryCache cache(_db, 2);
+        const QByteArray byId = "SELECT name FROM addresses WHERE id=?1";
+
+        auto q = cache.get(byId);
+        QVERIFY(q);
+        q->bindInt64(1, 1);
+        QVERIFY(q->exec());
+        QVERIFY(q->next());
+        QCOMPARE(q->stringValue(0), QStringLiteral("Gonzo Alberto"));
+
+        // The same statement comes back reset, with the bindings cleared
+        QCOMPARE(cache.get(byId), q);
+        q->bindInt64(1, 2);
+        QVERIFY(q->exec());
+        QVERIFY(q->next());
+        QCOMPARE(q->stringValue(0), QStringLiteral("Brucely Lafayette"));
+        QCOMPARE(cache.size(), 1);
+
+        // byId is the most recently used one and survives the eviction
+        QVERIFY(cache.get("SELECT id FROM addresses"));
+        QCOMPARE(cache.get(byId), q);
+        QVERIFY(cache.get("SELECT address FROM addresses"));
+        QCOMPARE(cache.size(), 2);
+        QCOMPARE(cache.get(byId), q);
+
+        cache.clear();
+        QCOMPARE(cache.size(), 0);
+    }
+
     void testDestructor()
     {
         // This test make sure that the destructor of SqlQuery works even if the SqlDatabase
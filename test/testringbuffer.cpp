@@ -0,0 +1,104 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <QtTest>
+
+#include "common/ringbuffer.h"
+
+using namespace OCC;
+
+static QList<int> contents(const RingBuffer<int> &buffer)
+{
+    QList<int> result;
+    for (int i = 0; i < buffer.size(); ++i)
+        result.append(buffer.at(i));
+    return result;
+}
+
+class TestRingBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testAppend()
+    {
+        RingBuffer<int> buffer(3);
+        QVERIFY(buffer.isEmpty());
+        buffer.append(1);
+        buffer.append(2);
+        QCOMPARE(buffer.size(), 2);
+        QVERIFY(!buffer.isFull());
+        QCOMPARE(contents(buffer), QList<int>({ 1, 2 }));
+
+        // Appending to a full buffer drops the oldest entries
+        buffer.append(3);
+        QVERIFY(buffer.isFull());
+        buffer.append(4);
+        buffer.append(5);
+        QCOMPARE(buffer.size(), 3);
+        QCOMPARE(contents(buffer), QList<int>({ 3, 4, 5 }));
+
+        buffer[0] = 7;
+        QCOMPARE(contents(buffer), QList<int>({ 7, 4, 5 }));
+
+        buffer.clear();
+        QVERIFY(buffer.isEmpty());
+        buffer.append(8);
+        QCOMPARE(contents(buffer), QList<int>({ 8 }));
+    }
+
+    void testRemoveFirst()
+    {
+        RingBuffer<int> buffer(4);
+        for (int i = 1; i <= 6; ++i)
+            buffer.append(i);
+        QCOMPARE(contents(buffer), QList<int>({ 3, 4, 5, 6 }));
+
+        buffer.removeFirst(2);
+        QCOMPARE(contents(buffer), QList<int>({ 5, 6 }));
+
+        // The freed slots are reused
+        buffer.append(7);
+        buffer.append(8);
+        QCOMPARE(contents(buffer), QList<int>({ 5, 6, 7, 8 }));
+        buffer.append(9);
+        QCOMPARE(contents(buffer), QList<int>({ 6, 7, 8, 9 }));
+
+        buffer.removeFirst(4);
+        QVERIFY(buffer.isEmpty());
+        buffer.append(10);
+        QCOMPARE(contents(buffer), QList<int>({ 10 }));
+    }
+
+    void testRemoveAt()
+    {
+        RingBuffer<int> buffer(4);
+        for (int i = 1; i <= 5; ++i)
+            buffer.append(i);
+        buffer.removeAt(1);
+        QCOMPARE(contents(buffer), QList<int>({ 2, 4, 5 }));
+        buffer.append(6);
+        buffer.append(7);
+        QCOMPARE(contents(buffer), QList<int>({ 4, 5, 6, 7 }));
+    }
+
+    void testRemoveIf()
+    {
+        RingBuffer<int> buffer(5);
+        for (int i = 1; i <= 8; ++i)
+            buffer.append(i);
+        QCOMPARE(buffer.removeIf([](int i) { return i % 2 == 0; }), 3);
+        QCOMPARE(contents(buffer), QList<int>({ 5, 7 }));
+        QCOMPARE(buffer.removeIf([](int) { return false; }), 0);
+
+        for (int i = 9; i <= 12; ++i)
+            buffer.append(i);
+        QCOMPARE(contents(buffer), QList<int>({ 7, 9, 10, 11, 12 }));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestRingBuffer)
+#include "testringbuffer.moc"
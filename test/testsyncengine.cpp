@@ -98,6 +98,90 @@ private slots:
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
 
+    // Deletes and moves of files may use all the parallel slots, not just the transfer ones
+    void testParallelRemoteDeletesAndMoves() {
+        FakeFolder fakeFolder{FileInfo{}};
+        SyncOptions syncOptions;
+        syncOptions._parallelNetworkJobs = 20;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+        fakeFolder.localModifier().mkdir("A");
+        for (int i = 0; i < 40; ++i)
+            fakeFolder.localModifier().insert(QString("A/del%1").arg(i));
+        for (int i = 0; i < 40; ++i)
+            fakeFolder.localModifier().insert(QString("A/mv%1").arg(i));
+        QVERIFY(fakeFolder.syncOnce());
+
+        int running = 0;
+        int maxRunning = 0;
+        QObject parent;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            auto verb = request.attribute(QNetworkRequest::CustomVerbAttribute);
+            QNetworkReply *reply = nullptr;
+            if (verb == "DELETE" || op == QNetworkAccessManager::DeleteOperation)
+                reply = new DelayedReply<FakeDeleteReply>(100, fakeFolder.remoteModifier(), op, request, &parent);
+            else if (verb == "MOVE")
+                reply = new DelayedReply<FakeMoveReply>(100, fakeFolder.remoteModifier(), op, request, &parent);
+            if (reply) {
+                maxRunning = qMax(maxRunning, ++running);
+                connect(reply, &QNetworkReply::finished, &parent, [&running] { --running; });
+            }
+            return reply;
+        });
+
+        fakeFolder.localModifier().mkdir("B");
+        for (int i = 0; i < 40; ++i) {
+            fakeFolder.localModifier().remove(QString("A/del%1").arg(i));
+            fakeFolder.localModifier().rename(QString("A/mv%1").arg(i), QString("B/mv%1").arg(i));
+        }
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(running, 0);
+        // Previously at most twice the transfer limit of 3 were admitted
+        QVERIFY(maxRunning > 6);
+        QVERIFY(maxRunning <= 20);
+    }
+
+    // Small uploads don't wait behind the large ones, which only get part of the transfer slots
+    void testSmallFilesFirst() {
+        FakeFolder fakeFolder{FileInfo{}};
+        SyncOptions syncOptions;
+        syncOptions._smallFilesFirst = true;
+        syncOptions._largeFileSize = 1000 * 1000;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+        int largeRunning = 0;
+        int maxLargeRunning = 0;
+        int largeFinished = 0;
+        int smallStartedBeforeLarge = 0;
+        QObject parent;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *outgoingData) -> QNetworkReply * {
+            if (op != QNetworkAccessManager::PutOperation)
+                return nullptr;
+            if (!request.url().path().contains("/A/big")) {
+                if (largeFinished == 0)
+                    ++smallStartedBeforeLarge;
+                return new FakePutReply(fakeFolder.remoteModifier(), op, request, outgoingData->readAll(), &parent);
+            }
+            auto reply = new DelayedReply<FakePutReply>(300, fakeFolder.remoteModifier(), op, request, outgoingData->readAll(), &parent);
+            maxLargeRunning = qMax(maxLargeRunning, ++largeRunning);
+            connect(reply, &QNetworkReply::finished, &parent, [&] { --largeRunning; ++largeFinished; });
+            return reply;
+        });
+
+        fakeFolder.localModifier().mkdir("A");
+        for (int i = 0; i < 4; ++i)
+            fakeFolder.localModifier().insert(QString("A/big%1").arg(i), 2 * 1000 * 1000);
+        for (int i = 0; i < 20; ++i)
+            fakeFolder.localModifier().insert(QString("A/small%1").arg(i), 1000);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QCOMPARE(largeRunning, 0);
+        // One of the 3 transfer slots is kept for files that aren't large
+        QCOMPARE(maxLargeRunning, 2);
+        // In tree order the small files would have waited for the first large uploads
+        QCOMPARE(smallStartedBeforeLarge, 20);
+    }
+
     void testEmlLocalChecksum() {
         FakeFolder fakeFolder{FileInfo{}};
         fakeFolder.localModifier().insert("a1.eml", 64, 'A');
@@ -141,6 +225,121 @@ private slots:
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
 
+    void testTouchedFileChecksum() {
+        FakeFolder fakeFolder{FileInfo{}};
+        auto options = fakeFolder.syncEngine().syncOptions();
+        options._checksumTouchedFiles = true;
+        fakeFolder.syncEngine().setSyncOptions(options);
+
+        fakeFolder.localModifier().mkdir("A");
+        fakeFolder.localModifier().insert("A/a1", 64, 'A');
+        fakeFolder.localModifier().insert("A/a2", 64, 'A');
+        fakeFolder.localModifier().insert("A/a3", 64, 'A');
+        QVERIFY(fakeFolder.syncOnce());
+
+        auto getDbRecord = [&](QString path) {
+            SyncJournalFileRecord record;
+            fakeFolder.syncJournal().getFileRecord(path, &record);
+            return record;
+        };
+        QByteArray referenceChecksum("SHA1:30b86e44e6001403827a62c58b08893e77cf121f");
+        QCOMPARE(getDbRecord("A/a1")._checksumHeader, referenceChecksum);
+        auto a1Modtime = getDbRecord("A/a1")._modtime;
+
+        QSignalSpy completeSpy(&fakeFolder.syncEngine(), SIGNAL(itemCompleted(const SyncFileItemPtr &)));
+        // Only touch a1, change the content but not the size of a2
+        fakeFolder.localModifier().setContents("A/a1", 'A');
+        fakeFolder.localModifier().setContents("A/a2", 'B');
+        fakeFolder.localModifier().appendByte("A/a3");
+        QVERIFY(fakeFolder.syncOnce());
+
+        QVERIFY(!itemDidComplete(completeSpy, "A/a1"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "A/a2"));
+        QVERIFY(itemDidCompleteSuccessfully(completeSpy, "A/a3"));
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // The new mtime was stored along with the unchanged checksum
+        QVERIFY(getDbRecord("A/a1")._modtime != a1Modtime);
+        QCOMPARE(getDbRecord("A/a1")._checksumHeader, referenceChecksum);
+        QCOMPARE(getDbRecord("A/a2")._checksumHeader, QByteArray("SHA1:84951fc23a4dafd10020ac349da1f5530fa65949"));
+    }
+
+    void testServerSideCopy() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.syncEngine().account()->setCapabilities({ { "dav", QVariantMap{ {"serverSideCopy", true} } } });
+        const int size = 200 * 1000;
+
+        int nPUT = 0;
+        int nCOPY = 0;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PutOperation)
+                ++nPUT;
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute) == "COPY")
+                ++nCOPY;
+            return nullptr;
+        });
+
+        fakeFolder.localModifier().insert("A/big", size, 'C');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 1);
+        QCOMPARE(nCOPY, 0);
+
+        auto getDbRecord = [&](QString path) {
+            SyncJournalFileRecord record;
+            fakeFolder.syncJournal().getFileRecord(path, &record);
+            return record;
+        };
+
+        // A copy of the file is copied on the server
+        nPUT = 0;
+        fakeFolder.localModifier().insert("B/copy", size, 'C');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 0);
+        QCOMPARE(nCOPY, 1);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+        QVERIFY(getDbRecord("B/copy").isValid());
+        QVERIFY(getDbRecord("B/copy")._fileId != getDbRecord("A/big")._fileId);
+        QCOMPARE(getDbRecord("B/copy")._checksumHeader, getDbRecord("A/big")._checksumHeader);
+
+        // Different content and small files are uploaded
+        nCOPY = 0;
+        fakeFolder.localModifier().insert("B/other", size, 'D');
+        fakeFolder.localModifier().insert("B/small", 10, 'C');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 2);
+        QCOMPARE(nCOPY, 0);
+
+        // If the source changed on the server the COPY fails and the file is uploaded.
+        // It changes after the discovery, so A/big isn't downloaded in the same sync.
+        nPUT = 0;
+        nCOPY = 0;
+        auto &remoteInfo = dynamic_cast<FileInfo &>(fakeFolder.remoteModifier());
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::PutOperation)
+                ++nPUT;
+            if (request.attribute(QNetworkRequest::CustomVerbAttribute) == "COPY") {
+                ++nCOPY;
+                remoteInfo.find("A/big")->etag = "changed";
+            }
+            return nullptr;
+        });
+        fakeFolder.localModifier().insert("C/copy", size, 'C');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nCOPY, 1);
+        QCOMPARE(nPUT, 1);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        // Without the capability there is no COPY
+        fakeFolder.syncEngine().account()->setCapabilities({});
+        nPUT = 0;
+        nCOPY = 0;
+        fakeFolder.localModifier().insert("C/copy2", size, 'C');
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(nPUT, 1);
+        QCOMPARE(nCOPY, 0);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
+
     void testSelectiveSyncBug() {
         // issue owncloud/enterprise#1965: files from selective-sync ignored
         // folders are uploaded anyway is some circumstances.
@@ -465,6 +465,62 @@ private slots:
 
         QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
     }
+
+    void excludedStatusFollowsExcludeChanges() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        auto &tracker = fakeFolder.syncEngine().syncFileStatusTracker();
+        QCOMPARE(tracker.fileStatus("A/a1"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+
+        // The cached verdict must not survive changes of the patterns
+        fakeFolder.syncEngine().excludedFiles().addManualExclude("A/a1");
+        QCOMPARE(tracker.fileStatus("A/a1"), SyncFileStatus(SyncFileStatus::StatusWarning));
+        fakeFolder.syncEngine().excludedFiles().clearManualExcludes();
+        QCOMPARE(tracker.fileStatus("A/a1"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+
+        // Nor a change of the hidden files setting
+        fakeFolder.localModifier().insert("A/.hidden");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(tracker.fileStatus("A/.hidden"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        fakeFolder.syncEngine().setIgnoreHiddenFiles(true);
+        QCOMPARE(tracker.fileStatus("A/.hidden"), SyncFileStatus(SyncFileStatus::StatusWarning));
+    }
+
+    void prefetchedDirectoryStatus() {
+        FakeFolder fakeFolder{FileInfo::A12_B12_C12_S12()};
+        fakeFolder.localModifier().insert("A/a3");
+        auto &tracker = fakeFolder.syncEngine().syncFileStatusTracker();
+
+        auto queryCount = [&]() { return fakeFolder.syncJournal().queryStatistics()._queryCount; };
+
+        // Once a directory was prefetched, its entries don't hit the journal anymore
+        tracker.prefetchDirectory("A", { "a1", "a2", "a3" });
+        auto queriesBefore = queryCount();
+        QCOMPARE(tracker.fileStatus("A/a1"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(tracker.fileStatus("A/a2"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(tracker.fileStatus("A/a3"), SyncFileStatus(SyncFileStatus::StatusNone));
+        QCOMPARE(queryCount(), queriesBefore);
+
+        tracker.prefetchDirectory("", { "A", "B", "C", "S" });
+        queriesBefore = queryCount();
+        QCOMPARE(tracker.fileStatus("A"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(tracker.fileStatus("S"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(queryCount(), queriesBefore);
+
+        // The index follows the propagation
+        fakeFolder.localModifier().remove("A/a2");
+        fakeFolder.remoteModifier().rename("B/b1", "B/b3");
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(tracker.fileStatus("A/a2"), SyncFileStatus(SyncFileStatus::StatusNone));
+        QCOMPARE(tracker.fileStatus("A/a3"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(tracker.fileStatus("B/b1"), SyncFileStatus(SyncFileStatus::StatusNone));
+        QCOMPARE(tracker.fileStatus("B/b3"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+
+        // Same results as a plain lookup in the journal
+        tracker.prefetchDirectory("B", { "b1", "b2", "b3" });
+        QCOMPARE(tracker.fileStatus("B/b1"), SyncFileStatus(SyncFileStatus::StatusNone));
+        QCOMPARE(tracker.fileStatus("B/b2"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+        QCOMPARE(tracker.fileStatus("B/b3"), SyncFileStatus(SyncFileStatus::StatusUpToDate));
+    }
 };
 
 QTEST_GUILESS_MAIN(TestSyncFileStatusTracker)
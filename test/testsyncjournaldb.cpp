@@ -10,6 +10,7 @@
 
 #include "common/syncjournaldb.h"
 #include "common/syncjournalfilerecord.h"
+#include "common/ownsql.h"
 
 using namespace OCC;
 
@@ -148,6 +149,43 @@ private slots:
         QVERIFY(!wipedRecord._valid);
     }
 
+    void testDownloadSegments()
+    {
+        typedef SyncJournalDb::DownloadSegment Segment;
+        QVERIFY(_db.getDownloadSegments("nonexistant").isEmpty());
+
+        SyncJournalDb::DownloadInfo info;
+        info._etag = "ABCDEF";
+        info._valid = true;
+        info._tmpfile = "/tmp/bar";
+        _db.setDownloadInfo("bar", info);
+
+        QVector<Segment> segments(2);
+        segments[0]._end = 100;
+        segments[0]._received = 42;
+        segments[1]._start = 100;
+        segments[1]._end = 150;
+        _db.setDownloadSegments("bar", segments);
+        auto stored = _db.getDownloadSegments("bar");
+        QCOMPARE(stored.size(), 2);
+        QCOMPARE(stored[0]._end, qint64(100));
+        QCOMPARE(stored[0]._received, qint64(42));
+        QCOMPARE(stored[1]._start, qint64(100));
+        QCOMPARE(stored[1].remaining(), qint64(50));
+
+        // Setting replaces the previous segments
+        segments[0]._received = 100;
+        segments.removeLast();
+        _db.setDownloadSegments("bar", segments);
+        stored = _db.getDownloadSegments("bar");
+        QCOMPARE(stored.size(), 1);
+        QCOMPARE(stored[0].remaining(), qint64(0));
+
+        // They are removed with the download info
+        _db.setDownloadInfo("bar", SyncJournalDb::DownloadInfo());
+        QVERIFY(_db.getDownloadSegments("bar").isEmpty());
+    }
+
     void testUploadInfo()
     {
         typedef SyncJournalDb::UploadInfo Info;
@@ -327,6 +365,89 @@ private slots:
         QVERIFY(checkElements());
     }
 
+    void testListFilesInPath()
+    {
+        QByteArrayList elements;
+        elements
+            << "lst"
+            << "lst/b"
+            << "lst/a-2"
+            << "lst/a"
+            << "lst/a/file"
+            << "lst/a/sub"
+            << "lst/a/sub/file"
+            << "lst-2";
+        for (const auto &elem : elements) {
+            SyncJournalFileRecord record;
+            record._path = elem;
+            QVERIFY(_db.setFileRecord(record));
+        }
+
+        QByteArrayList found;
+        auto collect = [&](const SyncJournalFileRecord &rec) { found.append(rec._path); };
+
+        QVERIFY(_db.listFilesInPath("lst", collect));
+        QCOMPARE(found, QByteArrayList({ "lst/a-2", "lst/a", "lst/b" }));
+
+        // The contents of a directory come directly after it
+        found.clear();
+        QVERIFY(_db.getFilesBelowPath("lst", collect));
+        QCOMPARE(found, QByteArrayList({ "lst/a-2", "lst/a", "lst/a/file", "lst/a/sub", "lst/a/sub/file", "lst/b" }));
+
+        found.clear();
+        QVERIFY(_db.getFilesBelowPath("lst/a/sub", collect));
+        QCOMPARE(found, QByteArrayList({ "lst/a/sub/file" }));
+    }
+
+    void testListInodes()
+    {
+        for (const auto inode : { 0, 424242, 424243 }) {
+            SyncJournalFileRecord record;
+            record._path = "inodes/file" + QByteArray::number(inode);
+            record._inode = inode;
+            QVERIFY(_db.setFileRecord(record));
+        }
+
+        QSet<quint64> inodes;
+        QVERIFY(_db.listInodes([&](quint64 inode) { inodes.insert(inode); }));
+        QVERIFY(inodes.contains(424242));
+        QVERIFY(inodes.contains(424243));
+        QVERIFY(!inodes.contains(0));
+    }
+
+    void testParentColumnMigration()
+    {
+        // A metadata table as created by clients that don't have the parent and sortkey columns
+        const QString dbFile = _tempDir.path() + "/migration.db";
+        {
+            SqlDatabase db;
+            QVERIFY(db.openOrCreateReadWrite(dbFile));
+            SqlQuery query(db);
+            QCOMPARE(query.prepare("CREATE TABLE metadata(phash INTEGER(8), pathlen INTEGER, path VARCHAR(4096), inode INTEGER,"
+                                   " uid INTEGER, gid INTEGER, mode INTEGER, modtime INTEGER(8), type INTEGER, md5 VARCHAR(32),"
+                                   " PRIMARY KEY(phash));"), 0);
+            QVERIFY(query.exec());
+            for (const QByteArray path : { "dir", "dir/file", "dir/sub", "dir/sub/file", "dir2" }) {
+                QCOMPARE(query.prepare("INSERT INTO metadata (phash, pathlen, path, type, md5) VALUES (?1, ?2, ?3, 0, 'etag');"), 0);
+                query.bindInt64(1, SyncJournalDb::getPHash(path));
+                query.bindInt64(2, path.size());
+                query.bindText(3, path);
+                QVERIFY(query.exec());
+            }
+        }
+
+        SyncJournalDb journal(dbFile);
+        QByteArrayList found;
+        auto collect = [&](const SyncJournalFileRecord &rec) { found.append(rec._path); };
+        QVERIFY(journal.listFilesInPath("", collect));
+        QCOMPARE(found, QByteArrayList({ "dir", "dir2" }));
+
+        found.clear();
+        QVERIFY(journal.getFilesBelowPath("dir", collect));
+        QCOMPARE(found, QByteArrayList({ "dir/file", "dir/sub", "dir/sub/file" }));
+        journal.close();
+    }
+
 private:
     SyncJournalDb _db;
 };
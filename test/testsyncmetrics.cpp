@@ -0,0 +1,102 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include "syncenginetestutils.h"
+#include <syncengine.h>
+#include <syncmetrics.h>
+
+using namespace OCC;
+
+class TestSyncMetrics : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testHistogram()
+    {
+        LatencyHistogram histogram;
+        histogram.add(0);
+        histogram.add(10);
+        histogram.add(11);
+        histogram.add(100000);
+        QCOMPARE(histogram.count(), quint64(4));
+        QCOMPARE(histogram.totalMsecs(), qint64(100021));
+        QCOMPARE(histogram.maxMsecs(), qint64(100000));
+        QCOMPARE(histogram.bucketCount(10), quint64(2));
+        QCOMPARE(histogram.bucketCount(25), quint64(1));
+        QCOMPARE(histogram.bucketCount(-1), quint64(1));
+
+        auto buckets = histogram.toJson()["buckets"].toArray();
+        QCOMPARE(buckets.size(), LatencyHistogram::bucketUpperBounds().size() + 1);
+        QCOMPARE(buckets.last().toObject()["le"].toString(), QStringLiteral("inf"));
+    }
+
+    void testSyncRun()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.remoteModifier().appendByte("A/a1");
+        fakeFolder.remoteModifier().insert("B/b3", 100);
+        fakeFolder.localModifier().insert("C/c3", 50);
+        QVERIFY(fakeFolder.syncOnce());
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+
+        const auto &metrics = fakeFolder.syncEngine().metrics();
+
+        // The root, A and B changed on the server and had to be listed
+        QVERIFY(metrics.propfindLatency().count() >= 3);
+        QCOMPARE(metrics.propfindErrors(), quint64(0));
+
+        auto transfers = metrics.transfers();
+        QCOMPARE(transfers["PropagateDownloadFile"]._count, quint64(2));
+        QCOMPARE(transfers["PropagateDownloadFile"]._bytes, qint64(5 + 100));
+        quint64 uploads = 0;
+        qint64 uploadedBytes = 0;
+        for (auto it = transfers.constBegin(); it != transfers.constEnd(); ++it) {
+            if (it.key().startsWith("PropagateUploadFile")) {
+                uploads += it->_count;
+                uploadedBytes += it->_bytes;
+            }
+        }
+        QCOMPARE(uploads, quint64(1));
+        QCOMPARE(uploadedBytes, qint64(50));
+
+        QVERIFY(metrics.journalStatistics()._queryCount > 0);
+        QVERIFY(metrics.journalStatistics()._rowCount > 0);
+        QVERIFY(metrics.checksumBytes() >= 50);
+        QVERIFY(metrics.totalMsecs() >= metrics.phaseMsecs(SyncMetrics::Discovery)
+                + metrics.phaseMsecs(SyncMetrics::Reconcile)
+                + metrics.phaseMsecs(SyncMetrics::Propagation));
+
+        // A sync without changes starts from zero again
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(metrics.transfers().isEmpty());
+        QCOMPARE(metrics.checksumBytes(), quint64(0));
+    }
+
+    void testWriteJson()
+    {
+        FakeFolder fakeFolder{ FileInfo::A12_B12_C12_S12() };
+        fakeFolder.remoteModifier().insert("A/a3", 10);
+        QVERIFY(fakeFolder.syncOnce());
+
+        QTemporaryDir dir;
+        const QString fileName = dir.path() + "/metrics.json";
+        QVERIFY(fakeFolder.syncEngine().metrics().writeJson(fileName));
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        auto json = QJsonDocument::fromJson(file.readAll()).object();
+        QVERIFY(json["success"].toBool());
+        QVERIFY(json["phaseMsecs"].toObject().contains("propagation"));
+        QVERIFY(json["propfind"].toObject()["count"].toInt() >= 1);
+        QCOMPARE(json["jobs"].toObject()["PropagateDownloadFile"].toObject()["bytes"].toInt(), 10);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestSyncMetrics)
+#include "testsyncmetrics.moc"
@@ -669,6 +669,55 @@ private slots:
         QVERIFY(itemInstruction(completeSpy, "file2", CSYNC_INSTRUCTION_NEW));
         QVERIFY(dbRecord(fakeFolder, "file2").isValid());
     }
+
+    // A virtual file that is opened during a long sync is downloaded ahead of
+    // the queued downloads
+    void testDownloadVirtualFileNow()
+    {
+        FakeFolder fakeFolder{ FileInfo() };
+        SyncOptions syncOptions;
+        syncOptions._newFilesAreVirtual = true;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+
+        fakeFolder.remoteModifier().mkdir("A");
+        fakeFolder.remoteModifier().insert("A/a1");
+        QVERIFY(fakeFolder.syncOnce());
+        QVERIFY(fakeFolder.currentLocalState().find("A/a1.owncloud"));
+
+        // Nothing to propagate, nothing to download right away
+        QVERIFY(!fakeFolder.syncEngine().downloadVirtualFileNow(dbRecord(fakeFolder, "A/a1.owncloud")));
+
+        syncOptions._newFilesAreVirtual = false;
+        fakeFolder.syncEngine().setSyncOptions(syncOptions);
+        fakeFolder.remoteModifier().mkdir("B");
+        for (int i = 0; i < 20; ++i)
+            fakeFolder.remoteModifier().insert(QString("B/b%1").arg(i), 200 * 1000);
+
+        QObject parent;
+        fakeFolder.setServerOverride([&](QNetworkAccessManager::Operation op, const QNetworkRequest &request, QIODevice *) -> QNetworkReply * {
+            if (op == QNetworkAccessManager::GetOperation && request.url().path().contains("/B/"))
+                return new DelayedReply<FakeGetReply>(50, fakeFolder.remoteModifier(), op, request, &parent);
+            return nullptr;
+        });
+        QStringList completed;
+        connect(&fakeFolder.syncEngine(), &SyncEngine::itemCompleted, &parent,
+            [&](const SyncFileItemPtr &item) { completed.append(item->_file); });
+
+        fakeFolder.scheduleSync();
+        fakeFolder.execUntilBeforePropagation();
+        triggerDownload(fakeFolder, "A/a1");
+        QVERIFY(fakeFolder.syncEngine().downloadVirtualFileNow(dbRecord(fakeFolder, "A/a1.owncloud")));
+        QVERIFY(fakeFolder.execUntilFinished());
+
+        QVERIFY(fakeFolder.currentLocalState().find("A/a1"));
+        QVERIFY(!fakeFolder.currentLocalState().find("A/a1.owncloud"));
+        QVERIFY(!dbRecord(fakeFolder, "A/a1.owncloud").isValid());
+        QCOMPARE(dbRecord(fakeFolder, "A/a1")._type, ItemTypeFile);
+        // Only the downloads that were already running may finish before it
+        QVERIFY(completed.contains("A/a1"));
+        QVERIFY(completed.indexOf("A/a1") <= 4);
+        QCOMPARE(fakeFolder.currentLocalState(), fakeFolder.currentRemoteState());
+    }
 };
 
 QTEST_GUILESS_MAIN(TestSyncVirtualFiles)
@@ -0,0 +1,124 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <QtTest>
+
+#include "tlssessioncache.h"
+#include "accessmanager.h"
+#include "account.h"
+#include "creds/abstractcredentials.h"
+
+using namespace OCC;
+
+// Creates a new AccessManager each time, like the real credentials
+class AccessManagerCredentials : public AbstractCredentials
+{
+public:
+    QString authType() const override { return "test"; }
+    QString user() const override { return "admin"; }
+    QNetworkAccessManager *createQNAM() const override { return new AccessManager; }
+    bool ready() const override { return true; }
+    void fetchFromKeychain() override { }
+    void askFromUser() override { }
+    bool stillValid(QNetworkReply *) override { return true; }
+    void persist() override { }
+    void invalidateToken() override { }
+    void forgetSensitiveData() override { }
+};
+
+class TestTlsSessionCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testStoreAndReload()
+    {
+        QTemporaryDir dir;
+        QString fileName = dir.path() + "/tls_sessions.json";
+        {
+            TlsSessionCache cache(fileName);
+            QVERIFY(cache.ticket(QUrl("https://example.com/owncloud"), "account1").isEmpty());
+            cache.storeTicket(QUrl("https://example.com/owncloud/status.php"), "account1", "ticket1", 0);
+            cache.storeTicket(QUrl("https://example.com:8443/"), "account1", "ticket2", 300);
+            QCOMPARE(cache.ticket(QUrl("https://EXAMPLE.com/remote.php/dav"), "account1"), QByteArray("ticket1"));
+            QCOMPARE(cache.ticket(QUrl("https://example.com:8443/x"), "account1"), QByteArray("ticket2"));
+            QVERIFY(cache.ticket(QUrl("https://example.org/"), "account1").isEmpty());
+        }
+
+        // Like after a restart
+        TlsSessionCache cache(fileName);
+        QCOMPARE(cache.ticket(QUrl("https://example.com/"), "account1"), QByteArray("ticket1"));
+        QCOMPARE(cache.ticket(QUrl("https://example.com:8443/"), "account1"), QByteArray("ticket2"));
+
+        // A new ticket replaces the old one
+        cache.storeTicket(QUrl("https://example.com/"), "account1", "ticket3", 0);
+        QCOMPARE(cache.ticket(QUrl("https://example.com/"), "account1"), QByteArray("ticket3"));
+        QCOMPARE(TlsSessionCache(fileName).ticket(QUrl("https://example.com/"), "account1"), QByteArray("ticket3"));
+    }
+
+    void testIdentitiesDontShareTickets()
+    {
+        QTemporaryDir dir;
+        TlsSessionCache cache(dir.path() + "/tls_sessions.json");
+        cache.storeTicket(QUrl("https://example.com/"), "account1", "ticket1", 0);
+        cache.storeTicket(QUrl("https://example.com/"), "account2/certdigest", "ticket2", 0);
+        QCOMPARE(cache.ticket(QUrl("https://example.com/"), "account1"), QByteArray("ticket1"));
+        QCOMPARE(cache.ticket(QUrl("https://example.com/"), "account2/certdigest"), QByteArray("ticket2"));
+        QVERIFY(cache.ticket(QUrl("https://example.com/"), "account2").isEmpty());
+        QVERIFY(cache.ticket(QUrl("https://example.com/"), QString()).isEmpty());
+    }
+
+    void testAccountIdentity()
+    {
+        auto account = Account::create();
+        account->setUrl(QUrl("https://example.com/owncloud"));
+        account->setCredentials(new AccessManagerCredentials);
+        QNetworkRequest request(account->url());
+        QString identity;
+
+        // Not shared until the account got an id
+        auto am = qobject_cast<AccessManager *>(account->networkAccessManager());
+        QVERIFY(am);
+        QVERIFY(!am->tlsSessionIdentity(request, &identity));
+
+        account->_id = "account1";
+        QVERIFY(am->tlsSessionIdentity(request, &identity));
+        QCOMPARE(identity, QString("account1"));
+
+        // A reconnect's new manager still belongs to the account
+        account->resetNetworkAccessManager();
+        am = qobject_cast<AccessManager *>(account->networkAccessManager());
+        QVERIFY(am);
+        QVERIFY(am->tlsSessionIdentity(request, &identity));
+        QCOMPARE(identity, QString("account1"));
+
+        // Managers without an account don't get its identity
+        AccessManager other;
+        QVERIFY(other.tlsSessionIdentity(request, &identity));
+        QVERIFY(identity.isEmpty());
+    }
+
+    void testExpiredTicketsAreNotUsed()
+    {
+        QTemporaryDir dir;
+        QString fileName = dir.path() + "/tls_sessions.json";
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QJsonObject entry;
+        entry.insert("ticket", QString::fromLatin1(QByteArray("old").toBase64()));
+        entry.insert("expires", double(QDateTime::currentDateTimeUtc().addSecs(-10).toMSecsSinceEpoch()));
+        QJsonObject hosts;
+        hosts.insert("example.com:443 account1", entry);
+        file.write(QJsonDocument(hosts).toJson());
+        file.close();
+
+        TlsSessionCache cache(fileName);
+        QVERIFY(cache.ticket(QUrl("https://example.com/"), "account1").isEmpty());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestTlsSessionCache)
+#include "testtlssessioncache.moc"
@@ -0,0 +1,99 @@
+/*
+ *    This software is in the public domain, furnished "as is", without technical
+ *    support, and with no warranty, express or implied, as to its usefulness for
+ *    any purpose.
+ *
+ */
+
+#include <QtTest>
+#include <QTemporaryDir>
+
+#include "tracelog.h"
+
+using namespace OCC;
+
+class TestTraceLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRoundTrip()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.path() + "/trace.bin";
+
+        auto traceLog = TraceLog::instance();
+        QVERIFY(!traceLog->isActive());
+        traceLog->event("ignored while inactive");
+
+        QVERIFY(traceLog->start(fileName));
+        QVERIFY(traceLog->isActive());
+        traceLog->message(QtWarningMsg, "sync.test", QStringLiteral("hello wörld"));
+        traceLog->event("propagation", QStringLiteral("A/a1"), "PropagateDownloadFile", 1234, 56);
+        traceLog->stop();
+        QVERIFY(!traceLog->isActive());
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QVector<TraceRecord> records;
+        QVERIFY(readTraceLog(&file, [&](const TraceRecord &r) { records.append(r); }));
+        QCOMPARE(records.size(), 2);
+
+        QCOMPARE(records[0]._kind, TraceRecord::Message);
+        QCOMPARE(records[0]._msgType, quint8(QtWarningMsg));
+        QCOMPARE(records[0]._name, QByteArray("sync.test"));
+        QCOMPARE(records[0]._message, QStringLiteral("hello wörld"));
+        QVERIFY(records[0]._timestamp > 0);
+
+        QCOMPARE(records[1]._kind, TraceRecord::Event);
+        QCOMPARE(records[1]._name, QByteArray("propagation"));
+        QCOMPARE(records[1]._file, QStringLiteral("A/a1"));
+        QCOMPARE(records[1]._job, QByteArray("PropagateDownloadFile"));
+        QCOMPARE(records[1]._bytes, qint64(1234));
+        QCOMPARE(records[1]._duration, qint64(56));
+        QVERIFY(records[1]._timestamp >= records[0]._timestamp);
+
+        QVERIFY(records[1].toText().contains("file=A/a1 job=PropagateDownloadFile bytes=1234 duration=56ms"));
+        auto json = QJsonDocument::fromJson(records[1].toJson()).object();
+        QCOMPARE(json["event"].toString(), QStringLiteral("propagation"));
+        QCOMPARE(json["bytes"].toInt(), 1234);
+    }
+
+    void testOverflow()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.path() + "/trace.bin";
+
+        auto traceLog = TraceLog::instance();
+        traceLog->setCapacity(16);
+        QVERIFY(traceLog->start(fileName));
+        // The writer may or may not keep up, but nothing may get lost silently
+        for (int i = 0; i < 10000; ++i)
+            traceLog->event("spam", QString(), QByteArray(), i);
+        traceLog->stop();
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        qint64 written = 0;
+        qint64 dropped = 0;
+        QVERIFY(readTraceLog(&file, [&](const TraceRecord &r) {
+            if (r._name == "trace.dropped")
+                dropped += r._bytes;
+            else
+                ++written;
+        }));
+        QCOMPARE(written + dropped, qint64(10000));
+        traceLog->setCapacity(64 * 1024);
+    }
+
+    void testNotATraceLog()
+    {
+        QBuffer buffer;
+        buffer.setData("12-01 10:00:00:000 [ info sync.engine ]: text log");
+        buffer.open(QIODevice::ReadOnly);
+        QVERIFY(!readTraceLog(&buffer, [](const TraceRecord &) {}));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestTraceLog)
+#include "testtracelog.moc"
@@ -123,6 +123,65 @@ private slots:
         QVERIFY(_subdirs.size() == 1);
     }
 
+    void testParserIncremental() {
+        const QByteArray testXml = "<?xml version='1.0' encoding='utf-8'?>"
+              "<d:multistatus xmlns:d=\"DAV:\" xmlns:s=\"http://sabredav.org/ns\" xmlns:oc=\"http://owncloud.org/ns\">"
+              "<d:response>"
+              "<d:href>/oc/remote.php/webdav/sharefolder/</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004213ocobzus5kn6s</oc:id>"
+              "<oc:size>121780</oc:size>"
+              "<d:resourcetype>"
+              "<d:collection/>"
+              "</d:resourcetype>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "<d:response>"
+              "<d:href>/oc/remote.php/webdav/sharefolder/quitte.pdf</d:href>"
+              "<d:propstat>"
+              "<d:prop>"
+              "<oc:id>00004215ocobzus5kn6s</oc:id>"
+              "<d:resourcetype/>"
+              "<d:getcontentlength>121780</d:getcontentlength>"
+              "</d:prop>"
+              "<d:status>HTTP/1.1 200 OK</d:status>"
+              "</d:propstat>"
+              "</d:response>"
+              "</d:multistatus>";
+
+        LsColXMLParser parser;
+
+        connect( &parser, SIGNAL(directoryListingSubfolders(const QStringList&)),
+                 this, SLOT(slotDirectoryListingSubFolders(const QStringList&)) );
+        connect( &parser, SIGNAL(directoryListingIterated(const QString&, const QMap<QString,QString>&)),
+                 this, SLOT(slotDirectoryListingIterated(const QString&, const QMap<QString,QString>&)) );
+        connect( &parser, SIGNAL(finishedWithoutError()),
+                 this, SLOT(slotFinishedSuccessfully()) );
+
+        // The data arrives a few bytes at a time, split in the middle of elements
+        QHash <QString, qint64> sizes;
+        parser.start(&sizes, "/oc/remote.php/webdav/sharefolder");
+        const QByteArray endTag = "</d:response>";
+        int firstEnd = testXml.indexOf(endTag) + endTag.size();
+        int lastEnd = testXml.lastIndexOf(endTag) + endTag.size();
+        for (int i = 0; i < testXml.size(); i += 7) {
+            QVERIFY(parser.addData(testXml.mid(i, 7)));
+            // Each entry is emitted as soon as it is complete
+            int received = qMin(i + 7, testXml.size());
+            QCOMPARE(_items.size(), received >= lastEnd ? 2 : received >= firstEnd ? 1 : 0);
+        }
+        QVERIFY(!_success);
+        QVERIFY(parser.finish());
+
+        QVERIFY(_success);
+        QCOMPARE(sizes.size(), 1);
+        QCOMPARE(_items, QStringList({ "/oc/remote.php/webdav/sharefolder", "/oc/remote.php/webdav/sharefolder/quitte.pdf" }));
+        QCOMPARE(_subdirs, QStringList({ "/oc/remote.php/webdav/sharefolder/" }));
+    }
+
     void testParserBrokenXml() {
         const QByteArray testXml = "X<?xml version='1.0' encoding='utf-8'?>"
               "<d:multistatus xmlns:d=\"DAV:\" xmlns:s=\"http://sabredav.org/ns\" xmlns:oc=\"http://owncloud.org/ns\">"